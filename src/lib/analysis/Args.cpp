@@ -102,6 +102,11 @@ Args::Ctor()
   doNormalizeTy = true;
 
   prof_metrics = Analysis::Args::MetricFlg_NULL;
+  prof_pruneThreshold = 0.0;
+  prof_distribute = Analysis::Args::Distribute_Size;
+  prof_numThreads = 1;
+  prof_pipeline = false;
+  prof_checkpointDir = "";
 
   profflat_computeFinalMetricValues = true;
 
@@ -113,9 +118,16 @@ Args::Ctor()
   out_db_csv        = "";
   db_dir            = Analysis_DB_DIR_pfx "-" Analysis_DB_DIR_nm;
   db_copySrcFiles   = true;
+  db_update         = false;
+  db_updatable      = false;
   out_db_config     = "";
   db_makeMetricDB   = false;
+  db_metricDBSparse = false;
+  db_metricDBNodeIdx = false;
+  db_metricDBShared = false;
+  db_makeViewDB = false;
   db_addStructId    = false;
+  out_phaseTimes    = "";
 
   out_txt           = Analysis_OUT_TXT;
   txt_summary       = TxtSum_NULL;
@@ -202,6 +214,15 @@ Args::normalizeSearchPaths()
 void
 Args::makeDatabaseDir()
 {
+  if (db_update) {
+    // reuse the existing database
+    if (!FileUtil::isDir(db_dir)) {
+      DIAG_Throw("database '" << db_dir << "' does not exist");
+    }
+    db_dir = RealPath(db_dir.c_str());
+    return;
+  }
+
   // prepare output directory (N.B.: chooses a unique name!)
   string dir = db_dir; // make copy
   std::pair<string, bool> ret =
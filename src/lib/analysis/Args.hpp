@@ -127,6 +127,10 @@ public:
   // Structure files
   std::vector<std::string> structureFiles;
 
+  // Cache for load modules without structure files; disable: ""
+  // (cf. --lm-cache)
+  std::string lmCacheDir;
+
   // Static analysis files
   std::vector<std::string> instructionFiles;
 
@@ -189,6 +193,32 @@ public:
 
   uint prof_metrics;
 
+  // drop CCT subtrees below this fraction of each profile's total
+  // while reading; disable: 0.0 (cf. --prune-threshold)
+  double prof_pruneThreshold;
+
+  // hpcprof-mpi: how measurement files are assigned to processes
+  // (cf. --distribute)
+  enum Distribute {
+    Distribute_Size,  // balance the on-disk bytes read by each process
+    Distribute_Queue  // processes fetch files from rank 0 as they finish
+  };
+
+  Distribute prof_distribute;
+
+  // threads per process for whole-CCT passes; hpcprof-mpi: also worker
+  // threads for reading profiles and making metrics (cf. --threads)
+  uint prof_numThreads;
+
+  // hpcprof-mpi: merge children's profiles in the reduction tree as
+  // they arrive, while still reading local files (cf. --pipeline)
+  bool prof_pipeline;
+
+  // hpcprof-mpi: directory for each process's partial profile and
+  // summary metrics, from which a restarted run resumes; disable: ""
+  // (cf. --checkpoint)
+  std::string prof_checkpointDir;
+
   // TODO: Currently this is always true even though we only need to
   // compute final metric values for (1) hpcproftt (flat) and (2)
   // hpcprof-flat when it computes derived metrics.  However, at the
@@ -201,6 +231,10 @@ public:
 
 #define Analysis_OUT_DB_EXPERIMENT "experiment.xml"
 #define Analysis_OUT_DB_CSV        "experiment.csv"
+#define Analysis_OUT_DB_CCT        "experiment.cct"       // cf. --update
+#define Analysis_OUT_DB_CCT_FILES  "experiment.cct-files" // cf. --update
+#define Analysis_OUT_DB_VIEWS      "experiment.views"     // cf. --view-db
+#define Analysis_OUT_DB_METRICS    "experiment.metricdb"  // cf. --metric-db
 
 #define Analysis_DB_DIR_pfx        "hpctoolkit"
 #define Analysis_DB_DIR_nm         "database"
@@ -212,12 +246,20 @@ public:
 
   std::string db_dir;            // disable: ""
   bool db_copySrcFiles;
+  bool db_update;                // update the existing database 'db_dir'
+  bool db_updatable;             // save state for a later 'db_update'
 
   std::string out_db_config;     // disable: "", stdout: "-"
 
   bool db_makeMetricDB;
+  bool db_metricDBSparse;        // sparse (node, metric, value) entries
+  bool db_metricDBNodeIdx;       // sparse: add a per-node index
+  bool db_metricDBShared;        // one file for all threads (MPI-IO)
+  bool db_makeViewDB;            // precomputed Flat and Callers views
   bool db_addStructId;
 
+  std::string out_phaseTimes;    // disable: "" (cf. PhaseTimer)
+
   // -------------------------------------------------------
   // Output arguments: textual output
   // -------------------------------------------------------
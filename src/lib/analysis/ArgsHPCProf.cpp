@@ -129,6 +129,10 @@ Options: Source Code and Static Structure:\n\
   -S <file>, --structure <file>\n\
                        Use hpcstruct structure file <file> for correlation.\n\
                        May pass multiple times (e.g., for shared libraries).\n\
+  --lm-cache <dir>     For load modules without a structure file, save the\n\
+                       procedures and source lines read from the binary in\n\
+                       cache directory <dir>, keyed by build-id or content\n\
+                       hash, and reuse them in later runs.\n\
   -R '<old-path>=<new-path>', --replace-path '<old-path>=<new-path>'\n\
                        Substitute instances of <old-path> with <new-path>;\n\
                        apply to all paths (profile's load map, source code)\n\
@@ -154,18 +158,79 @@ Options: Output:\n\
                        Specify Experiment database name <db-path>.\n\
                        {./" Analysis_DB_DIR "}";
 
+static const char* usage_details_prof = "\n\
+  --updatable          Save the canonical CCT (experiment.cct) so that a\n\
+                       later --update can extend the database.\n\
+  --update <db-path>   Update the existing Experiment database <db-path>\n\
+                       with the measurement files that it does not yet\n\
+                       contain.  Only new files are read; the database's\n\
+                       saved canonical CCT supplies the rest.  <db-path>\n\
+                       must have been created with --updatable.  Pass\n\
+                       measurement-groups in their original order.\n\
+  --threads <n>        Use <n> threads to compute metrics and write\n\
+                       experiment.xml. {1}\n\
+  --phase-times <file> Write the wall-clock time of each analysis phase\n\
+                       (read, merge, trace, overlay, metrics, prune, write,\n\
+                       cleanup, total) to <file> as comma-separated\n\
+                       'phase,seconds' lines.\n\
+  --prune-threshold <frac>\n\
+                       While reading each measurement file, drop the CCT\n\
+                       subtrees whose inclusive value for every metric is\n\
+                       less than <frac> (0 <= <frac> < 1) of that file's\n\
+                       total, e.g., 0.0001.  Dropped values are kept in a\n\
+                       synthetic child of the subtree's parent; subtrees\n\
+                       referenced by traces are kept. {0: disabled}";
+
 static const char* usage_details_2 = "\n\
-  --metric-db <yes|no>\n\
+  --metric-db <yes|no|sparse|shared>\n\
                        Control whether to generate a thread-level metric\n\
-                       value database for hpcviewer scatter plots. {no}";
+                       value database for hpcviewer scatter plots. With\n\
+                       'sparse', write only non-zero values. With 'shared',\n\
+                       write the databases of all threads, with an index,\n\
+                       to the single file " Analysis_OUT_DB_METRICS " using\n\
+                       collective MPI-IO. {no}\n\
+  --metric-db-index    With '--metric-db sparse', add a per-node index to\n\
+                       each thread's metric database.";
 
 static const char* usage_details_3 = "\n\
+  --view-db            Also write the Flat and Callers views, computed from\n\
+                       the summary metrics, to " Analysis_OUT_DB_VIEWS " so that\n\
+                       a viewer need not compute them from the whole CCT.\n\
   --remove-redundancy \n\
                        Eliminate procedure name redundancy in experiment.xml\n\
   --struct-id          Add 'str=nnn' field to profile data with the hpcstruct\n\
                        node id (for debug, default no).\n\
 ";
 
+static const char* usage_details_mpi = "\n\
+Options: Parallel:\n\
+  --distribute <size|queue>\n\
+                       Assign measurement files to processes so that each\n\
+                       reads about the same number of bytes ('size'), or\n\
+                       let processes fetch one file at a time from rank 0\n\
+                       as they finish ('queue').  With 'queue', rank 0 only\n\
+                       hands out files; it requires a single measurement\n\
+                       group and otherwise falls back to 'size'. {size}\n\
+  --threads <n>        Use <n> worker threads in each process to read and\n\
+                       merge its measurement files and to make their\n\
+                       summary and thread-level metrics, and as many to\n\
+                       compute metrics over the canonical CCT. {1}\n\
+  --pipeline           Merge the profiles of a process's children in the\n\
+                       reduction tree as they arrive, while it still reads\n\
+                       its own files.  Requires a single measurement group\n\
+                       and '--distribute size'.\n\
+  --checkpoint <dir>   Save each process's partial profile and summary\n\
+                       metrics in <dir> as it finishes them.  A run with\n\
+                       the same files, number of processes and <dir>\n\
+                       resumes from them instead of reading the files and\n\
+                       reducing them again.  Requires '--distribute size'.\n\
+  --phase-times <file> Write one comma-separated line per process to <file>\n\
+                       with the wall-clock time of each phase (read, merge,\n\
+                       reduce, broadcast, overlay, summary, prune, thread,\n\
+                       write, total), the bytes it sent and received, and\n\
+                       its peak resident memory in KB.\n\
+";
+
 
 
 #define CLP CmdLineParser
@@ -190,6 +255,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   { 'S', "structure",       CLP::ARG_REQ,  CLP::DUPOPT_CAT,  CLP_SEPARATOR,
      NULL },
+  {  0 , "lm-cache",        CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
   { 'R', "replace-path",    CLP::ARG_REQ,  CLP::DUPOPT_CAT,  CLP_SEPARATOR,
      NULL},
 
@@ -201,16 +268,36 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   {  0 , "force-metric",    CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "prune-threshold", CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "distribute",      CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "threads",         CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "pipeline",        CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "checkpoint",      CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // Output options
   { 'o', "output",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
      NULL },
   {  0 , "db",              CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "update",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "updatable",       CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "phase-times",     CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
+     NULL },
   {  0 , "metric-db",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "metric-db-index", CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
   {  0 , "struct-id",       CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "view-db",         CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // General
   { 'v', "verbose",         CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL,
@@ -277,7 +364,7 @@ void
 ArgsHPCProf::printUsageProf(std::ostream& os) const
 {
   os << "Usage: " << getCmd() << " " << usage_summary << endl
-     << usage_details << usage_details_3 << endl;
+     << usage_details << usage_details_prof << usage_details_3 << endl;
 } 
 
 
@@ -285,7 +372,8 @@ void
 ArgsHPCProf::printUsageProfMPI(std::ostream& os) const
 {
   os << "Usage: " << getCmd() << " " << usage_summary << endl
-     << usage_details << usage_details_2 << usage_details_3 << endl;
+     << usage_details << usage_details_2 << usage_details_3
+     << usage_details_mpi << endl;
 } 
 
 
@@ -414,6 +502,9 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       string str = parser.getOptArg("structure");
       StrUtil::tokenize_str(str, CLP_SEPARATOR, structureFiles);
     }
+    if (parser.isOpt("lm-cache")) {
+      lmCacheDir = parser.getOptArg("lm-cache");
+    }
     if (parser.isOpt("normalize")) { 
       const string& arg = parser.getOptArg("normalize");
       doNormalizeTy = parseArg_norm(arg, "--normalize/-N option");
@@ -452,6 +543,52 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       }
     }
     // N.B.: hpcprof checks for "force-metric": src/tool/hpcprof/Args.cpp
+    if (parser.isOpt("prune-threshold")) {
+      if (type == AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--prune-threshold is not supported by hpcprof-mpi");
+      }
+      const string& arg = parser.getOptArg("prune-threshold");
+      prof_pruneThreshold = CmdLineParser::toDbl(arg);
+      if (!(prof_pruneThreshold >= 0.0 && prof_pruneThreshold < 1.0)) {
+	ARG_ERROR("--prune-threshold: Unexpected value received: '"
+		  << arg << "'");
+      }
+    }
+    if (parser.isOpt("distribute")) {
+      if (type != AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--distribute is only supported by hpcprof-mpi");
+      }
+      const string& arg = parser.getOptArg("distribute");
+      if (arg == "size") {
+	prof_distribute = Analysis::Args::Distribute_Size;
+      }
+      else if (arg == "queue") {
+	prof_distribute = Analysis::Args::Distribute_Queue;
+      }
+      else {
+	ARG_ERROR("--distribute: Unexpected value received: '" << arg << "'");
+      }
+    }
+    if (parser.isOpt("threads")) {
+      const string& arg = parser.getOptArg("threads");
+      long numThreads = CmdLineParser::toLong(arg);
+      if (numThreads <= 0) {
+	ARG_ERROR("--threads: Unexpected value received: '" << arg << "'");
+      }
+      prof_numThreads = (uint)numThreads;
+    }
+    if (parser.isOpt("pipeline")) {
+      if (type != AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--pipeline is only supported by hpcprof-mpi");
+      }
+      prof_pipeline = true;
+    }
+    if (parser.isOpt("checkpoint")) {
+      if (type != AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--checkpoint is only supported by hpcprof-mpi");
+      }
+      prof_checkpointDir = parser.getOptArg("checkpoint");
+    }
     
     // Check for other options: Output options
     bool isDbDirSet = false;
@@ -463,13 +600,50 @@ ArgsHPCProf::parse(int argc, const char* const argv[], AppType type)
       db_dir = parser.getOptArg("db");
       isDbDirSet = true;
     }
+    if (parser.isOpt("update")) {
+      if (type == AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--update is not supported by hpcprof-mpi");
+      }
+      if (isDbDirSet) {
+	ARG_ERROR("--update and --db/--output are mutually exclusive");
+      }
+      db_dir = parser.getOptArg("update");
+      db_update = true;
+      db_updatable = true;
+      isDbDirSet = true;
+    }
+    if (parser.isOpt("updatable")) {
+      if (type == AppType::APP_HPCPROF_MPI) {
+	ARG_ERROR("--updatable is not supported by hpcprof-mpi");
+      }
+      db_updatable = true;
+    }
+    if (parser.isOpt("phase-times")) {
+      out_phaseTimes = parser.getOptArg("phase-times");
+    }
     if (parser.isOpt("metric-db")) {
       const string& arg = parser.getOptArg("metric-db");
-      db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
+      if (arg == "sparse") {
+	db_makeMetricDB = true;
+	db_metricDBSparse = true;
+      }
+      else if (arg == "shared") {
+	db_makeMetricDB = true;
+	db_metricDBShared = true;
+      }
+      else {
+	db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
+      }
+    }
+    if (parser.isOpt("metric-db-index")) {
+      db_metricDBNodeIdx = true;
     }
     if (parser.isOpt("struct-id")) {
       db_addStructId = true;
     }
+    if (parser.isOpt("view-db")) {
+      db_makeViewDB = true;
+    }
 
     // Check for required arguments
     uint numArgs = parser.getNumArgs();
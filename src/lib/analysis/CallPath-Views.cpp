@@ -0,0 +1,694 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <typeinfo>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "CallPath-Views.hpp"
+
+#include <lib/prof/CCT-Tree.hpp>
+#include <lib/prof/Metric-Mgr.hpp>
+#include <lib/prof/Metric-ADesc.hpp>
+#include <lib/prof/Metric-AExprIncr.hpp>
+#include <lib/prof/Struct-Tree.hpp>
+
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcio.h>
+
+#include <lib/support/diagnostics.h>
+
+//*************************** Forward Declarations ***************************
+
+static const char HPCVIEWDB_FMT_Magic[]   = "HPCPROF-viewdb____"; // 18 bytes
+static const char HPCVIEWDB_FMT_Version[] = "01.00";              // 5 bytes
+static const char HPCVIEWDB_FMT_Endian[]  = "b";                  // 1 byte
+
+#define HPCVIEWDB_FMT_HeaderLen   (18 + 5 + 1 + 4 + 4 + 4)
+#define HPCVIEWDB_FMT_SectionLen  (4 + 8)
+#define HPCVIEWDB_FMT_NodeLen     (4 + 4 + 4 + 4 + 4 + 8 + 4)
+#define HPCVIEWDB_FMT_ValueLen    (4 + 8)
+
+#define HPCVIEWDB_FMT_MaxCallers  8 // levels below the Callers view's root
+
+enum {
+  HPCVIEWDB_FMT_FlatView    = 1,
+  HPCVIEWDB_FMT_CallersView = 2
+};
+
+
+//***************************************************************************
+// ViewTree
+//***************************************************************************
+
+namespace {
+
+// ViewTree: A tree of view nodes, each with its non-zero metric values.
+// Nodes are created on demand, keyed by (parent, structId,
+// callSiteId).
+class ViewTree {
+public:
+  // (metric index, value) pairs in increasing metric index order
+  typedef std::vector<std::pair<uint, double> > Values;
+
+  ViewTree()
+  {
+    m_nodes.push_back(Node(0, 0, 0));
+    m_active.push_back(0);
+  }
+
+  uint
+  size() const
+  { return m_nodes.size(); }
+
+  uint
+  demandChild(uint parent, uint structId, uint callSiteId)
+  {
+    Key key(parent, structId, callSiteId);
+    KeyMap::iterator it = m_keyToNode.find(key);
+    if (it != m_keyToNode.end()) {
+      return it->second;
+    }
+
+    uint idx = m_nodes.size();
+    m_nodes.push_back(Node(parent, structId, callSiteId));
+    m_nodes[parent].children.push_back(idx);
+    m_active.push_back(0);
+    m_keyToNode.insert(std::make_pair(key, idx));
+    return idx;
+  }
+
+  void
+  rootStructId(uint structId)
+  { m_nodes[0].structId = structId; }
+
+  // addValue: add 'val' to metric 'j' of 'idx'
+  void
+  addValue(uint idx, uint j, double val)
+  {
+    Values& x = m_nodes[idx].values;
+    if (x.empty() || x.back().first < j) {
+      x.push_back(std::make_pair(j, val)); // common case
+      return;
+    }
+    Values::iterator it =
+      std::lower_bound(x.begin(), x.end(), std::make_pair(j, -HUGE_VAL));
+    if (it != x.end() && it->first == j) {
+      it->second += val;
+    }
+    else {
+      x.insert(it, std::make_pair(j, val));
+    }
+  }
+
+  // active: the number of enclosing CCT nodes (on the path from the
+  // CCT root) that already contribute to the inclusive values of
+  // 'idx'
+  uint&
+  active(uint idx)
+  { return m_active[idx]; }
+
+  // sectionSize: the number of bytes write() writes
+  uint64_t
+  sectionSize() const;
+
+  // write: write the tree as a section that begins at 'sectionOff'
+  int
+  write(FILE* fs, uint64_t sectionOff, uint mBegId);
+
+private:
+  struct Node {
+    Node(uint parent_, uint structId_, uint callSiteId_)
+      : parent(parent_), structId(structId_), callSiteId(callSiteId_)
+    { }
+
+    uint parent, structId, callSiteId;
+    std::vector<uint> children;
+    Values values;
+  };
+
+  struct Key {
+    Key(uint parent_, uint structId_, uint callSiteId_)
+      : parent(parent_), structId(structId_), callSiteId(callSiteId_)
+    { }
+
+    bool
+    operator==(const Key& x) const
+    {
+      return (parent == x.parent && structId == x.structId
+	      && callSiteId == x.callSiteId);
+    }
+
+    uint parent, structId, callSiteId;
+  };
+
+  struct KeyHash {
+    size_t
+    operator()(const Key& x) const
+    {
+      uint64_t h = ((uint64_t)x.parent << 32) ^ x.structId;
+      h = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+      h ^= (uint64_t)x.callSiteId * 0x94d049bb133111ebULL;
+      return (size_t)(h ^ (h >> 31));
+    }
+  };
+
+  typedef std::unordered_map<Key, uint, KeyHash> KeyMap;
+
+  struct ChildLt {
+    ChildLt(const std::vector<Node>& nodes)
+      : m_nodes(nodes)
+    { }
+
+    bool
+    operator()(uint x, uint y) const
+    {
+      const Node& x_n = m_nodes[x];
+      const Node& y_n = m_nodes[y];
+      return (x_n.structId < y_n.structId
+	      || (x_n.structId == y_n.structId
+		  && x_n.callSiteId < y_n.callSiteId));
+    }
+
+    const std::vector<Node>& m_nodes;
+  };
+
+  uint64_t
+  numValues(uint idx) const
+  {
+    const Values& x = m_nodes[idx].values;
+    uint64_t n = 0;
+    for (uint i = 0; i < x.size(); ++i) {
+      n += (x[i].second != 0.0);
+    }
+    return n;
+  }
+
+  std::vector<Node> m_nodes;
+  std::vector<uint> m_active;
+  KeyMap m_keyToNode;
+};
+
+
+uint64_t
+ViewTree::sectionSize() const
+{
+  uint64_t sz = 4 + (uint64_t)m_nodes.size() * HPCVIEWDB_FMT_NodeLen;
+  for (uint i = 0; i < m_nodes.size(); ++i) {
+    sz += numValues(i) * HPCVIEWDB_FMT_ValueLen;
+  }
+  return sz;
+}
+
+
+int
+ViewTree::write(FILE* fs, uint64_t sectionOff, uint mBegId)
+{
+  // -------------------------------------------------------
+  // number nodes breadth-first; order children by (structId, callSiteId)
+  // -------------------------------------------------------
+  std::vector<uint> order;
+  std::vector<uint> newId(m_nodes.size());
+  std::vector<uint> firstChild(m_nodes.size());
+
+  order.reserve(m_nodes.size());
+  order.push_back(0);
+  for (uint i = 0; i < order.size(); ++i) {
+    uint idx = order[i];
+    newId[idx] = i;
+    firstChild[idx] = order.size();
+
+    std::vector<uint>& children = m_nodes[idx].children;
+    std::sort(children.begin(), children.end(), ChildLt(m_nodes));
+    order.insert(order.end(), children.begin(), children.end());
+  }
+
+  // -------------------------------------------------------
+  // node records
+  // -------------------------------------------------------
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(order.size(), fs));
+
+  uint64_t valuesOff = sectionOff + 4
+    + (uint64_t)order.size() * HPCVIEWDB_FMT_NodeLen;
+
+  for (uint i = 0; i < order.size(); ++i) {
+    const Node& n = m_nodes[order[i]];
+    uint64_t nValues = numValues(order[i]);
+    uint parent = (i == 0) ? 0 : newId[n.parent];
+
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(parent, fs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(n.structId, fs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(n.callSiteId, fs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(firstChild[order[i]], fs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(n.children.size(), fs));
+    HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(valuesOff, fs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(nValues, fs));
+
+    valuesOff += nValues * HPCVIEWDB_FMT_ValueLen;
+  }
+
+  // -------------------------------------------------------
+  // values
+  // -------------------------------------------------------
+  for (uint i = 0; i < order.size(); ++i) {
+    const Values& values = m_nodes[order[i]].values;
+    for (uint k = 0; k < values.size(); ++k) {
+      if (values[k].second != 0.0) {
+	HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(mBegId + values[k].first, fs));
+	HPCFMT_ThrowIfError(hpcfmt_real8_fwrite(values[k].second, fs));
+      }
+    }
+  }
+
+  return HPCFMT_OK;
+}
+
+} // namespace
+
+
+//***************************************************************************
+// Building the views
+//***************************************************************************
+
+namespace {
+
+// ViewBuilder: Walk the CCT once and accumulate the Flat and Callers
+// views.  Each chain is a stack of view nodes: the nodes that the CCT
+// node being visited contributes to, for each enclosing CCT node.
+class ViewBuilder {
+public:
+  ViewBuilder(const Prof::CallPath::Profile& prof, uint mBegId, uint mEndId)
+    : m_mBegId(mBegId), m_mEndId(mEndId)
+  {
+    const Prof::Metric::Mgr& mMgr = *prof.metricMgr();
+    for (uint mId = mBegId; mId < mEndId; ++mId) {
+      m_kind.push_back(kind(mMgr.metric(mId)));
+    }
+
+    const Prof::Struct::Root* root = prof.structure()->root();
+    m_flat.rootStructId(root->id());
+    m_strctToFlat.insert(std::make_pair(root, 0));
+
+    visit(prof.cct()->root());
+  }
+
+  ViewTree&
+  flat()
+  { return m_flat; }
+
+  ViewTree&
+  callers()
+  { return m_callers; }
+
+private:
+  enum Kind { KindNone, KindIncl, KindExcl };
+
+  // kind: only raw and summed metrics add up over CCT nodes; others
+  // (derived, mean, min, max, ...) get no view values
+  static Kind
+  kind(const Prof::Metric::ADesc* m)
+  {
+    using namespace Prof;
+
+    bool isAdditive = (dynamic_cast<const Metric::SampledDesc*>(m) != NULL);
+    const Metric::DerivedIncrDesc* mDrvdIncr =
+      dynamic_cast<const Metric::DerivedIncrDesc*>(m);
+    if (mDrvdIncr && mDrvdIncr->expr()
+	&& typeid(*mDrvdIncr->expr()) == typeid(Metric::SumIncr)) {
+      isAdditive = true;
+    }
+
+    if (!isAdditive) {
+      return KindNone;
+    }
+    return (m->type() == Metric::ADesc::TyIncl) ? KindIncl
+      : (m->type() == Metric::ADesc::TyExcl) ? KindExcl : KindNone;
+  }
+
+  void
+  visit(const Prof::CCT::ANode* root);
+
+  void
+  enter(const Prof::CCT::ANode* n);
+
+  void
+  leave();
+
+  uint
+  demandFlat(const Prof::Struct::ANode* strct);
+
+  // add the values of 'n' to view node 'idx' of 'tree'
+  void
+  addValues(ViewTree& tree, uint idx, const Prof::CCT::ANode* n,
+	    bool doIncl, bool doExcl)
+  {
+    uint mEndId = std::min(m_mEndId, n->numMetrics());
+    for (uint mId = m_mBegId; mId < mEndId; ++mId) {
+      uint j = mId - m_mBegId;
+      if ((m_kind[j] == KindIncl && doIncl)
+	  || (m_kind[j] == KindExcl && doExcl)) {
+	double val = n->metric(mId);
+	if (val != 0.0) {
+	  tree.addValue(idx, j, val);
+	}
+      }
+    }
+  }
+
+private:
+  struct Frame {
+    uint procId;
+    uint callSiteId;
+  };
+
+  // Visit: a CCT node being visited and the extent of its chains
+  struct Visit {
+    const Prof::CCT::ANode* node;
+    const Prof::CCT::ANode* nextChild;
+    size_t flatBeg, flatEnd;
+    size_t callersBeg, callersEnd;
+    bool isFrame;
+  };
+
+  ViewTree m_flat;
+  ViewTree m_callers;
+
+  uint m_mBegId, m_mEndId;
+  std::vector<Kind> m_kind;
+
+  std::unordered_map<const Prof::Struct::ANode*, uint> m_strctToFlat;
+
+  std::vector<uint> m_flatChain;    // N.B.: stacks; cf. visit()
+  std::vector<uint> m_callersChain;
+  std::vector<Frame> m_frames;
+  std::vector<Visit> m_visits;
+};
+
+
+uint
+ViewBuilder::demandFlat(const Prof::Struct::ANode* strct)
+{
+  if (!strct) {
+    return 0; // not below the profile's root; should not happen
+  }
+
+  std::unordered_map<const Prof::Struct::ANode*, uint>::iterator it =
+    m_strctToFlat.find(strct);
+  if (it != m_strctToFlat.end()) {
+    return it->second;
+  }
+
+  uint parent = demandFlat(strct->parent());
+  uint idx = m_flat.demandChild(parent, strct->id(), 0);
+  m_strctToFlat.insert(std::make_pair(strct, idx));
+  return idx;
+}
+
+
+// visit: visit the descendants of 'root' in pre-order (iteratively;
+// call chains can be very deep)
+void
+ViewBuilder::visit(const Prof::CCT::ANode* root)
+{
+  Visit v;
+  v.node = root;
+  v.nextChild = root->firstChild();
+  v.flatBeg = v.flatEnd = v.callersBeg = v.callersEnd = 0;
+  v.isFrame = false;
+  m_visits.push_back(v);
+
+  while (m_visits.size() > 1 || m_visits.back().nextChild) {
+    const Prof::CCT::ANode* n = m_visits.back().nextChild;
+    if (n) {
+      m_visits.back().nextChild = n->nextSibling();
+      enter(n);
+    }
+    else {
+      leave();
+    }
+  }
+  m_visits.pop_back();
+}
+
+
+// enter: add 'n' to its view nodes and make them the chains of the
+// descendants of 'n'
+void
+ViewBuilder::enter(const Prof::CCT::ANode* n)
+{
+  using namespace Prof;
+
+  const Struct::ACodeNode* strct = n->structure();
+
+  Visit v;
+  v.node = n;
+  v.nextChild = n->firstChild();
+
+  // -------------------------------------------------------
+  // Flat view: the chain is the static structure from 'strct' to the
+  // root
+  // -------------------------------------------------------
+  v.flatBeg = m_flatChain.size();
+  if (strct) {
+    bool isStmt = (typeid(*n) == typeid(CCT::Stmt));
+    bool isInProc = true; // exclusive values stop at the innermost proc
+
+    for (const Struct::ANode* x = strct; x; x = x->parent()) {
+      uint idx = demandFlat(x);
+      Struct::ANode::ANodeTy ty = x->type();
+      bool isContainer = (ty == Struct::ANode::TyRoot
+			  || ty == Struct::ANode::TyGroup
+			  || ty == Struct::ANode::TyLM
+			  || ty == Struct::ANode::TyFile);
+
+      addValues(m_flat, idx, n, m_flat.active(idx) == 0,
+		isStmt && (isInProc || isContainer));
+      m_flatChain.push_back(idx);
+
+      if (ty == Struct::ANode::TyProc || ty == Struct::ANode::TyAlien) {
+	isInProc = false;
+      }
+    }
+  }
+  v.flatEnd = m_flatChain.size();
+
+  // -------------------------------------------------------
+  // Callers view: the chain is the procedure and then each caller, up
+  // to HPCVIEWDB_FMT_MaxCallers levels
+  // -------------------------------------------------------
+  v.callersBeg = m_callersChain.size();
+  v.isFrame = (strct && dynamic_cast<const CCT::AProcNode*>(n));
+  if (v.isFrame) {
+    const CCT::ANode* n_parent = n->parent();
+    Frame frame;
+    frame.procId = strct->id();
+    frame.callSiteId = 0;
+    if (n_parent && typeid(*n_parent) == typeid(CCT::Call)
+	&& n_parent->structure()) {
+      frame.callSiteId = n_parent->structure()->id();
+    }
+    m_frames.push_back(frame);
+
+    size_t iEnd = (m_frames.size() > HPCVIEWDB_FMT_MaxCallers)
+      ? m_frames.size() - HPCVIEWDB_FMT_MaxCallers : 0;
+    uint idx = m_callers.demandChild(0, frame.procId, 0);
+    for (size_t i = m_frames.size() - 1; /* */; --i) {
+      addValues(m_callers, idx, n, m_callers.active(idx) == 0, true);
+      m_callersChain.push_back(idx);
+      if (i == iEnd) {
+	break;
+      }
+      idx = m_callers.demandChild(idx, m_frames[i - 1].procId,
+				  m_frames[i].callSiteId);
+    }
+  }
+  v.callersEnd = m_callersChain.size();
+
+  // -------------------------------------------------------
+  // The chains' nodes contribute to the descendants' nodes
+  // -------------------------------------------------------
+  for (size_t i = v.flatBeg; i < v.flatEnd; ++i) {
+    m_flat.active(m_flatChain[i])++;
+  }
+  for (size_t i = v.callersBeg; i < v.callersEnd; ++i) {
+    m_callers.active(m_callersChain[i])++;
+  }
+
+  m_visits.push_back(v);
+}
+
+
+// leave: undo enter() for the innermost node being visited
+void
+ViewBuilder::leave()
+{
+  const Visit& v = m_visits.back();
+
+  for (size_t i = v.flatBeg; i < v.flatEnd; ++i) {
+    m_flat.active(m_flatChain[i])--;
+  }
+  for (size_t i = v.callersBeg; i < v.callersEnd; ++i) {
+    m_callers.active(m_callersChain[i])--;
+  }
+
+  m_flatChain.resize(v.flatBeg);
+  m_callersChain.resize(v.callersBeg);
+  if (v.isFrame) {
+    m_frames.pop_back();
+  }
+
+  m_visits.pop_back();
+}
+
+} // namespace
+
+
+//***************************************************************************
+// Writing the views
+//***************************************************************************
+
+namespace Analysis {
+
+namespace CallPath {
+
+static int
+writeViews(FILE* fs, ViewTree& flat, ViewTree& callers,
+	   uint mBegId, uint mEndId);
+
+
+void
+writeViews(const Prof::CallPath::Profile& prof, const string& fnm,
+	   uint mBegId, uint mEndId)
+{
+  if (mBegId >= mEndId) {
+    mBegId = mEndId = 0;
+  }
+
+  ViewBuilder views(prof, mBegId, mEndId);
+
+  DIAG_Msg(2, "Views: " << views.flat().size() << " flat nodes, "
+	   << views.callers().size() << " callers nodes");
+
+  FILE* fs = hpcio_fopen_w(fnm.c_str(), 1);
+  if (!fs) {
+    DIAG_Throw("error opening views file '" << fnm << "'");
+  }
+
+  int ret = writeViews(fs, views.flat(), views.callers(), mBegId, mEndId);
+  ret = (hpcio_fclose(fs) == 0 && ret == HPCFMT_OK) ? HPCFMT_OK : HPCFMT_ERR;
+  if (ret != HPCFMT_OK) {
+    DIAG_Throw("error writing views file '" << fnm << "'");
+  }
+}
+
+
+static int
+writeViews(FILE* fs, ViewTree& flat, ViewTree& callers,
+	   uint mBegId, uint mEndId)
+{
+  const uint numSections = 2;
+
+  // -------------------------------------------------------
+  // header
+  // -------------------------------------------------------
+  if (fwrite(HPCVIEWDB_FMT_Magic, 1, 18, fs) != 18
+      || fwrite(HPCVIEWDB_FMT_Version, 1, 5, fs) != 5
+      || fwrite(HPCVIEWDB_FMT_Endian, 1, 1, fs) != 1) {
+    return HPCFMT_ERR;
+  }
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(mEndId - mBegId, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(mBegId, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(numSections, fs));
+
+  uint64_t flatOff = HPCVIEWDB_FMT_HeaderLen
+    + numSections * HPCVIEWDB_FMT_SectionLen;
+  uint64_t callersOff = flatOff + flat.sectionSize();
+
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(HPCVIEWDB_FMT_FlatView, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(flatOff, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(HPCVIEWDB_FMT_CallersView, fs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(callersOff, fs));
+
+  // -------------------------------------------------------
+  // sections
+  // -------------------------------------------------------
+  HPCFMT_ThrowIfError(flat.write(fs, flatOff, mBegId));
+  HPCFMT_ThrowIfError(callers.write(fs, callersOff, mBegId));
+
+  return HPCFMT_OK;
+}
+
+} // namespace CallPath
+
+} // namespace Analysis
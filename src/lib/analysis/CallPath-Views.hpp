@@ -0,0 +1,145 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Precomputed Flat and Callers views for the Experiment database.
+//
+// Description:
+//   hpcviewer builds its Flat and Callers views by walking the whole
+//   calling context tree of 'experiment.xml'.  writeViews() computes
+//   both views from the canonical CCT instead and writes them to a
+//   binary side file with an index, so that a viewer can read the
+//   nodes it displays without reading the rest.
+//
+//   All integers are big-endian (cf. hpcfmt); offsets are from the
+//   beginning of the file.
+//
+//   [hdr]
+//     magic "HPCPROF-viewdb____" (18 bytes), version "01.00" (5 bytes),
+//     endian "b" (1 byte)
+//     numMetrics (int4), metricBegId (int4): values are for the
+//       'experiment.xml' metric ids [metricBegId, metricBegId + numMetrics)
+//     numSections (int4), then for each: kind (int4), offset (int8)
+//       kind: 1 = Flat view, 2 = Callers view
+//   [section]
+//     numNodes (int4)
+//     numNodes node records of 32 bytes; node 0 is the root (the
+//     Callers view's root is synthetic and has no values):
+//       parent (int4), structId (int4), callSiteId (int4),
+//       firstChild (int4), numChildren (int4),
+//       valuesOffset (int8), numValues (int4)
+//     values: for each node, numValues (metricId (int4), value (real8))
+//       pairs with non-zero values, in increasing metricId order
+//
+//   Nodes are numbered breadth-first, so the children of a node are
+//   the nodes [firstChild, firstChild + numChildren).
+//
+//   Flat view: the static structure tree (Root, LM, File, Proc, Alien,
+//   Loop, Stmt); 'structId' is the node's id in 'experiment.xml'.
+//   callSiteId is 0.
+//
+//   Callers view: the root's children are the procedures (Proc or
+//   Alien); the children of a node are its callers.  'structId' is the
+//   procedure's id; 'callSiteId' is the id of the Stmt of the call
+//   from the caller, or 0 if unknown (e.g., an inlined procedure).
+//   The view is 8 levels deep (a procedure and 7 levels of callers);
+//   a viewer expands deeper chains from the CCT.
+//
+//   Metric values: only raw metrics and summary sums add up over CCT
+//   nodes; other metrics (derived metrics, means, minimums, maximums,
+//   ...) have no values and a viewer computes them from the others.
+//   - Inclusive metrics: the sum over the CCT nodes that correspond to
+//     the view node, but only the outermost ones: the value of a
+//     recursive or nested instance is already part of the value of an
+//     enclosing instance.
+//   - Exclusive metrics: Flat view: the sum over the CCT statements in
+//     the scope and its loops up to the innermost procedure (or
+//     inlined procedure); files, load modules and the root include all
+//     of their statements.  Callers view: the sum over the procedure
+//     instances' exclusive values.
+//
+//***************************************************************************
+
+#ifndef Analysis_CallPath_CallPath_Views_hpp
+#define Analysis_CallPath_CallPath_Views_hpp
+
+//************************* System Include Files ****************************
+
+#include <string>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include <lib/prof/CallPath-Profile.hpp>
+
+//*************************** Forward Declarations ***************************
+
+//***************************************************************************
+
+namespace Analysis {
+
+namespace CallPath {
+
+// writeViews: write the Flat and Callers views of 'prof' for metrics
+// [mBegId, mEndId) to the file 'fnm'.  Assumes final metric values
+// and structure ids (cf. makeDatabase()).
+void
+writeViews(const Prof::CallPath::Profile& prof, const std::string& fnm,
+	   uint mBegId, uint mEndId);
+
+} // namespace CallPath
+
+} // namespace Analysis
+
+//***************************************************************************
+
+#endif // Analysis_CallPath_CallPath_Views_hpp
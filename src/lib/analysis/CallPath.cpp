@@ -71,7 +71,9 @@ using std::string;
 #include <climits>
 #include <cstring>
 #include <map>
+#include <set>
 #include <vector>
+#include <algorithm>
 
 #include <typeinfo>
 
@@ -84,9 +86,12 @@ using std::string;
 
 #include "CallPath.hpp"
 #include "CallPath-MetricComponentsFact.hpp"
+#include "CallPath-Views.hpp"
+#include "PhaseTimer.hpp"
 #include "Util.hpp"
 
 #include <lib/banal/StructSimple.hpp>
+#include <lib/banal/StructSimpleCache.hpp>
 
 #include <lib/prof/CCT-Tree.hpp>
 #include <lib/prof/Metric-Mgr.hpp>
@@ -95,6 +100,7 @@ using std::string;
 #include <lib/profxml/XercesUtil.hpp>
 #include <lib/profxml/PGMReader.hpp>
 
+#include <lib/prof-lean/hpcio.h>
 #include <lib/prof-lean/hpcrun-metric.h>
 
 #include <lib/binutils/LM.hpp>
@@ -105,8 +111,10 @@ using namespace xml;
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/Logic.hpp>
+#include <lib/support/FileUtil.hpp>
 #include <lib/support/IOUtil.hpp>
 #include <lib/support/StrUtil.hpp>
+#include <lib/support/realpath.h>
 
 
 //********************************** Macros **********************************
@@ -127,6 +135,9 @@ std::ostream* Analysis::CallPath::dbgOs = NULL; // for parallel debugging
 static void
 coalesceStmts(Prof::Struct::Tree& structure);
 
+static void
+pruneInsignificant(Prof::CallPath::Profile& prof, double thresholdFrac);
+
 namespace Analysis {
 
 namespace CallPath {
@@ -134,7 +145,7 @@ namespace CallPath {
 
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags, uint mrgFlags)
+     int mergeTy, uint rFlags, uint mrgFlags, double pruneFrac)
 {
   // Special case
   if (profileFiles.empty()) {
@@ -143,31 +154,51 @@ read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
   }
   
   // General case
+  PhaseTimer& timer = PhaseTimer::singleton();
+
   uint groupId = (groupMap) ? (*groupMap)[0] : 0;
-  Prof::CallPath::Profile* prof = read(profileFiles[0], groupId, rFlags);
+  timer.start("read");
+  Prof::CallPath::Profile* prof = read(profileFiles[0], groupId, rFlags,
+				       pruneFrac);
+  timer.stop("read");
 
   // add the directory into the set of directories
   prof->addDirectory(profileFiles[0]);
 
+  // rewrite trace files in one concurrent batch (cf. fixTraceFiles())
+  if (mrgFlags & Prof::CCT::MrgFlg_NormalizeTraceFileY) {
+    mrgFlags |= Prof::CCT::MrgFlg_DeferTraceFileY;
+  }
+
   for (uint i = 1; i < profileFiles.size(); ++i) {
     groupId = (groupMap) ? (*groupMap)[i] : 0;
-    Prof::CallPath::Profile* p = read(profileFiles[i], groupId, rFlags);
+    timer.start("read");
+    Prof::CallPath::Profile* p = read(profileFiles[i], groupId, rFlags,
+				      pruneFrac);
+    timer.stop("read");
+
+    timer.start("merge");
     prof->merge(*p, mergeTy, mrgFlags);
 
     prof->metricMgr()->mergePerfEventStatistics(p->metricMgr());
     delete p;
+    timer.stop("merge");
 
     // add the directory into the set of directories
     prof->addDirectory(profileFiles[i]);
   }
   prof->metricMgr()->mergePerfEventStatistics_finalize(profileFiles.size());
+
+  timer.start("trace");
+  prof->fixTraceFiles();
+  timer.stop("trace");
   
   return prof;
 }
 
 
 Prof::CallPath::Profile*
-read(const char* prof_fnm, uint groupId, uint rFlags)
+read(const char* prof_fnm, uint groupId, uint rFlags, double pruneFrac)
 {
   // -------------------------------------------------------
   // 
@@ -196,17 +227,207 @@ read(const char* prof_fnm, uint groupId, uint rFlags)
     metricMgr->recomputeMaps();
   }
 
+  // -------------------------------------------------------
+  // Drop insignificant subtrees before they reach the canonical CCT
+  // -------------------------------------------------------
+
+  if (pruneFrac > 0.0) {
+    pruneInsignificant(*prof, pruneFrac);
+  }
+
+  return prof;
+}
+
+
+void
+merge(Prof::CallPath::Profile& prof, const Util::StringVec& profileFiles,
+      const Util::UIntVec* groupMap, uint numPrevFiles,
+      int mergeTy, uint rFlags, uint mrgFlags, double pruneFrac)
+{
+  Prof::Metric::Mgr* mMgr = prof.metricMgr();
+
+  // 'prof' holds the mean period over its 'numPrevFiles' profiles;
+  // restore the sum so mergePerfEventStatistics_finalize() can
+  // average over all of them.
+  for (uint i = 0; i < mMgr->size(); ++i) {
+    Prof::Metric::ADesc* m = mMgr->metric(i);
+    m->periodMean(m->periodMean() * numPrevFiles);
+  }
+
+  if (mrgFlags & Prof::CCT::MrgFlg_NormalizeTraceFileY) {
+    mrgFlags |= Prof::CCT::MrgFlg_DeferTraceFileY;
+  }
+
+  PhaseTimer& timer = PhaseTimer::singleton();
+
+  for (uint i = 0; i < profileFiles.size(); ++i) {
+    uint groupId = (groupMap) ? (*groupMap)[i] : 0;
+    timer.start("read");
+    Prof::CallPath::Profile* p = read(profileFiles[i], groupId, rFlags,
+				      pruneFrac);
+    timer.stop("read");
+
+    timer.start("merge");
+    prof.merge(*p, mergeTy, mrgFlags);
+
+    mMgr->mergePerfEventStatistics(p->metricMgr());
+    delete p;
+    timer.stop("merge");
+
+    prof.addDirectory(profileFiles[i]);
+  }
+  mMgr->mergePerfEventStatistics_finalize(numPrevFiles + profileFiles.size());
+
+  timer.start("trace");
+  prof.fixTraceFiles();
+  timer.stop("trace");
+}
+
+
+//***************************************************************************
+
+// The state file is a profile in hpcrun format; the file list is text:
+//   profile <measurement file>
+//   trace <trace file name within the database>
+static const string stateTag_profile = "profile";
+static const string stateTag_trace   = "trace";
+
+
+void
+writeState(const Prof::CallPath::Profile& prof,
+	   const Util::StringVec& profileFiles, const string& db_dir)
+{
+  const string fnm = db_dir + "/" + Analysis_OUT_DB_CCT;
+  const string fnmTmp = fnm + "." + HPCPROF_TmpFnmSfx;
+
+  DIAG_Msg(2, "Writing canonical CCT: " << fnm);
+
+  // -------------------------------------------------------
+  // canonical CCT
+  // -------------------------------------------------------
+  FILE* fs = hpcio_fopen_w(fnmTmp.c_str(), 1/*overwrite*/);
+  if (!fs) {
+    DIAG_Throw("error opening file '" << fnmTmp << "'");
+  }
+
+  char* fsBuf = new char[HPCIO_RWBufferSz];
+  setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+
+  int ret = Prof::CallPath::Profile::fmt_fwrite(prof, fs, 0);
+  hpcio_fclose(fs);
+  delete[] fsBuf;
+
+  if (ret != HPCFMT_OK) {
+    FileUtil::remove(fnmTmp.c_str());
+    DIAG_Throw("error writing file '" << fnmTmp << "'");
+  }
+
+  // -------------------------------------------------------
+  // measurement files and trace files
+  // -------------------------------------------------------
+  const string lstFnm = db_dir + "/" + Analysis_OUT_DB_CCT_FILES;
+  std::ostream* os = IOUtil::OpenOStream(lstFnm.c_str());
+
+  for (uint i = 0; i < profileFiles.size(); ++i) {
+    *os << stateTag_profile << " " << RealPath(profileFiles[i].c_str())
+	<< std::endl;
+  }
+
+  const StringSet& traceFiles = prof.traceFileNameSet();
+  for (StringSet::const_iterator it = traceFiles.begin();
+       it != traceFiles.end(); ++it) {
+    *os << stateTag_trace << " " << FileUtil::basename(*it) << std::endl;
+  }
+
+  IOUtil::CloseStream(os);
+
+  // N.B.: replace the CCT last so an interrupted update leaves the
+  // previous state intact
+  FileUtil::move(fnm, fnmTmp);
+}
+
+
+Prof::CallPath::Profile*
+readState(const string& db_dir, Util::StringVec& profileFiles)
+{
+  const string fnm = db_dir + "/" + Analysis_OUT_DB_CCT;
+  const string lstFnm = db_dir + "/" + Analysis_OUT_DB_CCT_FILES;
+
+  if (!FileUtil::isReadable(fnm) || !FileUtil::isReadable(lstFnm)) {
+    DIAG_Throw("'" << db_dir << "' has no saved canonical CCT ('"
+	       << Analysis_OUT_DB_CCT << "'); it cannot be updated "
+	       << "(create it with --updatable)");
+  }
+
+  DIAG_Msg(2, "Reading canonical CCT: " << fnm);
+
+  // -------------------------------------------------------
+  // canonical CCT (metric values are final; cf. writeState())
+  // -------------------------------------------------------
+  FILE* fs = hpcio_fopen_r(fnm.c_str());
+  if (!fs) {
+    DIAG_Throw("error opening file '" << fnm << "'");
+  }
+
+  char* fsBuf = new char[HPCIO_RWBufferSz];
+  setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+
+  Prof::CallPath::Profile* prof = NULL;
+  Prof::CallPath::Profile::fmt_fread(prof, fs, 0, fnm, fnm.c_str(), NULL);
+  hpcio_fclose(fs);
+  delete[] fsBuf;
+
+  // -------------------------------------------------------
+  // measurement files and trace files
+  // -------------------------------------------------------
+  StringSet& traceFiles = prof->traceFileNameSet();
+  traceFiles.clear(); // fmt_fread() derives a name from 'fnm'
+
+  std::istream* is = IOUtil::OpenIStream(lstFnm.c_str());
+  string line;
+  while (std::getline(*is, line)) {
+    size_t pos = line.find(' ');
+    if (pos == string::npos) {
+      continue;
+    }
+    string tag = line.substr(0, pos);
+    string val = line.substr(pos + 1);
+
+    if (tag == stateTag_profile) {
+      profileFiles.push_back(val);
+    }
+    else if (tag == stateTag_trace) {
+      traceFiles.insert(db_dir + "/" + val);
+    }
+  }
+  IOUtil::CloseStream(is);
+
   return prof;
 }
 
 
 void
-readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args)
+readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args,
+	      const Prof::LoadMap* loadmap)
 {
   DocHandlerArgs docargs(&RealPathMgr::singleton());
 
+  // Only load modules with measurements need structure.  Match on
+  // both full and base names since structure may have been recovered
+  // from a copy of the binary.
+  std::set<string> lmFilter;
+  if (loadmap) {
+    for (Prof::LoadMap::LMId_t i = Prof::LoadMap::LMId_NULL + 1;
+	 i <= loadmap->size(); ++i) {
+      const string& nm = loadmap->lm(i)->name();
+      lmFilter.insert(nm);
+      lmFilter.insert(FileUtil::basename(nm));
+    }
+  }
+
   Prof::Struct::readStructure(*structure, args.structureFiles,
-			      PGMDocHandler::Doc_STRUCT, docargs);
+			      PGMDocHandler::Doc_STRUCT, docargs,
+			      (loadmap) ? &lmFilter : NULL);
 
   // BAnal::Struct::makeStructure() creates a Struct::Tree that
   // distinguishes between non-call-site statements and call site
@@ -368,20 +589,34 @@ makeVMAmap(VmaVecMap & vmaMap, Prof::CCT::ANode * node)
 // Precompute struct simple for one struct tree (lmStruct) from the
 // binutils load module (lm) and vma vector (vmaVec).
 //
+// If there is a cache, use its entries and add the ones found in lm.
+// In that case, lm may be NULL if every vma is in the cache (cf.
+// isStructSimpleCached()).
+//
 static void
 precomputeStructSimple(Prof::Struct::LM * lmStruct,
 		       BinUtil::LM * lm,
+		       BAnal::Struct::SimpleCache * cache,
 		       VmaVec * vmaVec)
 {
-  if (lm == NULL || vmaVec == NULL) {
+  if ((lm == NULL && cache == NULL) || vmaVec == NULL) {
     return;
   }
 
+  BAnal::Struct::SimpleInfo info;
+
   for (uint i = 0; i < vmaVec->size(); i++) {
     VMA vma = (*vmaVec)[i];
 
     if (lmStruct->findStmt(vma) == NULL) {
-      BAnal::Struct::makeStructureSimple(lmStruct, lm, vma);
+      if (cache == NULL || !cache->find(vma, info)) {
+	DIAG_Assert(lm, "precomputeStructSimple: vma not in cache");
+	BAnal::Struct::findSimpleInfo(lm, vma, info);
+	if (cache) {
+	  cache->insert(vma, info);
+	}
+      }
+      BAnal::Struct::makeStructureSimple(lmStruct, vma, info);
     }
   }
 
@@ -389,6 +624,23 @@ precomputeStructSimple(Prof::Struct::LM * lmStruct,
 }
 
 
+static bool
+isStructSimpleCached(BAnal::Struct::SimpleCache * cache, VmaVec * vmaVec)
+{
+  if (cache == NULL || vmaVec == NULL || cache->lmName().empty()) {
+    return false;
+  }
+
+  BAnal::Struct::SimpleInfo info;
+  for (uint i = 0; i < vmaVec->size(); i++) {
+    if (!cache->find((*vmaVec)[i], info)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
 //****************************************************************************
 // Overlaying static structure on a CCT
 //****************************************************************************
@@ -400,7 +652,9 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   Prof::LoadMap::LM* loadmap_lm,
 			   Prof::Struct::LM* lmStrct,
 			   VmaVec * vmaVec,
-                           bool printProgress);
+                           bool printProgress,
+			   const string& lmCacheDir,
+			   BAnal::Struct::SimpleCache* lmCache);
 
 static void
 overlayStaticStructure(Prof::CCT::ANode* node,
@@ -434,7 +688,8 @@ void
 Analysis::CallPath::
 overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   string agent, bool doNormalizeTy,
-                           bool printProgress)
+                           bool printProgress, const string& lmCacheDir,
+			   const LMSimpleCaches* lmCaches)
 {
   const Prof::LoadMap* loadmap = prof.loadmap();
   Prof::Struct::Root* rootStrct = prof.structure()->root();
@@ -463,7 +718,16 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 	  vmaVec = it->second;
 	}
 
-	overlayStaticStructureMain(prof, lm, lmStrct, vmaVec, printProgress);
+	BAnal::Struct::SimpleCache* lmCache = NULL;
+	if (lmCaches) {
+	  auto jt = lmCaches->find(i);
+	  if (jt != lmCaches->end()) {
+	    lmCache = jt->second;
+	  }
+	}
+
+	overlayStaticStructureMain(prof, lm, lmStrct, vmaVec, printProgress,
+				   lmCacheDir, lmCache);
       }
       catch (const Diagnostics::Exception& x) {
         errors += "  " + x.what() + "\n";
@@ -494,26 +758,51 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 
 
 //
-// Overlay for one load module.
+// Overlay for one load module.  If 'lmCache' holds every sampled vma
+// (cf. readStructureSimple()), the load module is not read.
 //
 static void
 overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   Prof::LoadMap::LM* loadmap_lm,
 			   Prof::Struct::LM* lmStrct,
 			   VmaVec * vmaVec,
-                           bool printProgress)
+                           bool printProgress,
+			   const string& lmCacheDir,
+			   BAnal::Struct::SimpleCache* lmCache)
 {
   const string& lm_nm = loadmap_lm->name();
   const string& lm_pretty_name = Prof::LoadMap::LM::pretty_name(lm_nm);
 
   BinUtil::LM* lm = NULL;
+  BAnal::Struct::SimpleCache* cache = NULL;
 
   bool useStruct = (lmStrct->childCount() > 0);
+  bool useLMCache = (!useStruct && isStructSimpleCached(lmCache, vmaVec));
+
+  if (!useStruct && !useLMCache
+      && loadmap_lm->id() != Prof::LoadMap::LMId_NULL
+      && !lmCacheDir.empty()) {
+    cache = new BAnal::Struct::SimpleCache(lmCacheDir, lm_nm);
+    if (!cache->isValid()) {
+      delete cache;
+      cache = NULL;
+    }
+  }
 
   if (useStruct) {
     DIAG_MsgIf(printProgress, "STRUCTURE: " << lm_pretty_name);
   } else if (loadmap_lm->id() == Prof::LoadMap::LMId_NULL) {
     // no-op for this case
+  } else if (useLMCache) {
+    // read elsewhere, e.g., by another hpcprof-mpi process
+    precomputeStructSimple(lmStrct, NULL, lmCache, vmaVec);
+    lmStrct->pretty_name(lmCache->lmName());
+    DIAG_MsgIf(printProgress, "Line map : " << lm_pretty_name);
+  } else if (isStructSimpleCached(cache, vmaVec)) {
+    // every sampled vma is in the cache: skip binutils
+    precomputeStructSimple(lmStrct, NULL, cache, vmaVec);
+    lmStrct->pretty_name(cache->lmName());
+    DIAG_MsgIf(printProgress, "Line map (cached): " << lm_pretty_name);
   } else {
     try {
       lm = new BinUtil::LM();
@@ -523,7 +812,7 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 	DIAG_WMsgIf(printProgress, "Unable to compute struct simple for " << lm_nm);
       }
       else {
-	precomputeStructSimple(lmStrct, lm, vmaVec);
+	precomputeStructSimple(lmStrct, lm, cache, vmaVec);
       }
     }
     catch (const Diagnostics::Exception& x) {
@@ -537,7 +826,12 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 
   if (lm) {
     lmStrct->pretty_name(lm->name());
+    if (cache) {
+      cache->lmName(lm->name());
+      cache->write();
+    }
   }
+  delete cache;
 
   overlayStaticStructure(prof.cct()->root(), loadmap_lm, lmStrct, NULL);
   
@@ -548,23 +842,120 @@ overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 }
 
 
+void
+Analysis::CallPath::
+readStructureSimple(Prof::CallPath::Profile& prof,
+		    const std::vector<Prof::LoadMap::LMId_t>& lmIds,
+		    const string& lmCacheDir, LMSimpleCaches& lmCaches)
+{
+  const Prof::LoadMap* loadmap = prof.loadmap();
+  const Prof::Struct::Root* rootStrct = prof.structure()->root();
+  VmaVecMap vmaMap;
+
+  makeVMAmap(vmaMap, prof.cct()->root());
+
+  for (uint k = 0; k < lmIds.size(); ++k) {
+    Prof::LoadMap::LMId_t i = lmIds[k];
+    Prof::LoadMap::LM* loadmap_lm = loadmap->lm(i);
+    auto it = vmaMap.find(i);
+    if (i == Prof::LoadMap::LMId_NULL || !loadmap_lm->isUsed()
+	|| it == vmaMap.end()) {
+      continue;
+    }
+    VmaVec* vmaVec = it->second;
+
+    // N.B.: find, rather than demand, the structure: new structure
+    // nodes would take node ids that other processes do not take
+    const string& lm_nm = loadmap_lm->name();
+    const Prof::Struct::LM* lmStrct = rootStrct->findLM(lm_nm);
+    if (lmStrct && lmStrct->childCount() > 0) {
+      continue;
+    }
+
+    BAnal::Struct::SimpleCache* cache = NULL;
+    if (!lmCacheDir.empty()) {
+      cache = new BAnal::Struct::SimpleCache(lmCacheDir, lm_nm);
+      if (!cache->isValid()) {
+	delete cache;
+	cache = NULL;
+      }
+    }
+
+    BAnal::Struct::SimpleCache* lmCache = new BAnal::Struct::SimpleCache;
+    BinUtil::LM* lm = NULL;
+    try {
+      BAnal::Struct::SimpleInfo info;
+      for (uint j = 0; j < vmaVec->size(); ++j) {
+	VMA vma = (*vmaVec)[j];
+	if (lmCache->find(vma, info)) {
+	  continue;
+	}
+	if (cache == NULL || !cache->find(vma, info)) {
+	  if (!lm) {
+	    lm = new BinUtil::LM();
+	    lm->open(lm_nm.c_str());
+	    lm->read(prof.directorySet(), BinUtil::LM::ReadFlg_Proc);
+	  }
+	  BAnal::Struct::findSimpleInfo(lm, vma, info);
+	  if (cache) {
+	    cache->insert(vma, info);
+	  }
+	}
+	lmCache->insert(vma, info);
+      }
+
+      if (lm) {
+	lmCache->lmName(lm->name());
+	if (cache) {
+	  cache->lmName(lm->name());
+	  cache->write();
+	}
+      }
+      else {
+	lmCache->lmName(cache->lmName());
+      }
+      lmCaches[i] = lmCache;
+    }
+    catch (const Diagnostics::Exception&) {
+      // overlayStaticStructureMain() reads it again and reports why
+      delete lmCache;
+    }
+    delete lm;
+    delete cache;
+  }
+
+  // delete VMA vectors
+  for (auto it = vmaMap.begin(); it != vmaMap.end(); ++it) {
+    delete it->second;
+  }
+}
+
+
 void
 Analysis::CallPath::
 noteStaticStructureOnLeaves(Prof::CallPath::Profile& prof)
 {
   const Prof::Struct::Root* rootStrct = prof.structure()->root();
 
+  // each load module's structure, found on first use
+  std::vector<const Prof::Struct::LM*>
+    lmStrctVec(prof.loadmap()->size() + 1, NULL);
+
   Prof::CCT::ANodeIterator it(prof.cct()->root(), NULL/*filter*/,
 			      true/*leavesOnly*/, IteratorStack::PreOrder);
   for (Prof::CCT::ANode* n = NULL; (n = it.current()); ++it) {
     Prof::CCT::ADynNode* n_dyn = dynamic_cast<Prof::CCT::ADynNode*>(n);
     if (n_dyn) {
       Prof::LoadMap::LMId_t lmId = n_dyn->lmId(); // ok if LoadMap::LMId_NULL
-      Prof::LoadMap::LM* loadmap_lm = prof.loadmap()->lm(lmId);
-      const string& lm_nm = loadmap_lm->name();
 
-      const Prof::Struct::LM* lmStrct = rootStrct->findLM(lm_nm);
-      DIAG_Assert(lmStrct, "failed to find Struct::LM: " << lm_nm);
+      const Prof::Struct::LM*& lmStrct = lmStrctVec[lmId];
+      if (!lmStrct) {
+	Prof::LoadMap::LM* loadmap_lm = prof.loadmap()->lm(lmId);
+	const string& lm_nm = loadmap_lm->name();
+
+	lmStrct = rootStrct->findLM(lm_nm);
+	DIAG_Assert(lmStrct, "failed to find Struct::LM: " << lm_nm);
+      }
 
       VMA lm_ip = n_dyn->lmIP();
       const Prof::Struct::ACodeNode* strct = lmStrct->findByVMA(lm_ip);
@@ -915,6 +1306,137 @@ coalesceStmts(Prof::CCT::ANode* node)
 }
 
 
+//***************************************************************************
+// Pruning while reading
+//***************************************************************************
+
+// pruneInsignificant: Given a profile as read from a measurement file
+// (whose metric values are all exclusive and attributed to the nodes
+// that were sampled), delete each subtree whose inclusive value for
+// every metric is less than 'thresholdFrac' of the metric's total.
+// The values of the subtrees deleted below a node are added to one
+// synthetic CCT::Stmt child of that node (with a NULL load module and
+// IP), so that inclusive values and totals are unchanged.
+//
+// Subtrees that contain a node with a retained id (cf.
+// hpcrun_fmt_doRetainId(); e.g., nodes referenced by traces) are
+// always kept.
+
+static bool
+pruneInsignificant(Prof::CCT::ANode* n, const std::vector<double>& thresh,
+		   std::vector<std::vector<double> >& inclStk, uint depth,
+		   uint& numPruned);
+
+
+static void
+pruneInsignificant(Prof::CallPath::Profile& prof, double thresholdFrac)
+{
+  Prof::CCT::ANode* root = prof.cct()->root();
+  uint numMetrics = prof.metricMgr()->size();
+  if (!root || numMetrics == 0) {
+    return;
+  }
+
+  std::vector<double> thresh(numMetrics, 0.0);
+  for (Prof::CCT::ANodeIterator it(root); it.Current(); ++it) {
+    Prof::CCT::ANode* n = it.current();
+    uint sz = std::min(numMetrics, n->numMetrics());
+    for (uint mId = 0; mId < sz; ++mId) {
+      thresh[mId] += n->metric(mId);
+    }
+  }
+  for (uint mId = 0; mId < numMetrics; ++mId) {
+    // N.B.: a metric with no samples makes nothing significant
+    thresh[mId] = (thresh[mId] > 0.0) ? thresholdFrac * thresh[mId] : -1.0;
+  }
+
+  std::vector<std::vector<double> > inclStk;
+  uint numPruned = 0;
+  pruneInsignificant(root, thresh, inclStk, 0, numPruned);
+
+  DIAG_Msg(2, "Pruned " << numPruned << " insignificant CCT subtrees from '"
+	   << prof.name() << "'");
+}
+
+
+// pruneInsignificant: Set inclStk[depth] to the inclusive metric
+// values of the subtree rooted at 'n' and prune the children of 'n'.
+// Returns whether the subtree contains a node with a retained id.
+static bool
+pruneInsignificant(Prof::CCT::ANode* n, const std::vector<double>& thresh,
+		   std::vector<std::vector<double> >& inclStk, uint depth,
+		   uint& numPruned)
+{
+  using namespace Prof;
+
+  uint numMetrics = thresh.size();
+
+  // N.B.: recursive calls may grow 'inclStk'; index it after each one
+  if (inclStk.size() <= depth + 1) {
+    inclStk.resize(depth + 2);
+  }
+  inclStk[depth].assign(numMetrics, 0.0);
+
+  uint sz = std::min(numMetrics, n->numMetrics());
+  for (uint mId = 0; mId < sz; ++mId) {
+    inclStk[depth][mId] = n->metric(mId);
+  }
+
+  CCT::ADynNode* n_dyn = dynamic_cast<CCT::ADynNode*>(n);
+  bool hasRetained = (n_dyn && n_dyn->cpId() != HPCRUN_FMT_CCTNodeId_NULL);
+
+  CCT::Stmt* synth = NULL;
+
+  for (CCT::ANodeChildIterator it(n); it.Current(); /* */) {
+    CCT::ANode* x = it.current();
+    it++; // advance iterator -- it is pointing at 'x'
+
+    bool x_hasRetained = pruneInsignificant(x, thresh, inclStk, depth + 1,
+					    numPruned);
+    std::vector<double>& incl = inclStk[depth];
+    const std::vector<double>& x_incl = inclStk[depth + 1];
+
+    for (uint mId = 0; mId < numMetrics; ++mId) {
+      incl[mId] += x_incl[mId];
+    }
+
+    bool isSignificant = x_hasRetained;
+    CCT::ADynNode* x_dyn = dynamic_cast<CCT::ADynNode*>(x);
+    if (x_dyn && x_dyn->isSecondarySynthRoot()) {
+      isSignificant = true;
+    }
+    for (uint mId = 0; mId < numMetrics && !isSignificant; ++mId) {
+      isSignificant = (thresh[mId] >= 0.0 && x_incl[mId] >= thresh[mId]);
+    }
+
+    if (isSignificant) {
+      hasRetained = hasRetained || x_hasRetained;
+    }
+    else {
+      if (!synth) {
+	synth = new CCT::Stmt(NULL, HPCRUN_FMT_CCTNodeId_NULL,
+			      lush_assoc_info_NULL, LoadMap::LMId_NULL,
+			      0/*ip*/, 0/*opIdx*/, NULL/*lip*/,
+			      Metric::IData(numMetrics));
+      }
+      for (uint mId = 0; mId < numMetrics; ++mId) {
+	synth->metric(mId) += x_incl[mId];
+      }
+
+      x->unlink(); // unlink 'x' from tree
+      delete x;
+      numPruned++;
+    }
+  }
+
+  if (synth) {
+    synth->link(n);
+  }
+
+  return hasRetained;
+}
+
+
 //***************************************************************************
 // Normalizing the CCT
 //***************************************************************************
@@ -1260,6 +1782,17 @@ makeDatabase(Prof::CallPath::Profile& prof, const Analysis::Args& args)
 
   delete[] outBuf;
 
+  // 5. Create precomputed Flat and Callers views (if requested)
+  if (args.db_makeViewDB) {
+    Prof::Metric::ADesc* mBeg = prof.metricMgr()->findFirstVisible();
+    Prof::Metric::ADesc* mEnd = prof.metricMgr()->findLastVisible();
+    uint mBegId = (mBeg) ? mBeg->id()     : 0;
+    uint mEndId = (mEnd) ? mEnd->id() + 1 : 0;
+
+    string views_fnm = db_dir + "/" + Analysis_OUT_DB_VIEWS;
+    Analysis::CallPath::writeViews(prof, views_fnm, mBegId, mEndId);
+  }
+
   auto moveFiles = [&](const std::vector<string> &files) {
     for (auto &file : files) {
       auto pos = file.rfind("/");
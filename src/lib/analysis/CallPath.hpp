@@ -66,6 +66,7 @@
 #include <vector>
 #include <stack>
 #include <string>
+#include <map>
 
 //*************************** User Include Files ****************************
 
@@ -81,6 +82,12 @@
 
 //*************************** Forward Declarations ***************************
 
+namespace BAnal {
+namespace Struct {
+  class SimpleCache;
+}
+}
+
 //****************************************************************************
 
 namespace Analysis {
@@ -94,22 +101,57 @@ extern std::ostream* dbgOs; // for parallel debugging
 //
 // ---------------------------------------------------------
 
+// read: If 'pruneFrac' > 0, as each file is read, delete the CCT
+// subtrees whose inclusive value for every metric is less than
+// 'pruneFrac' of the file's total (cf. --prune-threshold).  The
+// pruned values are kept in a synthetic child of the subtree's
+// parent, so totals are unchanged.  Subtrees with nodes referenced by
+// traces are always kept.
 Prof::CallPath::Profile*
 read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
-     int mergeTy, uint rFlags = 0, uint mrgFlags = 0);
+     int mergeTy, uint rFlags = 0, uint mrgFlags = 0,
+     double pruneFrac = 0.0);
 
 Prof::CallPath::Profile*
-read(const char* prof_fnm, uint groupId, uint rFlags = 0);
+read(const char* prof_fnm, uint groupId, uint rFlags = 0,
+     double pruneFrac = 0.0);
 
 static inline Prof::CallPath::Profile*
-read(const string& prof_fnm, uint groupId, uint rFlags = 0)
+read(const string& prof_fnm, uint groupId, uint rFlags = 0,
+     double pruneFrac = 0.0)
 {
-  return read(prof_fnm.c_str(), groupId, rFlags);
+  return read(prof_fnm.c_str(), groupId, rFlags, pruneFrac);
 }
 
+// merge: read 'profileFiles' and merge them into 'prof', which already
+// contains 'numPrevFiles' profiles (cf. read()).
+void
+merge(Prof::CallPath::Profile& prof, const Util::StringVec& profileFiles,
+      const Util::UIntVec* groupMap, uint numPrevFiles,
+      int mergeTy, uint rFlags = 0, uint mrgFlags = 0,
+      double pruneFrac = 0.0);
+
+
+// writeState: persist the canonical CCT 'prof' -- before static
+// structure is overlaid -- and the list of measurement files that
+// it contains in 'db_dir'.  Cf. 'hpcprof --update'.
+void
+writeState(const Prof::CallPath::Profile& prof,
+	   const Util::StringVec& profileFiles, const string& db_dir);
+
+// readState: read the canonical CCT and measurement file list saved
+// by writeState() from 'db_dir'.  Trace files named by the returned
+// profile refer to the copies in 'db_dir'.
+Prof::CallPath::Profile*
+readState(const string& db_dir, Util::StringVec& profileFiles);
 
+
+// readStructure: read args.structureFiles into 'structure'.  If
+// 'loadmap' is non-NULL, binary structure files only materialize the
+// load modules that appear in 'loadmap'.
 void
-readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args);
+readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args,
+	      const Prof::LoadMap* loadmap = NULL);
 
 
 // ---------------------------------------------------------
@@ -134,10 +176,33 @@ readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args);
 // - Every CCT::Call and CCT::Stmt is a descendant of a CCT::ProcFrm
 // - A CCT::Stmt node is always a leaf.
 
+// LMSimpleCaches: for load modules without structure files (by load
+// map id), the procedures and line map entries of their sampled vmas,
+// as they would be read from the load modules themselves.
+typedef std::map<Prof::LoadMap::LMId_t, BAnal::Struct::SimpleCache*>
+  LMSimpleCaches;
+
+// If 'lmCacheDir' is not empty, the procedures and line maps read
+// from load modules without structure files are cached in that
+// directory and reused by later runs (cf. BAnal::Struct::SimpleCache).
+// Load modules in 'lmCaches' are not read at all.
 void
 overlayStaticStructureMain(Prof::CallPath::Profile& prof,
 			   string agent, bool doNormalizeTy,
-                           bool printProgress);
+                           bool printProgress,
+			   const string& lmCacheDir = "",
+			   const LMSimpleCaches* lmCaches = NULL);
+
+// readStructureSimple: for those of the load modules 'lmIds' that are
+// sampled and have no structure file, read what
+// overlayStaticStructureMain() needs into new entries of 'lmCaches'
+// (which the caller deletes).  Unlike the overlay, does not change
+// 'prof', so that hpcprof-mpi can read different load modules on
+// different processes.  Load modules that cannot be read are skipped.
+void
+readStructureSimple(Prof::CallPath::Profile& prof,
+		    const std::vector<Prof::LoadMap::LMId_t>& lmIds,
+		    const string& lmCacheDir, LMSimpleCaches& lmCaches);
 
 // lm is optional and may be NULL
 void 
@@ -0,0 +1,193 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <fstream>
+
+#include <string>
+using std::string;
+
+#include <sys/time.h>
+
+//*************************** User Include Files ****************************
+
+#include "PhaseTimer.hpp"
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/IOUtil.hpp>
+
+//*************************** Forward Declarations ***************************
+
+//****************************************************************************
+
+namespace Analysis {
+
+PhaseTimer&
+PhaseTimer::singleton()
+{
+  static PhaseTimer s_singleton;
+  return s_singleton;
+}
+
+
+void
+PhaseTimer::start(const string& phase)
+{
+  Phase* x = find(phase);
+  if (!x) {
+    m_phases.push_back(Phase(phase));
+    x = &m_phases.back();
+  }
+  DIAG_Assert(!x->isRunning, "PhaseTimer: phase '" << phase
+	      << "' is already running");
+  x->isRunning = true;
+  x->begin = now();
+}
+
+
+void
+PhaseTimer::stop(const string& phase)
+{
+  double t = now();
+  Phase* x = find(phase);
+  DIAG_Assert(x && x->isRunning, "PhaseTimer: phase '" << phase
+	      << "' is not running");
+  x->seconds += (t - x->begin);
+  x->isRunning = false;
+}
+
+
+double
+PhaseTimer::seconds(const string& phase) const
+{
+  const Phase* x = find(phase);
+  return (x) ? x->seconds : 0.0;
+}
+
+
+void
+PhaseTimer::write(std::ostream& os) const
+{
+  std::streamsize prec = os.precision(6);
+  std::ios_base::fmtflags flg = os.setf(std::ios_base::fixed,
+					std::ios_base::floatfield);
+
+  os << "phase,seconds\n";
+  for (uint i = 0; i < m_phases.size(); ++i) {
+    os << m_phases[i].name << "," << m_phases[i].seconds << "\n";
+  }
+  os.flush();
+
+  os.precision(prec);
+  os.flags(flg);
+}
+
+
+void
+PhaseTimer::write(const string& fnm) const
+{
+  std::ostream* os = IOUtil::OpenOStream(fnm.c_str());
+  write(*os);
+  IOUtil::CloseStream(os);
+}
+
+
+void
+PhaseTimer::ddump() const
+{
+  dump(std::cerr);
+}
+
+
+double
+PhaseTimer::now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + ((double)tv.tv_usec / 1.0e6);
+}
+
+
+PhaseTimer::Phase*
+PhaseTimer::find(const string& phase)
+{
+  for (uint i = 0; i < m_phases.size(); ++i) {
+    if (m_phases[i].name == phase) {
+      return &m_phases[i];
+    }
+  }
+  return NULL;
+}
+
+
+const PhaseTimer::Phase*
+PhaseTimer::find(const string& phase) const
+{
+  for (uint i = 0; i < m_phases.size(); ++i) {
+    if (m_phases[i].name == phase) {
+      return &m_phases[i];
+    }
+  }
+  return NULL;
+}
+
+
+} // namespace Analysis
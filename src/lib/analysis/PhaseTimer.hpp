@@ -0,0 +1,162 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Wall-clock accounting of the analysis phases of hpcprof (read,
+//   merge, overlay, metrics, prune, write).
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#ifndef Analysis_PhaseTimer_hpp
+#define Analysis_PhaseTimer_hpp
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+//*************************** Forward Declarations ***************************
+
+//****************************************************************************
+
+namespace Analysis {
+
+//****************************************************************************
+// PhaseTimer
+//****************************************************************************
+
+// PhaseTimer: Accumulates the wall-clock time of named phases.  A
+// phase may be started and stopped repeatedly (e.g., 'read' once per
+// measurement file); its time is the sum of its intervals.  Phases
+// are reported in the order in which they were first started.
+//
+// N.B.: Not thread safe; start() and stop() are called by the thread
+// that drives the analysis, around (possibly parallel) phases.
+class PhaseTimer {
+public:
+  PhaseTimer()
+  { }
+
+  ~PhaseTimer()
+  { }
+
+  static PhaseTimer&
+  singleton();
+
+  void
+  start(const std::string& phase);
+
+  void
+  stop(const std::string& phase);
+
+  // seconds: accumulated time of 'phase' (0 if it never ran)
+  double
+  seconds(const std::string& phase) const;
+
+  void
+  clear()
+  { m_phases.clear(); }
+
+  // write: one 'phase,seconds' line per phase, preceded by a header
+  void
+  write(std::ostream& os) const;
+
+  // write: as above, to file 'fnm'
+  void
+  write(const std::string& fnm) const;
+
+  void
+  dump(std::ostream& os = std::cerr) const
+  { write(os); }
+
+  void
+  ddump() const;
+
+  // now: wall-clock time in seconds
+  static double
+  now();
+
+private:
+  struct Phase {
+    Phase(const std::string& name_)
+      : name(name_), seconds(0.0), begin(0.0), isRunning(false)
+    { }
+
+    std::string name;
+    double seconds;
+    double begin;
+    bool isRunning;
+  };
+
+  Phase*
+  find(const std::string& phase);
+
+  const Phase*
+  find(const std::string& phase) const;
+
+private:
+  std::vector<Phase> m_phases;
+};
+
+
+} // namespace Analysis
+
+//****************************************************************************
+
+#endif // Analysis_PhaseTimer_hpp
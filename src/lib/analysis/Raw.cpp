@@ -65,6 +65,8 @@ using std::string;
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <stdio.h>  // fseeko()
+#include <stdlib.h> // malloc()
 
 //*************************** User Include Files ****************************
 
@@ -125,6 +127,101 @@ Analysis::Raw::writeAsText_callpath(const char* filenm)
 }
 
 
+// Sparse metric-db: print the node index, if present, and then the
+// entries grouped by node
+static void
+writeAsText_callpathMetricDBSparse(hpcmetricDB_fmt_hdr_t* hdr, FILE* fs,
+				   const char* filenm)
+{
+  if (hdr->flags & HPCMETRICDB_FMT_FLG_NodeIdx) {
+    fprintf(stdout, "[node-index:\n");
+    for (uint i = 0; i < hdr->numNodes + 2; ++i) {
+      uint64_t off = 0;
+      if (hpcfmt_int8_fread(&off, fs) != HPCFMT_OK) {
+	DIAG_Throw("error reading metric-db file '" << filenm << "'");
+      }
+      if (i > 0) {
+	fprintf(stdout, "  (%6u: %" PRIu64 ")\n", i, off);
+      }
+    }
+    fprintf(stdout, "]\n");
+  }
+
+  uint curNodeId = 0;
+  for (uint64_t i = 0; i < hdr->numEntries; ++i) {
+    hpcmetricDB_fmt_entry_t x;
+    if (hpcmetricDB_fmt_entry_fread(&x, fs) != HPCFMT_OK) {
+      DIAG_Throw("error reading metric-db file '" << filenm << "'");
+    }
+    if (x.nodeId != curNodeId) {
+      if (curNodeId != 0) {
+	fprintf(stdout, ")\n");
+      }
+      fprintf(stdout, "(%6u: ", x.nodeId);
+      curNodeId = x.nodeId;
+    }
+    fprintf(stdout, "[%u] %g ", x.metricId, x.value);
+  }
+  if (curNodeId != 0) {
+    fprintf(stdout, ")\n");
+  }
+}
+
+
+// Dense metric-db: print the numNodes x numMetrics matrix by node
+static void
+writeAsText_callpathMetricDBDense(hpcmetricDB_fmt_hdr_t* hdr, FILE* fs,
+				  const char* filenm)
+{
+  for (uint nodeId = 1; nodeId < hdr->numNodes + 1; ++nodeId) {
+    fprintf(stdout, "(%6u: ", nodeId);
+    for (uint mId = 0; mId < hdr->numMetrics; ++mId) {
+      double mval = 0;
+      if (hpcfmt_real8_fread(&mval, fs) != HPCFMT_OK) {
+	DIAG_Throw("error reading metric-db file '" << filenm << "'");
+      }
+      fprintf(stdout, "%12g ", mval);
+    }
+    fprintf(stdout, ")\n");
+  }
+}
+
+
+// Shared metric-db: print each db listed in the db index
+static void
+writeAsText_callpathMetricDBShared(hpcmetricDB_fmt_hdr_t* hdr, FILE* fs,
+				   const char* filenm)
+{
+  off_t idxPos = hdr->indexOffset;
+  for (uint64_t i = 0; i < hdr->numDBs; ++i) {
+    uint64_t offset = 0, length = 0;
+    char* name = NULL;
+
+    if (fseeko(fs, idxPos, SEEK_SET) != 0
+	|| hpcmetricDB_fmt_dbidx_fread(&offset, &length, &name, fs, malloc)
+	   != HPCFMT_OK) {
+      DIAG_Throw("error reading metric-db index of '" << filenm << "'");
+    }
+    idxPos = ftello(fs);
+
+    fprintf(stdout, "[db %s: (offset: %" PRIu64 ") (length: %" PRIu64 ")\n",
+	    name, offset, length);
+
+    hpcmetricDB_fmt_hdr_t dbHdr;
+    if (fseeko(fs, offset, SEEK_SET) != 0
+	|| hpcmetricDB_fmt_hdr_fread(&dbHdr, fs) != HPCFMT_OK) {
+      DIAG_Throw("error reading metric-db '" << name << "' in '"
+		 << filenm << "'");
+    }
+    hpcmetricDB_fmt_hdr_fprint(&dbHdr, stdout);
+    writeAsText_callpathMetricDBDense(&dbHdr, fs, filenm);
+    fprintf(stdout, "]\n");
+
+    free(name);
+  }
+}
+
+
 void
 Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 {
@@ -144,17 +241,14 @@ Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 
     hpcmetricDB_fmt_hdr_fprint(&hdr, stdout);
 
-    for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
-      fprintf(stdout, "(%6u: ", nodeId);
-      for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
-	double mval = 0;
-	ret = hpcfmt_real8_fread(&mval, fs);
-	if (ret != HPCFMT_OK) {
-	  DIAG_Throw("error reading trace file '" << filenm << "'");
-	}
-	fprintf(stdout, "%12g ", mval);
-      }
-      fprintf(stdout, ")\n");
+    if (HPCMETRICDB_FMT_isSparse(&hdr)) {
+      writeAsText_callpathMetricDBSparse(&hdr, fs, filenm);
+    }
+    else if (HPCMETRICDB_FMT_isShared(&hdr)) {
+      writeAsText_callpathMetricDBShared(&hdr, fs, filenm);
+    }
+    else {
+      writeAsText_callpathMetricDBDense(&hdr, fs, filenm);
     }
 
     hpcio_fclose(fs);
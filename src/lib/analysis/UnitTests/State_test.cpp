@@ -0,0 +1,263 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <stdint.h>
+
+using std::string;
+
+#include "../CallPath.hpp"
+#include "../Util.hpp"
+
+#include <lib/prof/CallPath-Profile.hpp>
+#include <lib/prof/CCT-Tree.hpp>
+#include <lib/prof/CCT-TreeIterator.hpp>
+
+#include <lib/prof/UnitTests/TestMeasurement.hpp>
+
+#include <lib/support/FileUtil.hpp>
+#include <lib/support/realpath.h>
+
+
+// A measurement file with one metric, sampled with a mean period of
+// 'periodMean', and the CCT
+//   root -> frame -> { leaf 0x400200 = val0, leaf 0x400300 = val1 }
+static void
+writeMeasurement(const string& fnm, uint64_t val0, uint64_t val1,
+		 double periodMean)
+{
+	const TestMeasurementMetric metrics[] = { { "CYCLES", periodMean } };
+	const char* lmNames[] = { "/state/bin/state" };
+
+	const TestMeasurementNode cct[] = {
+		{  1, HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL, 0, { 0 } },
+		{  2, 1, 1, 0x400100, { 0 } },
+		{ -3, 2, 1, 0x400200, { val0 } },
+		{ -4, 2, 1, 0x400300, { val1 } },
+	};
+
+	writeTestMeasurement(fnm, metrics, 1, lmNames, 1,
+			     cct, sizeof(cct) / sizeof(cct[0]));
+}
+
+
+// Number of CCT nodes and the sum of each metric over all of them
+static void
+summarize(const Prof::CallPath::Profile& prof, uint& numNodes,
+	  std::vector<double>& sums)
+{
+	numNodes = 0;
+	sums.assign(prof.metricMgr()->size(), 0.0);
+	for (Prof::CCT::ANodeIterator it(prof.cct()->root()); it.Current(); ++it) {
+		Prof::CCT::ANode* n = it.current();
+		numNodes++;
+		for (uint i = 0; i < sums.size() && i < n->numMetrics(); ++i) {
+			sums[i] += n->metric(i);
+		}
+	}
+}
+
+
+// Assert that 'prof' has the metrics, CCT nodes, metric sums and mean
+// periods of 'ref'
+static void
+checkEqual(const Prof::CallPath::Profile& prof,
+	   const Prof::CallPath::Profile& ref, const char* what)
+{
+	const Prof::Metric::Mgr& mMgr = *prof.metricMgr();
+	const Prof::Metric::Mgr& mMgrRef = *ref.metricMgr();
+
+	uint numNodes, numNodesRef;
+	std::vector<double> sums, sumsRef;
+	summarize(prof, numNodes, sums);
+	summarize(ref, numNodesRef, sumsRef);
+
+	std::cout << "state: " << what << ": nodes " << numNodes
+		  << " (" << numNodesRef << ")";
+	for (uint i = 0; i < sums.size(); ++i) {
+		std::cout << " " << mMgr.metric(i)->name() << " " << sums[i]
+			  << "/" << mMgr.metric(i)->periodMean();
+		if (i < sumsRef.size()) {
+			std::cout << " (" << sumsRef[i] << "/"
+				  << mMgrRef.metric(i)->periodMean() << ")";
+		}
+	}
+	std::cout << std::endl;
+
+	assert(mMgr.size() == mMgrRef.size());
+	for (uint i = 0; i < mMgr.size(); ++i) {
+		assert(mMgr.metric(i)->name() == mMgrRef.metric(i)->name());
+		assert(mMgr.metric(i)->periodMean() == mMgrRef.metric(i)->periodMean());
+	}
+	assert(numNodes == numNodesRef);
+	assert(sums == sumsRef);
+}
+
+
+// Create a database from the first of two measurement files, update it
+// with the second, and reload it; at each step the CCT must be the one
+// that reading both files at once produces.
+static void
+stateTest(const string& dir, uint rFlags)
+{
+	string fnm1 = dir + "/a-000000-000-0-0.hpcrun";
+	string fnm2 = dir + "/a-000001-000-0-0.hpcrun";
+	string db_dir = dir + "/db";
+	writeMeasurement(fnm1, 10, 20, 100.0);
+	writeMeasurement(fnm2, 1, 2, 300.0);
+	FileUtil::mkdir(db_dir);
+
+	int mergeTy = Prof::CallPath::Profile::Merge_MergeMetricByName;
+	uint mrgFlags = Prof::CCT::MrgFlg_NormalizeTraceFileY; // cf. hpcprof
+
+	Analysis::Util::StringVec files1(1, fnm1);
+	Analysis::Util::StringVec files2(1, fnm2);
+	Analysis::Util::StringVec filesAll;
+	filesAll.push_back(fnm1);
+	filesAll.push_back(fnm2);
+
+	// reference
+	Prof::CallPath::Profile* ref =
+		Analysis::CallPath::read(filesAll, NULL, mergeTy, rFlags, mrgFlags);
+	uint numMetrics = (rFlags & Prof::CallPath::Profile::RFlg_MakeInclExcl)
+		? 2 : 1;
+	assert(ref->metricMgr()->size() == numMetrics);
+	for (uint i = 0; i < numMetrics; ++i) {
+		// N.B.: the reader gives exclusive partners no mean period
+		Prof::Metric::ADesc* m = ref->metricMgr()->metric(i);
+		assert(m->periodMean()
+		       == ((m->type() == Prof::Metric::ADesc::TyExcl) ? 0.0 : 200.0));
+	}
+
+	// create
+	Prof::CallPath::Profile* prof =
+		Analysis::CallPath::read(files1, NULL, mergeTy, rFlags, mrgFlags);
+	Analysis::CallPath::writeState(*prof, files1, db_dir);
+	delete prof;
+
+	// update
+	Analysis::Util::StringVec stateFiles;
+	prof = Analysis::CallPath::readState(db_dir, stateFiles);
+	assert(stateFiles.size() == 1);
+	assert(stateFiles[0] == RealPath(fnm1.c_str()));
+
+	Analysis::CallPath::merge(*prof, files2, NULL, stateFiles.size(),
+				  mergeTy, rFlags, mrgFlags);
+	checkEqual(*prof, *ref, "update");
+
+	std::vector<double> sums;
+	uint numNodes;
+	summarize(*prof, numNodes, sums);
+	for (uint i = 0; i < sums.size(); ++i) {
+		assert(sums[i] == 33);
+	}
+
+	// reload: the updated state holds both files
+	Analysis::CallPath::writeState(*prof, filesAll, db_dir);
+	delete prof;
+	stateFiles.clear();
+	prof = Analysis::CallPath::readState(db_dir, stateFiles);
+	assert(stateFiles.size() == 2);
+	checkEqual(*prof, *ref, "reload");
+	delete prof;
+	delete ref;
+
+	// a database made without saved state cannot be updated
+	FileUtil::remove((db_dir + "/" + Analysis_OUT_DB_CCT).c_str());
+	bool caught = false;
+	try {
+		stateFiles.clear();
+		Analysis::CallPath::readState(db_dir, stateFiles);
+	}
+	catch (const Diagnostics::Exception&) {
+		caught = true;
+	}
+	assert(caught);
+
+	FileUtil::remove((db_dir + "/" + Analysis_OUT_DB_CCT_FILES).c_str());
+	FileUtil::remove(fnm1.c_str());
+	FileUtil::remove(fnm2.c_str());
+	rmdir(db_dir.c_str());
+}
+
+
+void stateTest()
+{
+	char tmpl[] = "/tmp/hpcprof-state-XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	assert(dir);
+
+	stateTest(dir, 0);
+
+	// hpcprof's default: inclusive/exclusive pairs (cf. hpcprof --update)
+	stateTest(dir, Prof::CallPath::Profile::RFlg_MakeInclExcl);
+
+	rmdir(dir);
+}
@@ -0,0 +1,354 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+#include <stdint.h>
+
+using std::string;
+
+#include "../CallPath-Views.hpp"
+
+#include <lib/prof/CallPath-Profile.hpp>
+#include <lib/prof/CCT-Tree.hpp>
+#include <lib/prof/Metric-Mgr.hpp>
+#include <lib/prof/Metric-ADesc.hpp>
+#include <lib/prof/Struct-Tree.hpp>
+
+#include <lib/prof-lean/hpcfmt.h>
+
+
+using namespace Prof;
+
+// A profile with the metrics (cycles incl, cycles excl, derived incl)
+// and the CCT
+//   main -> f (call at s20) -> f (call at s40) -> ... ('depth' f's)
+// where each frame has a statement with 1 cycle and the derived
+// metric's value is 1 everywhere.
+struct ViewsProfile {
+	ViewsProfile(uint depth);
+
+	CallPath::Profile prof;
+	uint mainId, fId, s20Id, s40Id;
+};
+
+
+static void
+setValues(CCT::ANode* n, double incl, double excl)
+{
+	n->demandMetric(0, 3) = incl;
+	n->demandMetric(1, 3) = excl;
+	n->demandMetric(2, 3) = 1.0;
+}
+
+
+ViewsProfile::ViewsProfile(uint depth)
+	: prof("views")
+{
+	Metric::SampledDesc* mIncl =
+		new Metric::SampledDesc("cycles", "", 1, false, "", "", "");
+	mIncl->type(Metric::ADesc::TyIncl);
+	Metric::SampledDesc* mExcl =
+		new Metric::SampledDesc("cycles", "", 1, false, "", "", "");
+	mExcl->type(Metric::ADesc::TyExcl);
+	Metric::DerivedDesc* mDrvd = new Metric::DerivedDesc("ratio", "", NULL);
+	mDrvd->type(Metric::ADesc::TyIncl);
+	prof.metricMgr()->insert(mIncl);
+	prof.metricMgr()->insert(mExcl);
+	prof.metricMgr()->insert(mDrvd);
+
+	prof.structure(new Struct::Tree("", new Struct::Root("")));
+	Struct::Root* sRoot = prof.structure()->root();
+	Struct::LM* lm = new Struct::LM("a.out", sRoot);
+	Struct::File* file = new Struct::File("a.c", lm);
+	Struct::Proc* pMain = new Struct::Proc("main", file, "main", false, 1, 100);
+	Struct::Proc* pF = new Struct::Proc("f", file, "f", false, 101, 200);
+	Struct::Stmt* s10 = new Struct::Stmt(pMain, 10, 10);
+	Struct::Stmt* s20 = new Struct::Stmt(pMain, 20, 20);
+	Struct::Stmt* s30 = new Struct::Stmt(pF, 130, 130);
+	Struct::Stmt* s40 = new Struct::Stmt(pF, 140, 140);
+	mainId = pMain->id();
+	fId = pF->id();
+	s20Id = s20->id();
+	s40Id = s40->id();
+
+	CCT::ANode* root = prof.cct()->root();
+	CCT::ProcFrm* frm = new CCT::ProcFrm(root, pMain);
+	setValues(frm, depth + 1, 1);
+	CCT::Stmt* stmt = new CCT::Stmt(frm, 0);
+	stmt->structure(s10);
+	setValues(stmt, 1, 1);
+
+	Struct::Stmt* sCall = s20;
+	for (uint i = 0; i < depth; ++i) {
+		CCT::Call* call = new CCT::Call(frm, 0);
+		call->structure(sCall);
+		setValues(call, depth - i, 0);
+
+		frm = new CCT::ProcFrm(call, pF);
+		setValues(frm, depth - i, 1);
+		stmt = new CCT::Stmt(frm, 0);
+		stmt->structure(s30);
+		setValues(stmt, 1, 1);
+		sCall = s40;
+	}
+}
+
+
+// A view read back from the views file
+struct ViewNode {
+	uint parent, structId, callSiteId, firstChild, numChildren;
+	std::map<uint, double> values;
+};
+
+
+static uint32_t
+readInt4(FILE* fs)
+{
+	uint32_t x = 0;
+	int ret = hpcfmt_int4_fread(&x, fs);
+	assert(ret == HPCFMT_OK);
+	return x;
+}
+
+
+static uint64_t
+readInt8(FILE* fs)
+{
+	uint64_t x = 0;
+	int ret = hpcfmt_int8_fread(&x, fs);
+	assert(ret == HPCFMT_OK);
+	return x;
+}
+
+
+static void
+readView(const string& fnm, uint kind, std::vector<ViewNode>& view)
+{
+	FILE* fs = fopen(fnm.c_str(), "r");
+	assert(fs);
+
+	char hdr[24];
+	assert(fread(hdr, 1, sizeof(hdr), fs) == sizeof(hdr));
+	assert(strncmp(hdr, "HPCPROF-viewdb____", 18) == 0);
+	uint numMetrics = readInt4(fs);
+	uint mBegId = readInt4(fs);
+	assert(numMetrics == 3 && mBegId == 0);
+
+	uint64_t off = 0;
+	uint numSections = readInt4(fs);
+	for (uint i = 0; i < numSections; ++i) {
+		uint k = readInt4(fs);
+		uint64_t o = readInt8(fs);
+		if (k == kind) {
+			off = o;
+		}
+	}
+	assert(off != 0);
+
+	fseek(fs, off, SEEK_SET);
+	view.resize(readInt4(fs));
+	std::vector<uint64_t> valuesOff(view.size());
+	std::vector<uint> numValues(view.size());
+	for (uint i = 0; i < view.size(); ++i) {
+		ViewNode& n = view[i];
+		n.parent = readInt4(fs);
+		n.structId = readInt4(fs);
+		n.callSiteId = readInt4(fs);
+		n.firstChild = readInt4(fs);
+		n.numChildren = readInt4(fs);
+		valuesOff[i] = readInt8(fs);
+		numValues[i] = readInt4(fs);
+	}
+
+	for (uint i = 0; i < view.size(); ++i) {
+		fseek(fs, valuesOff[i], SEEK_SET);
+		for (uint j = 0; j < numValues[i]; ++j) {
+			uint mId = readInt4(fs);
+			uint64_t bits = readInt8(fs);
+			double val;
+			memcpy(&val, &bits, sizeof(val));
+			view[i].values[mId] = val;
+		}
+	}
+
+	fclose(fs);
+}
+
+
+// The child of view node 'idx' for (structId, callSiteId), or 0
+static uint
+findChild(const std::vector<ViewNode>& view, uint idx,
+	  uint structId, uint callSiteId)
+{
+	const ViewNode& n = view[idx];
+	for (uint i = n.firstChild; i < n.firstChild + n.numChildren; ++i) {
+		assert(view[i].parent == idx);
+		if (view[i].structId == structId && view[i].callSiteId == callSiteId) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+
+static void
+checkValues(const ViewNode& n, double incl, double excl)
+{
+	assert(n.values.size() == 2); // none for the derived metric
+	assert(n.values.find(0)->second == incl);
+	assert(n.values.find(1)->second == excl);
+}
+
+
+static uint
+viewDepth(const std::vector<ViewNode>& view, uint idx)
+{
+	uint depth = 0;
+	const ViewNode& n = view[idx];
+	for (uint i = n.firstChild; i < n.firstChild + n.numChildren; ++i) {
+		depth = std::max(depth, 1 + viewDepth(view, i));
+	}
+	return depth;
+}
+
+
+// The Callers view: a procedure's values are those of its outermost
+// instances (inclusive) or of all instances (exclusive), and each
+// level of callers splits them by call path.
+void viewsTest()
+{
+	char tmpl[] = "/tmp/hpcprof-views-XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	assert(dir);
+	string fnm = string(dir) + "/views.db";
+
+	// main -> f -> f
+	{
+		ViewsProfile p(2);
+		Analysis::CallPath::writeViews(p.prof, fnm, 0, 3);
+
+		std::vector<ViewNode> view;
+		readView(fnm, 2 /*Callers view*/, view);
+
+		assert(view[0].values.empty());
+		assert(view[0].numChildren == 2);
+
+		uint main = findChild(view, 0, p.mainId, 0);
+		assert(main != 0);
+		checkValues(view[main], 3, 1);
+		assert(view[main].numChildren == 0);
+
+		uint f = findChild(view, 0, p.fId, 0);
+		assert(f != 0);
+		checkValues(view[f], 2, 2);
+		assert(view[f].numChildren == 2);
+
+		uint f_main = findChild(view, f, p.mainId, p.s20Id);
+		assert(f_main != 0);
+		checkValues(view[f_main], 2, 1);
+
+		uint f_f = findChild(view, f, p.fId, p.s40Id);
+		assert(f_f != 0);
+		checkValues(view[f_f], 1, 1);
+		assert(view[f_f].numChildren == 1);
+
+		uint f_f_main = findChild(view, f_f, p.mainId, p.s20Id);
+		assert(f_f_main != 0);
+		checkValues(view[f_f_main], 1, 1);
+		assert(view[f_f_main].numChildren == 0);
+	}
+
+	// Deep recursion: the view is bounded; its top is exact
+	{
+		const uint depth = 20;
+		ViewsProfile p(depth);
+		Analysis::CallPath::writeViews(p.prof, fnm, 0, 3);
+
+		std::vector<ViewNode> view;
+		readView(fnm, 2 /*Callers view*/, view);
+
+		assert(viewDepth(view, 0) == 8);
+
+		uint f = findChild(view, 0, p.fId, 0);
+		assert(f != 0);
+		checkValues(view[f], depth, depth);
+
+		uint f_f = findChild(view, f, p.fId, p.s40Id);
+		assert(f_f != 0);
+		checkValues(view[f_f], depth - 1, depth - 1);
+	}
+
+	unlink(fnm.c_str());
+	rmdir(dir);
+}
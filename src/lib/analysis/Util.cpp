@@ -64,16 +64,23 @@
 #include <string>
 using std::string;
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include <algorithm>
 #include <typeinfo>
 
 #include <cstring> // strlen()
 
 #include <dirent.h> // scandir()
+#include <fcntl.h>
+#include <unistd.h>
 
 //*************************** User Include Files ****************************
 
 #include <include/gcc-attr.h>
+#include <include/hpctoolkit-config.h>
 #include <include/uint.h>
 
 #include "Util.hpp"
@@ -91,6 +98,10 @@ using std::string;
 #include <lib/support/dictionary.h>
 #include <lib/support/realpath.h>
 
+#ifdef ENABLE_OPENMP
+#include <omp.h>
+#endif
+
 #define DEBUG_DEMAND_STRUCT  0
 #define TMP_BUFFER_LEN 1024
 
@@ -376,11 +387,38 @@ demandStructure(VMA vma, Prof::Struct::LM* lmStruct,
 // 
 //***************************************************************************
 
+// SrcFileCopy: a file to be copied into the database
+struct SrcFileCopy {
+  SrcFileCopy(const string& src, const string& dst)
+    : fnm_src(src), fnm_dst(dst), size(0), hash(0), isHashed(false),
+      dupIdx(-1)
+  { }
+
+  string fnm_src;  // the source file (a 'real path')
+  string fnm_dst;  // its location in the database
+
+  off_t    size;
+  uint64_t hash;
+  bool     isHashed;
+  int      dupIdx; // index of an earlier SrcFileCopy with equal contents
+};
+
+typedef std::vector<SrcFileCopy> SrcFileCopyVec;
+
+
 static string
-copySourceFileMain(const string& fnm_orig,
-		   std::map<string, string>& processedFiles,
-		   const Analysis::PathTupleVec& pathVec,
-		   const string& dstDir);
+resolveSourceFile(const string& fnm_orig,
+		  std::map<string, string>& processedFiles,
+		  const Analysis::PathTupleVec& pathVec,
+		  const string& dstDir,
+		  SrcFileCopyVec& copyVec,
+		  std::map<string, uint>& copyMap);
+
+static void
+hashSourceFiles(SrcFileCopyVec& copyVec);
+
+static void
+copySourceFiles(SrcFileCopyVec& copyVec);
 
 static bool 
 Flat_Filter(const Prof::Struct::ANode& x, long GCC_ATTR_UNUSED type)
@@ -398,6 +436,11 @@ namespace Util {
 // Prof::Struct::Alien x in 'structure' that can be reached with paths
 // in 'pathVec', copy x to its appropriate viewname path and update
 // x's path to be relative to this location.
+//
+// Source files are first resolved (serially, in structure order), then
+// copied concurrently.  Files with identical contents (e.g., the same
+// header reached through different paths) are stored once: later
+// copies are hard links to the first.
 void
 copySourceFiles(Prof::Struct::Root* structure, 
 		const Analysis::PathTupleVec& pathVec,
@@ -406,6 +449,14 @@ copySourceFiles(Prof::Struct::Root* structure,
   // Prevent multiple copies of the same file (Alien scopes)
   std::map<string, string> processedFiles;
 
+  SrcFileCopyVec copyVec;
+  std::map<string, uint> copyMap; // database file -> index in copyVec
+
+  std::vector<std::pair<Prof::Struct::ANode*, string> > renameVec;
+
+  // ------------------------------------------------------
+  // 1. Resolve source files and database names
+  // ------------------------------------------------------
   Prof::Struct::ANodeFilter filter(Flat_Filter, "Flat_Filter", 0);
   for (Prof::Struct::ANodeIterator it(structure, &filter); it.Current(); ++it) {
     Prof::Struct::ANode* strct = it.current();
@@ -422,22 +473,51 @@ copySourceFiles(Prof::Struct::Root* structure,
 	strct->name()));
     
     // ------------------------------------------------------
-    // Given fnm_orig, attempt to find and copy fnm_new
-    // ------------------------------------------------------
-    string fnm_new =
-      copySourceFileMain(fnm_orig, processedFiles, pathVec, dstDir);
-    
-    // ------------------------------------------------------
-    // Update static structure
+    // Given fnm_orig, attempt to find fnm_new
     // ------------------------------------------------------
+    string fnm_new = resolveSourceFile(fnm_orig, processedFiles, pathVec,
+				       dstDir, copyVec, copyMap);
     if (!fnm_new.empty()) {
-      if (typeid(*strct) == typeid(Prof::Struct::Alien)) {
-	dynamic_cast<Prof::Struct::Alien*>(strct)->fileName(fnm_new);
-      } else if (typeid(*strct) == typeid(Prof::Struct::Loop)) {
-	dynamic_cast<Prof::Struct::Loop*>(strct)->fileName(fnm_new);
-      } else {
-	dynamic_cast<Prof::Struct::File*>(strct)->name(fnm_new);
-      }
+      renameVec.push_back(make_pair(strct, fnm_new));
+    }
+  }
+
+  // ------------------------------------------------------
+  // 2. Create the database directories
+  // ------------------------------------------------------
+  std::set<string> dirSet;
+  for (uint i = 0; i < copyVec.size(); ++i) {
+    dirSet.insert(FileUtil::dirname(copyVec[i].fnm_dst));
+  }
+  for (std::set<string>::iterator it = dirSet.begin();
+       it != dirSet.end(); ++it) {
+    try {
+      FileUtil::mkdir(*it);
+    }
+    catch (const Diagnostics::Exception& x) {
+      DIAG_EMsg(x.message());
+    }
+  }
+
+  // ------------------------------------------------------
+  // 3. Find identical files and copy
+  // ------------------------------------------------------
+  hashSourceFiles(copyVec);
+  copySourceFiles(copyVec);
+
+  // ------------------------------------------------------
+  // 4. Update static structure (in structure order)
+  // ------------------------------------------------------
+  for (uint i = 0; i < renameVec.size(); ++i) {
+    Prof::Struct::ANode* strct = renameVec[i].first;
+    const string& fnm_new = renameVec[i].second;
+
+    if (typeid(*strct) == typeid(Prof::Struct::Alien)) {
+      dynamic_cast<Prof::Struct::Alien*>(strct)->fileName(fnm_new);
+    } else if (typeid(*strct) == typeid(Prof::Struct::Loop)) {
+      dynamic_cast<Prof::Struct::Loop*>(strct)->fileName(fnm_new);
+    } else {
+      dynamic_cast<Prof::Struct::File*>(strct)->name(fnm_new);
     }
   }
 }
@@ -451,14 +531,17 @@ static std::pair<int, string>
 matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec);
 
 static string
-copySourceFile(const string& filenm, const string& dstDir, 
-	       const Analysis::PathTuple& pathTpl);
+makeSourceFileCopy(const string& filenm, const string& dstDir, 
+		   const Analysis::PathTuple& pathTpl,
+		   SrcFileCopyVec& copyVec, std::map<string, uint>& copyMap);
 
 static string
-copySourceFileMain(const string& fnm_orig,
-		   std::map<string, string>& processedFiles,
-		   const Analysis::PathTupleVec& pathVec,
-		   const string& dstDir)
+resolveSourceFile(const string& fnm_orig,
+		  std::map<string, string>& processedFiles,
+		  const Analysis::PathTupleVec& pathVec,
+		  const string& dstDir,
+		  SrcFileCopyVec& copyVec,
+		  std::map<string, uint>& copyMap)
 {
   string fnm_new;
   
@@ -471,7 +554,8 @@ copySourceFileMain(const string& fnm_orig,
     int idx = fnd.first;
     if (idx >= 0) {
       // fnm_orig explicitly matches a <search-path, path-view> tuple
-      fnm_new = copySourceFile(fnd.second, dstDir, pathVec[idx]);
+      fnm_new = makeSourceFileCopy(fnd.second, dstDir, pathVec[idx],
+				   copyVec, copyMap);
     }
     else if (fnm_orig[0] == '/' && FileUtil::isReadable(fnm_orig.c_str())) {
       // fnm_orig does not match a pathVec tuple; but if it is an
@@ -479,7 +563,8 @@ copySourceFileMain(const string& fnm_orig,
       // path-view> tuple.
       static const Analysis::PathTuple 
 	defaultTpl("/", Analysis::DefaultPathTupleTarget);
-      fnm_new = copySourceFile(fnm_orig, dstDir, defaultTpl);
+      fnm_new = makeSourceFileCopy(fnm_orig, dstDir, defaultTpl,
+				   copyVec, copyMap);
     }
 
     if (fnm_new.empty()) {
@@ -563,12 +648,13 @@ matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec)
 
 
 // Given a file 'filenm' a destination directory 'dstDir' and a
-// PathTuple, form a database file name, copy 'filenm' into the
-// database and return the database file name.
+// PathTuple, form a database file name, record that 'filenm' should be
+// copied there and return the database file name.
 // NOTE: assume filenm is already a 'real path'
 static string
-copySourceFile(const string& filenm, const string& dstDir, 
-	       const Analysis::PathTuple& pathTpl)
+makeSourceFileCopy(const string& filenm, const string& dstDir, 
+		   const Analysis::PathTuple& pathTpl,
+		   SrcFileCopyVec& copyVec, std::map<string, uint>& copyMap)
 {
   const string& fnm_fnd = filenm;
   const string& viewnm = pathTpl.second;
@@ -581,24 +667,175 @@ copySourceFile(const string& filenm, const string& dstDir,
     fnm_to = "./";
   }
   fnm_to = fnm_to + dstDir + "/" + viewnm + fnm_fnd;
-  string dir_to(fnm_to); // need to strip off ending filename to 
-  uint end;              // get full path for 'fnm_to'
-  for (end = dir_to.length() - 1; dir_to[end] != '/'; end--) { }
-  dir_to[end] = '\0';    // should not end with '/'
-	
-  try {
-    FileUtil::mkdir(dir_to);
-    FileUtil::copy(fnm_to, fnm_fnd);
-    DIAG_DevMsgIf(0, "cp " << fnm_to);
-  }
-  catch (const Diagnostics::Exception& x) {
-    DIAG_EMsg(x.message());
+
+  // different names may resolve to the same file
+  if (copyMap.find(fnm_to) == copyMap.end()) {
+    copyMap.insert(make_pair(fnm_to, copyVec.size()));
+    copyVec.push_back(SrcFileCopy(fnm_fnd, fnm_to));
   }
   
   return fnm_new;
 }
 
 
+//***************************************************************************
+
+static const size_t SrcFileBufSz = 64 * 1024;
+
+
+// hashSourceFile: computes a 64-bit FNV-1a hash of the contents of
+// 'x.fnm_src'.  The hash only groups candidates; identical contents are
+// confirmed with isSameSourceFile().
+static void
+hashSourceFile(SrcFileCopy& x, unsigned char* buf)
+{
+  int fd = open(x.fnm_src.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  off_t size = 0;
+  ssize_t nRead;
+  while ((nRead = read(fd, buf, SrcFileBufSz)) > 0) {
+    for (ssize_t i = 0; i < nRead; ++i) {
+      hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+    }
+    size += nRead;
+  }
+  close(fd);
+
+  if (nRead == 0) {
+    x.hash = hash;
+    x.size = size;
+    x.isHashed = true;
+  }
+}
+
+
+static bool
+isSameSourceFile(const string& fnm1, const string& fnm2,
+		 unsigned char* buf1, unsigned char* buf2)
+{
+  int fd1 = open(fnm1.c_str(), O_RDONLY);
+  int fd2 = open(fnm2.c_str(), O_RDONLY);
+
+  bool isSame = (fd1 >= 0 && fd2 >= 0);
+  while (isSame) {
+    ssize_t n1 = read(fd1, buf1, SrcFileBufSz);
+    ssize_t n2 = (n1 > 0) ? read(fd2, buf2, n1) : read(fd2, buf2, 1);
+    isSame = (n1 >= 0 && n1 == n2 && memcmp(buf1, buf2, n1) == 0);
+    if (n1 <= 0) {
+      break;
+    }
+  }
+
+  if (fd1 >= 0) {
+    close(fd1);
+  }
+  if (fd2 >= 0) {
+    close(fd2);
+  }
+  return isSame;
+}
+
+
+// hashSourceFiles: Hash all source files and, in 'copyVec' order, mark
+// each file whose size and hash match an earlier one as a duplicate.
+static void
+hashSourceFiles(SrcFileCopyVec& copyVec)
+{
+#ifdef ENABLE_OPENMP
+#pragma omp parallel
+#endif
+  {
+    unsigned char* buf = new unsigned char[SrcFileBufSz];
+
+#ifdef ENABLE_OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+    for (uint i = 0; i < copyVec.size(); ++i) {
+      hashSourceFile(copyVec[i], buf);
+    }
+
+    delete[] buf;
+  }
+
+  std::map<std::pair<off_t, uint64_t>, uint> hashMap;
+  for (uint i = 0; i < copyVec.size(); ++i) {
+    SrcFileCopy& x = copyVec[i];
+    if (x.isHashed) {
+      std::pair<std::map<std::pair<off_t, uint64_t>, uint>::iterator, bool>
+	ret = hashMap.insert(std::make_pair(std::make_pair(x.size, x.hash), i));
+      if (!ret.second) {
+	x.dupIdx = ret.first->second;
+      }
+    }
+  }
+}
+
+
+// copySourceFile: Copy 'x' into the database; if 'x' is a duplicate of
+// an (already copied) file, try a hard link to that copy first.
+static void
+copySourceFile(SrcFileCopy& x, const SrcFileCopyVec& copyVec,
+	       unsigned char* buf1, unsigned char* buf2)
+{
+  // An existing database file may be linked to another one (cf.
+  // hpcprof --update); never write through it.
+  unlink(x.fnm_dst.c_str());
+
+  if (x.dupIdx >= 0) {
+    const SrcFileCopy& y = copyVec[x.dupIdx];
+    if (isSameSourceFile(x.fnm_src, y.fnm_src, buf1, buf2)) {
+      if (link(y.fnm_dst.c_str(), x.fnm_dst.c_str()) == 0) {
+	DIAG_Msg(3, "  ln: " << y.fnm_dst << " -> " << x.fnm_dst);
+	return;
+      }
+    }
+  }
+
+  try {
+    FileUtil::copy(x.fnm_dst, x.fnm_src);
+    DIAG_DevMsgIf(0, "cp " << x.fnm_dst);
+  }
+  catch (const Diagnostics::Exception& ex) {
+    DIAG_EMsg(ex.message());
+  }
+}
+
+
+static void
+copySourceFiles(SrcFileCopyVec& copyVec)
+{
+  // Copy unique files first, so that duplicates can link to them
+  for (int pass = 0; pass < 2; ++pass) {
+    bool doDups = (pass == 1);
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel
+#endif
+    {
+      unsigned char* buf1 = new unsigned char[SrcFileBufSz];
+      unsigned char* buf2 = new unsigned char[SrcFileBufSz];
+
+#ifdef ENABLE_OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+      for (uint i = 0; i < copyVec.size(); ++i) {
+	SrcFileCopy& x = copyVec[i];
+	if ((x.dupIdx >= 0) == doDups) {
+	  copySourceFile(x, copyVec, buf1, buf2);
+	}
+      }
+
+      delete[] buf1;
+      delete[] buf2;
+    }
+  }
+}
+
+
 //***************************************************************************
 //
 //***************************************************************************
@@ -617,6 +854,11 @@ copyTraceFiles(const std::string& dstDir, const std::set<string>& srcFiles)
 
     const string& x = *it;
 
+    // already in the database (cf. hpcprof --update)
+    if (FileUtil::dirname(x) == dstDir) {
+      continue;
+    }
+
     const string  srcFnm1 = x + "." + HPCPROF_TmpFnmSfx;
     const string& srcFnm2 = x;
     const string  dstFnm = dstDir + "/" + FileUtil::basename(x);
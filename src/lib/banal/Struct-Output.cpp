@@ -74,6 +74,7 @@
 #include <string>
 
 #include <lib/binutils/VMAInterval.hpp>
+#include <lib/prof/Struct-BinFmt.hpp>
 #include <lib/support/FileUtil.hpp>
 #include <lib/support/StringTable.hpp>
 #include <lib/support/dictionary.h>
@@ -93,6 +94,11 @@ using namespace std;
 static long next_index;
 static long gaps_line;
 
+// binary structure output (hpcstruct --format), fed in parallel with
+// the xml tags.  the node ids match the xml i= indices.
+static Prof::Struct::BinFmt::Writer * binWriter = NULL;
+static ostream * binFile = NULL;
+
 static const char * hpcstruct_xml_head =
 #include <lib/xml/hpc-structure.dtd.h>
   ;
@@ -107,9 +113,9 @@ static const char * hpcstruct_xml_head =
 // Helpers to generate fields inside tags.  The macros are designed to
 // fit within << operators.
 
-// this generates pre-order
-#define INDEX  \
-  " i=\"" << next_index++ << "\""
+// the index is taken from next_index in pre-order
+#define INDEX(index)  \
+  " i=\"" << index << "\""
 
 #define NUMBER(label, num)  \
   " " << label << "=\"" << num << "\""
@@ -168,6 +174,12 @@ doLoopList(ostream *, int, TreeNode *, HPC::StringTable &);
 static void
 locateTree(TreeNode *, ScopeInfo &, HPC::StringTable &, bool = false);
 
+static void
+doAlienBegin(ostream *, int, long, const string &, const string &);
+
+static void
+doAlienEnd(ostream *, int);
+
 //----------------------------------------------------------------------
 
 // Sort StmtInfo by line number and then by vma.
@@ -183,17 +195,24 @@ StmtLessThan(StmtInfo * s1, StmtInfo * s2)
 
 // DOCTYPE header and <HPCToolkitStructure> tag.
 void
-printStructFileBegin(ostream * os, ostream * gaps, string filenm)
+printStructFileBegin(ostream * os, ostream * gaps, ostream * bin, string filenm)
 {
-  if (os == NULL) {
+  if (bin != NULL) {
+    binWriter = new Prof::Struct::BinFmt::Writer;
+    binFile = bin;
+  }
+
+  if (os == NULL && bin == NULL) {
     return;
   }
 
-  *os << "<?xml version=\"1.0\"?>\n"
-      << "<!DOCTYPE HPCToolkitStructure [\n"
-      << hpcstruct_xml_head
-      << "]>\n"
-      << "<HPCToolkitStructure i=\"0\" version=\"4.7\" n=\"\">\n";
+  if (os != NULL) {
+    *os << "<?xml version=\"1.0\"?>\n"
+	<< "<!DOCTYPE HPCToolkitStructure [\n"
+	<< hpcstruct_xml_head
+	<< "]>\n"
+	<< "<HPCToolkitStructure i=\"0\" version=\"4.7\" n=\"\">\n";
+  }
 
   if (gaps != NULL) {
     *gaps << "This file describes the unclaimed vma ranges (gaps) in the control\n"
@@ -208,12 +227,21 @@ printStructFileBegin(ostream * os, ostream * gaps, string filenm)
 void
 printStructFileEnd(ostream * os, ostream * gaps)
 {
-  if (os == NULL) {
+  if (binWriter != NULL) {
+    binWriter->write(*binFile);
+    binFile->flush();
+    delete binWriter;
+    binWriter = NULL;
+    binFile = NULL;
+  }
+  else if (os == NULL) {
     return;
   }
 
-  *os << "</HPCToolkitStructure>\n";
-  os->flush();
+  if (os != NULL) {
+    *os << "</HPCToolkitStructure>\n";
+    os->flush();
+  }
 
   if (gaps != NULL) {
     gaps->flush();
@@ -226,27 +254,30 @@ printStructFileEnd(ostream * os, ostream * gaps)
 void
 printLoadModuleBegin(ostream * os, string lmName)
 {
-  if (os == NULL) {
-    return;
-  }
-
   next_index = INIT_LM_INDEX;
+  long index = next_index++;
 
-  *os << "<LM"
-      << INDEX
-      << STRING("n", lmName)
-      << " v=\"{}\">\n";
+  if (os != NULL) {
+    *os << "<LM"
+	<< INDEX(index)
+	<< STRING("n", lmName)
+	<< " v=\"{}\">\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->beginLM(index, lmName);
+  }
 }
 
 // Closing </LM> tag.
 void
 printLoadModuleEnd(ostream * os)
 {
-  if (os == NULL) {
-    return;
+  if (os != NULL) {
+    *os << "</LM>\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->end();
   }
-
-  *os << "</LM>\n";
 }
 
 //----------------------------------------------------------------------
@@ -255,27 +286,39 @@ printLoadModuleEnd(ostream * os)
 void
 printFileBegin(ostream * os, FileInfo * finfo)
 {
-  if (os == NULL || finfo == NULL) {
+  if (finfo == NULL) {
     return;
   }
 
-  doIndent(os, 1);
-  *os << "<F"
-      << INDEX
-      << STRING("n", finfo->fileName)
-      << ">\n";
+  long index = next_index++;
+
+  if (os != NULL) {
+    doIndent(os, 1);
+    *os << "<F"
+	<< INDEX(index)
+	<< STRING("n", finfo->fileName)
+	<< ">\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->beginFile(index, finfo->fileName);
+  }
 }
 
 // Closing </F> tag.
 void
 printFileEnd(ostream * os, FileInfo * finfo)
 {
-  if (os == NULL || finfo == NULL) {
+  if (finfo == NULL) {
     return;
   }
 
-  doIndent(os, 1);
-  *os << "</F>\n";
+  if (os != NULL) {
+    doIndent(os, 1);
+    *os << "</F>\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->end();
+  }
 }
 
 //----------------------------------------------------------------------
@@ -286,7 +329,7 @@ printProc(ostream * os, ostream * gaps, string gaps_file,
 	  FileInfo * finfo, GroupInfo * ginfo, ProcInfo * pinfo,
 	  HPC::StringTable & strTab)
 {
-  if (os == NULL || finfo == NULL || ginfo == NULL
+  if ((os == NULL && binWriter == NULL) || finfo == NULL || ginfo == NULL
       || pinfo == NULL || pinfo->root == NULL) {
     return;
   }
@@ -296,20 +339,30 @@ printProc(ostream * os, ostream * gaps, string gaps_file,
   long base_index = strTab.str2index(FileUtil::basename(finfo->fileName.c_str()));
   ScopeInfo scope(file_index, base_index, pinfo->line_num);
 
-  doIndent(os, 2);
-  *os << "<P"
-      << INDEX
-      << STRING("n", pinfo->prettyName);
+  long index = next_index++;
+
+  if (os != NULL) {
+    doIndent(os, 2);
+    *os << "<P"
+	<< INDEX(index)
+	<< STRING("n", pinfo->prettyName);
 
-  if (pinfo->linkName != pinfo->prettyName) {
-    *os << STRING("ln", pinfo->linkName);
+    if (pinfo->linkName != pinfo->prettyName) {
+      *os << STRING("ln", pinfo->linkName);
+    }
+    if (pinfo->symbol_index != 0) {
+      *os << NUMBER("s", pinfo->symbol_index);
+    }
+    *os << NUMBER("l", pinfo->line_num)
+	<< VRANGE(pinfo->entry_vma, 1)
+	<< ">\n";
   }
-  if (pinfo->symbol_index != 0) {
-    *os << NUMBER("s", pinfo->symbol_index);
+  if (binWriter != NULL) {
+    VMAIntervalSet vset;
+    vset.insert(pinfo->entry_vma, pinfo->entry_vma + 1);
+    binWriter->beginProc(index, pinfo->prettyName, pinfo->linkName,
+			 pinfo->line_num, pinfo->line_num, vset);
   }
-  *os << NUMBER("l", pinfo->line_num)
-      << VRANGE(pinfo->entry_vma, 1)
-      << ">\n";
 
   // write the gaps to the first proc (low vma) of the group.  this
   // only applies to full gaps.
@@ -319,8 +372,13 @@ printProc(ostream * os, ostream * gaps, string gaps_file,
 
   doTreeNode(os, 3, root, scope, strTab);
 
-  doIndent(os, 2);
-  *os << "</P>\n";
+  if (os != NULL) {
+    doIndent(os, 2);
+    *os << "</P>\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->end();
+  }
 }
 
 //----------------------------------------------------------------------
@@ -337,7 +395,8 @@ static void
 doGaps(ostream * os, ostream * gaps, string gaps_file,
        FileInfo * finfo, GroupInfo * ginfo, ProcInfo * pinfo)
 {
-  if (gaps == NULL || ginfo->gapSet.empty()) {
+  if ((os == NULL && binWriter == NULL) || gaps == NULL
+      || ginfo->gapSet.empty()) {
     return;
   }
 
@@ -347,23 +406,9 @@ doGaps(ostream * os, ostream * gaps, string gaps_file,
 	<< "0x" << hex << ginfo->start << "--0x" << ginfo->end << dec << "\n\n";
   gaps_line += 6;
 
-  doIndent(os, 3);
-  *os << "<A"
-      << INDEX
-      << NUMBER("l", pinfo->line_num)
-      << STRING("f", finfo->fileName)
-      << STRING("n", "")
-      << " v=\"{}\""
-      << ">\n";
-
-  doIndent(os, 4);
-  *os << "<A"
-      << INDEX
-      << NUMBER("l", gaps_line - 4)
-      << STRING("f", gaps_file)
-      << STRING("n", "unclaimed region in: " + pinfo->prettyName)
-      << " v=\"{}\""
-      << ">\n";
+  doAlienBegin(os, 3, pinfo->line_num, finfo->fileName, "");
+  doAlienBegin(os, 4, gaps_line - 4, gaps_file,
+	       "unclaimed region in: " + pinfo->prettyName);
 
   for (auto git = ginfo->gapSet.begin(); git != ginfo->gapSet.end(); ++git) {
     long start = git->beg();
@@ -374,19 +419,25 @@ doGaps(ostream * os, ostream * gaps, string gaps_file,
 	  << dec << "  (" << len << ")\n";
     gaps_line++;
 
-    doIndent(os, 5);
-    *os << "<S"
-	<< INDEX
-	<< NUMBER("l", gaps_line)
-	<< VRANGE(start, len)
-	<< "/>\n";
-  }
+    long index = next_index++;
 
-  doIndent(os, 4);
-  *os << "</A>\n";
+    if (os != NULL) {
+      doIndent(os, 5);
+      *os << "<S"
+	  << INDEX(index)
+	  << NUMBER("l", gaps_line)
+	  << VRANGE(start, len)
+	  << "/>\n";
+    }
+    if (binWriter != NULL) {
+      VMAIntervalSet vset;
+      vset.insert(start, start + len);
+      binWriter->stmt(index, gaps_line, gaps_line, vset);
+    }
+  }
 
-  doIndent(os, 3);
-  *os << "</A>\n";
+  doAlienEnd(os, 4);
+  doAlienEnd(os, 3);
 }
 
 //----------------------------------------------------------------------
@@ -487,20 +538,13 @@ doTreeNode(ostream * os, int depth, TreeNode * root, ScopeInfo scope,
     locateTree(node, alien_scope, strTab, true);
 
     // guard alien
-    doIndent(os, depth);
-    *os << "<A"
-	<< INDEX
-	<< NUMBER("l", alien_scope.line_num)
-	<< STRING("f", strTab.index2str(file_index))
-	<< STRING("n", GUARD_NAME)
-	<< " v=\"{}\""
-	<< ">\n";
+    doAlienBegin(os, depth, alien_scope.line_num,
+		 strTab.index2str(file_index), GUARD_NAME);
 
     doStmtList(os, depth + 1, node);
     doLoopList(os, depth + 1, node, strTab);
 
-    doIndent(os, depth);
-    *os << "</A>\n";
+    doAlienEnd(os, depth);
 
     node->clear();
     delete node;
@@ -522,34 +566,56 @@ doTreeNode(ostream * os, int depth, TreeNode * root, ScopeInfo scope,
 
     // outer, caller alien.  use file and line from flp call site, but
     // empty proc name.
-    doIndent(os, depth);
-    *os << "<A"
-	<< INDEX
-	<< NUMBER("l", flp.line_num)
-	<< STRING("f", strTab.index2str(flp.file_index))
-	<< STRING("n", "")
-	<< " v=\"{}\""
-	<< ">\n";
+    doAlienBegin(os, depth, flp.line_num,
+		 strTab.index2str(flp.file_index), "");
 
     // inner, callee alien.  use proc name from flp call site, but
     // file and line from subtree.
-    doIndent(os, depth + 1);
-    *os << "<A"
-	<< INDEX
-	<< NUMBER("l", subscope.line_num)
-	<< STRING("f", strTab.index2str(subscope.file_index))
-	<< STRING("n", callname)
-	<< " v=\"{}\""
-	<< ">\n";
+    doAlienBegin(os, depth + 1, subscope.line_num,
+		 strTab.index2str(subscope.file_index), callname);
 
     doTreeNode(os, depth + 2, subtree, subscope, strTab);
 
-    doIndent(os, depth + 1);
-    *os << "</A>\n";
+    doAlienEnd(os, depth + 1);
+    doAlienEnd(os, depth);
+  }
+}
+
+//----------------------------------------------------------------------
 
+// Begin <A> alien tag (guard, double or gap alien).
+static void
+doAlienBegin(ostream * os, int depth, long line, const string & file,
+	     const string & name)
+{
+  long index = next_index++;
+
+  if (os != NULL) {
+    doIndent(os, depth);
+    *os << "<A"
+	<< INDEX(index)
+	<< NUMBER("l", line)
+	<< STRING("f", file)
+	<< STRING("n", name)
+	<< " v=\"{}\""
+	<< ">\n";
+  }
+  if (binWriter != NULL) {
+    binWriter->beginAlien(index, file, name, line, line);
+  }
+}
+
+// Closing </A> tag.
+static void
+doAlienEnd(ostream * os, int depth)
+{
+  if (os != NULL) {
     doIndent(os, depth);
     *os << "</A>\n";
   }
+  if (binWriter != NULL) {
+    binWriter->end();
+  }
 }
 
 //----------------------------------------------------------------------
@@ -597,12 +663,19 @@ doStmtList(ostream * os, int depth, TreeNode * node)
     long line = mit->first;
     VMAIntervalSet * vset = mit->second;
 
-    doIndent(os, depth);
-    *os << "<S"
-	<< INDEX
-	<< NUMBER("l", line)
-	<< " v=\"" << vset->toString() << "\""
-	<< "/>\n";
+    long index = next_index++;
+
+    if (os != NULL) {
+      doIndent(os, depth);
+      *os << "<S"
+	  << INDEX(index)
+	  << NUMBER("l", line)
+	  << " v=\"" << vset->toString() << "\""
+	  << "/>\n";
+    }
+    if (binWriter != NULL) {
+      binWriter->stmt(index, line, line, *vset);
+    }
 
     delete vset;
   }
@@ -611,19 +684,31 @@ doStmtList(ostream * os, int depth, TreeNode * node)
   for (uint i = 0; i < callVec.size(); i++) {
     StmtInfo * sinfo = callVec[i];
 
-    doIndent(os, depth);
-    *os << "<C"
-	<< INDEX
-	<< NUMBER("l", sinfo->line_num)
-	<< VRANGE(sinfo->vma, sinfo->len);
+    long index = next_index++;
+    bool hasTarget = (! sinfo->is_sink && ENABLE_TARGET_FIELD);
+
+    if (os != NULL) {
+      doIndent(os, depth);
+      *os << "<C"
+	  << INDEX(index)
+	  << NUMBER("l", sinfo->line_num)
+	  << VRANGE(sinfo->vma, sinfo->len);
 
-    if (! sinfo->is_sink && ENABLE_TARGET_FIELD) {
-      *os << HEX("t", sinfo->target);
+      if (hasTarget) {
+	*os << HEX("t", sinfo->target);
+      }
+      if (ENABLE_DEVICE_FIELD) {
+	*os << STRING("d", sinfo->device);
+      }
+      *os << "/>\n";
     }
-    if (ENABLE_DEVICE_FIELD) {
-      *os << STRING("d", sinfo->device);
+    if (binWriter != NULL) {
+      VMAIntervalSet vset;
+      vset.insert(sinfo->vma, sinfo->vma + sinfo->len);
+      binWriter->call(index, sinfo->line_num, vset,
+		      hasTarget, sinfo->target,
+		      (ENABLE_DEVICE_FIELD) ? sinfo->device : string(""));
     }
-    *os << "/>\n";
   }
 }
 
@@ -639,18 +724,33 @@ doLoopList(ostream * os, int depth, TreeNode * node, HPC::StringTable & strTab)
     LoopInfo * linfo = *lit;
     ScopeInfo scope(linfo->file_index, linfo->base_index);
 
-    doIndent(os, depth);
-    *os << "<L"
-	<< INDEX
-	<< NUMBER("l", linfo->line_num)
-	<< STRING("f", strTab.index2str(linfo->file_index))
-	<< VRANGE(linfo->entry_vma, 1)
-	<< ">\n";
+    long index = next_index++;
+
+    if (os != NULL) {
+      doIndent(os, depth);
+      *os << "<L"
+	  << INDEX(index)
+	  << NUMBER("l", linfo->line_num)
+	  << STRING("f", strTab.index2str(linfo->file_index))
+	  << VRANGE(linfo->entry_vma, 1)
+	  << ">\n";
+    }
+    if (binWriter != NULL) {
+      VMAIntervalSet vset;
+      vset.insert(linfo->entry_vma, linfo->entry_vma + 1);
+      binWriter->beginLoop(index, strTab.index2str(linfo->file_index),
+			   linfo->line_num, linfo->line_num, vset);
+    }
 
     doTreeNode(os, depth + 1, linfo->node, scope, strTab);
 
-    doIndent(os, depth);
-    *os << "</L>\n";
+    if (os != NULL) {
+      doIndent(os, depth);
+      *os << "</L>\n";
+    }
+    if (binWriter != NULL) {
+      binWriter->end();
+    }
   }
 }
 
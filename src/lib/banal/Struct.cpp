@@ -555,7 +555,8 @@ printTime(const char *label, struct timeval *tv_prev, struct rusage *ru_prev,
 //
 // Read the binutils load module and the parseapi code object, iterate
 // over functions, loops and blocks, make an internal inline tree and
-// write an hpcstruct file to 'outFile'.
+// write an hpcstruct file to 'outFile' (xml) and/or 'binFile'
+// (binary structure format).  Either may be NULL.
 //
 // Fixme: may want to rethink the split between tool/hpcstruct and
 // lib/banal.
@@ -563,6 +564,7 @@ printTime(const char *label, struct timeval *tv_prev, struct rusage *ru_prev,
 void
 makeStructure(string filename,
 	      ostream * outFile,
+	      ostream * binFile,
 	      ostream * gapsFile,
 	      string gaps_filenm,
 	      string search_path,
@@ -590,7 +592,7 @@ makeStructure(string filename,
     return;
   }
 
-  Output::printStructFileBegin(outFile, gapsFile, sfilename);
+  Output::printStructFileBegin(outFile, gapsFile, binFile, sfilename);
 
   for (uint i = 0; i < elfFileVector->size(); i++) {
     bool parsable = true;
@@ -86,6 +86,7 @@ public:
 void
 makeStructure(std::string filename,
 	      std::ostream * outFile,
+	      std::ostream * binFile,
 	      std::ostream * gapsFile,
 	      std::string gaps_filenm,
 	      std::string search_path,
@@ -76,85 +76,111 @@ using namespace std;
 //****************************************************************************
 
 //
-// makeStructureSimple -- make a Prof::Struct::Stmt node and path up
-// to lmStruct for vma.
+// findSimpleInfo -- query the binutils load module (lm) for everything
+// makeStructureSimple() needs to know about vma.
 //
-Prof::Struct::Stmt *
-BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
-				   BinUtil::LM * lm, VMA vma)
+void
+BAnal::Struct::findSimpleInfo(BinUtil::LM * lm, VMA vma, SimpleInfo & info)
 {
   //
   // begin address for proc containing vma, and proc and file name
   //
-  string prettynm, linknm, proc_filenm;
-  SrcFile::ln proc_line = 0;
-  VMA proc_vma = vma;
+  info.linkName.clear();
+  info.procFile.clear();
+  info.procLine = 0;
+  info.procVMA = vma;
 
   BinUtil::Proc * bproc = lm->findProc(vma);
-
   if (bproc != NULL) {
-    proc_vma = bproc->begVMA();
-    lm->findSrcCodeInfo(proc_vma, 0, linknm, proc_filenm, proc_line);
+    info.procVMA = bproc->begVMA();
+    lm->findSrcCodeInfo(info.procVMA, 0, info.linkName, info.procFile,
+			info.procLine);
   } else {
-    lm->findSimpleFunction(proc_vma, linknm);
+    lm->findSimpleFunction(info.procVMA, info.linkName);
   }
 
-  if (proc_filenm.empty()) {
-    proc_filenm = string(UNKNOWN_FILE)
+  if (info.procFile.empty()) {
+    info.procFile = string(UNKNOWN_FILE)
         + " [" + FileUtil::basename(lm->name().c_str()) + "]";
   }
 
-  if (! linknm.empty()) {
-    prettynm = BinUtil::demangleProcName(linknm);
+  if (! info.linkName.empty()) {
+    info.prettyName = BinUtil::demangleProcName(info.linkName);
   }
   else {
     stringstream buf;
-
-    buf << UNKNOWN_PROC << " 0x" << hex << proc_vma << dec
+    buf << UNKNOWN_PROC << " 0x" << hex << info.procVMA << dec
 	<< " [" << FileUtil::basename(lm->name().c_str()) << "]";
-    prettynm = buf.str();
+    info.prettyName = buf.str();
   }
 
-  Prof::Struct::File * fileStruct =
-    Prof::Struct::File::demand(lmStruct, proc_filenm);
-
-  Prof::Struct::Proc * procStruct =
-    Prof::Struct::Proc::demand(fileStruct, prettynm, linknm, proc_line, proc_line);
-
   //
   // file and line for vma (stmt), and end vma
   //
-  string stmt_procnm, stmt_filenm;
-  SrcFile::ln stmt_line = 0;
-  VMA end_vma = vma + 1;
+  string stmt_procnm;
+  info.stmtFile.clear();
+  info.stmtLine = 0;
+  info.endVMA = vma + 1;
 
-  lm->findSrcCodeInfo(vma, 0, stmt_procnm, stmt_filenm, stmt_line);
+  lm->findSrcCodeInfo(vma, 0, stmt_procnm, info.stmtFile, info.stmtLine);
 
   BinUtil::Insn * insn = lm->findInsn(vma, 0);
   if (insn) {
-    end_vma = insn->endVMA();
+    info.endVMA = insn->endVMA();
   }
+}
+
+
+//
+// makeStructureSimple -- make a Prof::Struct::Stmt node and path up
+// to lmStruct for vma.
+//
+Prof::Struct::Stmt *
+BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
+				   BinUtil::LM * lm, VMA vma)
+{
+  SimpleInfo info;
+  findSimpleInfo(lm, vma, info);
+  return makeStructureSimple(lmStruct, vma, info);
+}
+
+
+//
+// makeStructureSimple -- same as above, given the load module's
+// information about vma (e.g., from a SimpleCache).
+//
+Prof::Struct::Stmt *
+BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct, VMA vma,
+				   const SimpleInfo & info)
+{
+  Prof::Struct::File * fileStruct =
+    Prof::Struct::File::demand(lmStruct, info.procFile);
+
+  Prof::Struct::Proc * procStruct =
+    Prof::Struct::Proc::demand(fileStruct, info.prettyName, info.linkName,
+			       info.procLine, info.procLine);
 
   Prof::Struct::Stmt * stmt = NULL;
 
   // stmts with known file and line that differs from proc need a
   // guard alien
-  if ((! stmt_filenm.empty()) && stmt_line != 0
-      && (stmt_filenm != proc_filenm || stmt_line < proc_line))
+  if ((! info.stmtFile.empty()) && info.stmtLine != 0
+      && (info.stmtFile != info.procFile || info.stmtLine < info.procLine))
   {
-    Prof::Struct::Alien * alien = procStruct->demandGuardAlien(stmt_filenm, stmt_line);
-    stmt = alien->demandStmt(stmt_line, vma, end_vma);
+    Prof::Struct::Alien * alien =
+      procStruct->demandGuardAlien(info.stmtFile, info.stmtLine);
+    stmt = alien->demandStmt(info.stmtLine, vma, info.endVMA);
   }
   else {
-    stmt = procStruct->demandStmtSimple(stmt_line, vma, end_vma);
+    stmt = procStruct->demandStmtSimple(info.stmtLine, vma, info.endVMA);
   }
 
 #if DEBUG_STRUCT_SIMPLE
   cout << "------------------------------------------------------------\n"
-       << "0x" << hex << vma << "--0x" << end_vma << dec << "  (struct simple)\n"
-       << "line:  " << stmt_line << "\n"
-       << "file:  " << stmt_filenm << "\n"
-       << "name:  " << linknm << "\n\n";
+       << "0x" << hex << vma << "--0x" << info.endVMA << dec << "  (struct simple)\n"
+       << "line:  " << info.stmtLine << "\n"
+       << "file:  " << info.stmtFile << "\n"
+       << "name:  " << info.linkName << "\n\n";
 
   stmt->dumpmePath(cout, 0, "");
   cout << "\n";
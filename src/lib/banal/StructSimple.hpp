@@ -62,6 +62,8 @@
 
 //************************* System Include Files ****************************
 
+#include <string>
+
 //*************************** User Include Files ****************************
 
 #include <include/uint.h> 
@@ -86,6 +88,31 @@ namespace Struct {
   Prof::Struct::Stmt*
   makeStructureSimple(Prof::Struct::LM* lmStrct, BinUtil::LM* lm, VMA vma);
 
+
+  // SimpleInfo: What makeStructureSimple() uses from a load module
+  // for one vma: the enclosing procedure and the vma's source line.
+  // All of it can be saved and reused without the load module (cf.
+  // BAnal::Struct::SimpleCache).
+  struct SimpleInfo {
+    VMA endVMA;              // end of the instruction at vma
+
+    VMA procVMA;             // begin of the enclosing procedure
+    std::string linkName;
+    std::string prettyName;
+    std::string procFile;
+    SrcFile::ln procLine;
+
+    std::string stmtFile;
+    SrcFile::ln stmtLine;
+  };
+
+  void
+  findSimpleInfo(BinUtil::LM* lm, VMA vma, SimpleInfo& info);
+
+  Prof::Struct::Stmt*
+  makeStructureSimple(Prof::Struct::LM* lmStrct, VMA vma,
+		      const SimpleInfo& info);
+
 } // namespace Struct
 
 } // namespace BAnal
@@ -0,0 +1,555 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <cstdio>
+#include <cstring>
+
+#include <elf.h>
+#include <unistd.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "StructSimpleCache.hpp"
+
+#include <lib/prof-lean/hpcfmt.h>
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/FileUtil.hpp>
+
+//*************************** Forward Declarations ***************************
+
+#define SIMPLE_CACHE_MAGIC    "HPCToolkit-struct-simple-cache"
+#define SIMPLE_CACHE_VERSION  1
+#define SIMPLE_CACHE_SUFFIX   ".hpcsc"
+
+// sanity limits for reading
+#define SIMPLE_CACHE_MAX_STR  (1u << 20)
+#define SIMPLE_CACHE_MAX_NUM  (1u << 28)
+
+static bool
+readStr(FILE* fs, string& x);
+
+static bool
+writeStr(FILE* fs, const string& x);
+
+//***************************************************************************
+
+namespace BAnal {
+
+namespace Struct {
+
+
+SimpleCache::SimpleCache(const string& cacheDir, const string& lmName)
+  : m_isModified(false)
+{
+  string lmKey = key(lmName);
+  if (lmKey.empty()) {
+    DIAG_Msg(2, "struct simple cache: cannot read '" << lmName << "'");
+    return;
+  }
+
+  try {
+    if (!FileUtil::isDir(cacheDir)) {
+      FileUtil::mkdir(cacheDir);
+    }
+  }
+  catch (const Diagnostics::Exception& x) {
+    DIAG_WMsgIf(1, "Cannot create cache directory '" << cacheDir << "': "
+		<< x.what());
+    return;
+  }
+
+  m_fnm = cacheDir + "/" + FileUtil::basename(lmName) + "-" + lmKey
+    + SIMPLE_CACHE_SUFFIX;
+
+  // id 0 is the empty string
+  strId(string());
+
+  read();
+}
+
+
+SimpleCache::SimpleCache()
+  : m_isModified(false)
+{
+  // id 0 is the empty string
+  strId(string());
+}
+
+
+SimpleCache::~SimpleCache()
+{
+}
+
+
+bool
+SimpleCache::find(VMA vma, SimpleInfo& info) const
+{
+  std::map<VMA, StmtInfo>::const_iterator it = m_stmts.find(vma);
+  if (it == m_stmts.end()) {
+    return false;
+  }
+
+  const StmtInfo& stmt = it->second;
+  const ProcInfo& proc = m_procs[stmt.proc];
+
+  info.endVMA     = stmt.endVMA;
+  info.procVMA    = proc.procVMA;
+  info.linkName   = m_strs[proc.linkName];
+  info.prettyName = m_strs[proc.prettyName];
+  info.procFile   = m_strs[proc.procFile];
+  info.procLine   = proc.procLine;
+  info.stmtFile   = m_strs[stmt.stmtFile];
+  info.stmtLine   = stmt.stmtLine;
+  return true;
+}
+
+
+void
+SimpleCache::insert(VMA vma, const SimpleInfo& info)
+{
+  uint procIdx;
+  std::map<VMA, uint>::iterator it = m_procVMAToIdx.find(info.procVMA);
+  if (it != m_procVMAToIdx.end()) {
+    procIdx = it->second;
+  }
+  else {
+    ProcInfo proc;
+    proc.procVMA    = info.procVMA;
+    proc.linkName   = strId(info.linkName);
+    proc.prettyName = strId(info.prettyName);
+    proc.procFile   = strId(info.procFile);
+    proc.procLine   = info.procLine;
+
+    procIdx = m_procs.size();
+    m_procs.push_back(proc);
+    m_procVMAToIdx.insert(std::make_pair(info.procVMA, procIdx));
+  }
+
+  StmtInfo stmt;
+  stmt.endVMA   = info.endVMA;
+  stmt.proc     = procIdx;
+  stmt.stmtFile = strId(info.stmtFile);
+  stmt.stmtLine = info.stmtLine;
+
+  m_stmts[vma] = stmt;
+  m_isModified = true;
+}
+
+
+uint
+SimpleCache::strId(const string& x)
+{
+  std::map<string, uint>::iterator it = m_strToId.find(x);
+  if (it != m_strToId.end()) {
+    return it->second;
+  }
+  uint id = m_strs.size();
+  m_strs.push_back(x);
+  m_strToId.insert(std::make_pair(x, id));
+  return id;
+}
+
+
+//***************************************************************************
+// Reading and writing
+//***************************************************************************
+
+// Format (all integers in hpcfmt, i.e., big-endian, byte order):
+//   magic (str), version (int4), BinUtil::LM name (str)
+//   strings: count (int4), then each (str); id 0 is ""
+//   procs:   count (int4), then each
+//              procVMA (int8), linkName, prettyName, procFile (int4
+//              string ids), procLine (int4)
+//   stmts:   count (int4), then each, in increasing vma order
+//              vma (int8), endVMA - vma (int4), proc (int4 index),
+//              stmtFile (int4 string id), stmtLine (int4)
+// where 'str' is a length (int4) followed by the bytes.
+
+void
+SimpleCache::read()
+{
+  FILE* fs = fopen(m_fnm.c_str(), "r");
+  if (!fs) {
+    return;
+  }
+
+  bool isOK = fmt_fread(fs);
+  fclose(fs);
+
+  if (!isOK) {
+    DIAG_WMsgIf(1, "Ignoring invalid cache file '" << m_fnm << "'");
+    return;
+  }
+
+  DIAG_Msg(2, "struct simple cache: read " << m_stmts.size()
+	   << " entries from '" << m_fnm << "'");
+}
+
+
+void
+SimpleCache::write()
+{
+  if (!isValid() || !m_isModified) {
+    return;
+  }
+
+  // write a private file and rename it over the old one (N.B.: the
+  // host name distinguishes processes on different nodes)
+  char host[128] = "";
+  gethostname(host, sizeof(host) - 1);
+  string tmpFnm = m_fnm + "." + host + "." + std::to_string(getpid());
+
+  FILE* fs = fopen(tmpFnm.c_str(), "w");
+  if (!fs) {
+    DIAG_WMsgIf(1, "Cannot write cache file '" << tmpFnm << "'");
+    return;
+  }
+
+  bool isOK = fmt_fwrite(fs);
+  isOK = (fclose(fs) == 0) && isOK;
+  isOK = isOK && (rename(tmpFnm.c_str(), m_fnm.c_str()) == 0);
+
+  if (!isOK) {
+    unlink(tmpFnm.c_str());
+    DIAG_WMsgIf(1, "Cannot write cache file '" << m_fnm << "'");
+    return;
+  }
+
+  m_isModified = false;
+  DIAG_Msg(2, "struct simple cache: wrote " << m_stmts.size()
+	   << " entries to '" << m_fnm << "'");
+}
+
+
+bool
+SimpleCache::fmt_fread(FILE* fs)
+{
+  bool isOK = true;
+  string magic;
+  uint32_t version = 0;
+  isOK = (readStr(fs, magic) && magic == SIMPLE_CACHE_MAGIC
+	  && hpcfmt_int4_fread(&version, fs) == HPCFMT_OK
+	  && version == SIMPLE_CACHE_VERSION
+	  && readStr(fs, m_lmName));
+
+  // strings (N.B.: the first is always "", which is already present)
+  uint32_t numStrs = 0;
+  isOK = isOK && (hpcfmt_int4_fread(&numStrs, fs) == HPCFMT_OK)
+    && numStrs >= 1 && numStrs < SIMPLE_CACHE_MAX_NUM;
+  for (uint i = 0; isOK && i < numStrs; ++i) {
+    string x;
+    isOK = readStr(fs, x) && (i != 0 || x.empty());
+    if (isOK && i != 0) {
+      isOK = (strId(x) == i); // no duplicates
+    }
+  }
+
+  // procs
+  uint32_t numProcs = 0;
+  isOK = isOK && (hpcfmt_int4_fread(&numProcs, fs) == HPCFMT_OK)
+    && numProcs < SIMPLE_CACHE_MAX_NUM;
+  for (uint i = 0; isOK && i < numProcs; ++i) {
+    ProcInfo proc;
+    uint64_t procVMA = 0;
+    uint32_t procLine = 0;
+    isOK = (hpcfmt_int8_fread(&procVMA, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&proc.linkName, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&proc.prettyName, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&proc.procFile, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&procLine, fs) == HPCFMT_OK
+	    && proc.linkName < numStrs && proc.prettyName < numStrs
+	    && proc.procFile < numStrs);
+    proc.procVMA = procVMA;
+    proc.procLine = procLine;
+    if (isOK) {
+      m_procs.push_back(proc);
+      m_procVMAToIdx.insert(std::make_pair(proc.procVMA, i));
+    }
+  }
+
+  // stmts
+  uint32_t numStmts = 0;
+  isOK = isOK && (hpcfmt_int4_fread(&numStmts, fs) == HPCFMT_OK)
+    && numStmts < SIMPLE_CACHE_MAX_NUM;
+  for (uint i = 0; isOK && i < numStmts; ++i) {
+    StmtInfo stmt;
+    uint64_t vma = 0;
+    uint32_t len = 0, stmtLine = 0;
+    isOK = (hpcfmt_int8_fread(&vma, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&len, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&stmt.proc, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&stmt.stmtFile, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fread(&stmtLine, fs) == HPCFMT_OK
+	    && stmt.proc < numProcs && stmt.stmtFile < numStrs);
+    stmt.endVMA = vma + len;
+    stmt.stmtLine = stmtLine;
+    if (isOK) {
+      m_stmts.insert(m_stmts.end(), std::make_pair((VMA)vma, stmt));
+    }
+  }
+
+  if (!isOK) {
+    clear();
+  }
+  return isOK;
+}
+
+
+bool
+SimpleCache::fmt_fwrite(FILE* fs) const
+{
+  bool isOK = (writeStr(fs, SIMPLE_CACHE_MAGIC)
+	       && hpcfmt_int4_fwrite(SIMPLE_CACHE_VERSION, fs) == HPCFMT_OK
+	       && writeStr(fs, m_lmName));
+
+  isOK = isOK && (hpcfmt_int4_fwrite(m_strs.size(), fs) == HPCFMT_OK);
+  for (uint i = 0; isOK && i < m_strs.size(); ++i) {
+    isOK = writeStr(fs, m_strs[i]);
+  }
+
+  isOK = isOK && (hpcfmt_int4_fwrite(m_procs.size(), fs) == HPCFMT_OK);
+  for (uint i = 0; isOK && i < m_procs.size(); ++i) {
+    const ProcInfo& proc = m_procs[i];
+    isOK = (hpcfmt_int8_fwrite(proc.procVMA, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(proc.linkName, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(proc.prettyName, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(proc.procFile, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(proc.procLine, fs) == HPCFMT_OK);
+  }
+
+  isOK = isOK && (hpcfmt_int4_fwrite(m_stmts.size(), fs) == HPCFMT_OK);
+  for (std::map<VMA, StmtInfo>::const_iterator it = m_stmts.begin();
+       isOK && it != m_stmts.end(); ++it) {
+    const StmtInfo& stmt = it->second;
+    isOK = (hpcfmt_int8_fwrite(it->first, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(stmt.endVMA - it->first, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(stmt.proc, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(stmt.stmtFile, fs) == HPCFMT_OK
+	    && hpcfmt_int4_fwrite(stmt.stmtLine, fs) == HPCFMT_OK);
+  }
+
+  return isOK;
+}
+
+
+void
+SimpleCache::clear()
+{
+  m_lmName.clear();
+  m_strs.clear();
+  m_strToId.clear();
+  m_procs.clear();
+  m_procVMAToIdx.clear();
+  m_stmts.clear();
+  strId(string());
+}
+
+
+//***************************************************************************
+// Keys
+//***************************************************************************
+
+// findBuildId: Set 'id' to the hex digits of the GNU build-id note
+// of the ELF file 'fs'.  Only handles files with the host's byte
+// order, which is the case for the binaries hpcrun measured.
+template<typename Ehdr, typename Shdr>
+static bool
+findBuildId(FILE* fs, string& id)
+{
+  Ehdr ehdr;
+  if (fseek(fs, 0, SEEK_SET) != 0 || fread(&ehdr, sizeof(ehdr), 1, fs) != 1
+      || ehdr.e_shentsize != sizeof(Shdr)) {
+    return false;
+  }
+
+  for (uint i = 0; i < ehdr.e_shnum; ++i) {
+    Shdr shdr;
+    if (fseek(fs, ehdr.e_shoff + (long)i * sizeof(Shdr), SEEK_SET) != 0
+	|| fread(&shdr, sizeof(shdr), 1, fs) != 1) {
+      return false;
+    }
+    if (shdr.sh_type != SHT_NOTE || shdr.sh_size > (1 << 16)) {
+      continue;
+    }
+
+    std::vector<unsigned char> buf(shdr.sh_size);
+    if (buf.empty() || fseek(fs, shdr.sh_offset, SEEK_SET) != 0
+	|| fread(&buf[0], buf.size(), 1, fs) != 1) {
+      continue;
+    }
+
+    // N.B.: note headers are the same size for ELF32 and ELF64
+    size_t off = 0;
+    while (off + sizeof(Elf32_Nhdr) <= buf.size()) {
+      Elf32_Nhdr nhdr;
+      memcpy(&nhdr, &buf[off], sizeof(nhdr));
+      size_t nameOff = off + sizeof(nhdr);
+      size_t descOff = nameOff + ((nhdr.n_namesz + 3) & ~3u);
+      off = descOff + ((nhdr.n_descsz + 3) & ~3u);
+      if (off > buf.size()) {
+	break;
+      }
+
+      if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4
+	  && memcmp(&buf[nameOff], "GNU", 4) == 0 && nhdr.n_descsz > 0) {
+	static const char hex[] = "0123456789abcdef";
+	id.clear();
+	for (uint j = 0; j < nhdr.n_descsz; ++j) {
+	  unsigned char c = buf[descOff + j];
+	  id += hex[c >> 4];
+	  id += hex[c & 0xf];
+	}
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
+string
+SimpleCache::key(const string& lmName)
+{
+  FILE* fs = fopen(lmName.c_str(), "r");
+  if (!fs) {
+    return "";
+  }
+
+  string id;
+
+  // 1. GNU build-id
+  unsigned char ident[EI_NIDENT];
+  const uint16_t one = 1;
+  const unsigned char hostData =
+    (*(const unsigned char*)&one == 1) ? ELFDATA2LSB : ELFDATA2MSB;
+
+  if (fread(ident, sizeof(ident), 1, fs) == 1
+      && memcmp(ident, ELFMAG, SELFMAG) == 0 && ident[EI_DATA] == hostData) {
+    bool found = false;
+    if (ident[EI_CLASS] == ELFCLASS64) {
+      found = findBuildId<Elf64_Ehdr, Elf64_Shdr>(fs, id);
+    }
+    else if (ident[EI_CLASS] == ELFCLASS32) {
+      found = findBuildId<Elf32_Ehdr, Elf32_Shdr>(fs, id);
+    }
+    if (found) {
+      fclose(fs);
+      return "b" + id;
+    }
+  }
+
+  // 2. 64-bit FNV-1a hash of the contents
+  uint64_t hash = 14695981039346656037ULL;
+  unsigned char buf[1 << 16];
+  size_t len;
+  if (fseek(fs, 0, SEEK_SET) != 0) {
+    fclose(fs);
+    return "";
+  }
+  while ((len = fread(buf, 1, sizeof(buf), fs)) > 0) {
+    for (size_t i = 0; i < len; ++i) {
+      hash = (hash ^ buf[i]) * 1099511628211ULL;
+    }
+  }
+  bool isErr = ferror(fs);
+  fclose(fs);
+  if (isErr) {
+    return "";
+  }
+
+  char str[32];
+  snprintf(str, sizeof(str), "h%016llx", (unsigned long long)hash);
+  return str;
+}
+
+
+} // namespace Struct
+
+} // namespace BAnal
+
+
+//***************************************************************************
+
+static bool
+readStr(FILE* fs, string& x)
+{
+  uint32_t len = 0;
+  if (hpcfmt_int4_fread(&len, fs) != HPCFMT_OK || len > SIMPLE_CACHE_MAX_STR) {
+    return false;
+  }
+  x.resize(len);
+  return (len == 0 || fread(&x[0], 1, len, fs) == len);
+}
+
+
+static bool
+writeStr(FILE* fs, const string& x)
+{
+  return (hpcfmt_int4_fwrite(x.size(), fs) == HPCFMT_OK
+	  && (x.empty() || fwrite(x.data(), 1, x.size(), fs) == x.size()));
+}
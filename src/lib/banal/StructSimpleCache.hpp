@@ -0,0 +1,221 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A persistent, on-disk cache of the load module information used
+//   by BAnal::Struct::makeStructureSimple().
+//
+// Description:
+//   When a load module has no hpcstruct file, hpcprof opens it with
+//   binutils and, for each sampled vma, finds the enclosing procedure
+//   and the vma's source line.  Reading symbols and line maps is
+//   usually the most expensive part, and it is repeated on every run
+//   even if the binaries have not changed.
+//
+//   A SimpleCache saves the procedures and the vma-to-line entries
+//   found for one load module in a compact binary file in a cache
+//   directory.  The file is named after the load module's GNU
+//   build-id, or a hash of its contents if it has none, so that a
+//   rebuilt binary never uses stale entries.  If a later run only
+//   needs vmas that are in the cache, the load module need not be
+//   opened at all; otherwise, the new entries are added to the file.
+//
+//   Files are replaced by rename(), so concurrent writers (e.g., the
+//   ranks of hpcprof-mpi) never leave a partial file; the last writer
+//   wins.
+//
+//   A cache may also live only in memory, e.g., to send the entries
+//   that one hpcprof-mpi process read to the others (cf. fmt_fwrite()).
+//
+//***************************************************************************
+
+#ifndef BAnal_StructSimpleCache_hpp
+#define BAnal_StructSimpleCache_hpp
+
+//************************* System Include Files ****************************
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include <lib/binutils/VMAInterval.hpp>
+
+#include <lib/support/SrcFile.hpp>
+
+#include "StructSimple.hpp"
+
+//*************************** Forward Declarations ***************************
+
+//***************************************************************************
+
+namespace BAnal {
+
+namespace Struct {
+
+class SimpleCache {
+public:
+  // Find the cache file for the load module 'lmName' in directory
+  // 'cacheDir' and read it, if it exists.  Creates 'cacheDir' if
+  // necessary.  If the load module cannot be read, isValid() is false
+  // and the cache is neither read nor written.
+  SimpleCache(const std::string& cacheDir, const std::string& lmName);
+
+  // an empty cache without a file: isValid() is false and write() does
+  // nothing
+  SimpleCache();
+
+  ~SimpleCache();
+
+  bool
+  isValid() const
+  { return !m_fnm.empty(); }
+
+  // the name recorded with BinUtil::LM::name(); empty if unknown
+  const std::string&
+  lmName() const
+  { return m_lmName; }
+
+  void
+  lmName(const std::string& x)
+  {
+    if (x != m_lmName) {
+      m_lmName = x;
+      m_isModified = true;
+    }
+  }
+
+  // find: Returns whether 'vma' is in the cache and, if so, sets 'info'
+  bool
+  find(VMA vma, SimpleInfo& info) const;
+
+  void
+  insert(VMA vma, const SimpleInfo& info);
+
+  uint
+  size() const
+  { return m_stmts.size(); }
+
+  // write: write the cache file if there are new entries.  Errors are
+  // not fatal: the cache is only an optimization.
+  void
+  write();
+
+  // fmt_fwrite/fmt_fread: write/read the entries and lmName() in the
+  // format of the cache file to/from 'fs'.  fmt_fread() expects an
+  // empty cache; if 'fs' is invalid, it returns false and leaves the
+  // cache empty.
+  bool
+  fmt_fwrite(FILE* fs) const;
+
+  bool
+  fmt_fread(FILE* fs);
+
+  // key: the load module's build-id ('b' followed by hex digits) or,
+  // if it has none, a hash of its contents ('h'); empty on error
+  static std::string
+  key(const std::string& lmName);
+
+private:
+  SimpleCache(const SimpleCache& x);
+
+  SimpleCache&
+  operator=(const SimpleCache& x);
+
+  void
+  read();
+
+  uint
+  strId(const std::string& x);
+
+  void
+  clear();
+
+private:
+  struct ProcInfo {
+    VMA procVMA;
+    uint linkName, prettyName, procFile; // string ids
+    SrcFile::ln procLine;
+  };
+
+  struct StmtInfo {
+    VMA endVMA;
+    uint proc;     // index into m_procs
+    uint stmtFile; // string id
+    SrcFile::ln stmtLine;
+  };
+
+  std::string m_fnm;
+  std::string m_lmName;
+
+  std::vector<std::string> m_strs;
+  std::map<std::string, uint> m_strToId;
+
+  std::vector<ProcInfo> m_procs;
+  std::map<VMA, uint> m_procVMAToIdx;
+
+  std::map<VMA, StmtInfo> m_stmts;
+
+  bool m_isModified;
+};
+
+} // namespace Struct
+
+} // namespace BAnal
+
+//***************************************************************************
+
+#endif // BAnal_StructSimpleCache_hpp
@@ -67,6 +67,7 @@
 
 #include <set>
 #include <map>
+#include <vector>
 
 //*************************** User Include Files ****************************
 
@@ -505,6 +506,120 @@ private:
 };
 
 
+//***************************************************************************
+// VMAIntervalIndex
+//***************************************************************************
+
+// --------------------------------------------------------------------------
+// VMAIntervalIndex: an immutable, flattened snapshot of a
+// VMAIntervalMap for lookup-heavy phases.  Interval bounds and values
+// are stored in sorted parallel arrays, so a lookup is a branch-light
+// binary search over contiguous memory instead of a walk over
+// red-black tree nodes.  find(vma) has exactly the semantics of
+// VMAIntervalMap::find() on the unit interval [vma, vma+1).
+//
+// The index does not observe later changes to its source map; it must
+// be rebuilt (or discarded) when the map changes.
+// --------------------------------------------------------------------------
+
+template <typename T>
+class VMAIntervalIndex
+{
+public:
+  typedef T            mapped_type;
+  typedef std::size_t  size_type;
+
+public:
+  // -------------------------------------------------------
+  // constructor/destructor
+  // -------------------------------------------------------
+  VMAIntervalIndex()
+  { }
+
+  explicit VMAIntervalIndex(const VMAIntervalMap<T>& x)
+  { build(x); }
+
+  ~VMAIntervalIndex()
+  { }
+
+  // build: replace the contents with a snapshot of 'x'
+  void
+  build(const VMAIntervalMap<T>& x)
+  {
+    m_beg.clear();
+    m_end.clear();
+    m_val.clear();
+    m_beg.reserve(x.size());
+    m_end.reserve(x.size());
+    m_val.reserve(x.size());
+    for (typename VMAIntervalMap<T>::const_iterator it = x.begin();
+	 it != x.end(); ++it) {
+      m_beg.push_back(it->first.beg());
+      m_end.push_back(it->first.end());
+      m_val.push_back(it->second);
+    }
+  }
+
+  size_type
+  size() const
+  { return m_beg.size(); }
+
+  bool
+  empty() const
+  { return m_beg.empty(); }
+
+  // find: Given a VMA, return a pointer to the value mapped to the
+  //   interval that contains [vma, vma+1), or NULL if there is none.
+  const T*
+  find(VMA vma) const
+  {
+    const size_type sz = m_beg.size();
+    if (sz == 0) {
+      return NULL;
+    }
+
+    const VMA* beg = &m_beg[0];
+    const VMA* end = &m_end[0];
+    const VMA vma_end = vma + 1;
+
+    // lb: first interval !< [vma, vma+1), using operator<(VMAInterval).
+    // The loop body compiles to a conditional move.
+    size_type lb = 0;
+    size_type n = sz;
+    while (n > 1) {
+      size_type half = n / 2;
+      size_type i = lb + half - 1;
+      bool lt = (beg[i] < vma) || (beg[i] == vma && end[i] < vma_end);
+      lb = lt ? lb + half : lb;
+      n -= half;
+    }
+    lb += ((beg[lb] < vma) || (beg[lb] == vma && end[lb] < vma_end));
+
+    // As with VMAIntervalMap::find(), only 'lb' and its predecessor
+    // can contain the unit interval
+    if (lb < sz && beg[lb] <= vma && end[lb] >= vma_end) {
+      return &m_val[lb];
+    }
+    if (lb > 0 && beg[lb - 1] <= vma && end[lb - 1] >= vma_end) {
+      return &m_val[lb - 1];
+    }
+    return NULL;
+  }
+
+private:
+  VMAIntervalIndex(const VMAIntervalIndex& x);
+
+  VMAIntervalIndex&
+  operator=(const VMAIntervalIndex& x)
+  { return *this; }
+
+private:
+  std::vector<VMA> m_beg;
+  std::vector<VMA> m_end;
+  std::vector<T>   m_val;
+};
+
+
 //***************************************************************************
 
 #endif 
@@ -1002,6 +1002,7 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
   if (nr != HPCMETRICDB_FMT_VersionLen) {
     return HPCFMT_ERR;
   }
+  strcpy(hdr->versionStr, version);
   hdr->version = atof(hdr->versionStr);
 
   nr = fread(&endian, 1, HPCMETRICDB_FMT_EndianLen, infs);
@@ -1012,6 +1013,20 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numNodes), infs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numMetrics), infs));
 
+  hdr->numEntries = 0;
+  hdr->flags = 0;
+  if (HPCMETRICDB_FMT_isSparse(hdr)) {
+    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(hdr->numEntries), infs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->flags), infs));
+  }
+
+  hdr->numDBs = 0;
+  hdr->indexOffset = 0;
+  if (HPCMETRICDB_FMT_isShared(hdr)) {
+    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(hdr->numDBs), infs));
+    HPCFMT_ThrowIfError(hpcfmt_int8_fread(&(hdr->indexOffset), infs));
+  }
+
   return HPCFMT_OK;
 }
 
@@ -1045,7 +1060,156 @@ hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
 
   fprintf(outfs, "(num-nodes:   %u)\n", hdr->numNodes);
   fprintf(outfs, "(num-metrics: %u)\n", hdr->numMetrics);
+  if (HPCMETRICDB_FMT_isSparse(hdr)) {
+    fprintf(outfs, "(num-entries: %"PRIu64")\n", hdr->numEntries);
+    fprintf(outfs, "(flags:       0x%x)\n", hdr->flags);
+  }
+  if (HPCMETRICDB_FMT_isShared(hdr)) {
+    fprintf(outfs, "(num-dbs:     %"PRIu64")\n", hdr->numDBs);
+    fprintf(outfs, "(index:       %"PRIu64")\n", hdr->indexOffset);
+  }
+
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_sparse_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
+{
+  int nw;
+
+  nw = fwrite(HPCMETRICDB_FMT_Magic,   1, HPCMETRICDB_FMT_MagicLen, outfs);
+  if (nw != HPCMETRICDB_FMT_MagicLen) return HPCFMT_ERR;
+
+  nw = fwrite(HPCMETRICDB_FMT_VersionSparse, 1, HPCMETRICDB_FMT_VersionLen,
+	      outfs);
+  if (nw != HPCMETRICDB_FMT_VersionLen) return HPCFMT_ERR;
+
+  nw = fwrite(HPCMETRICDB_FMT_Endian,  1, HPCMETRICDB_FMT_EndianLen, outfs);
+  if (nw != HPCMETRICDB_FMT_EndianLen) return HPCFMT_ERR;
+
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numNodes, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numMetrics, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(hdr->numEntries, outfs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->flags, outfs));
+
+  return HPCFMT_OK;
+}
+
+
+static inline unsigned char*
+hpcmetricDB_encode_be(unsigned char* buf, uint64_t val, int size)
+{
+  for (int shift = (size - 1) * 8; shift >= 0; shift -= 8) {
+    *buf++ = (unsigned char)((val >> shift) & 0xff);
+  }
+  return buf;
+}
+
+
+size_t
+hpcmetricDB_fmt_entries_encode(const hpcmetricDB_fmt_entry_t* x, size_t n,
+			       unsigned char* buf)
+{
+  unsigned char* p = buf;
 
+  for (size_t i = 0; i < n; ++i) {
+    hpcfmt_byte8_union_t v;
+    v.r8 = x[i].value;
+
+    p = hpcmetricDB_encode_be(p, x[i].nodeId, 4);
+    p = hpcmetricDB_encode_be(p, x[i].metricId, 4);
+    p = hpcmetricDB_encode_be(p, v.i8, 8);
+  }
+  return (p - buf);
+}
+
+
+size_t
+hpcmetricDB_fmt_index_encode(const uint64_t* x, size_t n, unsigned char* buf)
+{
+  unsigned char* p = buf;
+
+  for (size_t i = 0; i < n; ++i) {
+    p = hpcmetricDB_encode_be(p, x[i], 8);
+  }
+  return (p - buf);
+}
+
+
+size_t
+hpcmetricDB_fmt_hdr_encode(const hpcmetricDB_fmt_hdr_t* hdr, bool isShared,
+			   unsigned char* buf)
+{
+  unsigned char* p = buf;
+
+  const char* version = (isShared) ? HPCMETRICDB_FMT_VersionShared
+    : HPCMETRICDB_FMT_Version;
+
+  memcpy(p, HPCMETRICDB_FMT_Magic, HPCMETRICDB_FMT_MagicLen);
+  p += HPCMETRICDB_FMT_MagicLen;
+  memcpy(p, version, HPCMETRICDB_FMT_VersionLen);
+  p += HPCMETRICDB_FMT_VersionLen;
+  memcpy(p, HPCMETRICDB_FMT_Endian, HPCMETRICDB_FMT_EndianLen);
+  p += HPCMETRICDB_FMT_EndianLen;
+
+  p = hpcmetricDB_encode_be(p, hdr->numNodes, 4);
+  p = hpcmetricDB_encode_be(p, hdr->numMetrics, 4);
+  if (isShared) {
+    p = hpcmetricDB_encode_be(p, hdr->numDBs, 8);
+    p = hpcmetricDB_encode_be(p, hdr->indexOffset, 8);
+  }
+  return (p - buf);
+}
+
+
+size_t
+hpcmetricDB_fmt_real8_encode(const double* x, size_t n, unsigned char* buf)
+{
+  unsigned char* p = buf;
+
+  for (size_t i = 0; i < n; ++i) {
+    hpcfmt_byte8_union_t v;
+    v.r8 = x[i];
+    p = hpcmetricDB_encode_be(p, v.i8, 8);
+  }
+  return (p - buf);
+}
+
+
+size_t
+hpcmetricDB_fmt_dbidx_encode(uint64_t offset, uint64_t length,
+			     const char* name, unsigned char* buf)
+{
+  unsigned char* p = buf;
+  uint32_t len = strlen(name);
+
+  p = hpcmetricDB_encode_be(p, offset, 8);
+  p = hpcmetricDB_encode_be(p, length, 8);
+  p = hpcmetricDB_encode_be(p, len, 4);
+  memcpy(p, name, len);
+  p += len;
+  return (p - buf);
+}
+
+
+int
+hpcmetricDB_fmt_entry_fread(hpcmetricDB_fmt_entry_t* x, FILE* infs)
+{
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(x->nodeId), infs));
+  HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(x->metricId), infs));
+  HPCFMT_ThrowIfError(hpcfmt_real8_fread(&(x->value), infs));
+  return HPCFMT_OK;
+}
+
+
+int
+hpcmetricDB_fmt_dbidx_fread(uint64_t* offset, uint64_t* length, char** name,
+			    FILE* infs, hpcfmt_alloc_fn alloc)
+{
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(offset, infs));
+  HPCFMT_ThrowIfError(hpcfmt_int8_fread(length, infs));
+  HPCFMT_ThrowIfError(hpcfmt_str_fread(name, infs, alloc));
   return HPCFMT_OK;
 }
 
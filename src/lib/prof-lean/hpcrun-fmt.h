@@ -736,6 +736,8 @@ hpctrace_fmt_datum_fprint(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 
 static const char HPCMETRICDB_FMT_Magic[]   = "HPCPROF-metricdb__"; // 18 bytes
 static const char HPCMETRICDB_FMT_Version[] = "00.10";              // 5 bytes
+static const char HPCMETRICDB_FMT_VersionSparse[] = "01.00";        // 5 bytes
+static const char HPCMETRICDB_FMT_VersionShared[] = "02.00";        // 5 bytes
 static const char HPCMETRICDB_FMT_Endian[]  = "b";                  // 1 byte
 
 #define HPCMETRICDB_FMT_MagicLenX   (sizeof(HPCMETRICDB_FMT_Magic) - 1)
@@ -761,9 +763,62 @@ typedef struct hpcmetricDB_fmt_hdr_t {
   uint32_t numNodes;
   uint32_t numMetrics;
 
+  // sparse format only (version 01.00)
+  uint64_t numEntries;
+  uint32_t flags;
+
+  // shared format only (version 02.00)
+  uint64_t numDBs;
+  uint64_t indexOffset;
+
 } hpcmetricDB_fmt_hdr_t;
 
 
+// The dense format (version 00.10) is a numNodes x numMetrics matrix
+// of real8 values; row i corresponds to node i+1.
+//
+// The sparse format (version 01.00) stores only non-zero values as
+// (nodeId, metricId, value) entries sorted by node and then metric:
+//   [hdr] [node index, if HPCMETRICDB_FMT_FLG_NodeIdx] [entries]
+// The node index has numNodes + 2 int8 byte offsets from the start of
+// the db: the entries for node n occupy bytes [idx[n], idx[n+1]), so
+// a reader can seek directly to them.  (idx[0] is unused.)
+//
+// The shared format (version 02.00) holds the dense metric dbs of many
+// profiles in one file (cf. hpcprof-mpi --metric-db shared):
+//   [hdr] [db]* [db index]
+// Each db, including its header, is as it would be written to its own
+// file.  The db index, at hdr.indexOffset, has hdr.numDBs entries:
+//   int8 offset, int8 length, int4 name length, name
+// where the name is that of the db's own file.  hdr.numMetrics is 0.
+
+#define HPCMETRICDB_FMT_FLG_NodeIdx  0x1
+
+#define HPCMETRICDB_FMT_isSparse(hdr) \
+  ((hdr)->version >= 1.0 && (hdr)->version < 2.0)
+
+#define HPCMETRICDB_FMT_isShared(hdr) ((hdr)->version >= 2.0)
+
+static const int HPCMETRICDB_FMT_DenseHeaderLen =
+  (HPCMETRICDB_FMT_HeaderLen + 4 + 4);
+
+static const int HPCMETRICDB_FMT_SparseHeaderLen =
+  (HPCMETRICDB_FMT_HeaderLen + 4 + 4 + 8 + 4);
+
+static const int HPCMETRICDB_FMT_SharedHeaderLen =
+  (HPCMETRICDB_FMT_HeaderLen + 4 + 4 + 8 + 8);
+
+static const int HPCMETRICDB_FMT_EntryLen = 4 + 4 + 8;
+
+typedef struct hpcmetricDB_fmt_entry_t {
+
+  uint32_t nodeId;
+  uint32_t metricId;
+  double   value;
+
+} hpcmetricDB_fmt_entry_t;
+
+
 int
 hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs);
 
@@ -773,6 +828,52 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 int
 hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
 
+int
+hpcmetricDB_fmt_sparse_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs);
+
+// hpcmetricDB_fmt_entries_encode: encode 'n' entries into 'buf', which
+// must hold n * HPCMETRICDB_FMT_EntryLen bytes, so that they may be
+// written in bulk.  Returns the number of bytes encoded.
+size_t
+hpcmetricDB_fmt_entries_encode(const hpcmetricDB_fmt_entry_t* x, size_t n,
+			       unsigned char* buf);
+
+// hpcmetricDB_fmt_index_encode: encode the 'n' node index offsets in
+// 'x' into 'buf', which must hold n * 8 bytes.  Returns the number of
+// bytes encoded.
+size_t
+hpcmetricDB_fmt_index_encode(const uint64_t* x, size_t n, unsigned char* buf);
+
+// hpcmetricDB_fmt_hdr_encode: encode the dense (or, if 'isShared', the
+// shared) header 'hdr' into 'buf', which must hold
+// HPCMETRICDB_FMT_{Dense,Shared}HeaderLen bytes.  Returns the number
+// of bytes encoded.
+size_t
+hpcmetricDB_fmt_hdr_encode(const hpcmetricDB_fmt_hdr_t* hdr, bool isShared,
+			   unsigned char* buf);
+
+// hpcmetricDB_fmt_real8_encode: encode the 'n' values in 'x' (dense
+// rows) into 'buf', which must hold n * 8 bytes.  Returns the number
+// of bytes encoded.
+size_t
+hpcmetricDB_fmt_real8_encode(const double* x, size_t n, unsigned char* buf);
+
+// hpcmetricDB_fmt_dbidx_encode: encode one entry of a shared db index
+// into 'buf', which must hold 8 + 8 + 4 + strlen(name) bytes.  Returns
+// the number of bytes encoded.
+size_t
+hpcmetricDB_fmt_dbidx_encode(uint64_t offset, uint64_t length,
+			     const char* name, unsigned char* buf);
+
+int
+hpcmetricDB_fmt_entry_fread(hpcmetricDB_fmt_entry_t* x, FILE* infs);
+
+// hpcmetricDB_fmt_dbidx_fread: read one entry of a shared db index;
+// 'name' is allocated with 'alloc'.
+int
+hpcmetricDB_fmt_dbidx_fread(uint64_t* offset, uint64_t* length, char** name,
+			    FILE* infs, hpcfmt_alloc_fn alloc);
+
 // --------------------------------------------------------------------------
 // additional sampling info
 // --------------------------------------------------------------------------
@@ -154,6 +154,11 @@ enum {
   // Instruct a merge function to only perform tree merges; tree
   // inserts are considered errors and throw an exception.
   MrgFlg_AssertCCTMergeOnly  = (1 << 2),
+
+  // With MrgFlg_NormalizeTraceFileY, queue the rewrite of y's trace
+  // file within x rather than performing it during the merge.
+  // Cf. CallPath::Profile::fixTraceFiles().
+  MrgFlg_DeferTraceFileY     = (1 << 4),
   
   // -------------------------------------------------------
   // *Private* CCT Merge flags
@@ -74,11 +74,17 @@ using std::vector;
 #include <set>
 using std::set;
 
+#include <map>
+
 #include <typeinfo>
+#include <algorithm>
+
+#include <cstdio>
 
 //*************************** User Include Files ****************************
 
 #include <include/gcc-attr.h>
+#include <include/hpctoolkit-config.h>
 #include <include/uint.h>
 
 #include "CCT-Tree.hpp"
@@ -95,6 +101,10 @@ using SrcFile::ln_NULL;
 
 #include <lib/support/dictionary.h>
 
+#ifdef ENABLE_OPENMP
+#include <omp.h>
+#endif
+
 //*************************** Forward Declarations ***************************
 
 
@@ -120,10 +130,11 @@ static uint
 getProcIdFromMap(uint proc_id)
 {
   uint id = proc_id;
-  if (Prof::m_mapProcIDs.find(proc_id) != Prof::m_mapProcIDs.end()) {
+  std::map<uint, uint>::iterator it = Prof::m_mapProcIDs.find(proc_id);
+  if (it != Prof::m_mapProcIDs.end()) {
     // the file ID should redirected to another file ID which has 
     // exactly the same filename
-    id = Prof::m_mapProcIDs[proc_id];
+    id = it->second;
   }
   return id;
 }
@@ -145,6 +156,24 @@ getLoadModuleFromMap(uint lm_id)
 
 namespace CCT {
   
+uint Tree::s_numThreads = 1;
+
+
+// numThreads_par: the number of threads for a whole-tree pass that is
+// about to start (cf. Tree::numThreads())
+static uint
+numThreads_par()
+{
+  uint numThreads = 1;
+#ifdef ENABLE_OPENMP
+  if (!omp_in_parallel()) {
+    numThreads = Tree::numThreads();
+  }
+#endif
+  return numThreads;
+}
+
+
 Tree::Tree(const CallPath::Profile* metadata)
   : m_root(NULL), m_metadata(metadata),
     m_maxDenseId(0), m_nodeidMap(NULL),
@@ -200,14 +229,10 @@ Tree::merge(const Tree* y, uint x_newMetricBegIdx, uint mrgFlag, uint oFlag)
   // 
   // -------------------------------------------------------
 
-  if (!m_mergeCtxt) {
-    bool doTrackCPIds = !x->metadata()->traceFileNameSet().empty();
-    m_mergeCtxt = new MergeContext(x, doTrackCPIds);
-  }
-  m_mergeCtxt->flags(mrgFlag);
+  MergeContext& mrgCtxt = x->mergeContext(mrgFlag);
   
   MergeEffectList* mrgEffects =
-    x_root->mergeDeep(y_root, x_newMetricBegIdx, *m_mergeCtxt, oFlag);
+    x_root->mergeDeep(y_root, x_newMetricBegIdx, mrgCtxt, oFlag);
 
   DIAG_If(0 /*public diag level*/) {
     verifyUniqueCPIds();
@@ -217,6 +242,18 @@ Tree::merge(const Tree* y, uint x_newMetricBegIdx, uint mrgFlag, uint oFlag)
 }
 
 
+MergeContext&
+Tree::mergeContext(uint mrgFlag)
+{
+  if (!m_mergeCtxt) {
+    bool doTrackCPIds = !metadata()->traceFileNameSet().empty();
+    m_mergeCtxt = new MergeContext(this, doTrackCPIds);
+  }
+  m_mergeCtxt->flags(mrgFlag);
+  return *m_mergeCtxt;
+}
+
+
 void
 Tree::pruneCCTByNodeId(const uint8_t* prunedNodes)
 {
@@ -282,7 +319,12 @@ Tree::writeXML(std::ostream& os, uint metricBeg, uint metricEnd,
 	       uint oFlags) const
 {
   if (m_root) {
-    m_root->writeXML(os, metricBeg, metricEnd, oFlags);
+    if (isWriteXMLParOK(oFlags) && numThreads_par() > 1) {
+      writeXML_par(os, metricBeg, metricEnd, oFlags);
+    }
+    else {
+      m_root->writeXML(os, metricBeg, metricEnd, oFlags);
+    }
   }
   return os;
 }
@@ -468,83 +510,192 @@ ANode::aggregateMetricsIncl(uint mBegId, uint mEndId)
 }
 
 
-void
-ANode::aggregateMetricsIncl(const VMAIntervalSet& ivalset)
+// --------------------------------------------------------------------------
+// Parallel aggregation.  The tree is split into a 'spine' of interior
+// nodes near the root and the disjoint subtrees ('units') hanging off
+// it (cf. Tree::writeXML_par()).  Units are aggregated concurrently;
+// a serial walk over the spine then completes the aggregation.  Each
+// addition into a node outside of a unit is made by the spine walk,
+// in the order that the serial post-order walk would make it, so the
+// results do not depend on the number of threads.
+// --------------------------------------------------------------------------
+
+typedef std::set<const ANode*> AggSpine_par;
+
+
+// splitTreeAgg_par: Expand the frontier from 'root' a level at a time
+// until there are 'numUnitsGoal' units or nothing is left to expand.
+// Expanded nodes form 'spine'; the final frontier forms 'units'.
+static void
+splitTreeAgg_par(ANode* root, uint numUnitsGoal, AggSpine_par& spine,
+		 std::vector<ANode*>& units)
 {
-  if (ivalset.empty()) {
-    return; // short circuit
+  units.assign(1, root);
+
+  std::vector<ANode*> units_nxt;
+  bool isExpanded = true;
+  while (units.size() < numUnitsGoal && isExpanded) {
+    units_nxt.clear();
+    isExpanded = false;
+
+    for (uint i = 0; i < units.size(); ++i) {
+      ANode* n = units[i];
+      if (!n->isLeaf()) {
+	spine.insert(n);
+	for (ANodeChildIterator it(n); it.Current(); ++it) {
+	  units_nxt.push_back(it.current());
+	}
+	isExpanded = true;
+      }
+      else {
+	units_nxt.push_back(n);
+      }
+    }
+    units.swap(units_nxt);
   }
+}
 
-  const ANode* root = this;
+
+// addMetricsTo: y += x for metrics in 'ivalset'
+static inline void
+addMetricsTo(ANode* y, const ANode* x, const VMAIntervalSet& ivalset)
+{
+  for (VMAIntervalSet::const_iterator it = ivalset.begin();
+       it != ivalset.end(); ++it) {
+    const VMAInterval& ival = *it;
+    uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
+
+    for (uint mId = mBegId; mId < mEndId; ++mId) {
+      double mVal = x->demandMetric(mId, mEndId/*size*/);
+      y->demandMetric(mId, mEndId/*size*/) += mVal;
+    }
+  }
+}
+
+
+// aggregateMetricsIncl_ser: aggregate the subtree rooted at 'root'
+// (but not into the parent of 'root')
+static void
+aggregateMetricsIncl_ser(ANode* root, const VMAIntervalSet& ivalset)
+{
   ANodeIterator it(root, NULL/*filter*/, false/*leavesOnly*/,
 		   IteratorStack::PostOrder);
   for (ANode* n = NULL; (n = it.current()); ++it) {
     if (n != root) {
-      ANode* n_parent = n->parent();
-      
-      for (VMAIntervalSet::const_iterator it1 = ivalset.begin();
-	   it1 != ivalset.end(); ++it1) {
-	const VMAInterval& ival = *it1;
-	uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
-
-	for (uint mId = mBegId; mId < mEndId; ++mId) {
-	  double mVal = n->demandMetric(mId, mEndId/*size*/);
-	  n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
-	}
-      }
+      addMetricsTo(n->parent(), n, ivalset);
     }
   }
 }
 
 
-void
-ANode::aggregateMetricsExcl(uint mBegId, uint mEndId)
+static void
+aggregateMetricsIncl_spine(ANode* n, const AggSpine_par& spine,
+			   const VMAIntervalSet& ivalset)
 {
-  VMAIntervalSet ivalset; // TODO: cheat using a VMAInterval set
-  for (uint mId = mBegId; mId < mEndId; ++mId) {
-    ivalset.insert(VMAInterval(mId, mId + 1)); // [ )
+  // N.B. visit children in the order of the post-order iterator used
+  // by aggregateMetricsIncl_ser(), which is the reverse of
+  // ANodeChildIterator's
+  for (ANode* x = n->firstChild(); x; x = x->nextSibling()) {
+    if (spine.find(x) != spine.end()) {
+      aggregateMetricsIncl_spine(x, spine, ivalset);
+    }
+    addMetricsTo(n, x, ivalset);
   }
-  aggregateMetricsExcl(ivalset);
 }
 
 
 void
-ANode::aggregateMetricsExcl(const VMAIntervalSet& ivalset)
+ANode::aggregateMetricsIncl(const VMAIntervalSet& ivalset)
 {
   if (ivalset.empty()) {
     return; // short circuit
   }
 
-  AProcNode* frame = NULL; // will be set during tree traversal
-  aggregateMetricsExcl(frame, ivalset);
+  uint numThreads = numThreads_par();
+  if (numThreads <= 1) {
+    aggregateMetricsIncl_ser(this, ivalset);
+    return;
+  }
+
+  AggSpine_par spine;
+  std::vector<ANode*> units;
+  splitTreeAgg_par(this, 16 * numThreads, spine, units);
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+  for (uint i = 0; i < units.size(); ++i) {
+    aggregateMetricsIncl_ser(units[i], ivalset);
+  }
+
+  if (!spine.empty()) {
+    aggregateMetricsIncl_spine(this, spine, ivalset);
+  }
 }
 
 
 void
-ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
+ANode::aggregateMetricsExcl(uint mBegId, uint mEndId)
 {
-  ANode* n = this;
+  VMAIntervalSet ivalset; // TODO: cheat using a VMAInterval set
+  for (uint mId = mBegId; mId < mEndId; ++mId) {
+    ivalset.insert(VMAInterval(mId, mId + 1)); // [ )
+  }
+  aggregateMetricsExcl(ivalset);
+}
 
-  // -------------------------------------------------------
-  // Pre-order visit
-  // -------------------------------------------------------
-  //
-  // laks 2015.10.21: we don't want accumulate the exclusive cost of 
-  // an inlined statement to the caller. Instead, we assume an inline
-  // function (Proc) as the same as a normal procedure (ProcFrm).
-  // And the lowest common ancestor for Proc and ProcFrm is AProcNode.
-  //
+
+//
+// laks 2015.10.21: we don't want accumulate the exclusive cost of 
+// an inlined statement to the caller. Instead, we assume an inline
+// function (Proc) as the same as a normal procedure (ProcFrm).
+// And the lowest common ancestor for Proc and ProcFrm is AProcNode.
+//
+
+// AggExclAdd: an addition into a node outside of a unit, deferred to
+// the spine walk
+struct AggExclAdd {
+  AggExclAdd(ANode* x, uint id, double val)
+    : node(x), mId(id), mVal(val)
+  { }
+
+  ANode* node;
+  uint mId;
+  double mVal;
+};
+
+typedef std::vector<AggExclAdd> AggExclAddVec;
+
+
+// AggExclUnit: a unit, the frame it inherits from the spine and its
+// deferred additions
+struct AggExclUnit {
+  AggExclUnit(ANode* n = NULL, AProcNode* f = NULL)
+    : node(n), frame(f)
+  { }
+
+  ANode* node;
+  AProcNode* frame;
+  AggExclAddVec adds;
+};
+
+
+// aggExclFrame: Return the frame for the children of 'n', given the
+// frame of 'n'.  Sets 'isInlineMacro'.
+static AProcNode*
+aggExclFrame(ANode* n, AProcNode* frame, bool& isInlineMacro)
+{
   bool isFrame = (typeid(*n) == typeid(ProcFrm));
   bool isProc  = (typeid(*n) == typeid(Proc));
 
-  bool isInlineMacro = false;
   bool isInlineCall  = false;
+  isInlineMacro = false;
 
   NonUniformDegreeTreeNode *parent = n->Parent();
   if (isProc && parent != NULL) {
     // if this node and the parent are proc, it is possible this node is an
     //  inline procedure callsite
-    std::string myprocname = n->structure()->name();
+    const std::string& myprocname = n->structure()->name();
 
     if (typeid(*parent) == typeid(Proc)) {
       // check if this node is an inline procedure call.
@@ -563,76 +714,220 @@ ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
     isInlineMacro = !isInlineCall && myprocname.compare(GUARD_NAME) == 0;
   }
 
-  bool isLogicalProc   = isFrame || isInlineCall || isInlineMacro;
-  AProcNode * frameNxt = (isLogicalProc) ? static_cast<AProcNode*>(n) : frame;
+  bool isLogicalProc = isFrame || isInlineCall || isInlineMacro;
+  return (isLogicalProc) ? static_cast<AProcNode*>(n) : frame;
+}
+
+
+// aggregateMetricsExclMe: the post-order visit of 'n'.  If 'unit' is
+// non-NULL, additions into the parent of 'unit' or into 'unit->frame'
+// are deferred to 'unit->adds'.
+static void
+aggregateMetricsExclMe(ANode* n, AProcNode* frame, bool isInlineMacro,
+		       const VMAIntervalSet& ivalset, AggExclUnit* unit)
+{
+  if ( !(typeid(*n) == typeid(CCT::Stmt) || isInlineMacro) ) {
+    return;
+  }
+
+  ANode* n_parent = n->parent();
+  bool isParentOut = (unit && n == unit->node);
+  bool isFrameOut  = (unit && frame == unit->frame);
+
+  for (VMAIntervalSet::const_iterator it = ivalset.begin();
+       it != ivalset.end(); ++it) {
+    const VMAInterval& ival = *it;
+    uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
+
+    for (uint mId = mBegId; mId < mEndId; ++mId) {
+      double mVal = n->demandMetric(mId, mEndId/*size*/);
+      if (isParentOut) {
+	unit->adds.push_back(AggExclAdd(n_parent, mId, mVal));
+      }
+      else {
+	n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
+      }
+      if (frame && frame != n_parent) {
+	if (isFrameOut) {
+	  unit->adds.push_back(AggExclAdd(frame, mId, mVal));
+	}
+	else {
+	  frame->demandMetric(mId, mEndId/*size*/) += mVal;
+	}
+      }
+    }
+  }
+}
+
+
+static void
+aggregateMetricsExcl_ser(ANode* n, AProcNode* frame,
+			 const VMAIntervalSet& ivalset, AggExclUnit* unit)
+{
+  bool isInlineMacro = false;
+  AProcNode* frameNxt = aggExclFrame(n, frame, isInlineMacro);
 
-  // -------------------------------------------------------
-  // Tree traversal
-  // -------------------------------------------------------
   for (ANodeChildIterator it(n); it.Current(); ++it) {
     ANode* x = it.current();
-    x->aggregateMetricsExcl(frameNxt, ivalset);
+    aggregateMetricsExcl_ser(x, frameNxt, ivalset, unit);
   }
 
-  // -------------------------------------------------------
-  // Post-order visit
-  // -------------------------------------------------------
-  if (typeid(*n) == typeid(CCT::Stmt) || isInlineMacro) {
-    ANode* n_parent = n->parent();
+  aggregateMetricsExclMe(n, frame, isInlineMacro, ivalset, unit);
+}
 
-    for (VMAIntervalSet::const_iterator it = ivalset.begin();
-        it != ivalset.end(); ++it) {
-      const VMAInterval& ival = *it;
-      uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
 
-      for (uint mId = mBegId; mId < mEndId; ++mId) {
-        double mVal = n->demandMetric(mId, mEndId/*size*/);
-        n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
-        if (frame && frame != n_parent) {
-          frame->demandMetric(mId, mEndId/*size*/) += mVal;
-        }
+// aggregateMetricsExcl_units: Find the frame that each unit inherits
+// from the spine
+static void
+aggregateMetricsExcl_units(ANode* n, AProcNode* frame,
+			   const AggSpine_par& spine,
+			   std::map<const ANode*, AggExclUnit*>& unitMap)
+{
+  bool isInlineMacro = false;
+  AProcNode* frameNxt = aggExclFrame(n, frame, isInlineMacro);
+
+  for (ANodeChildIterator it(n); it.Current(); ++it) {
+    ANode* x = it.current();
+    if (spine.find(x) != spine.end()) {
+      aggregateMetricsExcl_units(x, frameNxt, spine, unitMap);
+    }
+    else {
+      unitMap[x]->frame = frameNxt;
+    }
+  }
+}
+
+
+static void
+aggregateMetricsExcl_spine(ANode* n, AProcNode* frame,
+			   const AggSpine_par& spine,
+			   const std::map<const ANode*, AggExclUnit*>& unitMap,
+			   const VMAIntervalSet& ivalset)
+{
+  bool isInlineMacro = false;
+  AProcNode* frameNxt = aggExclFrame(n, frame, isInlineMacro);
+
+  for (ANodeChildIterator it(n); it.Current(); ++it) {
+    ANode* x = it.current();
+    if (spine.find(x) != spine.end()) {
+      aggregateMetricsExcl_spine(x, frameNxt, spine, unitMap, ivalset);
+    }
+    else {
+      const AggExclAddVec& adds = unitMap.find(x)->second->adds;
+      uint mEndId = (uint)ivalset.rbegin()->end();
+      for (uint i = 0; i < adds.size(); ++i) {
+	const AggExclAdd& a = adds[i];
+	a.node->demandMetric(a.mId, mEndId/*size*/) += a.mVal;
       }
     }
   }
+
+  aggregateMetricsExclMe(n, frame, isInlineMacro, ivalset, NULL);
 }
 
 
 void
-ANode::computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-		      bool doFinal)
+ANode::aggregateMetricsExcl(const VMAIntervalSet& ivalset)
 {
-  if ( !(mBegId < mEndId) ) {
+  if (ivalset.empty()) {
+    return; // short circuit
+  }
+
+  AProcNode* frame = NULL; // will be set during tree traversal
+
+  uint numThreads = numThreads_par();
+  if (numThreads <= 1) {
+    aggregateMetricsExcl_ser(this, frame, ivalset, NULL);
     return;
   }
-  
-  // N.B. pre-order walk assumes point-wise metrics
-  // Cf. Analysis::Flat::Driver::computeDerivedBatch().
 
-  for (ANodeIterator it(this); it.Current(); ++it) {
-    ANode* n = it.current();
-    n->computeMetricsMe(mMgr, mBegId, mEndId, doFinal);
+  AggSpine_par spine;
+  std::vector<ANode*> unitNodes;
+  splitTreeAgg_par(this, 16 * numThreads, spine, unitNodes);
+
+  if (spine.empty()) {
+    aggregateMetricsExcl_ser(this, frame, ivalset, NULL);
+    return;
+  }
+
+  std::vector<AggExclUnit> units(unitNodes.size());
+  std::map<const ANode*, AggExclUnit*> unitMap;
+  for (uint i = 0; i < unitNodes.size(); ++i) {
+    units[i].node = unitNodes[i];
+    unitMap[unitNodes[i]] = &units[i];
+  }
+  aggregateMetricsExcl_units(this, frame, spine, unitMap);
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+  for (uint i = 0; i < units.size(); ++i) {
+    AggExclUnit& u = units[i];
+    aggregateMetricsExcl_ser(u.node, u.frame, ivalset, &u);
   }
+
+  aggregateMetricsExcl_spine(this, frame, spine, unitMap, ivalset);
 }
 
 
 void
-ANode::computeMetricsMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-			bool doFinal)
+ANode::computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
+		      bool doFinal)
 {
+  if ( !(mBegId < mEndId) ) {
+    return;
+  }
+  
+  // Compile the metric expressions into one program that is run over
+  // batches of nodes (cf. AExpr::eval(), AExpr::evalNF()).
   uint numMetrics = mMgr.size();
 
+  Metric::AExprProg prog;
   for (uint mId = mBegId; mId < mEndId; ++mId) {
     const Metric::ADesc* m = mMgr.metric(mId);
     const Metric::DerivedDesc* mm = dynamic_cast<const Metric::DerivedDesc*>(m);
     if (mm && mm->expr()) {
       const Metric::AExpr* expr = mm->expr();
-      expr->evalNF(*this);
+      expr->compileNF(prog);
       if (doFinal) {
-	double val = expr->eval(*this);
-	demandMetric(mId, numMetrics/*size*/) = val;
+	expr->compile(prog);
+	prog.emit(Metric::AExprProg::OpStore, mId, numMetrics/*size*/);
       }
     }
   }
+
+  if (prog.empty()) {
+    return;
+  }
+
+  // N.B. pre-order walk assumes point-wise metrics, so batches are
+  // independent.
+  // Cf. Analysis::Flat::Driver::computeDerivedBatch().
+
+  std::vector<Metric::IData*> nodes;
+  for (ANodeIterator it(this); it.Current(); ++it) {
+    nodes.push_back(it.current());
+  }
+
+  const uint bsz = Metric::AExprProg::BatchSz;
+  const uint numBatches = (nodes.size() + bsz - 1) / bsz;
+  uint numThreads = numThreads_par();
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel num_threads(numThreads) if (numThreads > 1)
+#endif
+  {
+    std::vector<double> stack; // per thread
+
+#ifdef ENABLE_OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (uint i = 0; i < numBatches; ++i) {
+      uint beg = i * bsz;
+      uint n = std::min((uint)nodes.size() - beg, bsz);
+      prog.eval(&nodes[beg], n, stack);
+    }
+  }
 }
 
 
@@ -644,12 +939,60 @@ ANode::computeMetricsIncr(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
     return;
   }
   
-  // N.B. pre-order walk assumes point-wise metrics
+  // Resolve the metric expressions and function once rather than at
+  // each node (cf. computeMetricsIncrMe()).
+  typedef double (Metric::AExprIncr::*IncrFn)(Metric::IData&) const;
+
+  IncrFn incrFn = NULL;
+  switch (fn) {
+    case Metric::AExprIncr::FnInit:
+      incrFn = &Metric::AExprIncr::initialize; break;
+    case Metric::AExprIncr::FnInitSrc:
+      incrFn = &Metric::AExprIncr::initializeSrc; break;
+    case Metric::AExprIncr::FnAccum:
+      incrFn = &Metric::AExprIncr::accumulate; break;
+    case Metric::AExprIncr::FnCombine:
+      incrFn = &Metric::AExprIncr::combine; break;
+    case Metric::AExprIncr::FnFini:
+      incrFn = &Metric::AExprIncr::finalize; break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+
+  std::vector<const Metric::AExprIncr*> exprs;
+  for (uint mId = mBegId; mId < mEndId; ++mId) {
+    const Metric::ADesc* m = mMgr.metric(mId);
+    const Metric::DerivedIncrDesc* mm =
+      dynamic_cast<const Metric::DerivedIncrDesc*>(m);
+    if (mm && mm->expr()) {
+      exprs.push_back(mm->expr());
+    }
+  }
+
+  if (exprs.empty()) {
+    return;
+  }
+
+  // N.B. pre-order walk assumes point-wise metrics, so nodes are
+  // independent.
   // Cf. Analysis::Flat::Driver::computeDerivedBatch().
 
+  std::vector<ANode*> nodes;
   for (ANodeIterator it(this); it.Current(); ++it) {
-    ANode* n = it.current();
-    n->computeMetricsIncrMe(mMgr, mBegId, mEndId, fn);
+    nodes.push_back(it.current());
+  }
+
+  uint numThreads = numThreads_par();
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThreads) \
+  if (numThreads > 1)
+#endif
+  for (uint j = 0; j < nodes.size(); ++j) {
+    ANode* n = nodes[j];
+    for (uint i = 0; i < exprs.size(); ++i) {
+      (exprs[i]->*incrFn)(*n);
+    }
   }
 }
 
@@ -989,6 +1332,13 @@ ADynNode::mergeMe(const ANode& y, MergeContext* mrgCtxt, uint metricBegIdx, bool
 
 ADynNode*
 ANode::findDynChild(const ADynNode& y_dyn)
+{
+  return findDynChild(y_dyn, y_dyn.isLeaf());
+}
+
+
+ADynNode*
+ANode::findDynChild(const ADynNode& y_dyn, bool y_isLeaf)
 {
   for (ANodeChildIterator it(this); it.Current(); ++it) {
     ANode* x = it.current();
@@ -996,13 +1346,13 @@ ANode::findDynChild(const ADynNode& y_dyn)
     ADynNode* x_dyn = dynamic_cast<ADynNode*>(x);
     if (x_dyn) {
       // Base case: an ADynNode descendent
-      if (ADynNode::isMergable(*x_dyn, y_dyn)) {
+      if (ADynNode::isMergable(*x_dyn, y_dyn, y_isLeaf)) {
 	return x_dyn;
       }
     }
     else {
       // Inductive case: some other type; find the first ADynNode descendents.
-      ADynNode* x_dyn_descendent = x->findDynChild(y_dyn);
+      ADynNode* x_dyn_descendent = x->findDynChild(y_dyn, y_isLeaf);
       if (x_dyn_descendent) {
 	return x_dyn_descendent;
       }
@@ -1225,10 +1575,11 @@ static uint
 getFileIdFromMap(uint file_id)
 {
   uint id = file_id;
-  if (Prof::m_mapFileIDs.find(file_id) != Prof::m_mapFileIDs.end()) {
+  std::map<uint, uint>::iterator it = Prof::m_mapFileIDs.find(file_id);
+  if (it != Prof::m_mapFileIDs.end()) {
     // the file ID should redirected to another file ID which has 
     // exactly the same filename
-    id = Prof::m_mapFileIDs[file_id];
+    id = it->second;
   }
   return id;
 }
@@ -1517,6 +1868,421 @@ ANode::writeXML_post(ostream& os, uint GCC_ATTR_UNUSED oFlags,
 }
 
 
+//**********************************************************************
+// Tree: parallel XML writer
+//**********************************************************************
+
+// The routines below mirror ANode::writeXML() and the toStringMe()
+// family for the compressed, non-debug case.  They append to a
+// caller-owned buffer and avoid both iostreams and StrUtil::toStr(),
+// which formats into a static buffer and is not thread safe.
+
+static inline void
+appendXMLUInt(string& buf, uint64_t x)
+{
+  char str[24];
+  char* end = str + sizeof(str);
+  char* p = end;
+  do {
+    *--p = (char)('0' + (x % 10));
+    x /= 10;
+  } while (x != 0);
+  buf.append(p, end - p);
+}
+
+
+// cf. StrUtil::toStr(x, 16), i.e., "%#" PRIx64
+static inline void
+appendXMLHex(string& buf, uint64_t x)
+{
+  static const char digits[] = "0123456789abcdef";
+
+  if (x == 0) {
+    buf += '0'; // "%#x" has no prefix for 0
+    return;
+  }
+
+  char str[24];
+  char* end = str + sizeof(str);
+  char* p = end;
+  while (x != 0) {
+    *--p = digits[x & 0xf];
+    x >>= 4;
+  }
+  *--p = 'x';
+  *--p = '0';
+  buf.append(p, end - p);
+}
+
+
+// cf. xml::MakeAttrNum(double).  Shortest-form "%g" output is subtle
+// enough that we keep printf's conversion, but into a local buffer.
+static inline void
+appendXMLDouble(string& buf, double x)
+{
+  char str[64];
+  int len = snprintf(str, sizeof(str), "%g", x);
+  buf.append(str, len);
+}
+
+
+static inline void
+appendXMLAttrNum(string& buf, const char* nm, uint64_t x)
+{
+  buf += ' ';
+  buf += nm;
+  buf += xml::attB;
+  appendXMLUInt(buf, x);
+  buf += xml::attE;
+}
+
+
+static inline void
+appendXMLAttrHex(string& buf, const char* nm, uint64_t x)
+{
+  buf += ' ';
+  buf += nm;
+  buf += xml::attB;
+  appendXMLHex(buf, x);
+  buf += xml::attE;
+}
+
+
+// cf. ANode::toStringMe() and its overrides
+static void
+writeXMLMe_par(string& buf, const ANode* n, uint oFlags)
+{
+  ANode::ANodeTy ty = n->type();
+  Struct::ACodeNode* strct = n->structure();
+
+  buf += ANode::ANodeTyToName(ty);
+
+  uint sId = n->structureId();
+  if (ty == ANode::TyProcFrm || ty == ANode::TyProc) {
+    sId = getProcIdFromMap(sId);
+  }
+  appendXMLAttrNum(buf, "i", n->id());
+  appendXMLAttrNum(buf, "s", sId);
+  appendXMLAttrNum(buf, "l", n->begLine());
+
+  switch (ty) {
+    case ANode::TyProcFrm: {
+      const ProcFrm* x = static_cast<const ProcFrm*>(n);
+      if (strct) {
+	appendXMLAttrNum(buf, "lm", getLoadModuleFromMap(x->lmId()));
+	appendXMLAttrNum(buf, "f", getFileIdFromMap(x->fileId()));
+	appendXMLAttrNum(buf, "n", getProcIdFromMap(x->procId()));
+      }
+      break;
+    }
+    case ANode::TyProc: {
+      const Proc* x = static_cast<const Proc*>(n);
+      if (strct) {
+	appendXMLAttrNum(buf, "lm", x->lmId());
+	appendXMLAttrNum(buf, "f", getFileIdFromMap(x->fileId()));
+	appendXMLAttrNum(buf, "n", getProcIdFromMap(x->procId()));
+	if (x->isAlien()) {
+	  buf += " a=\"1\"";
+	}
+      }
+      break;
+    }
+    case ANode::TyLoop: {
+      const Loop* x = static_cast<const Loop*>(n);
+      appendXMLAttrNum(buf, "f", getFileIdFromMap(x->fileId()));
+      VMAIntervalSet& vma = strct->vmaSet();
+      appendXMLAttrHex(buf, "v", vma.begin()->beg());
+      break;
+    }
+    case ANode::TyCall: {
+      const Call* x = static_cast<const Call*>(n);
+      appendXMLAttrHex(buf, "v", x->lmRA());
+      break;
+    }
+    case ANode::TyStmt: {
+      const Stmt* x = static_cast<const Stmt*>(n);
+      if (hpcrun_fmt_doRetainId(x->cpId())) {
+	appendXMLAttrNum(buf, "it", x->cpId());
+      }
+      break;
+    }
+    case ANode::TySCC: {
+      const SCC* x = static_cast<const SCC*>(n);
+      appendXMLAttrNum(buf, "f", getFileIdFromMap(x->fileId()));
+      break;
+    }
+    default:
+      break;
+  }
+
+  if ((oFlags & Tree::OFlg_StructId) && strct) {
+    appendXMLAttrNum(buf, "str", strct->m_origId);
+  }
+}
+
+
+// cf. ANode::writeXML_pre(): returns whether writeXMLPost_par() is needed
+static bool
+writeXMLPre_par(string& buf, const ANode* n, uint mBegId, uint mEndId,
+		uint oFlags)
+{
+  bool doTag = (n->type() != ANode::TyRoot);
+  bool doMetrics = ((oFlags & Tree::OFlg_LeafMetricsOnly)
+		    ? n->isLeaf() && n->hasMetrics(mBegId, mEndId)
+		    : n->hasMetrics(mBegId, mEndId));
+  bool isXMLLeaf = n->isLeaf() && !doMetrics;
+
+  if (doTag) {
+    buf += '<';
+    writeXMLMe_par(buf, n, oFlags);
+    buf += (isXMLLeaf) ? "/>\n" : ">\n";
+  }
+
+  if (doMetrics) {
+    // cf. Metric::IData::writeMetricsXML()
+    uint mBeg = (mBegId == Metric::IData::npos) ? 0 : mBegId;
+    uint mEnd = std::min(n->numMetrics(), mEndId);
+    for (uint i = mBeg; i < mEnd; ++i) {
+      if (n->hasMetric(i)) {
+	buf += "<M n";
+	buf += xml::attB;
+	appendXMLUInt(buf, i);
+	buf += xml::attE;
+	buf += " v";
+	buf += xml::attB;
+	appendXMLDouble(buf, n->metric(i));
+	buf += xml::attE;
+	buf += "/>";
+      }
+    }
+    buf += '\n';
+  }
+
+  return !isXMLLeaf;
+}
+
+
+// cf. ANode::writeXML_post()
+static void
+writeXMLPost_par(string& buf, const ANode* n)
+{
+  if (n->type() != ANode::TyRoot) {
+    buf += "</";
+    buf += ANode::ANodeTyToName(n->type());
+    buf += ">\n";
+  }
+}
+
+
+// children in the order of ANodeSortedChildIterator with
+// cmpByStructureInfo (a total order, so std::sort gives the same
+// sequence as the iterator's quicksort)
+struct ANodeLtByStructureInfo {
+  bool
+  operator()(ANode* x, ANode* y) const
+  { return (ANodeSortedIterator::cmpByStructureInfo(&x, &y) < 0); }
+};
+
+
+static void
+getSortedChildren_par(const ANode* n, vector<ANode*>& kids)
+{
+  kids.clear();
+  for (ANodeChildIterator it(n); it.current(); it++) {
+    kids.push_back(it.current());
+  }
+  std::sort(kids.begin(), kids.end(), ANodeLtByStructureInfo());
+}
+
+
+// cf. ANode::writeXML()
+static void
+writeXMLTree_par(string& buf, const ANode* n, uint mBegId, uint mEndId,
+		 uint oFlags)
+{
+  bool doPost = writeXMLPre_par(buf, n, mBegId, mEndId, oFlags);
+
+  vector<ANode*> kids;
+  getSortedChildren_par(n, kids);
+  for (uint i = 0; i < kids.size(); ++i) {
+    writeXMLTree_par(buf, kids[i], mBegId, mEndId, oFlags);
+  }
+
+  if (doPost) {
+    writeXMLPost_par(buf, n);
+  }
+}
+
+
+// A piece of the output: either a subtree to be formatted ('node')
+// or already-formatted text for the nodes above the subtrees.
+struct XMLUnit_par {
+  XMLUnit_par(const ANode* n = NULL)
+    : node(n)
+  { }
+
+  const ANode* node;
+  string text;
+};
+
+
+// findBigNodes_par: insert into 'bigNodes' each node of the tree
+// rooted at 'root' whose subtree has more than 'maxNodes' nodes
+static void
+findBigNodes_par(const ANode* root, uint64_t maxNodes,
+		 std::set<const ANode*>& bigNodes)
+{
+  struct Frame {
+    const ANode* node;
+    const ANode* child;  // next child to visit
+    uint64_t numNodes;   // size of the subtree visited so far
+  };
+
+  // N.B.: an explicit stack, since CCTs may be very deep
+  vector<Frame> stack;
+  Frame f0 = { root, root->firstChild(), 1 };
+  stack.push_back(f0);
+
+  while (!stack.empty()) {
+    Frame& f = stack.back();
+    if (f.child) {
+      const ANode* x = f.child;
+      f.child = x->nextSibling();
+      Frame fx = { x, x->firstChild(), 1 };
+      stack.push_back(fx);
+    }
+    else {
+      const ANode* x = f.node;
+      uint64_t numNodes = f.numNodes;
+      stack.pop_back();
+
+      if (numNodes > maxNodes) {
+	bigNodes.insert(x);
+      }
+      if (!stack.empty()) {
+	stack.back().numNodes += numNodes;
+      }
+    }
+  }
+}
+
+
+bool
+Tree::isWriteXMLParOK(uint oFlags)
+{
+  // Debug flags and diagnostic levels > 2 add attributes that are
+  // only produced by the toStringMe() family.
+  return ((oFlags & OFlg_Compressed)
+	  && !(oFlags & (OFlg_Debug | OFlg_DebugAll))
+	  && Diagnostics_GetDiagnosticFilterLevel() <= 2);
+}
+
+
+void
+Tree::writeXML_par(std::ostream& os, uint metricBeg, uint metricEnd,
+		   uint oFlags) const
+{
+  uint numThreads = numThreads_par();
+
+  // Number of subtrees to aim for; also the number formatted before
+  // their text is written out.
+  const uint numUnitsGoal = 16 * numThreads;
+
+  // Subtrees of more than 'maxUnitNodes' nodes are split further, so
+  // that a window of 'numUnitsGoal' subtrees buffers the text of at
+  // most 'WindowNodes' nodes (about 100-200 MB with a few metrics per
+  // node).  The opening and closing text of the split nodes is
+  // buffered until it is written, as are the unformatted subtrees
+  // (a pointer and an empty string each).
+  const uint64_t WindowNodes = (1 << 20);
+  const uint64_t maxUnitNodes = std::max(WindowNodes / numUnitsGoal,
+					 (uint64_t)1);
+
+  std::set<const ANode*> bigNodes;
+  findBigNodes_par(m_root, maxUnitNodes, bigNodes);
+
+  // -------------------------------------------------------
+  // 1. Split the tree into independent subtrees.  Expand the frontier
+  //    a level at a time, turning each interior node into its opening
+  //    text, its (sorted) children and its closing text, until there
+  //    is enough parallel slack and no subtree is too big, or nothing
+  //    is left to expand.
+  // -------------------------------------------------------
+  vector<XMLUnit_par> units(1, XMLUnit_par(m_root));
+  uint numNodeUnits = 1;
+
+  vector<ANode*> kids;
+  bool isExpanded = true;
+  while (isExpanded) {
+    bool doExpandAll = (numNodeUnits < numUnitsGoal);
+    vector<XMLUnit_par> units_nxt;
+    units_nxt.reserve(units.size());
+    numNodeUnits = 0;
+    isExpanded = false;
+
+    for (uint i = 0; i < units.size(); ++i) {
+      XMLUnit_par& u = units[i];
+      if (u.node && !u.node->isLeaf()
+	  && (doExpandAll || bigNodes.find(u.node) != bigNodes.end())) {
+	units_nxt.push_back(XMLUnit_par());
+	bool doPost = writeXMLPre_par(units_nxt.back().text, u.node,
+				      metricBeg, metricEnd, oFlags);
+
+	getSortedChildren_par(u.node, kids);
+	for (uint k = 0; k < kids.size(); ++k) {
+	  units_nxt.push_back(XMLUnit_par(kids[k]));
+	}
+	numNodeUnits += kids.size();
+
+	if (doPost) {
+	  units_nxt.push_back(XMLUnit_par());
+	  writeXMLPost_par(units_nxt.back().text, u.node);
+	}
+	isExpanded = true;
+      }
+      else {
+	units_nxt.push_back(XMLUnit_par(u.node));
+	units_nxt.back().text.swap(u.text);
+	if (u.node) {
+	  numNodeUnits++;
+	}
+      }
+    }
+    units.swap(units_nxt);
+  }
+
+  // -------------------------------------------------------
+  // 2. Format a window of subtrees in parallel and write it in order
+  // -------------------------------------------------------
+  for (uint beg = 0; beg < units.size(); ) {
+    uint end = beg;
+    for (uint numNodes = 0; end < units.size() && numNodes < numUnitsGoal;
+	 ++end) {
+      if (units[end].node) {
+	numNodes++;
+      }
+    }
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+    for (uint i = beg; i < end; ++i) {
+      XMLUnit_par& u = units[i];
+      if (u.node) {
+	writeXMLTree_par(u.text, u.node, metricBeg, metricEnd, oFlags);
+      }
+    }
+
+    for (uint i = beg; i < end; ++i) {
+      XMLUnit_par& u = units[i];
+      os.write(u.text.data(), u.text.size());
+      string().swap(u.text);
+    }
+    beg = end;
+  }
+}
+
+
 //**********************************************************************
 // 
 //**********************************************************************
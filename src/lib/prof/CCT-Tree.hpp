@@ -98,6 +98,7 @@
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/NonUniformDegreeTree.hpp>
+#include <lib/support/SlabPool.hpp>
 #include <lib/support/SrcFile.hpp>
 #include <lib/support/Unique.hpp>
 
@@ -178,6 +179,12 @@ public:
   merge(const Tree* y, uint x_newMetricBegIdx,
 	uint mrgFlag = 0, uint oFlag = 0);
 
+  // mergeContext: the context for merging into 'this' (created on
+  // demand), with merge flags set to 'mrgFlag'.  Useful for merging
+  // nodes that do not (yet) form a Tree.
+  MergeContext&
+  mergeContext(uint mrgFlag = 0);
+
   // -------------------------------------------------------
   // dense ids (only used when explicitly requested)
   // -------------------------------------------------------
@@ -215,6 +222,20 @@ public:
   bool
   verifyUniqueCPIds();
 
+  // -------------------------------------------------------
+  // numThreads: the number of threads with which whole-tree passes
+  // (metric aggregation and computation, writeXML()) run.  The
+  // default, 1, runs them serially, as does a call from within a
+  // parallel region.  Set by the tool (cf. --threads).
+  // -------------------------------------------------------
+  static uint
+  numThreads()
+  { return s_numThreads; }
+
+  static void
+  numThreads(uint x)
+  { s_numThreads = (x > 0) ? x : 1; }
+
   // -------------------------------------------------------
   // Write contents
   // -------------------------------------------------------
@@ -241,6 +262,18 @@ public:
   typedef std::map<uint, ANode*> NodeIdToANodeMap;
 
   
+private:
+  // writeXML_par: A writer for the (common) compressed, non-debug
+  // case of writeXML() that formats independent subtrees into
+  // private buffers in parallel and concatenates them in order.  The
+  // output is byte-identical to ANode::writeXML().
+  static bool
+  isWriteXMLParOK(uint oFlags);
+
+  void
+  writeXML_par(std::ostream& os, uint metricBeg, uint metricEnd,
+	       uint oFlags) const;
+
 private:
   // CCT and metadata for interpreting CCT (e.g., metrics)
   ANode* m_root;
@@ -252,6 +285,8 @@ private:
 
   // merge information, cached here for performance
   MergeContext* m_mergeCtxt;
+
+  static uint s_numThreads;
 };
 
 
@@ -320,31 +355,34 @@ public:
   ANode(ANodeTy type, ANode* parent, Struct::ACodeNode* strct = NULL)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   ANode(ANodeTy type,
 	ANode* parent, Struct::ACodeNode* strct, const Metric::IData& metrics)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(metrics),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   virtual ~ANode()
   { }
+
+  static void*
+  operator new(size_t sz)
+  { return SlabPool::alloc(sz); }
+
+  static void
+  operator delete(void* p, size_t sz)
+  { SlabPool::free(p, sz); }
   
   // deep copy of internals (but without children)
   ANode(const ANode& x)
     : NonUniformDegreeTreeNode(NULL),
       Metric::IData(x),
-      m_type(x.m_type), m_id(s_nextUniqueId), m_strct(x.m_strct)
+      m_type(x.m_type), m_id(nextUniqueId()), m_strct(x.m_strct)
   {
     zeroLinks();
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
   }
 
   // deep copy of internals (but without children)
@@ -355,8 +393,7 @@ public:
       //NonUniformDegreeTreeNode::operator=(x);
       Metric::IData::operator=(x);
       m_type = x.m_type;
-      m_id = s_nextUniqueId;
-      s_nextUniqueId += 2;
+      m_id = nextUniqueId();
       // m_id: skip
       m_strct = x.m_strct;
     }
@@ -507,6 +544,9 @@ public:
 
   // aggregateMetricsExcl: aggregates metrics for exclusive CCT
   // metrics. [mBegId, mEndId) forms an interval for batch processing.
+  //
+  // With OpenMP, both aggregations process independent subtrees
+  // concurrently; the results are identical to a serial traversal.
   void
   aggregateMetricsExcl(uint mBegId, uint mEndId);
 
@@ -517,27 +557,13 @@ public:
   aggregateMetricsExcl(uint mBegId)
   { aggregateMetricsExcl(mBegId, mBegId + 1); }
 
-private:
-  //
-  // laks 2015.10.21: we don't want accumulate the exclusive cost of 
-  // an inlined statement to the caller. Instead, we assume an inline
-  // function (Proc) as the same as a normal procedure (ProcFrm).
-  // And the lowest common ancestor for Proc and ProcFrm is AProcNode.
-  void
-  aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset);
 
-public:
   // computeMetrics: compute this subtree's Metric::DerivedDesc metric
   //   values for metric ids [mBegId, mEndId)
-  // computeMetricsMe: same, but for the node (not the subtree)
   void
   computeMetrics(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
 		 bool doFinal);
 
-  void
-  computeMetricsMe(const Metric::Mgr& mMgr, uint mBegId, uint mEndId,
-		   bool doFinal);
-
 
   // computeMetricsIncr: compute this subtree's Metric::DerivedIncrDesc metric
   //   values for metric ids [mBegId, mEndId)
@@ -609,6 +635,12 @@ public:
   CCT::ADynNode*
   findDynChild(const ADynNode& y_dyn);
 
+  // findDynChild: as above, but treat y_dyn as a leaf iff 'y_isLeaf',
+  //   regardless of its current children.  Useful when y_dyn's
+  //   children have not yet been materialized.
+  CCT::ADynNode*
+  findDynChild(const ADynNode& y_dyn, bool y_isLeaf);
+
 
   // --------------------------------------------------------
   // 
@@ -679,8 +711,14 @@ protected:
 
 
 private:
+  // nextUniqueId: atomic, since threads may build separate trees
+  // concurrently (e.g., hpcprof-mpi reading profiles)
+  static uint
+  nextUniqueId()
+  { return __sync_fetch_and_add(&s_nextUniqueId, 2); } // cf. HPCRUN_FMT_RetainIdFlag
+
   static uint s_nextUniqueId;
-  
+
 protected:
   ANodeTy m_type; // obsolete with typeid(), but hard to replace
   uint m_id;
@@ -919,8 +957,13 @@ public:
 
   static bool
   isMergable(const ADynNode& x, const ADynNode& y)
+  { return isMergable(x, y, y.isLeaf()); }
+
+  // isMergable: as above, but treat y as a leaf iff 'y_isLeaf'
+  static bool
+  isMergable(const ADynNode& x, const ADynNode& y, bool y_isLeaf)
   {
-    if (x.isLeaf() == y.isLeaf()
+    if (x.isLeaf() == y_isLeaf
 	&& x.lmId_real() == y.lmId_real()) {
 
       // 1. additional tests for standard merge condition (N.B.: order
@@ -79,7 +79,13 @@ using std::string;
 #include <cmath> // abs
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -92,6 +98,7 @@ using std::string;
 //*************************** User Include Files ****************************
 
 #include <include/gcc-attr.h>
+#include <include/hpctoolkit-config.h>
 #include <include/uint.h>
 
 #include "CallPath-Profile.hpp"
@@ -117,6 +124,10 @@ using namespace xml;
 #include <lib/support/ExprEval.hpp>
 #include <lib/support/VarMap.hpp>
 
+#ifdef ENABLE_OPENMP
+#include <omp.h>
+#endif
+
 //*************************** Forward Declarations **************************
 
 // implementations of prof_abort will be separately defined for MPI and 
@@ -156,6 +167,10 @@ std::map<uint, uint> m_mapLoadModuleIDs;      // map between load module IDs
 
 namespace CallPath {
 
+static void
+makeCPIdPairs(const CCT::MergeEffectList* mrgEffects,
+	      std::vector<std::pair<uint, uint> >& cpIdPairs);
+
 
 Profile::Profile(const std::string name)
 {
@@ -166,6 +181,7 @@ Profile::Profile(const std::string name)
 
   m_traceMinTime = UINT64_MAX;
   m_traceMaxTime = 0;
+  m_traceFixBytes = 0;
 
   m_mMgr = new Metric::Mgr;
   m_isMetricMgrVirtual = false;
@@ -195,50 +211,18 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
   Profile& x = (*this);
 
   DIAG_Assert(!y.m_structure, "Profile::merge: source profile should not have structure yet!");
-  DIAG_Assert(y.m_fmtVersion == x.m_fmtVersion, "Error: cannot merge two different versions of measurement");
 
   // -------------------------------------------------------
   // merge name, flags, etc
   // -------------------------------------------------------
-
-  // Note: these values can be 'null' if the hpcrun-fmt data had no epochs
-  if (x.m_fmtVersion == 0.0) {
-    x.m_fmtVersion = y.m_fmtVersion;
-  }
-  else if (y.m_fmtVersion == 0.0) {
-    y.m_fmtVersion = x.m_fmtVersion;
-  }
-
-  if (x.m_flags.bits == 0) {
-    x.m_flags.bits = y.m_flags.bits;
-  }
-  else if (y.m_flags.bits == 0) {
-    y.m_flags.bits = x.m_flags.bits;
-  }
-
-  if (x.m_measurementGranularity == 0) {
-    x.m_measurementGranularity = y.m_measurementGranularity;
-  }
-  else if (y.m_measurementGranularity == 0) {
-    y.m_measurementGranularity = x.m_measurementGranularity;
-  }
-
-  DIAG_WMsgIf(x.m_fmtVersion != y.m_fmtVersion,
-	      "CallPath::Profile::merge(): ignoring incompatible versions: "
-	      << x.m_fmtVersion << " vs. " << y.m_fmtVersion);
-  DIAG_WMsgIf(x.m_flags.bits != y.m_flags.bits,
-	      "CallPath::Profile::merge(): ignoring incompatible flags: "
-	      << x.m_flags.bits << " vs. " << y.m_flags.bits);
-  DIAG_WMsgIf(x.m_measurementGranularity != y.m_measurementGranularity,
-	      "CallPath::Profile::merge(): ignoring incompatible measurement-granularity: " << x.m_measurementGranularity << " vs. " << y.m_measurementGranularity);
+  x.merge_meta(y.m_fmtVersion, y.m_flags, y.m_measurementGranularity,
+	       y.m_traceMinTime, y.m_traceMaxTime);
 
   x.m_profileFileName = "";
 
   x.m_traceFileName = "";
   x.m_traceFileNameSet.insert(y.m_traceFileNameSet.begin(),
 			      y.m_traceFileNameSet.end());
-  x.m_traceMinTime = std::min(x.m_traceMinTime, y.m_traceMinTime);
-  x.m_traceMaxTime = std::max(x.m_traceMaxTime, y.m_traceMaxTime);
 
 
   // -------------------------------------------------------
@@ -272,24 +256,84 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
 			     mrgFlag & CCT::MrgFlg_NormalizeTraceFileY),
 	      "CallPath::Profile::merge: there should only be CCT::MergeEffects when MrgFlg_NormalizeTraceFileY is passed");
 
-  y.merge_fixTrace(mrgEffects2);
+  if ((mrgFlag & CCT::MrgFlg_DeferTraceFileY) && !y.m_traceFileName.empty()
+      && mrgEffects2 && !mrgEffects2->empty()) {
+    x.m_traceFixes.push_back(TraceFix());
+    TraceFix& fix = x.m_traceFixes.back();
+    fix.fileName = y.m_traceFileName;
+    makeCPIdPairs(mrgEffects2, fix.cpIdPairs);
+
+    x.m_traceFixBytes += fix.cpIdPairs.size() * sizeof(fix.cpIdPairs[0]);
+    if (x.m_traceFixBytes >= TraceFixBatchBytes) {
+      x.fixTraceFiles();
+    }
+  }
+  else {
+    y.merge_fixTrace(mrgEffects2);
+  }
   delete mrgEffects2;
 
   return firstMergedMetric;
 }
 
 
+void
+Profile::merge_meta(double y_fmtVersion, epoch_flags_t y_flags,
+		    uint64_t y_measurementGranularity,
+		    uint64_t y_traceMinTime, uint64_t y_traceMaxTime)
+{
+  Profile& x = (*this);
+
+  DIAG_Assert(y_fmtVersion == x.m_fmtVersion, "Error: cannot merge two different versions of measurement");
+
+  // Note: these values can be 'null' if the hpcrun-fmt data had no epochs
+  if (x.m_fmtVersion == 0.0) {
+    x.m_fmtVersion = y_fmtVersion;
+  }
+  else if (y_fmtVersion == 0.0) {
+    y_fmtVersion = x.m_fmtVersion;
+  }
+
+  if (x.m_flags.bits == 0) {
+    x.m_flags.bits = y_flags.bits;
+  }
+  else if (y_flags.bits == 0) {
+    y_flags.bits = x.m_flags.bits;
+  }
+
+  if (x.m_measurementGranularity == 0) {
+    x.m_measurementGranularity = y_measurementGranularity;
+  }
+  else if (y_measurementGranularity == 0) {
+    y_measurementGranularity = x.m_measurementGranularity;
+  }
+
+  DIAG_WMsgIf(x.m_fmtVersion != y_fmtVersion,
+	      "CallPath::Profile::merge(): ignoring incompatible versions: "
+	      << x.m_fmtVersion << " vs. " << y_fmtVersion);
+  DIAG_WMsgIf(x.m_flags.bits != y_flags.bits,
+	      "CallPath::Profile::merge(): ignoring incompatible flags: "
+	      << x.m_flags.bits << " vs. " << y_flags.bits);
+  DIAG_WMsgIf(x.m_measurementGranularity != y_measurementGranularity,
+	      "CallPath::Profile::merge(): ignoring incompatible measurement-granularity: " << x.m_measurementGranularity << " vs. " << y_measurementGranularity);
+
+  x.m_traceMinTime = std::min(x.m_traceMinTime, y_traceMinTime);
+  x.m_traceMaxTime = std::max(x.m_traceMaxTime, y_traceMaxTime);
+}
+
+
 uint
-Profile::mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx)
+Profile::mergeMetrics(const Metric::Mgr& y_mMgr, bool y_isMetricMgrVirtual,
+		      int mergeTy, uint& x_newMetricBegIdx)
 {
   Profile& x = (*this);
 
-  DIAG_Assert(x.m_isMetricMgrVirtual == y.m_isMetricMgrVirtual,
+  DIAG_Assert(x.m_isMetricMgrVirtual == y_isMetricMgrVirtual,
 	      "CallPath::Profile::merge(): incompatible metrics");
 
   DIAG_MsgIf(0, "Profile::mergeMetrics: init\n"
 	     << "x: " << x.metricMgr()->toString("  ")
-	     << "y: " << y.metricMgr()->toString("  "));
+	     << "y: " << y_mMgr.toString("  "));
 
   uint yBeg_mapsTo_xIdx = 0;
 
@@ -299,7 +343,7 @@ Profile::mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx)
   // Translate Merge_mergeMetricByName to a primitive merge type
   // -------------------------------------------------------
   if (mergeTy == Merge_MergeMetricByName) {
-    uint mapsTo = x.metricMgr()->findGroup(*y.metricMgr());
+    uint mapsTo = x.metricMgr()->findGroup(y_mMgr);
     mergeTy = (mapsTo == Metric::Mgr::npos) ? Merge_CreateMetric : (int)mapsTo;
   }
 
@@ -317,7 +361,7 @@ Profile::mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx)
   else if (mergeTy >= Merge_MergeMetricById) {
     yBeg_mapsTo_xIdx = (uint)mergeTy; // [
     
-    uint yEnd_mapsTo_xIdx = yBeg_mapsTo_xIdx + y.metricMgr()->size(); // )
+    uint yEnd_mapsTo_xIdx = yBeg_mapsTo_xIdx + y_mMgr.size(); // )
     if (! (x.metricMgr()->size() >= yEnd_mapsTo_xIdx) ) {
       uint overlapSz = x.metricMgr()->size() - yBeg_mapsTo_xIdx;
       y_newMetricIdx = overlapSz;
@@ -327,8 +371,8 @@ Profile::mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx)
     DIAG_Die(DIAG_UnexpectedInput);
   }
 
-  for (uint i = y_newMetricIdx; i < y.metricMgr()->size(); ++i) {
-    const Metric::ADesc* m = y.metricMgr()->metric(i);
+  for (uint i = y_newMetricIdx; i < y_mMgr.size(); ++i) {
+    const Metric::ADesc* m = y_mMgr.metric(i);
     x.metricMgr()->insert(m->clone());
   }
 
@@ -380,11 +424,40 @@ Profile::merge_fixCCT(const std::vector<LoadMap::MergeEffect>* mrgEffects)
 }
 
 
+// makeCPIdPairs: the (old cpId, new cpId) pairs of 'mrgEffects',
+// sorted by old cpId
+static void
+makeCPIdPairs(const CCT::MergeEffectList* mrgEffects,
+	      std::vector<std::pair<uint, uint> >& cpIdPairs)
+{
+  cpIdPairs.clear();
+  cpIdPairs.reserve(mrgEffects->size());
+  for (CCT::MergeEffectList::const_iterator it = mrgEffects->begin();
+       it != mrgEffects->end(); ++it) {
+    cpIdPairs.push_back(std::make_pair(it->old_cpId, it->new_cpId));
+  }
+  std::sort(cpIdPairs.begin(), cpIdPairs.end());
+}
+
+
+// makeCPIdMap: a dense map from old cpIds to new cpIds
+// (HPCRUN_FMT_CCTNodeId_NULL if unchanged)
+static void
+makeCPIdMap(const std::vector<std::pair<uint, uint> >& cpIdPairs,
+	    std::vector<uint>& cpIdMap)
+{
+  uint maxId = (cpIdPairs.empty()) ? 0 : cpIdPairs.back().first;
+
+  cpIdMap.assign(maxId + 1, HPCRUN_FMT_CCTNodeId_NULL);
+  for (uint i = 0; i < cpIdPairs.size(); ++i) {
+    cpIdMap[cpIdPairs[i].first] = cpIdPairs[i].second;
+  }
+}
+
+
 void
 Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 {
-  typedef std::map<uint, uint> UIntToUIntMap;
-
   // early exit for trivial case
   if (m_traceFileName.empty()) {
     return;
@@ -395,119 +468,234 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 
   // N.B.: We could build a map of old->new cpIds within
   // Profile::merge(), but the list of effects is more general and
-  // extensible.  There are no asymptotic problems with building the
-  // following map for local use.
-  UIntToUIntMap cpIdMap;
-  for (CCT::MergeEffectList::const_iterator it = mrgEffects->begin();
-       it != mrgEffects->end(); ++it) {
-    const CCT::MergeEffect& effct = *it;
-    cpIdMap.insert(std::make_pair(effct.old_cpId, effct.new_cpId));
+  // extensible.  cpIds are bounded, so a dense map is cheap.
+  std::vector<std::pair<uint, uint> > cpIdPairs;
+  makeCPIdPairs(mrgEffects, cpIdPairs);
+
+  std::vector<uint> cpIdMap;
+  makeCPIdMap(cpIdPairs, cpIdMap);
+
+  fixTraceFile(m_traceFileName, cpIdMap);
+}
+
+
+void
+Profile::fixTraceFiles()
+{
+  if (m_traceFixes.empty()) {
+    return;
   }
 
-  // ------------------------------------------------------------
-  // Rewrite trace file
-  // ------------------------------------------------------------
-  int ret;
+  long numFiles = m_traceFixes.size();
+  uint64_t numBytes = 0;
+
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:numBytes) \
+  num_threads(CCT::Tree::numThreads())
+#endif
+  for (long i = 0; i < numFiles; ++i) {
+    // N.B.: only the files being rewritten have a dense map
+    TraceFix& fix = m_traceFixes[i];
+    std::vector<uint> cpIdMap;
+    makeCPIdMap(fix.cpIdPairs, cpIdMap);
+    std::vector<std::pair<uint, uint> >().swap(fix.cpIdPairs);
+
+    numBytes += fixTraceFile(fix.fileName, cpIdMap);
+  }
+
+  gettimeofday(&time2, NULL);
+  double secs = (time2.tv_sec - time1.tv_sec)
+    + (time2.tv_usec - time1.tv_usec) / 1.0e6;
+  double mb = numBytes / (1024.0 * 1024.0);
+
+  DIAG_Msg(1, "Normalized " << numFiles << " trace files (" << mb << " MB) in "
+	   << secs << " s: " << ((secs > 0.0) ? mb / secs : 0.0) << " MB/s");
+
+  m_traceFixes.clear();
+  m_traceFixBytes = 0;
+}
 
-  DIAG_MsgIf(0, "Profile::merge_fixTrace: " << m_traceFileName);
 
-  string traceFileNameTmp = m_traceFileName + "." + HPCPROF_TmpFnmSfx;
+static bool
+writeTraceBuf(int fd, const unsigned char* buf, size_t sz)
+{
+  while (sz > 0) {
+    ssize_t ret = write(fd, buf, sz);
+    if (ret < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return false;
+    }
+    buf += ret;
+    sz -= ret;
+  }
+  return true;
+}
 
-  char* infsBuf = new char[HPCIO_RWBufferSz];
-  char* outfsBuf = new char[HPCIO_RWBufferSz];
 
-  const string& inFnm = m_traceFileName;
-  FILE* infs = hpcio_fopen_r(inFnm.c_str());
-  if (!infs) {
+uint64_t
+Profile::fixTraceFile(const string& inFnm, const std::vector<uint>& cpIdMap)
+{
+  DIAG_MsgIf(0, "Profile::fixTraceFile: " << inFnm);
+
+  // ------------------------------------------------------------
+  // Map trace file
+  // ------------------------------------------------------------
+  int infd = open(inFnm.c_str(), O_RDONLY);
+  if (infd < 0) {
     std::string errorString;
     hpcrun_getFileErrorString(inFnm, errorString);
-    DIAG_EMsg("failed to open trace file " << errorString << "; skip this one."); 
-    return; 
+    DIAG_EMsg("failed to open trace file " << errorString << "; skip this one.");
+    return 0;
+  }
+
+  struct stat statbuf;
+  size_t inSz = (fstat(infd, &statbuf) == 0) ? statbuf.st_size : 0;
+
+  const unsigned char* in = NULL;
+  if (inSz > 0) {
+    void* addr = mmap(NULL, inSz, PROT_READ, MAP_PRIVATE, infd, 0);
+    if (addr != MAP_FAILED) {
+      in = (const unsigned char*)addr;
+      madvise(addr, inSz, MADV_SEQUENTIAL);
+    }
   }
+  close(infd);
 
-  ret = setvbuf(infs, infsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, inFnm << ": Profile::merge_fixTrace: setvbuf!");
+  // ------------------------------------------------------------
+  // Read header (cf. hpctrace_fmt_hdr_fread())
+  // ------------------------------------------------------------
+  size_t hdrSz = HPCTRACE_FMT_MagicLen + HPCTRACE_FMT_VersionLen
+    + HPCTRACE_FMT_EndianLen;
+
+  bool isHdrOK = (in && inSz >= hdrSz
+		  && memcmp(in, HPCTRACE_FMT_Magic, HPCTRACE_FMT_MagicLen) == 0);
+
+  hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
+  if (isHdrOK) {
+    char versionStr[HPCTRACE_FMT_VersionLen + 1];
+    memcpy(versionStr, in + HPCTRACE_FMT_MagicLen, HPCTRACE_FMT_VersionLen);
+    versionStr[HPCTRACE_FMT_VersionLen] = '\0';
+    if (atof(versionStr) > 1.0) {
+      isHdrOK = (inSz >= hdrSz + HPCTRACE_FMT_FlagsLen);
+      if (isHdrOK) {
+	flags = 0;
+	for (int i = 0; i < HPCTRACE_FMT_FlagsLen; ++i) {
+	  flags = (flags << 8) | in[hdrSz + i];
+	}
+	hdrSz += HPCTRACE_FMT_FlagsLen;
+      }
+    }
+  }
 
-  hpctrace_fmt_hdr_t hdr;
-  ret = hpctrace_fmt_hdr_fread(&hdr, infs);
-  if (ret == HPCFMT_ERR) {
+  if (!isHdrOK) {
     std::string errorString;
     hpcrun_getFileErrorString(inFnm, errorString);
     DIAG_EMsg("failed reading header from trace measurement file " << errorString << "; skip this one."); 
-    hpcio_fclose(infs);
-    return;
+    if (in) {
+      munmap((void*)in, inSz);
+    }
+    return 0;
   }
 
-  const string& outFnm = traceFileNameTmp;
-  FILE* outfs = hpcio_fopen_w(outFnm.c_str(), 1/*overwrite*/);
-  if (!outfs) {
+  // ------------------------------------------------------------
+  // Rewrite trace file
+  // ------------------------------------------------------------
+  string outFnm = inFnm + "." + HPCPROF_TmpFnmSfx;
+
+  int outfd = open(outFnm.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (outfd < 0) {
     if (errno == EDQUOT) {
       DIAG_EMsg("disk quota exceeded; unable to open trace result file  " << 
 		outFnm << "; aborting.");
-      hpcio_fclose(infs);
+      munmap((void*)in, inSz);
       prof_abort(-1);
     } else {
       std::string errorString;
       hpcrun_getFileErrorString(outFnm, errorString);
       DIAG_EMsg("failed opening trace result file " << errorString << 
 		"when processing trace measurement file " << inFnm << "; skip this one.");
-      hpcio_fclose(infs);
-      return; 
+      munmap((void*)in, inSz);
+      return 0;
     }
   }
 
-  ret = setvbuf(outfs, outfsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, outFnm << ": Profile::merge_fixTrace: setvbuf!");
+  // datum: time (8 bytes), cpId (4 bytes), [metricId (4 bytes)]
+  const size_t cpIdOff = 8;
+  size_t datumSz = 12;
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(flags, HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    datumSz += 4;
+  }
 
-  ret = hpctrace_fmt_hdr_fwrite(hdr.flags, outfs);
-  if (ret == HPCFMT_ERR) goto badwrite;
+  const size_t bufSz = (HPCIO_RWBufferSz / datumSz) * datumSz;
+  unsigned char* buf = NULL;
+  if (posix_memalign((void**)&buf, 4096, std::max(bufSz, (size_t)4096)) != 0) {
+    DIAG_EMsg("out of memory rewriting trace file " << inFnm << "; aborting.");
+    prof_abort(-1);
+  }
 
-  while ( !feof(infs) ) {
-    // 1. Read trace record (exit on EOF)
-    hpctrace_fmt_datum_t datum;
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
-    if (ret == HPCFMT_EOF) {
-      break;
-    } else if (ret == HPCFMT_ERR) {
-      DIAG_EMsg("failed reading a record from trace measurement file " << inFnm << "; skip this one.");
-      hpcio_fclose(infs);
-      hpcio_fclose(outfs);
-      unlink(outFnm.c_str()); // delete incomplete output file
-      return;
-    }
-    
-    // 2. Translate cct id
-    uint cctId_old = datum.cpId;
-    uint cctId_new = datum.cpId;
-    UIntToUIntMap::iterator it = cpIdMap.find(cctId_old);
-    if (it != cpIdMap.end()) {
-      cctId_new = it->second;
-      DIAG_MsgIf(0, "  " << cctId_old << " -> " << cctId_new);
+  bool isOK = true;
+
+  // header (cf. hpctrace_fmt_hdr_fwrite())
+  size_t hdrOutSz = 0;
+  memcpy(buf + hdrOutSz, HPCTRACE_FMT_Magic, HPCTRACE_FMT_MagicLen);
+  hdrOutSz += HPCTRACE_FMT_MagicLen;
+  memcpy(buf + hdrOutSz, HPCTRACE_FMT_Version, HPCTRACE_FMT_VersionLen);
+  hdrOutSz += HPCTRACE_FMT_VersionLen;
+  memcpy(buf + hdrOutSz, HPCTRACE_FMT_Endian, HPCTRACE_FMT_EndianLen);
+  hdrOutSz += HPCTRACE_FMT_EndianLen;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    buf[hdrOutSz++] = (flags >> shift) & 0xff;
+  }
+  isOK = writeTraceBuf(outfd, buf, hdrOutSz);
+
+  // data: copy in blocks and translate cpIds in place
+  const unsigned char* inCur = in + hdrSz;
+  const unsigned char* inEnd = in + hdrSz + ((inSz - hdrSz) / datumSz) * datumSz;
+  const uint mapSz = cpIdMap.size();
+
+  while (isOK && inCur < inEnd) {
+    size_t sz = std::min(bufSz, (size_t)(inEnd - inCur));
+    memcpy(buf, inCur, sz);
+    inCur += sz;
+
+    for (unsigned char* x = buf + cpIdOff; x < buf + sz; x += datumSz) {
+      uint cpId = ((uint)x[0] << 24) | ((uint)x[1] << 16)
+	| ((uint)x[2] << 8) | (uint)x[3];
+      if (cpId < mapSz && cpIdMap[cpId] != HPCRUN_FMT_CCTNodeId_NULL) {
+	uint cpIdNew = cpIdMap[cpId];
+	x[0] = (cpIdNew >> 24) & 0xff;
+	x[1] = (cpIdNew >> 16) & 0xff;
+	x[2] = (cpIdNew >> 8) & 0xff;
+	x[3] = cpIdNew & 0xff;
+      }
     }
-    datum.cpId = cctId_new;
 
-    // 3. Write new trace record
-    ret = hpctrace_fmt_datum_fwrite(&datum, hdr.flags, outfs);
-    if (ret == HPCFMT_ERR) goto badwrite;
+    isOK = writeTraceBuf(outfd, buf, sz);
   }
 
-  hpcio_fclose(infs);
-  hpcio_fclose(outfs);
-
-  delete[] infsBuf;
-  delete[] outfsBuf;
-  return;
+  free(buf);
+  munmap((void*)in, inSz);
 
-badwrite:
-  {
+  if (!isOK || close(outfd) != 0) {
     std::string errorString;
     hpcrun_getFileErrorString(outFnm, errorString);
     DIAG_EMsg("failed writing trace result file " << errorString << "; aborting.");
-    hpcio_fclose(infs);
-    hpcio_fclose(outfs);
     unlink(outFnm.c_str()); // delete incomplete output file
     prof_abort(-1);
   }
+
+  if (inEnd != in + inSz) {
+    DIAG_EMsg("failed reading a record from trace measurement file " << inFnm << "; skip this one.");
+    unlink(outFnm.c_str()); // delete incomplete output file
+    return 0;
+  }
+
+  return inSz;
 }
 
 
@@ -1644,6 +1832,7 @@ Profile::fmt_fwrite(const Profile& prof, FILE* fs, uint wFlags)
 
   ret = hpcrun_fmt_hdr_fwrite(fs,
 			"TODO:hdr-name","TODO:hdr-value",
+			HPCRUN_FMT_NV_prog, prof.name().c_str(),
 			HPCRUN_FMT_NV_traceMinTime, traceMinTimeStr.c_str(),
 			HPCRUN_FMT_NV_traceMaxTime, traceMaxTimeStr.c_str(),
 			NULL);
@@ -95,6 +95,9 @@ namespace CallPath {
 
 typedef std::map<uint32_t, CCT::ANode*> CCTIdToCCTNodeMap;
 
+class WireReader; // cf. CallPath-ProfileWire.cpp
+class WireBase;   // cf. CallPath-ProfileWire.cpp
+
 class Profile
   : public Unique // non copyable
 {
@@ -247,6 +250,17 @@ public:
   uint
   merge(Profile& y, int mergeTy, uint mrgFlag = 0);
 
+  // fixTraceFiles: perform the trace file rewrites deferred by
+  //   merge() (cf. CCT::MrgFlg_DeferTraceFileY), processing files
+  //   concurrently.  As with an immediate rewrite, trace file 'f' is
+  //   rewritten to 'f.tmp' (cf. Analysis::Util::copyTraceFiles()).
+  //   merge() itself performs them once the pending cpId maps exceed
+  //   TraceFixBatchBytes.
+  void
+  fixTraceFiles();
+
+  static const size_t TraceFixBatchBytes = (64 * 1024 * 1024);
+
   // -------------------------------------------------------
   //
   // -------------------------------------------------------
@@ -324,6 +338,66 @@ public:
   static int
   fmt_cct_fwrite(const Profile& prof, FILE* fs, uint wFlags);
 
+
+  // -------------------------------------------------------
+  // Compact wire encoding (cf. CallPath-ProfileWire.cpp)
+  //
+  // A private binary encoding for exchanging (unstructured)
+  // intermediate profiles between processes, e.g., in hpcprof-mpi's
+  // reduction.  Unlike hpcrun-fmt, it uses variable-length integers,
+  // a deduplicated string table and sparse metric values; and it may
+  // be merged directly into another profile.  It is not portable
+  // across architectures and is not meant to be stored.
+  // -------------------------------------------------------
+
+  // WireNodeMap: For a profile y merged by wire_merge(), describes
+  //   each of y's nodes, in preorder: the node of x into which it was
+  //   merged, along with y's cp-id, lush association and subtree size.
+  //   Lets x be sent back relative to y (cf. wire_pack()).
+  struct WireNode {
+    CCT::ANode* node;
+    uint cpId;
+    uint32_t assocBits;
+    uint size;
+  };
+
+  typedef std::vector<WireNode> WireNodeMap;
+
+  // wire_pack: encode 'prof' into a malloc'd buffer (which the caller
+  // must free), setting 'bufferSz'.
+  static void
+  wire_pack(const Profile& prof, uint8_t** buffer, size_t* bufferSz)
+  { wire_pack(prof, NULL, buffer, bufferSz); }
+
+  // wire_pack: as above, but if 'baseMap' is non-NULL, encode 'prof'
+  //   relative to the base profile y it describes: nodes of 'prof'
+  //   that y holds are sent as references to y's nodes, and subtrees
+  //   y holds entirely, as a single reference.  Such a buffer may only
+  //   be decoded with y (cf. wire_unpack()).
+  static void
+  wire_pack(const Profile& prof, const WireNodeMap* baseMap,
+	    uint8_t** buffer, size_t* bufferSz);
+
+  // wire_unpack: decode a profile encoded by wire_pack().  If the
+  //   profile was encoded relative to a base profile, 'base' must be
+  //   that profile; if 'baseNodes' is also non-NULL, it receives, for
+  //   each of base's nodes in preorder, its node in the new profile
+  //   (or NULL).
+  static Profile*
+  wire_unpack(const uint8_t* buffer, size_t bufferSz,
+	      const Profile* base = NULL,
+	      std::vector<CCT::ANode*>* baseNodes = NULL);
+
+  // wire_merge: Given a profile y encoded by wire_pack(), merge y
+  //   into x = 'this' exactly as merge() would (with no merge flags),
+  //   but without materializing y: y's CCT is merged into x's as it
+  //   is decoded.  If 'y_mMgr' is non-NULL, it receives y's metric
+  //   descriptors; if 'y_nodeMap' is non-NULL, it receives the map of
+  //   y's nodes.  Returns the index of the first merged metric in x.
+  uint
+  wire_merge(const uint8_t* buffer, size_t bufferSz, int mergeTy,
+	     Metric::Mgr* y_mMgr = NULL, WireNodeMap* y_nodeMap = NULL);
+
   // -------------------------------------------------------
   // Output
   // -------------------------------------------------------
@@ -352,8 +426,25 @@ private:
   void
   canonicalize(uint rFlags = 0);
 
+  void
+  merge_meta(double y_fmtVersion, epoch_flags_t y_flags,
+	     uint64_t y_measurementGranularity,
+	     uint64_t y_traceMinTime, uint64_t y_traceMaxTime);
+
+  uint
+  mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx)
+  {
+    return mergeMetrics(*y.metricMgr(), y.isMetricMgrVirtual(), mergeTy,
+			x_newMetricBegIdx);
+  }
+
+  uint
+  mergeMetrics(const Metric::Mgr& y_mMgr, bool y_isMetricMgrVirtual,
+	       int mergeTy, uint& x_newMetricBegIdx);
+
   uint
-  mergeMetrics(Profile& y, int mergeTy, uint& x_newMetricBegIdx);
+  wire_merge(WireReader& y, int mergeTy, Metric::Mgr* y_mMgr,
+	     WireNodeMap* y_nodeMap, WireBase* base);
 
   // apply MergeEffects after merging two profiles
   void
@@ -362,6 +453,18 @@ private:
   void
   merge_fixTrace(const CCT::MergeEffectList* mrgEffects);
 
+  // rewrite 'fnm' to 'fnm.tmp' using 'cpIdMap' (old cpId -> new
+  // cpId or NULL); returns the number of bytes read
+  static uint64_t
+  fixTraceFile(const std::string& fnm, const std::vector<uint>& cpIdMap);
+
+  // a deferred rewrite: the changed cpIds of 'fileName' as sorted
+  // (old cpId, new cpId) pairs
+  struct TraceFix {
+    std::string fileName;
+    std::vector<std::pair<uint, uint> > cpIdPairs;
+  };
+
 
 private:
   std::string m_name;
@@ -374,6 +477,8 @@ private:
 
   std::string m_traceFileName;   // non-empty, if relevant
   StringSet m_traceFileNameSet;
+  std::vector<TraceFix> m_traceFixes; // cf. fixTraceFiles()
+  size_t m_traceFixBytes;
   uint64_t m_traceMinTime, m_traceMaxTime;
 
   //typedef std::map<std::string, std::string> StrToStrMap;
@@ -0,0 +1,1364 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A compact wire encoding of CallPath::Profile for exchanging
+//   intermediate (unstructured) profiles between processes.
+//
+// Description:
+//   Cf. CallPath::Profile::wire_pack(), wire_unpack(), wire_merge().
+//
+//     [header]   magic, version, endian tag
+//     [strings]  num-strings; each: length, bytes
+//     [meta]     name (string id), fmt-version, epoch flags,
+//                measurement granularity, trace min/max times,
+//                virtual-metrics flag
+//     [metrics]  num-metrics; each: formatted name and description
+//                (string ids), value type, multiplexed flag, period
+//                mean, number of samples
+//     [loadmap]  num-lms; each (in id order, from 1): name (string id)
+//     [cct]      num-metric-values, followed by each node in preorder:
+//                  flags (node type and NFlg_* presence bits)
+//                  num-children
+//                  [cp-id] [assoc-info] lm-id lm-ip [lip]
+//                  [num-values; each: metric-id delta, value]
+//
+//   The root node carries only its flags and number of children.
+//   Unsigned integers are LEB128 varints; an lm-ip is the zig-zag
+//   encoded delta from the preceding node's lm-ip; doubles and lips
+//   are raw bytes in host byte order.  Since preorder and child
+//   counts fix the tree shape, node ids are not transmitted.
+//
+//   A profile may also be encoded relative to a base profile that the
+//   receiver holds (cf. Profile::WireNodeMap).  Then a node the base
+//   holds is sent as the zig-zag encoded delta of its base preorder
+//   index from the expected one (the index following the previous
+//   reference), with a cp-id or association only where they differ:
+//                  flags (with NFlg_Base), num-children, index delta
+//                  [cp-id] [assoc-info] [metric values]
+//   And a subtree that the base holds entirely (identical shape and
+//   order, no metric values) is sent as a single reference:
+//                  flags (with NFlg_BaseTree), index delta,
+//                  num-cp-ids; each: subtree offset delta, cp-id
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <new>
+#include <typeinfo>
+
+#include <cstring>
+#include <cstdlib>
+
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "CallPath-Profile.hpp"
+#include "LoadMap.hpp"
+
+#include <lib/prof-lean/hpcrun-fmt.h>
+#include <lib/prof-lean/hpcrun-metric.h>
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/RealPathMgr.hpp>
+#include <lib/support/StrUtil.hpp>
+
+
+//*************************** Forward Declarations **************************
+
+static const char    WireMagic[]  = "HPCPROF-cct-wire"; // 16 bytes
+static const int     WireMagicLen = sizeof(WireMagic) - 1;
+static const uint8_t WireVersion  = 1;
+
+enum {
+  // node type: the low bits of the node flags
+  NTy_Root     = 0,
+  NTy_Call     = 1,
+  NTy_Stmt     = 2,
+  NTy_Mask     = 0x3,
+
+  // presence of optional node fields
+  NFlg_CpId    = (1 << 2),
+  NFlg_Assoc   = (1 << 3),
+  NFlg_Lip     = (1 << 4),
+  NFlg_Metrics = (1 << 5),
+
+  // reference to a node, or subtree, of a base profile
+  NFlg_Base     = (1 << 6),
+  NFlg_BaseTree = (1 << 7)
+};
+
+
+static char
+wireEndian()
+{
+  const uint16_t x = 1;
+  return (*(const uint8_t*)&x) ? 'l' : 'b';
+}
+
+
+//***************************************************************************
+// WireWriter
+//***************************************************************************
+
+namespace {
+
+class WireWriter {
+public:
+  WireWriter()
+    : m_buf(NULL), m_sz(0), m_capacity(0)
+  { }
+
+  ~WireWriter()
+  { free(m_buf); }
+
+  // release: relinquish the malloc'd buffer and its size
+  uint8_t*
+  release(size_t* sz)
+  {
+    uint8_t* buf = m_buf;
+    *sz = m_sz;
+    m_buf = NULL;
+    m_sz = m_capacity = 0;
+    return buf;
+  }
+
+  void
+  byte(uint8_t x)
+  {
+    reserve(1);
+    m_buf[m_sz++] = x;
+  }
+
+  void
+  bytes(const void* x, size_t n)
+  {
+    reserve(n);
+    memcpy(m_buf + m_sz, x, n);
+    m_sz += n;
+  }
+
+  void
+  varint(uint64_t x)
+  {
+    reserve(10);
+    while (x >= 0x80) {
+      m_buf[m_sz++] = (uint8_t)(x | 0x80);
+      x >>= 7;
+    }
+    m_buf[m_sz++] = (uint8_t)x;
+  }
+
+  void
+  zigzag(int64_t x)
+  { varint(((uint64_t)x << 1) ^ (uint64_t)(x >> 63)); }
+
+  void
+  real8(double x)
+  { bytes(&x, sizeof(x)); }
+
+  // -------------------------------------------------------
+  // string table: note all strings, write the table and then refer
+  // to strings by id
+  // -------------------------------------------------------
+
+  void
+  noteString(const string& x)
+  { m_strToId.insert(std::make_pair(x, 0)); }
+
+  void
+  strings()
+  {
+    varint(m_strToId.size());
+    uint id = 0;
+    for (StrToIdMap::iterator it = m_strToId.begin();
+	 it != m_strToId.end(); ++it) {
+      it->second = id++;
+      varint(it->first.size());
+      bytes(it->first.data(), it->first.size());
+    }
+  }
+
+  void
+  string_id(const string& x)
+  {
+    StrToIdMap::const_iterator it = m_strToId.find(x);
+    DIAG_Assert(it != m_strToId.end(), "WireWriter: unknown string '" << x << "'");
+    varint(it->second);
+  }
+
+private:
+  void
+  reserve(size_t n)
+  {
+    if (m_sz + n > m_capacity) {
+      size_t capacity = std::max(std::max(2 * m_capacity, m_sz + n),
+				 (size_t)4096);
+      uint8_t* buf = (uint8_t*)realloc(m_buf, capacity);
+      if (!buf) {
+	throw std::bad_alloc();
+      }
+      m_buf = buf;
+      m_capacity = capacity;
+    }
+  }
+
+private:
+  typedef std::map<string, uint> StrToIdMap;
+
+  uint8_t* m_buf;
+  size_t m_sz;
+  size_t m_capacity;
+
+  StrToIdMap m_strToId;
+};
+
+} // namespace
+
+
+//***************************************************************************
+// WireReader
+//***************************************************************************
+
+namespace Prof {
+
+namespace CallPath {
+
+class WireReader {
+public:
+  // WireReader: validates the header and reads the string table and
+  // meta data, leaving the cursor at the metric table
+  WireReader(const uint8_t* buf, size_t sz)
+    : m_cur(buf), m_end(buf + sz)
+  {
+    char magic[WireMagicLen];
+    bytes(magic, WireMagicLen);
+    if (memcmp(magic, WireMagic, WireMagicLen) != 0) {
+      DIAG_Throw("Profile wire buffer: bad magic");
+    }
+    uint8_t version = byte();
+    if (version != WireVersion) {
+      DIAG_Throw("Profile wire buffer: unsupported version " << (uint)version);
+    }
+    char endian = (char)byte();
+    if (endian != wireEndian()) {
+      DIAG_Throw("Profile wire buffer: unexpected endianness '" << endian << "'");
+    }
+
+    uint64_t numStrings = varint();
+    m_strings.reserve(std::min(numStrings, (uint64_t)sz));
+    for (uint64_t i = 0; i < numStrings; ++i) {
+      uint64_t len = varint();
+      need(len);
+      m_strings.push_back(string((const char*)m_cur, len));
+      m_cur += len;
+    }
+
+    m_name = string_id();
+    m_fmtVersion = real8();
+    m_flags.bits = varint();
+    m_measurementGranularity = varint();
+    m_traceMinTime = varint();
+    m_traceMaxTime = varint();
+    m_isMetricMgrVirtual = (byte() != 0);
+  }
+
+  // -------------------------------------------------------
+  // meta data
+  // -------------------------------------------------------
+
+  const string&
+  name() const
+  { return m_name; }
+
+  double
+  fmtVersion() const
+  { return m_fmtVersion; }
+
+  epoch_flags_t
+  flags() const
+  { return m_flags; }
+
+  uint64_t
+  measurementGranularity() const
+  { return m_measurementGranularity; }
+
+  uint64_t
+  traceMinTime() const
+  { return m_traceMinTime; }
+
+  uint64_t
+  traceMaxTime() const
+  { return m_traceMaxTime; }
+
+  bool
+  isMetricMgrVirtual() const
+  { return m_isMetricMgrVirtual; }
+
+  // -------------------------------------------------------
+  // primitives
+  // -------------------------------------------------------
+
+  bool
+  isEnd() const
+  { return (m_cur == m_end); }
+
+  uint8_t
+  byte()
+  {
+    need(1);
+    return *m_cur++;
+  }
+
+  void
+  bytes(void* x, size_t n)
+  {
+    need(n);
+    memcpy(x, m_cur, n);
+    m_cur += n;
+  }
+
+  uint64_t
+  varint()
+  {
+    uint64_t x = 0;
+    for (uint shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      x |= (uint64_t)(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+	return x;
+      }
+    }
+    DIAG_Throw("Profile wire buffer: bad varint");
+  }
+
+  int64_t
+  zigzag()
+  {
+    uint64_t x = varint();
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+  }
+
+  double
+  real8()
+  {
+    double x;
+    bytes(&x, sizeof(x));
+    return x;
+  }
+
+  const string&
+  string_id()
+  {
+    uint64_t id = varint();
+    if (id >= m_strings.size()) {
+      DIAG_Throw("Profile wire buffer: bad string id " << id);
+    }
+    return m_strings[id];
+  }
+
+private:
+  void
+  need(uint64_t n)
+  {
+    if ((uint64_t)(m_end - m_cur) < n) {
+      DIAG_Throw("Profile wire buffer: truncated");
+    }
+  }
+
+private:
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+
+  std::vector<string> m_strings;
+
+  string m_name;
+  double m_fmtVersion;
+  epoch_flags_t m_flags;
+  uint64_t m_measurementGranularity;
+  uint64_t m_traceMinTime, m_traceMaxTime;
+  bool m_isMetricMgrVirtual;
+};
+
+} // namespace CallPath
+
+} // namespace Prof
+
+
+//***************************************************************************
+// WireBase
+//***************************************************************************
+
+// wire_effectiveCPId: the cp-id that a node's encoding conveys
+static uint
+wire_effectiveCPId(const Prof::CCT::ADynNode* n)
+{
+  uint cpId = n->cpId();
+  return (hpcrun_fmt_doRetainId(cpId)) ? cpId : HPCRUN_FMT_CCTNodeId_NULL;
+}
+
+
+// wire_nodeTy: the wire node type of 'n'
+static uint8_t
+wire_nodeTy(const Prof::CCT::ANode* n)
+{
+  if (typeid(*n) == typeid(Prof::CCT::Call)) {
+    return NTy_Call;
+  }
+  else if (typeid(*n) == typeid(Prof::CCT::Stmt)) {
+    return NTy_Stmt;
+  }
+  DIAG_Die("Profile wire encoding: unexpected CCT node type");
+}
+
+
+// wire_preorder: Collect the nodes of the tree at 'root' in preorder,
+// as CCT::ANodeIterator visits them, along with their subtree sizes
+// and (optionally) the preorder index of their parents (the root is
+// its own parent).
+static void
+wire_preorder(const Prof::CCT::ANode* root,
+	      std::vector<const Prof::CCT::ANode*>& nodes,
+	      std::vector<uint>& sizes, std::vector<uint>* parents)
+{
+  std::vector<uint> ancestors;
+
+  for (Prof::CCT::ANodeIterator it(root); it.Current(); ++it) {
+    const Prof::CCT::ANode* n = it.current();
+    uint idx = nodes.size();
+
+    while (!ancestors.empty() && nodes[ancestors.back()] != n->parent()) {
+      sizes[ancestors.back()] = idx - ancestors.back();
+      ancestors.pop_back();
+    }
+
+    nodes.push_back(n);
+    sizes.push_back(0);
+    if (parents) {
+      parents->push_back((ancestors.empty()) ? idx : ancestors.back());
+    }
+    ancestors.push_back(idx);
+  }
+
+  while (!ancestors.empty()) {
+    sizes[ancestors.back()] = nodes.size() - ancestors.back();
+    ancestors.pop_back();
+  }
+}
+
+
+namespace Prof {
+
+namespace CallPath {
+
+// WireBase: The base profile against which a profile was encoded (cf.
+// Profile::wire_pack()), with the nodes decoded so far for each of
+// its nodes.
+class WireBase {
+public:
+  WireBase(const Profile& base)
+    : m_base(base), m_nextIdx(1)
+  {
+    wire_preorder(base.cct()->root(), m_nodes, m_sizes, &m_parents);
+    m_newNodes.resize(m_nodes.size(), NULL);
+  }
+
+  // makeLMIdMap: map the base's load module ids to those of
+  //   'x_loadmap' (by name), which must have each of them
+  void
+  makeLMIdMap(const LoadMap& x_loadmap)
+  {
+    const LoadMap& loadmap = *m_base.loadmap();
+
+    m_lmIdMap.resize(loadmap.size() + 1);
+    m_lmIdMap[LoadMap::LMId_NULL] = LoadMap::LMId_NULL;
+    for (LoadMap::LMId_t i = 1; i <= loadmap.size(); ++i) {
+      const string& nm = loadmap.lm(i)->name();
+      LoadMap::LMSet_nm::iterator it = x_loadmap.lm_find(nm);
+      if (it == x_loadmap.lm_end_nm()) {
+	DIAG_Throw("Profile wire buffer: base load module '" << nm << "' is unknown");
+      }
+      m_lmIdMap[i] = (*it)->id();
+    }
+  }
+
+  // index: the index of a referenced node, given its delta from the
+  //   expected index
+  uint
+  index(int64_t delta) const
+  {
+    int64_t idx = (int64_t)m_nextIdx + delta;
+    if (idx < 1 || idx >= (int64_t)m_nodes.size()) {
+      DIAG_Throw("Profile wire buffer: bad base node index " << idx);
+    }
+    return (uint)idx;
+  }
+
+  // nextIndex: note the expected index of the next reference
+  void
+  nextIndex(uint idx)
+  { m_nextIdx = idx; }
+
+  uint
+  size(uint idx) const
+  { return m_sizes[idx]; }
+
+  uint
+  parent(uint idx) const
+  { return m_parents[idx]; }
+
+  uint
+  cpId(uint idx) const
+  { return wire_effectiveCPId(dynNode(idx)); }
+
+  lush_assoc_info_t
+  assocInfo(uint idx) const
+  { return dynNode(idx)->assocInfo(); }
+
+  uint8_t
+  nodeTy(uint idx) const
+  { return wire_nodeTy(m_nodes[idx]); }
+
+  // makeNode: make a (parentless) copy of the base's node 'idx' of
+  //   type 'nodeTy', with the given cp-id, association and metrics, and
+  //   with load module ids of 'x_loadmap'
+  CCT::ADynNode*
+  makeNode(uint idx, uint8_t nodeTy, uint cpId, lush_assoc_info_t as_info,
+	   const Metric::IData& metricData, LoadMap& x_loadmap) const
+  {
+    const CCT::ADynNode* n = dynNode(idx);
+
+    LoadMap::LMId_t lmId = m_lmIdMap[n->lmId_real()];
+    x_loadmap.lm(lmId)->isUsedMrg(true);
+
+    lush_lip_t* lip = NULL;
+    if (n->lip()) {
+      lush_lip_t lip_y = *(n->lip());
+      LoadMap::LMId_t lip_lmId = m_lmIdMap[lush_lip_getLMId(&lip_y)];
+      lush_lip_setLMId(&lip_y, (uint16_t)lip_lmId);
+      x_loadmap.lm(lip_lmId)->isUsedMrg(true);
+      lip = CCT::ADynNode::clone_lip(&lip_y);
+    }
+
+    if (nodeTy == NTy_Call && typeid(*n) == typeid(CCT::Call)) {
+      return new CCT::Call(NULL, cpId, as_info, lmId, n->lmIP_real(), 0, lip,
+			   metricData);
+    }
+    else if (nodeTy == NTy_Stmt && typeid(*n) == typeid(CCT::Stmt)) {
+      return new CCT::Stmt(NULL, cpId, as_info, lmId, n->lmIP_real(), 0, lip,
+			   metricData);
+    }
+    delete lip;
+    DIAG_Throw("Profile wire buffer: base node type mismatch");
+  }
+
+  // newNode: the decoded node for the base's node 'idx' (or NULL)
+  CCT::ANode*
+  newNode(uint idx) const
+  { return m_newNodes[idx]; }
+
+  void
+  newNode(uint idx, CCT::ANode* n)
+  { m_newNodes[idx] = n; }
+
+  std::vector<CCT::ANode*>&
+  newNodes()
+  { return m_newNodes; }
+
+private:
+  const CCT::ADynNode*
+  dynNode(uint idx) const
+  {
+    const CCT::ADynNode* n = dynamic_cast<const CCT::ADynNode*>(m_nodes[idx]);
+    DIAG_Assert(n, "WireBase: unexpected base node type");
+    return n;
+  }
+
+private:
+  const Profile& m_base;
+
+  std::vector<const CCT::ANode*> m_nodes; // preorder
+  std::vector<uint> m_sizes;
+  std::vector<uint> m_parents;
+
+  std::vector<LoadMap::LMId_t> m_lmIdMap;
+  std::vector<CCT::ANode*> m_newNodes;
+
+  uint m_nextIdx;
+};
+
+} // namespace CallPath
+
+} // namespace Prof
+
+
+//***************************************************************************
+// 
+//***************************************************************************
+
+// wire_readMetric: Make the descriptor for metric 'mId', as
+// Profile::fmt_epoch_fread() would when reading a metric table written
+// by Profile::fmt_epoch_fwrite() (a virtual metric table, without
+// inclusive/exclusive pairs).  This preserves the semantics of
+// exchanging profiles as hpcrun-fmt.
+static Prof::Metric::ADesc*
+wire_readMetric(Prof::CallPath::WireReader& y, uint mId)
+{
+  using namespace Prof;
+
+  string nm = y.string_id();
+  string desc = y.string_id();
+
+  hpcrun_metricFlags_t flags = hpcrun_metricFlags_NULL;
+  flags.fields.ty = MetricFlags_Ty_Final;
+  flags.fields.valTy = (MetricFlags_ValTy_t)y.byte();
+  flags.fields.valFmt = MetricFlags_ValFmt_Real;
+
+  bool isMultiplexed = (y.byte() != 0);
+  double periodMean = y.real8();
+  uint64_t numSamples = y.varint();
+
+  Metric::SampledDesc* m =
+    new Metric::SampledDesc(nm, desc, 1/*period*/, true/*isUnitsEvents*/,
+			    ""/*profName*/, StrUtil::toStr(mId), "HPCRUN",
+			    flags.fields.show, false, flags.fields.showPercent);
+  m->order((int)mId);
+
+  if (nm == HPCRUN_METRIC_RetCnt) {
+    m->type(Metric::ADesc::TyExcl);
+  }
+  else {
+    m->type(Metric::ADesc::fromHPCRunMetricValTy(flags.fields.valTy));
+  }
+  m->flags(flags);
+
+  m->sampling_type(Metric::SamplingType_t::PERIOD);
+  m->isMultiplexed(isMultiplexed);
+  m->periodMean   (periodMean);
+  m->num_samples  (numSamples);
+
+  return m;
+}
+
+
+// wire_numValues: the number of non-zero values among the first
+// 'numMetrics' metrics of 'n'
+static uint
+wire_numValues(const Prof::CCT::ANode* n, uint numMetrics)
+{
+  uint nMetrics = std::min(numMetrics, (uint)n->numMetrics());
+  uint numValues = 0;
+  for (uint i = 0; i < nMetrics; ++i) {
+    if (n->metric(i) != 0.0) {
+      numValues++;
+    }
+  }
+  return numValues;
+}
+
+
+static void
+wire_writeValues(WireWriter& wr, const Prof::CCT::ANode* n, uint numMetrics,
+		 uint numValues)
+{
+  uint nMetrics = std::min(numMetrics, (uint)n->numMetrics());
+  wr.varint(numValues);
+  uint mId_prev = 0;
+  for (uint i = 0; i < nMetrics; ++i) {
+    double val = n->metric(i);
+    if (val != 0.0) {
+      wr.varint(i - mId_prev);
+      wr.real8(val);
+      mId_prev = i;
+    }
+  }
+}
+
+
+// wire_matchBase: For each node of 'nodes' (in preorder), find the
+// base node it corresponds to, if any ('baseIdx'; 0 if none), and the
+// length of the run of nodes, in preorder, that correspond to
+// consecutive base nodes, that have no metric values and whose
+// associations match the base's ('baseRun').  A node heads a subtree
+// that the base holds entirely iff its run covers its subtree, which
+// is the size of its base subtree.
+static void
+wire_matchBase(const std::vector<const Prof::CCT::ANode*>& nodes,
+	       const Prof::CallPath::Profile::WireNodeMap& baseMap,
+	       uint numMetrics,
+	       std::vector<uint>& baseIdx, std::vector<uint>& baseRun)
+{
+  using namespace Prof;
+
+  // N.B.: if several base nodes were merged into one node, use the first
+  std::map<const CCT::ANode*, uint> nodeToBaseIdx;
+  for (uint i = 1; i < baseMap.size(); ++i) {
+    if (baseMap[i].node) {
+      nodeToBaseIdx.insert(std::make_pair(baseMap[i].node, i));
+    }
+  }
+
+  baseIdx.assign(nodes.size(), 0);
+  baseRun.assign(nodes.size(), 0);
+
+  for (uint p = nodes.size(); p-- > 1; ) {
+    const CCT::ANode* n = nodes[p];
+    std::map<const CCT::ANode*, uint>::const_iterator it =
+      nodeToBaseIdx.find(n);
+    if (it == nodeToBaseIdx.end()) {
+      continue;
+    }
+
+    uint i = it->second;
+    baseIdx[p] = i;
+
+    const CCT::ADynNode* n_dyn = dynamic_cast<const CCT::ADynNode*>(n);
+    if (n_dyn && n_dyn->assocInfo().bits == baseMap[i].assocBits
+	&& wire_numValues(n, numMetrics) == 0) {
+      bool isNextInRun = (p + 1 < nodes.size() && baseIdx[p + 1] == i + 1);
+      baseRun[p] = 1 + ((isNextInRun) ? baseRun[p + 1] : 0);
+    }
+  }
+}
+
+
+namespace Prof {
+
+namespace CallPath {
+
+//***************************************************************************
+// Profile: wire encoding
+//***************************************************************************
+
+void
+Profile::wire_pack(const Profile& prof, const WireNodeMap* baseMap,
+		   uint8_t** buffer, size_t* bufferSz)
+{
+  const Metric::Mgr& mMgr = *prof.metricMgr();
+  const LoadMap& loadmap = *prof.loadmap();
+  const CCT::ANode* root = prof.cct()->root();
+
+  DIAG_Assert(root && typeid(*root) == typeid(CCT::Root),
+	      "Profile::wire_pack: expected a canonical CCT");
+
+  WireWriter wr;
+
+  // ------------------------------------------------------------
+  // string table
+  // ------------------------------------------------------------
+  wr.noteString(prof.m_name);
+  for (uint i = 0; i < mMgr.size(); ++i) {
+    const Metric::ADesc* m = mMgr.metric(i);
+    wr.noteString(m->nameToFmt());
+    wr.noteString(m->description());
+  }
+  for (LoadMap::LMId_t i = 1; i <= loadmap.size(); ++i) {
+    wr.noteString(loadmap.lm(i)->name());
+  }
+
+  // ------------------------------------------------------------
+  // header, string table, meta data
+  // ------------------------------------------------------------
+  wr.bytes(WireMagic, WireMagicLen);
+  wr.byte(WireVersion);
+  wr.byte((uint8_t)wireEndian());
+
+  wr.strings();
+
+  wr.string_id(prof.m_name);
+  wr.real8(prof.m_fmtVersion);
+  wr.varint(prof.m_flags.bits);
+  wr.varint(prof.m_measurementGranularity);
+  wr.varint(prof.m_traceMinTime);
+  wr.varint(prof.m_traceMaxTime);
+  wr.byte(prof.isMetricMgrVirtual());
+
+  // ------------------------------------------------------------
+  // metric table
+  // ------------------------------------------------------------
+  wr.varint(mMgr.size());
+  for (uint i = 0; i < mMgr.size(); ++i) {
+    const Metric::ADesc* m = mMgr.metric(i);
+    wr.string_id(m->nameToFmt());
+    wr.string_id(m->description());
+    wr.byte((uint8_t)Metric::ADesc::toHPCRunMetricValTy(m->type()));
+    wr.byte(m->isMultiplexed());
+    wr.real8(m->periodMean());
+    wr.varint(m->num_samples());
+  }
+
+  // ------------------------------------------------------------
+  // loadmap
+  // ------------------------------------------------------------
+  wr.varint(loadmap.size());
+  for (LoadMap::LMId_t i = 1; i <= loadmap.size(); ++i) {
+    const LoadMap::LM* lm = loadmap.lm(i);
+    DIAG_Assert(lm->id() == i, "Profile::wire_pack: expected dense load module ids");
+    wr.string_id(lm->name());
+  }
+
+  // ------------------------------------------------------------
+  // cct
+  // ------------------------------------------------------------
+  uint numMetrics = (prof.isMetricMgrVirtual()) ? 0 : mMgr.size();
+  wr.varint(numMetrics);
+
+  std::vector<const CCT::ANode*> nodes;
+  std::vector<uint> sizes;
+  wire_preorder(root, nodes, sizes, NULL);
+
+  std::vector<uint> baseIdx, baseRun;
+  if (baseMap) {
+    wire_matchBase(nodes, *baseMap, numMetrics, baseIdx, baseRun);
+  }
+
+  wr.byte(NTy_Root);
+  wr.varint(root->childCount());
+
+  VMA lmIP_prev = 0;
+  uint baseIdx_next = 1;
+
+  for (uint p = 1; p < nodes.size(); /* */) {
+    const CCT::ANode* n = nodes[p];
+    const CCT::ADynNode* n_dyn = dynamic_cast<const CCT::ADynNode*>(n);
+    uint8_t flg = wire_nodeTy(n);
+    uint cpId = wire_effectiveCPId(n_dyn);
+
+    uint i = (baseMap) ? baseIdx[p] : 0;
+
+    // ----------------------------------------------------------
+    // A subtree the base holds: a reference and the cp-ids that differ
+    // ----------------------------------------------------------
+    if (i > 0 && baseRun[p] >= sizes[p] && sizes[p] == (*baseMap)[i].size) {
+      std::vector<uint> cpIdOffsets;
+      for (uint k = 0; k < sizes[p]; ++k) {
+	uint cpId_k =
+	  wire_effectiveCPId(dynamic_cast<const CCT::ADynNode*>(nodes[p + k]));
+	if (cpId_k != (*baseMap)[i + k].cpId) {
+	  cpIdOffsets.push_back(k);
+	}
+      }
+
+      wr.byte(flg | NFlg_Base | NFlg_BaseTree);
+      wr.zigzag((int64_t)i - (int64_t)baseIdx_next);
+      wr.varint(cpIdOffsets.size());
+      uint k_prev = 0;
+      for (uint j = 0; j < cpIdOffsets.size(); ++j) {
+	uint k = cpIdOffsets[j];
+	wr.varint(k - k_prev);
+	wr.varint(wire_effectiveCPId(
+		    dynamic_cast<const CCT::ADynNode*>(nodes[p + k])));
+	k_prev = k;
+      }
+
+      baseIdx_next = i + sizes[p];
+      p += sizes[p];
+      continue;
+    }
+
+    uint numValues = wire_numValues(n, numMetrics);
+    if (numValues > 0) {
+      flg |= NFlg_Metrics;
+    }
+
+    // ----------------------------------------------------------
+    // A node the base holds: a reference and what differs
+    // ----------------------------------------------------------
+    if (i > 0) {
+      flg |= NFlg_Base;
+      if (cpId != (*baseMap)[i].cpId) {
+	flg |= NFlg_CpId;
+      }
+      if (n_dyn->assocInfo().bits != (*baseMap)[i].assocBits) {
+	flg |= NFlg_Assoc;
+      }
+
+      wr.byte(flg);
+      wr.varint(n->childCount());
+      wr.zigzag((int64_t)i - (int64_t)baseIdx_next);
+
+      if (flg & NFlg_CpId) {
+	wr.varint(cpId);
+      }
+      if (flg & NFlg_Assoc) {
+	wr.varint(n_dyn->assocInfo().bits);
+      }
+      if (flg & NFlg_Metrics) {
+	wire_writeValues(wr, n, numMetrics, numValues);
+      }
+
+      baseIdx_next = i + 1;
+      p++;
+      continue;
+    }
+
+    // ----------------------------------------------------------
+    // Any other node
+    // ----------------------------------------------------------
+    if (cpId != HPCRUN_FMT_CCTNodeId_NULL) {
+      flg |= NFlg_CpId;
+    }
+    if (n_dyn->assocInfo().bits != lush_assoc_info_NULL.bits) {
+      flg |= NFlg_Assoc;
+    }
+    if (n_dyn->lip()) {
+      flg |= NFlg_Lip;
+    }
+
+    wr.byte(flg);
+    wr.varint(n->childCount());
+
+    if (flg & NFlg_CpId) {
+      wr.varint(cpId);
+    }
+    if (flg & NFlg_Assoc) {
+      wr.varint(n_dyn->assocInfo().bits);
+    }
+
+    VMA lmIP = n_dyn->lmIP_real();
+    wr.varint(n_dyn->lmId_real());
+    wr.zigzag((int64_t)(lmIP - lmIP_prev));
+    lmIP_prev = lmIP;
+
+    if (flg & NFlg_Lip) {
+      wr.bytes(n_dyn->lip(), sizeof(lush_lip_t));
+    }
+
+    if (flg & NFlg_Metrics) {
+      wire_writeValues(wr, n, numMetrics, numValues);
+    }
+    p++;
+  }
+
+  *buffer = wr.release(bufferSz);
+}
+
+
+Profile*
+Profile::wire_unpack(const uint8_t* buffer, size_t bufferSz,
+		     const Profile* base, std::vector<CCT::ANode*>* baseNodes)
+{
+  WireReader y(buffer, bufferSz);
+
+  Profile* prof = new Profile(y.name());
+  prof->m_fmtVersion = y.fmtVersion();
+  prof->m_flags = y.flags();
+  prof->m_measurementGranularity = y.measurementGranularity();
+  prof->isMetricMgrVirtual(y.isMetricMgrVirtual());
+
+  WireBase* y_base = (base) ? new WireBase(*base) : NULL;
+
+  try {
+    prof->wire_merge(y, Merge_CreateMetric, NULL, NULL, y_base);
+  }
+  catch (...) {
+    delete prof;
+    delete y_base;
+    throw;
+  }
+
+  if (y_base && baseNodes) {
+    baseNodes->swap(y_base->newNodes());
+  }
+  delete y_base;
+
+  prof->metricMgr()->computePartners();
+
+  return prof;
+}
+
+
+uint
+Profile::wire_merge(const uint8_t* buffer, size_t bufferSz, int mergeTy,
+		    Metric::Mgr* y_mMgr, WireNodeMap* y_nodeMap)
+{
+  WireReader y(buffer, bufferSz);
+  return wire_merge(y, mergeTy, y_mMgr, y_nodeMap, NULL);
+}
+
+
+namespace {
+
+// a node of x whose children are (being) merged with the next
+// 'numKids' nodes of y
+struct WireFrame {
+  WireFrame(CCT::ANode* node_, uint64_t numKids_, bool isInserted_,
+	    uint y_idx_)
+    : node(node_), numKids(numKids_), isInserted(isInserted_), y_idx(y_idx_)
+  { }
+
+  CCT::ANode* node;
+  uint64_t numKids;
+  bool isInserted; // node came from y: its y-children are simply inserted
+  uint y_idx;      // the preorder index of the corresponding y node
+};
+
+} // namespace
+
+
+// N.B.: Mirrors merge(): merge meta data, metrics, LoadMaps and then
+// CCTs (cf. CCT::ANode::mergeDeep()), but applies the LoadMap's merge
+// effects as each y node is decoded; and each y node is either merged
+// into a corresponding x node (and destroyed) or linked into x.
+//
+// If y was encoded relative to 'base', x must be empty: nodes of the
+// base's subtrees are then simply linked into x.
+uint
+Profile::wire_merge(WireReader& y, int mergeTy, Metric::Mgr* y_mMgr,
+		    WireNodeMap* y_nodeMap, WireBase* base)
+{
+  Profile& x = (*this);
+
+  // -------------------------------------------------------
+  // merge name, flags, etc
+  // -------------------------------------------------------
+  x.merge_meta(y.fmtVersion(), y.flags(), y.measurementGranularity(),
+	       y.traceMinTime(), y.traceMaxTime());
+
+  x.m_profileFileName = "";
+  x.m_traceFileName = "";
+
+  // -------------------------------------------------------
+  // merge metrics
+  // -------------------------------------------------------
+  Metric::Mgr y_mMgrLcl;
+  Metric::Mgr& y_metricMgr = (y_mMgr) ? *y_mMgr : y_mMgrLcl;
+
+  uint64_t numMetricDescs = y.varint();
+  for (uint i = 0; i < numMetricDescs; ++i) {
+    y_metricMgr.insert(wire_readMetric(y, i));
+  }
+
+  uint x_newMetricBegIdx = 0;
+  uint firstMergedMetric =
+    mergeMetrics(y_metricMgr, y.isMetricMgrVirtual(), mergeTy,
+		 x_newMetricBegIdx);
+
+  // -------------------------------------------------------
+  // merge LoadMaps: form the map of y's load module ids to x's
+  // -------------------------------------------------------
+  std::vector<LoadMap::LMId_t> lmIdMap;
+  {
+    uint64_t numLMs = y.varint();
+
+    LoadMap y_loadmap(numLMs);
+    for (uint64_t i = 0; i < numLMs; ++i) {
+      string nm = y.string_id();
+      RealPathMgr::singleton().realpath(nm);
+      y_loadmap.lm_insert(new LoadMap::LM(nm));
+    }
+
+    lmIdMap.resize(y_loadmap.size() + 1);
+    for (LoadMap::LMId_t i = 0; i < lmIdMap.size(); ++i) {
+      lmIdMap[i] = i;
+    }
+
+    std::vector<LoadMap::MergeEffect>* mrgEffects =
+      x.m_loadmap->merge(y_loadmap);
+    for (uint i = 0; i < mrgEffects->size(); ++i) {
+      const LoadMap::MergeEffect& chg = (*mrgEffects)[i];
+      lmIdMap[chg.old_id] = chg.new_id;
+    }
+    delete mrgEffects;
+  }
+
+  if (base) {
+    base->makeLMIdMap(*x.m_loadmap);
+  }
+
+  // -------------------------------------------------------
+  // merge CCTs
+  // -------------------------------------------------------
+  uint numMetrics = y.varint();
+
+  CCT::ANode* x_root = x.cct()->root();
+  DIAG_Assert(x_root && typeid(*x_root) == typeid(CCT::Root),
+	      "Profile::wire_merge: expected a canonical CCT");
+
+  uint8_t flg = y.byte();
+  if ((flg & NTy_Mask) != NTy_Root) {
+    DIAG_Throw("Profile wire buffer: expected a canonical CCT");
+  }
+  // as with hpcrun-fmt, whose (synthetic) root refers to LMId_NULL
+  x.m_loadmap->lm(LoadMap::LMId_NULL)->isUsedMrg(true);
+
+  CCT::MergeContext& mrgCtxt = x.cct()->mergeContext();
+
+  std::vector<WireFrame> stack;
+  stack.push_back(WireFrame(x_root, y.varint(), false, 0));
+
+  uint y_numNodes = 1;
+  if (y_nodeMap) {
+    y_nodeMap->clear();
+    WireNode y_root = { x_root, HPCRUN_FMT_CCTNodeId_NULL,
+			lush_assoc_info_NULL.bits, 0 };
+    y_nodeMap->push_back(y_root);
+  }
+
+  VMA lmIP_prev = 0;
+
+  while (true) {
+    while (!stack.empty() && stack.back().numKids == 0) {
+      if (y_nodeMap) {
+	uint y_idx = stack.back().y_idx;
+	(*y_nodeMap)[y_idx].size = y_numNodes - y_idx;
+      }
+      stack.pop_back();
+    }
+    if (stack.empty()) {
+      break;
+    }
+
+    stack.back().numKids--;
+    CCT::ANode* x_parent = stack.back().node;
+    bool isInserted = stack.back().isInserted;
+
+    flg = y.byte();
+
+    if ((flg & (NFlg_Base | NFlg_BaseTree)) && !base) {
+      DIAG_Throw("Profile wire buffer: unexpected base node reference");
+    }
+
+    // ----------------------------------------------------------
+    // Link a copy of the base's subtree, with its new cp-ids
+    // ----------------------------------------------------------
+    if (flg & NFlg_BaseTree) {
+      uint idx = base->index(y.zigzag());
+      uint size = base->size(idx);
+
+      std::vector<uint> cpIds(size);
+      for (uint k = 0; k < size; ++k) {
+	cpIds[k] = base->cpId(idx + k);
+      }
+      uint64_t numCPIds = y.varint();
+      uint64_t offset = 0;
+      for (uint64_t j = 0; j < numCPIds; ++j) {
+	offset += y.varint();
+	if (offset >= size) {
+	  DIAG_Throw("Profile wire buffer: bad base subtree offset " << offset);
+	}
+	cpIds[offset] = y.varint();
+      }
+
+      Metric::IData metricData(numMetrics);
+      for (uint k = 0; k < size; ++k) {
+	uint i = idx + k;
+	uint8_t nodeTy = (k == 0) ? (flg & NTy_Mask) : base->nodeTy(i);
+	CCT::ADynNode* y_dyn = base->makeNode(i, nodeTy, cpIds[k],
+					      base->assocInfo(i), metricData,
+					      *x.m_loadmap);
+
+	CCT::ANode* y_parent =
+	  (k == 0) ? x_parent : base->newNode(base->parent(i));
+
+	// cf. CCT::ANode::mergeDeep_fixInsert()
+	CCT::MergeContext::pair ret = mrgCtxt.ensureUniqueCPId(y_dyn->cpId());
+	y_dyn->cpId(ret.cpId);
+	y_dyn->insertMetricsBefore(x_newMetricBegIdx);
+
+	y_dyn->link(y_parent);
+	base->newNode(i, y_dyn);
+      }
+
+      base->nextIndex(idx + size);
+      y_numNodes += size;
+      continue;
+    }
+
+    // ----------------------------------------------------------
+    // Decode y node, translating its load module ids
+    // ----------------------------------------------------------
+    uint64_t numKids = y.varint();
+
+    uint baseIdx = 0;
+    if (flg & NFlg_Base) {
+      baseIdx = base->index(y.zigzag());
+      base->nextIndex(baseIdx + 1);
+    }
+
+    uint cpId = HPCRUN_FMT_CCTNodeId_NULL;
+    if (flg & NFlg_CpId) {
+      cpId = y.varint();
+    }
+    else if (baseIdx > 0) {
+      cpId = base->cpId(baseIdx);
+    }
+
+    lush_assoc_info_t as_info = lush_assoc_info_NULL;
+    if (flg & NFlg_Assoc) {
+      as_info.bits = (uint32_t)y.varint();
+    }
+    else if (baseIdx > 0) {
+      as_info = base->assocInfo(baseIdx);
+    }
+
+    uint64_t lmId = LoadMap::LMId_NULL;
+    VMA lmIP = 0;
+    lush_lip_t* lip = NULL;
+
+    if (baseIdx == 0) {
+      lmId = y.varint();
+      if (lmId >= lmIdMap.size()) {
+	DIAG_Throw("Profile wire buffer: bad load module id " << lmId);
+      }
+      lmId = lmIdMap[lmId];
+      x.m_loadmap->lm(lmId)->isUsedMrg(true);
+
+      lmIP = lmIP_prev + (VMA)y.zigzag();
+      lmIP_prev = lmIP;
+
+      if (flg & NFlg_Lip) {
+	lush_lip_t lip_y;
+	y.bytes(&lip_y, sizeof(lip_y));
+
+	LoadMap::LMId_t lip_lmId = lush_lip_getLMId(&lip_y);
+	if (lip_lmId >= lmIdMap.size()) {
+	  DIAG_Throw("Profile wire buffer: bad (logical) load module id " << lip_lmId);
+	}
+	lip_lmId = lmIdMap[lip_lmId];
+	lush_lip_setLMId(&lip_y, (uint16_t)lip_lmId);
+	x.m_loadmap->lm(lip_lmId)->isUsedMrg(true);
+
+	lip = CCT::ADynNode::clone_lip(&lip_y);
+      }
+    }
+
+    Metric::IData metricData(numMetrics);
+    if (flg & NFlg_Metrics) {
+      uint64_t numValues = y.varint();
+      uint64_t mId = 0;
+      for (uint64_t i = 0; i < numValues; ++i) {
+	mId += y.varint();
+	if (mId >= numMetrics) {
+	  delete lip;
+	  DIAG_Throw("Profile wire buffer: bad metric id " << mId);
+	}
+	metricData.metric(mId) = y.real8();
+      }
+    }
+
+    CCT::ADynNode* y_dyn = NULL;
+    if (baseIdx > 0) {
+      y_dyn = base->makeNode(baseIdx, flg & NTy_Mask, cpId, as_info,
+			     metricData, *x.m_loadmap);
+    }
+    else {
+      switch (flg & NTy_Mask) {
+        case NTy_Call:
+	  y_dyn = new CCT::Call(NULL, cpId, as_info, lmId, lmIP, 0, lip,
+				metricData);
+	  break;
+        case NTy_Stmt:
+	  y_dyn = new CCT::Stmt(NULL, cpId, as_info, lmId, lmIP, 0, lip,
+				metricData);
+	  break;
+        default:
+	  delete lip;
+	  DIAG_Throw("Profile wire buffer: unexpected CCT node type " << (uint)flg);
+      }
+    }
+
+    // ----------------------------------------------------------
+    // Merge y node into x's CCT (cf. CCT::ANode::mergeDeep())
+    // ----------------------------------------------------------
+    CCT::ADynNode* x_dyn = NULL;
+    if (!isInserted) {
+      // N.B.: y_dyn's children are not yet materialized
+      x_dyn = x_parent->findDynChild(*y_dyn, (numKids == 0));
+    }
+
+    uint y_idx = y_numNodes++;
+    if (x_dyn) {
+      x_dyn->mergeMe(*y_dyn, &mrgCtxt, x_newMetricBegIdx);
+      delete y_dyn;
+      stack.push_back(WireFrame(x_dyn, numKids, false, y_idx));
+    }
+    else {
+      // cf. CCT::ANode::mergeDeep_fixInsert()
+      CCT::MergeContext::pair ret = mrgCtxt.ensureUniqueCPId(y_dyn->cpId());
+      y_dyn->cpId(ret.cpId);
+      y_dyn->insertMetricsBefore(x_newMetricBegIdx);
+
+      y_dyn->link(x_parent);
+      x_dyn = y_dyn;
+      stack.push_back(WireFrame(y_dyn, numKids, true, y_idx));
+    }
+
+    if (y_nodeMap) {
+      WireNode y_node = { x_dyn, cpId, as_info.bits, 0 };
+      y_nodeMap->push_back(y_node);
+    }
+    if (baseIdx > 0) {
+      base->newNode(baseIdx, x_dyn);
+    }
+  }
+
+  if (!y.isEnd()) {
+    DIAG_Throw("Profile wire buffer: trailing data");
+  }
+
+  return firstMergedMetric;
+}
+
+
+} // namespace CallPath
+
+} // namespace Prof
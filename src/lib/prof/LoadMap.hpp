@@ -83,6 +83,7 @@
 #include <lib/prof-lean/hpcrun-fmt.h>
 
 #include <lib/support/diagnostics.h>
+#include <lib/support/InternStr.hpp>
 #include <lib/support/Unique.hpp>
 
 
@@ -176,7 +177,7 @@ public:
     
   private: 
     LMId_t m_id;
-    std::string m_name;
+    InternStr m_name;
     bool m_isUsed;
   };
 
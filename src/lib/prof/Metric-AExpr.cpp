@@ -139,6 +139,14 @@ Neg::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Neg::compile(AExprProg& prog) const
+{
+  m_expr->compile(prog);
+  prog.emit(AExprProg::OpNeg);
+}
+
+
 std::ostream&
 Neg::dumpMe(std::ostream& os) const
 {
@@ -177,6 +185,15 @@ Power::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Power::compile(AExprProg& prog) const
+{
+  m_base->compile(prog);
+  m_exponent->compile(prog);
+  prog.emit(AExprProg::OpPower);
+}
+
+
 std::ostream&
 Power::dumpMe(std::ostream& os) const
 {
@@ -209,6 +226,15 @@ Divide::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Divide::compile(AExprProg& prog) const
+{
+  m_numerator->compile(prog);
+  m_denominator->compile(prog);
+  prog.emit(AExprProg::OpDivide);
+}
+
+
 std::ostream&
 Divide::dumpMe(std::ostream& os) const
 {
@@ -237,6 +263,15 @@ Minus::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Minus::compile(AExprProg& prog) const
+{
+  m_minuend->compile(prog);
+  m_subtrahend->compile(prog);
+  prog.emit(AExprProg::OpMinus);
+}
+
+
 std::ostream&
 Minus::dumpMe(std::ostream& os) const
 {
@@ -271,6 +306,14 @@ Plus::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Plus::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpSum, m_sz);
+}
+
+
 std::ostream&
 Plus::dumpMe(std::ostream& os) const
 {
@@ -308,6 +351,14 @@ Times::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Times::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpTimes, m_sz);
+}
+
+
 std::ostream&
 Times::dumpMe(std::ostream& os) const
 {
@@ -345,6 +396,14 @@ Max::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Max::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpMax, m_sz);
+}
+
+
 std::ostream&
 Max::dumpMe(std::ostream& os) const
 {
@@ -386,6 +445,14 @@ Min::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Min::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpMin, m_sz);
+}
+
+
 std::ostream&
 Min::dumpMe(std::ostream& os) const
 {
@@ -419,6 +486,14 @@ Mean::eval(const Metric::IData& mdata) const
 }
 
 
+void
+Mean::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpMean, m_sz);
+}
+
+
 std::ostream&
 Mean::dumpMe(std::ostream& os) const
 {
@@ -453,6 +528,14 @@ StdDev::eval(const Metric::IData& mdata) const
 }
 
 
+void
+StdDev::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpStdDev, m_sz);
+}
+
+
 std::ostream&
 StdDev::dumpMe(std::ostream& os) const
 {
@@ -492,6 +575,14 @@ CoefVar::eval(const Metric::IData& mdata) const
 }
 
 
+void
+CoefVar::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpCoefVar, m_sz);
+}
+
+
 std::ostream&
 CoefVar::dumpMe(std::ostream& os) const
 {
@@ -531,6 +622,14 @@ RStdDev::eval(const Metric::IData& mdata) const
 }
 
 
+void
+RStdDev::compile(AExprProg& prog) const
+{
+  compile_opands(prog, m_opands, m_sz);
+  prog.emit(AExprProg::OpRStdDev, m_sz);
+}
+
+
 std::ostream&
 RStdDev::dumpMe(std::ostream& os) const
 {
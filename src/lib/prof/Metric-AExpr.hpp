@@ -87,6 +87,7 @@
 
 #include "Metric-IData.hpp"
 #include "Metric-IDBExpr.hpp"
+#include "Metric-AExprProg.hpp"
 
 #include <lib/support/NaN.h>
 #include <lib/support/Unique.hpp>
@@ -147,6 +148,18 @@ public:
     return z;
   }
 
+  // compile: append code to 'prog' that pushes the value of eval()
+  virtual void
+  compile(AExprProg& prog) const = 0;
+
+  // compileNF: append code to 'prog' that performs evalNF()
+  virtual void
+  compileNF(AExprProg& prog) const
+  {
+    compile(prog);
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+  }
+
 
   static bool
   isok(double x)
@@ -319,6 +332,25 @@ protected:
   }
 
 
+  void
+  compileStdDevNF(AExprProg& prog, AExpr** opands, uint sz) const
+  {
+    compile_opands(prog, opands, sz);
+    prog.emit(AExprProg::OpSumSq, sz);
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+    prog.emit(AExprProg::OpStore, m_accumId[1]);
+  }
+
+
+  static void
+  compile_opands(AExprProg& prog, AExpr** opands, uint sz)
+  {
+    for (uint i = 0; i < sz; ++i) {
+      opands[i]->compile(prog);
+    }
+  }
+
+
   static void
   dump_opands(std::ostream& os, AExpr** opands, uint sz,
 	      const char* sep = ", ");
@@ -349,6 +381,10 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return m_c; }
 
+  virtual void
+  compile(AExprProg& prog) const
+  { prog.emitConst(m_c); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -390,6 +426,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -435,6 +474,10 @@ public:
   eval(const Metric::IData& mdata) const
   { return mdata.demandMetric(m_metricId); }
 
+  virtual void
+  compile(AExprProg& prog) const
+  { prog.emit(AExprProg::OpVar, m_metricId); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -490,6 +533,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -540,6 +586,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -587,6 +636,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -631,6 +683,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -681,6 +736,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -727,6 +785,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -776,6 +837,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   // ------------------------------------------------------------
   // Metric::IDBExpr:
   // ------------------------------------------------------------
@@ -825,6 +889,9 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   {
@@ -833,6 +900,14 @@ public:
     return z;
   }
 
+  virtual void
+  compileNF(AExprProg& prog) const
+  {
+    compile_opands(prog, m_opands, m_sz);
+    prog.emit(AExprProg::OpSum, m_sz);
+    prog.emit(AExprProg::OpStore, m_accumId[0]);
+  }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr:
@@ -886,10 +961,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprProg& prog) const
+  { compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -952,10 +1034,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprProg& prog) const
+  { compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1018,10 +1107,17 @@ public:
   virtual double
   eval(const Metric::IData& mdata) const;
 
+  virtual void
+  compile(AExprProg& prog) const;
+
   virtual double
   evalNF(Metric::IData& mdata) const
   { return evalStdDevNF(mdata, m_opands, m_sz); }
 
+  virtual void
+  compileNF(AExprProg& prog) const
+  { compileStdDevNF(prog, m_opands, m_sz); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
@@ -1086,6 +1182,10 @@ public:
   eval(const Metric::IData& GCC_ATTR_UNUSED mdata) const
   { return (double)m_numSrc; }
 
+  virtual void
+  compile(AExprProg& prog) const
+  { prog.emitConst((double)m_numSrc); }
+
 
   // ------------------------------------------------------------
   // Metric::IDBExpr: exported formulas for Flat and Callers view
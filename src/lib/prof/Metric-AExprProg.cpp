@@ -0,0 +1,421 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+//  Prof::Metric::AExprProg
+//
+//***************************************************************************
+
+//************************ System Include Files ******************************
+
+#include <iostream>
+using std::endl;
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+//************************* User Include Files *******************************
+
+#include <include/uint.h>
+
+#include "Metric-AExprProg.hpp"
+#include "Metric-AExpr.hpp"
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/NaN.h>
+
+//************************ Forward Declarations ******************************
+
+//****************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+void
+AExprProg::emit(OpTy op, uint arg, uint arg2, double c)
+{
+  Instr x;
+  x.op = op;
+  x.arg = arg;
+  x.arg2 = arg2;
+  x.c = c;
+  m_code.push_back(x);
+
+  // track the stack depth
+  switch (op) {
+    case OpConst:
+      m_depth++;
+      break;
+    case OpVar:
+      m_depth++;
+      m_dataSz = std::max(m_dataSz, arg + 1);
+      break;
+    case OpNeg:
+      DIAG_Assert(m_depth >= 1, "");
+      break;
+    case OpPower:
+    case OpDivide:
+    case OpMinus:
+      DIAG_Assert(m_depth >= 2, "");
+      m_depth--;
+      break;
+    case OpMax:
+      DIAG_Assert(arg >= 1, "AExprProg: max() requires an operand");
+      // fall through
+    case OpSum:
+    case OpTimes:
+    case OpMin:
+    case OpMean:
+    case OpStdDev:
+    case OpCoefVar:
+    case OpRStdDev:
+      DIAG_Assert(m_depth >= arg, "");
+      m_depth = m_depth - arg + 1;
+      break;
+    case OpSumSq:
+      DIAG_Assert(m_depth >= arg, "");
+      m_depth = m_depth - arg + 2;
+      break;
+    case OpStore:
+      DIAG_Assert(m_depth >= 1, "");
+      m_depth--;
+      m_dataSz = std::max(m_dataSz, std::max(arg + 1, arg2));
+      break;
+    default:
+      DIAG_Die(DIAG_UnexpectedInput);
+  }
+  m_maxDepth = std::max(m_maxDepth, m_depth);
+}
+
+
+static inline bool
+isok(double x)
+{
+  return !(c_isnan_d(x) || c_isinf_d(x));
+}
+
+
+// Computes the running mean and variance of the 'k' columns in 'xs'
+// into 'mean' and 'var' (cf. AExpr::evalVariance()).
+static void
+evalVariance(const double* xs, uint k, uint n, double* mean, double* var)
+{
+  const uint bsz = AExprProg::BatchSz;
+
+  for (uint j = 0; j < n; ++j) {
+    mean[j] = 0.0;
+    var[j] = 0.0;
+  }
+  for (uint i = 0; i < k; ++i) {
+    const double* x = xs + (i * bsz);
+    for (uint j = 0; j < n; ++j) {
+      double t = x[j];
+      double delta = t - mean[j];
+      mean[j] += delta / (i + 1);
+      var[j] += delta * (t - mean[j]);
+    }
+  }
+  for (uint j = 0; j < n; ++j) {
+    var[j] = var[j] / k;
+  }
+}
+
+
+void
+AExprProg::eval(IData* const* data, uint n, std::vector<double>& stack) const
+{
+  const uint bsz = BatchSz;
+
+  DIAG_Assert(n <= bsz, "AExprProg::eval: batch too large");
+
+  // stack of columns, plus two scratch columns
+  if (stack.size() < (m_maxDepth + 2) * bsz) {
+    stack.resize((m_maxDepth + 2) * bsz);
+  }
+  double* stk = &stack[0];
+  double* r0 = stk + (m_maxDepth * bsz);
+  double* r1 = r0 + bsz;
+  uint sp = 0;
+
+  // Size each datum once, to the size that the program's demandMetric()
+  // calls would leave it, so that the loops below index its values.
+  double* row[BatchSz];
+  for (uint j = 0; j < n; ++j) {
+    row[j] = (m_dataSz > 0) ? &data[j]->demandMetric(0, m_dataSz) : NULL;
+  }
+
+#define COL(i) (stk + ((i) * bsz))
+
+  for (uint pc = 0; pc < m_code.size(); ++pc) {
+    const Instr& ins = m_code[pc];
+    uint k = ins.arg;
+
+    switch (ins.op) {
+      case OpConst: {
+	double* z = COL(sp++);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = ins.c;
+	}
+	break;
+      }
+      case OpVar: {
+	double* z = COL(sp++);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = row[j][ins.arg];
+	}
+	break;
+      }
+      case OpNeg: {
+	double* z = COL(sp - 1);
+	for (uint j = 0; j < n; ++j) {
+	  z[j] = -z[j];
+	}
+	break;
+      }
+      case OpPower: {
+	double* b = COL(sp - 2);
+	const double* e = COL(sp - 1);
+	for (uint j = 0; j < n; ++j) {
+	  b[j] = pow(b[j], e[j]);
+	}
+	sp--;
+	break;
+      }
+      case OpDivide: {
+	double* x = COL(sp - 2);
+	const double* d = COL(sp - 1);
+	for (uint j = 0; j < n; ++j) {
+	  double z = c_FP_NAN_d;
+	  if (isok(d[j]) && d[j] != 0.0) {
+	    z = x[j] / d[j];
+	  }
+	  x[j] = z;
+	}
+	sp--;
+	break;
+      }
+      case OpMinus: {
+	double* m = COL(sp - 2);
+	const double* s = COL(sp - 1);
+	for (uint j = 0; j < n; ++j) {
+	  m[j] = (m[j] - s[j]);
+	}
+	sp--;
+	break;
+      }
+
+      // n-ary operators: operands are COL(sp - k) ... COL(sp - 1); the
+      // result is formed in a scratch column since 'k' may be 0.
+      case OpSum:
+      case OpMean: {
+	const double* xs = COL(sp - k);
+	for (uint j = 0; j < n; ++j) {
+	  r0[j] = 0.0;
+	}
+	for (uint i = 0; i < k; ++i) {
+	  const double* x = xs + (i * bsz);
+	  for (uint j = 0; j < n; ++j) {
+	    r0[j] += x[j];
+	  }
+	}
+	if (ins.op == OpMean) {
+	  for (uint j = 0; j < n; ++j) {
+	    r0[j] = r0[j] / (double) k;
+	  }
+	}
+	sp = sp - k;
+	std::copy(r0, r0 + n, COL(sp++));
+	break;
+      }
+      case OpTimes: {
+	const double* xs = COL(sp - k);
+	for (uint j = 0; j < n; ++j) {
+	  r0[j] = 1.0;
+	}
+	for (uint i = 0; i < k; ++i) {
+	  const double* x = xs + (i * bsz);
+	  for (uint j = 0; j < n; ++j) {
+	    r0[j] *= x[j];
+	  }
+	}
+	sp = sp - k;
+	std::copy(r0, r0 + n, COL(sp++));
+	break;
+      }
+      case OpMin: {
+	// observational min (cf. Min::eval())
+	const double* xs = COL(sp - k);
+	for (uint j = 0; j < n; ++j) {
+	  r0[j] = DBL_MAX;
+	}
+	for (uint i = 0; i < k; ++i) {
+	  const double* x = xs + (i * bsz);
+	  for (uint j = 0; j < n; ++j) {
+	    if (x[j] != 0.0) {
+	      r0[j] = std::min(r0[j], x[j]);
+	    }
+	  }
+	}
+	for (uint j = 0; j < n; ++j) {
+	  if (r0[j] == DBL_MAX) { r0[j] = DBL_MIN; }
+	}
+	sp = sp - k;
+	std::copy(r0, r0 + n, COL(sp++));
+	break;
+      }
+      case OpMax: {
+	double* z = COL(sp - k);
+	for (uint i = 1; i < k; ++i) {
+	  const double* x = z + (i * bsz);
+	  for (uint j = 0; j < n; ++j) {
+	    z[j] = std::max(z[j], x[j]);
+	  }
+	}
+	sp = sp - k + 1;
+	break;
+      }
+      case OpStdDev:
+      case OpCoefVar:
+      case OpRStdDev: {
+	evalVariance(COL(sp - k), k, n, r0, r1);
+	for (uint j = 0; j < n; ++j) {
+	  double sdev = sqrt(r1[j]); // always non-negative
+	  double mean = r0[j];
+	  double z = 0.0;
+	  if (ins.op == OpStdDev) {
+	    z = sdev;
+	  }
+	  else if (mean > EPSILON) {
+	    z = (ins.op == OpCoefVar) ? (sdev / mean) : ((sdev / mean) * 100);
+	  }
+	  r0[j] = z;
+	}
+	sp = sp - k;
+	std::copy(r0, r0 + n, COL(sp++));
+	break;
+      }
+      case OpSumSq: {
+	// pushes the sum of squares and then the sum (on top)
+	const double* xs = COL(sp - k);
+	for (uint j = 0; j < n; ++j) {
+	  r0[j] = 0.0; // sum
+	  r1[j] = 0.0; // sum of squares
+	}
+	for (uint i = 0; i < k; ++i) {
+	  const double* x = xs + (i * bsz);
+	  for (uint j = 0; j < n; ++j) {
+	    r0[j] += x[j];
+	    r1[j] += (x[j] * x[j]);
+	  }
+	}
+	sp = sp - k;
+	std::copy(r1, r1 + n, COL(sp++));
+	std::copy(r0, r0 + n, COL(sp++));
+	break;
+      }
+      case OpStore: {
+	const double* z = COL(--sp);
+	for (uint j = 0; j < n; ++j) {
+	  row[j][ins.arg] = z[j];
+	}
+	break;
+      }
+      default:
+	DIAG_Die(DIAG_UnexpectedInput);
+    }
+  }
+
+#undef COL
+
+  DIAG_Assert(sp == 0, "AExprProg::eval: unbalanced program");
+}
+
+
+std::ostream&
+AExprProg::dump(std::ostream& os) const
+{
+  static const char* opNm[] = {
+    "const", "var", "neg", "pow", "div", "minus", "sum", "times", "min",
+    "max", "mean", "stddev", "coefvar", "r-stddev", "sumsq", "store"
+  };
+
+  for (uint pc = 0; pc < m_code.size(); ++pc) {
+    const Instr& ins = m_code[pc];
+    os << pc << ": " << opNm[ins.op];
+    if (ins.op == OpConst) {
+      os << " " << ins.c;
+    }
+    else if (ins.op == OpStore) {
+      os << " $" << ins.arg;
+    }
+    else if (ins.op == OpVar) {
+      os << " $" << ins.arg;
+    }
+    else if (ins.op >= OpSum) {
+      os << " " << ins.arg;
+    }
+    os << endl;
+  }
+  return os;
+}
+
+
+void
+AExprProg::ddump() const
+{
+  dump(std::cerr);
+}
+
+
+//****************************************************************************
+
+} // namespace Metric
+
+} // namespace Prof
@@ -0,0 +1,179 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// class Prof::Metric::AExprProg
+//
+// An AExpr tree compiled into a flat stack program.  Instead of one
+// virtual eval() per expression node per CCT node, the program is run
+// over a batch of metric data at a time: each stack slot is a column
+// of BatchSz values and each instruction is a simple loop over a
+// column.
+//
+// The program evaluates operations in exactly the same order as the
+// corresponding AExpr::eval() and AExpr::evalNF() routines so that the
+// results are identical.
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Metric_AExprProg_hpp
+#define prof_Prof_Metric_AExprProg_hpp
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <vector>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Metric-IData.hpp"
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+
+namespace Prof {
+
+namespace Metric {
+
+class AExprProg
+{
+public:
+  // maximum number of metric data evaluated at a time
+  static const uint BatchSz = 128;
+
+  enum OpTy {
+    OpConst,    // push c
+    OpVar,      // push metric 'arg'
+    OpNeg,      // unary
+    OpPower,    // binary
+    OpDivide,
+    OpMinus,
+    OpSum,      // 'arg' operands
+    OpTimes,
+    OpMin,
+    OpMax,
+    OpMean,
+    OpStdDev,
+    OpCoefVar,
+    OpRStdDev,
+    OpSumSq,    // 'arg' operands; push sum and sum of squares
+    OpStore     // pop into metric 'arg' (demanding 'arg2' metrics)
+  };
+
+  struct Instr {
+    OpTy   op;
+    uint   arg;
+    uint   arg2;
+    double c;
+  };
+
+public:
+  AExprProg()
+    : m_depth(0), m_maxDepth(0), m_dataSz(0)
+  { }
+
+  ~AExprProg()
+  { }
+
+  // ------------------------------------------------------------
+  // compilation (cf. AExpr::compile())
+  // ------------------------------------------------------------
+
+  void
+  emit(OpTy op, uint arg = 0, uint arg2 = 0, double c = 0.0);
+
+  void
+  emitConst(double c)
+  { emit(OpConst, 0, 0, c); }
+
+  bool
+  empty() const
+  { return m_code.empty(); }
+
+  uint
+  size() const
+  { return m_code.size(); }
+
+  // ------------------------------------------------------------
+  // evaluation
+  // ------------------------------------------------------------
+
+  // eval: run the program over data[0, n), where n <= BatchSz.  The
+  // program must be balanced (results are stored with OpStore).
+  // 'stack' is scratch space; reuse it across calls (one per thread).
+  void
+  eval(IData* const* data, uint n, std::vector<double>& stack) const;
+
+  // ------------------------------------------------------------
+  //
+  // ------------------------------------------------------------
+
+  std::ostream&
+  dump(std::ostream& os = std::cerr) const;
+
+  void
+  ddump() const;
+
+private:
+  std::vector<Instr> m_code;
+  uint m_depth;    // stack depth after the last instruction
+  uint m_maxDepth; // maximum stack depth
+  uint m_dataSz;   // number of metric values that the program demands
+};
+
+//***************************************************************************
+
+} // namespace Metric
+
+} // namespace Prof
+
+//***************************************************************************
+
+#endif /* prof_Prof_Metric_AExprProg_hpp */
@@ -0,0 +1,874 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include <string>
+using std::string;
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Struct-BinFmt.hpp"
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/FileUtil.hpp>
+
+//*************************** Forward Declarations **************************
+
+#define DBG 0
+
+static char
+hostEndian()
+{
+  const uint16_t x = 1;
+  return (*(const char*)&x) ? 'l' : 'b';
+}
+
+
+// isRange: true if [beg, beg + cnt) lies within [0, size)
+static bool
+isRange(uint64_t beg, uint64_t cnt, uint64_t size)
+{
+  return (beg <= size && cnt <= size - beg);
+}
+
+
+// isSection: true if 'cnt' records of 'recSz' bytes at file offset
+// 'off' lie within a file of 'len' bytes and are aligned
+static bool
+isSection(uint64_t off, uint64_t cnt, size_t recSz, size_t len)
+{
+  return (off <= len && cnt <= (len - off) / recSz && off % sizeof(uint64_t) == 0);
+}
+
+//***************************************************************************
+
+namespace Prof {
+namespace Struct {
+namespace BinFmt {
+
+bool
+isBinary(const char* filenm)
+{
+  char buf[MagicLen];
+
+  int fd = ::open(filenm, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t ret = ::read(fd, buf, MagicLen);
+  ::close(fd);
+
+  return (ret == MagicLen && memcmp(buf, Magic, MagicLen) == 0);
+}
+
+
+//***************************************************************************
+// Writer
+//***************************************************************************
+
+Writer::Writer()
+{
+  str2id(""); // string id 0
+}
+
+
+Writer::~Writer()
+{
+}
+
+
+uint32_t
+Writer::str2id(const string& str)
+{
+  std::pair<StrToIdMap::iterator, bool> ret =
+    m_strToId.insert(std::make_pair(str, (uint32_t)m_strs.size()));
+  if (ret.second) {
+    m_strs.push_back(&(ret.first->first));
+  }
+  return ret.first->second;
+}
+
+
+uint32_t
+Writer::pushNode(uint8_t type, uint id, uint32_t name, uint32_t aux,
+		 SrcFile::ln begLn, SrcFile::ln endLn)
+{
+  NodeRec rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.type   = type;
+  rec.parent = (m_stack.empty()) ? Id_NULL : m_stack.back();
+  rec.origId = id;
+  rec.name   = name;
+  rec.aux    = aux;
+  rec.begLn  = begLn;
+  rec.endLn  = endLn;
+  rec.vmaBeg = m_vmas.size();
+  rec.vmaCnt = 0;
+
+  m_nodes.push_back(rec);
+  return m_nodes.size() - 1;
+}
+
+
+void
+Writer::pushVMAs(uint32_t nodeIdx, const VMAIntervalSet& vmaset)
+{
+  NodeRec& rec = m_nodes[nodeIdx];
+  rec.vmaBeg = m_vmas.size();
+  rec.vmaCnt = vmaset.size();
+  for (VMAIntervalSet::const_iterator it = vmaset.begin();
+       it != vmaset.end(); ++it) {
+    VMARec vrec = { it->beg(), it->end() };
+    m_vmas.push_back(vrec);
+  }
+}
+
+
+void
+Writer::beginLM(uint id, const string& nm)
+{
+  DIAG_Assert(m_stack.empty(), "Struct::BinFmt::Writer: nested LM");
+
+  LMRec lrec;
+  memset(&lrec, 0, sizeof(lrec));
+  lrec.name = str2id(nm);
+  lrec.nodeBeg = m_nodes.size();
+  m_lms.push_back(lrec);
+
+  uint32_t idx = pushNode(ANode::TyLM, id, lrec.name, 0, ln_NULL, ln_NULL);
+  m_stack.push_back(idx);
+}
+
+
+void
+Writer::beginFile(uint id, const string& nm)
+{
+  uint32_t idx = pushNode(ANode::TyFile, id, str2id(nm), 0,
+			  ln_NULL, ln_NULL);
+  m_stack.push_back(idx);
+}
+
+
+void
+Writer::beginProc(uint id, const string& nm, const string& lnm,
+		  SrcFile::ln begLn, SrcFile::ln endLn,
+		  const VMAIntervalSet& vmaset)
+{
+  uint32_t idx = pushNode(ANode::TyProc, id, str2id(nm), str2id(lnm),
+			  begLn, endLn);
+  pushVMAs(idx, vmaset);
+  for (VMAIntervalSet::const_iterator it = vmaset.begin();
+       it != vmaset.end(); ++it) {
+    m_lmProcMap.insert(std::make_pair(*it, idx));
+  }
+  m_stack.push_back(idx);
+}
+
+
+void
+Writer::beginAlien(uint id, const string& filenm, const string& nm,
+		   SrcFile::ln begLn, SrcFile::ln endLn)
+{
+  uint32_t idx = pushNode(ANode::TyAlien, id, str2id(nm), str2id(filenm),
+			  begLn, endLn);
+  m_stack.push_back(idx);
+}
+
+
+void
+Writer::beginLoop(uint id, const string& filenm,
+		  SrcFile::ln begLn, SrcFile::ln endLn,
+		  const VMAIntervalSet& vmaset)
+{
+  uint32_t idx = pushNode(ANode::TyLoop, id, 0, str2id(filenm),
+			  begLn, endLn);
+  pushVMAs(idx, vmaset);
+  m_stack.push_back(idx);
+}
+
+
+void
+Writer::stmt(uint id, SrcFile::ln begLn, SrcFile::ln endLn,
+	     const VMAIntervalSet& vmaset)
+{
+  uint32_t idx = pushNode(ANode::TyStmt, id, 0, 0, begLn, endLn);
+  pushVMAs(idx, vmaset);
+  for (VMAIntervalSet::const_iterator it = vmaset.begin();
+       it != vmaset.end(); ++it) {
+    m_lmStmtMap.insert(std::make_pair(*it, idx));
+  }
+}
+
+
+void
+Writer::call(uint id, SrcFile::ln line, const VMAIntervalSet& vmaset,
+	     bool hasTarget, VMA target, const string& device)
+{
+  uint32_t idx = pushNode(ANode::TyStmt, id, 0, 0, line, line);
+  pushVMAs(idx, vmaset);
+
+  NodeRec& rec = m_nodes[idx];
+  rec.flags |= NFlg_Call;
+  if (hasTarget) {
+    rec.flags |= NFlg_HasTarget;
+    rec.target = target;
+  }
+  if (!device.empty()) {
+    rec.flags |= NFlg_HasDevice;
+    rec.aux = str2id(device);
+  }
+
+  for (VMAIntervalSet::const_iterator it = vmaset.begin();
+       it != vmaset.end(); ++it) {
+    m_lmStmtMap.insert(std::make_pair(*it, idx));
+  }
+}
+
+
+void
+Writer::end()
+{
+  DIAG_Assert(!m_stack.empty(), "Struct::BinFmt::Writer: unbalanced end()");
+  uint32_t idx = m_stack.back();
+  m_stack.pop_back();
+
+  if (m_nodes[idx].type == ANode::TyLM) {
+    finishLM();
+  }
+}
+
+
+void
+Writer::finishLM()
+{
+  LMRec& lrec = m_lms.back();
+  lrec.nodeEnd = m_nodes.size();
+
+  lrec.procMapBeg = m_maps.size();
+  lrec.procMapCnt = m_lmProcMap.size();
+  for (std::map<VMAInterval, uint32_t>::const_iterator it = m_lmProcMap.begin();
+       it != m_lmProcMap.end(); ++it) {
+    MapRec mrec = { it->first.beg(), it->first.end(), it->second, 0 };
+    m_maps.push_back(mrec);
+  }
+
+  lrec.stmtMapBeg = m_maps.size();
+  lrec.stmtMapCnt = m_lmStmtMap.size();
+  for (std::map<VMAInterval, uint32_t>::const_iterator it = m_lmStmtMap.begin();
+       it != m_lmStmtMap.end(); ++it) {
+    MapRec mrec = { it->first.beg(), it->first.end(), it->second, 0 };
+    m_maps.push_back(mrec);
+  }
+
+  m_lmProcMap.clear();
+  m_lmStmtMap.clear();
+}
+
+
+static void
+writeBytes(std::ostream& os, const void* buf, size_t sz)
+{
+  os.write((const char*)buf, sz);
+  if (!os.good()) {
+    DIAG_Throw("error writing binary structure file");
+  }
+}
+
+
+// sections are 8-byte aligned so that they may be used in place when
+// the file is mmapped
+static uint64_t
+align8(uint64_t x)
+{
+  return (x + 7) & ~((uint64_t)7);
+}
+
+
+static void
+writePad(std::ostream& os, uint64_t& off)
+{
+  static const char zeros[8] = { 0 };
+  uint64_t off_new = align8(off);
+  writeBytes(os, zeros, off_new - off);
+  off = off_new;
+}
+
+
+void
+Writer::write(std::ostream& os)
+{
+  DIAG_Assert(m_stack.empty(), "Struct::BinFmt::Writer: unbalanced begin()");
+
+  // -------------------------------------------------------
+  // compute layout
+  // -------------------------------------------------------
+  std::vector<uint64_t> strOffsets(m_strs.size() + 1);
+  uint64_t strDataSz = 0;
+  for (uint i = 0; i < m_strs.size(); ++i) {
+    strOffsets[i] = strDataSz;
+    strDataSz += m_strs[i]->size() + 1;
+  }
+  strOffsets[m_strs.size()] = strDataSz;
+
+  FileHdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, Magic, MagicLen);
+  memcpy(hdr.version, Version, VersionLen);
+  hdr.endian = hostEndian();
+
+  hdr.numStrings = m_strs.size();
+  hdr.numNodes   = m_nodes.size();
+  hdr.numVMAs    = m_vmas.size();
+  hdr.numLMs     = m_lms.size();
+  hdr.numMapRecs = m_maps.size();
+
+  uint64_t off = sizeof(hdr);
+  hdr.strOffsetsOff = off = align8(off);
+  off += strOffsets.size() * sizeof(uint64_t);
+  hdr.strDataOff = off;
+  off += strDataSz;
+  hdr.nodeOff = off = align8(off);
+  off += m_nodes.size() * sizeof(NodeRec);
+  hdr.vmaOff = off = align8(off);
+  off += m_vmas.size() * sizeof(VMARec);
+  hdr.lmOff = off = align8(off);
+  off += m_lms.size() * sizeof(LMRec);
+  hdr.mapOff = off = align8(off);
+
+  // -------------------------------------------------------
+  // write
+  // -------------------------------------------------------
+  off = 0;
+  writeBytes(os, &hdr, sizeof(hdr));
+  off += sizeof(hdr);
+
+  writePad(os, off);
+  writeBytes(os, strOffsets.data(), strOffsets.size() * sizeof(uint64_t));
+  off += strOffsets.size() * sizeof(uint64_t);
+  for (uint i = 0; i < m_strs.size(); ++i) {
+    writeBytes(os, m_strs[i]->c_str(), m_strs[i]->size() + 1);
+  }
+  off += strDataSz;
+
+  writePad(os, off);
+  writeBytes(os, m_nodes.data(), m_nodes.size() * sizeof(NodeRec));
+  off += m_nodes.size() * sizeof(NodeRec);
+
+  writePad(os, off);
+  writeBytes(os, m_vmas.data(), m_vmas.size() * sizeof(VMARec));
+  off += m_vmas.size() * sizeof(VMARec);
+
+  writePad(os, off);
+  writeBytes(os, m_lms.data(), m_lms.size() * sizeof(LMRec));
+  off += m_lms.size() * sizeof(LMRec);
+
+  writePad(os, off);
+  writeBytes(os, m_maps.data(), m_maps.size() * sizeof(MapRec));
+
+  os.flush();
+}
+
+
+//***************************************************************************
+
+static void
+writeNode(Writer& writer, const ANode* node)
+{
+  bool isLeaf = false;
+
+  switch (node->type()) {
+    case ANode::TyLM: {
+      const LM* lm = static_cast<const LM*>(node);
+      writer.beginLM(lm->m_origId, lm->name());
+      break;
+    }
+    case ANode::TyFile: {
+      const File* file = static_cast<const File*>(node);
+      writer.beginFile(file->m_origId, file->name());
+      break;
+    }
+    case ANode::TyProc: {
+      const Proc* proc = static_cast<const Proc*>(node);
+      writer.beginProc(proc->m_origId, proc->name(), proc->linkName(),
+		       proc->begLine(), proc->endLine(), proc->vmaSet());
+      break;
+    }
+    case ANode::TyAlien: {
+      const Alien* alien = static_cast<const Alien*>(node);
+      writer.beginAlien(alien->m_origId, alien->fileName(),
+			alien->displayName(),
+			alien->begLine(), alien->endLine());
+      break;
+    }
+    case ANode::TyLoop: {
+      const Loop* loop = static_cast<const Loop*>(node);
+      writer.beginLoop(loop->m_origId, loop->fileName(),
+		       loop->begLine(), loop->endLine(), loop->vmaSet());
+      break;
+    }
+    case ANode::TyStmt: {
+      Stmt* stmt = const_cast<Stmt*>(static_cast<const Stmt*>(node));
+      if (stmt->stmtType() == Stmt::STMT_CALL) {
+	writer.call(stmt->m_origId, stmt->begLine(), stmt->vmaSet(),
+		    (stmt->target() != 0), stmt->target(), stmt->device());
+      }
+      else {
+	writer.stmt(stmt->m_origId, stmt->begLine(), stmt->endLine(),
+		    stmt->vmaSet());
+      }
+      isLeaf = true;
+      break;
+    }
+    default:
+      DIAG_Throw("binary structure files do not support "
+		 << ANode::ANodeTyToName(node->type()) << " scopes");
+  }
+
+  for (const ANode* x = node->firstChild(); x; x = x->nextSibling()) {
+    DIAG_Assert(!isLeaf, "Struct::BinFmt: Stmt with children");
+    writeNode(writer, x);
+  }
+
+  if (!isLeaf) {
+    writer.end();
+  }
+}
+
+
+void
+write(std::ostream& os, const Tree& tree)
+{
+  Writer writer;
+
+  Root* root = tree.root();
+  if (root) {
+    for (const ANode* x = root->firstChild(); x; x = x->nextSibling()) {
+      writeNode(writer, x);
+    }
+  }
+
+  writer.write(os);
+}
+
+
+//***************************************************************************
+// Reader
+//***************************************************************************
+
+Reader::Reader()
+  : m_addr(NULL), m_len(0), m_hdr(NULL),
+    m_strOffsets(NULL), m_strData(NULL), m_nodes(NULL), m_vmas(NULL),
+    m_lms(NULL), m_maps(NULL)
+{
+}
+
+
+Reader::~Reader()
+{
+  close();
+}
+
+
+void
+Reader::open(const char* filenm)
+{
+  close();
+  m_filenm = filenm;
+
+  int fd = ::open(filenm, O_RDONLY);
+  if (fd < 0) {
+    DIAG_Throw("Unable to open binary structure file '" << filenm << "': "
+	       << strerror(errno));
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(FileHdr)) {
+    ::close(fd);
+    DIAG_Throw("Invalid binary structure file '" << filenm << "'");
+  }
+
+  m_len = sb.st_size;
+  m_addr = mmap(NULL, m_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (m_addr == MAP_FAILED) {
+    m_addr = NULL;
+    DIAG_Throw("Unable to mmap binary structure file '" << filenm << "': "
+	       << strerror(errno));
+  }
+
+  const char* base = (const char*)m_addr;
+  const FileHdr* hdr = (const FileHdr*)base;
+
+  if (memcmp(hdr->magic, Magic, MagicLen) != 0) {
+    close();
+    DIAG_Throw("'" << filenm << "' is not a binary structure file");
+  }
+  if (memcmp(hdr->version, Version, VersionLen) != 0) {
+    string ver(hdr->version, VersionLen);
+    close();
+    DIAG_Throw("'" << filenm << "': unsupported binary structure version "
+	       << ver << "; please regenerate the file");
+  }
+  if (hdr->endian != hostEndian()) {
+    close();
+    DIAG_Throw("'" << filenm << "': binary structure file has foreign byte order");
+  }
+
+  // sanity check the sections.  (Node records are checked as load
+  // modules are materialized.)
+  if (!isSection(hdr->strOffsetsOff, (uint64_t)hdr->numStrings + 1,
+		 sizeof(uint64_t), m_len)
+      || !isSection(hdr->nodeOff, hdr->numNodes, sizeof(NodeRec), m_len)
+      || !isSection(hdr->vmaOff, hdr->numVMAs, sizeof(VMARec), m_len)
+      || !isSection(hdr->lmOff, hdr->numLMs, sizeof(LMRec), m_len)
+      || !isSection(hdr->mapOff, hdr->numMapRecs, sizeof(MapRec), m_len)
+      || !isRange(hdr->strDataOff, 0, m_len)) {
+    close();
+    DIAG_Throw("'" << filenm << "': truncated binary structure file");
+  }
+
+  // each string must be NUL-terminated within the string data
+  const uint64_t* strOffsets = (const uint64_t*)(base + hdr->strOffsetsOff);
+  const char* strData = base + hdr->strDataOff;
+  bool isValid = (strOffsets[0] == 0
+		  && isRange(hdr->strDataOff, strOffsets[hdr->numStrings], m_len));
+  for (uint32_t i = 0; isValid && i < hdr->numStrings; ++i) {
+    isValid = (strOffsets[i] < strOffsets[i + 1]
+	       && strOffsets[i + 1] <= strOffsets[hdr->numStrings]
+	       && strData[strOffsets[i + 1] - 1] == '\0');
+  }
+
+  // each load module must be a range of nodes, rooted at an LM, with
+  // ranges of map records
+  const NodeRec* nodes = (const NodeRec*)(base + hdr->nodeOff);
+  const LMRec* lms = (const LMRec*)(base + hdr->lmOff);
+  for (uint32_t i = 0; isValid && i < hdr->numLMs; ++i) {
+    const LMRec& lrec = lms[i];
+    isValid = (lrec.name < hdr->numStrings
+	       && lrec.nodeBeg < lrec.nodeEnd && lrec.nodeEnd <= hdr->numNodes
+	       && nodes[lrec.nodeBeg].type == ANode::TyLM
+	       && isRange(lrec.procMapBeg, lrec.procMapCnt, hdr->numMapRecs)
+	       && isRange(lrec.stmtMapBeg, lrec.stmtMapCnt, hdr->numMapRecs));
+  }
+
+  if (!isValid) {
+    close();
+    DIAG_Throw("'" << filenm << "': corrupt binary structure file");
+  }
+
+  m_hdr        = hdr;
+  m_strOffsets = (const uint64_t*)(base + hdr->strOffsetsOff);
+  m_strData    = base + hdr->strDataOff;
+  m_nodes      = (const NodeRec*)(base + hdr->nodeOff);
+  m_vmas       = (const VMARec*)(base + hdr->vmaOff);
+  m_lms        = (const LMRec*)(base + hdr->lmOff);
+  m_maps       = (const MapRec*)(base + hdr->mapOff);
+
+  m_paths.assign(hdr->numStrings, NULL);
+}
+
+
+void
+Reader::close()
+{
+  for (uint i = 0; i < m_paths.size(); ++i) {
+    delete m_paths[i];
+  }
+  m_paths.clear();
+
+  if (m_addr) {
+    munmap(m_addr, m_len);
+  }
+  m_addr = NULL;
+  m_len = 0;
+  m_hdr = NULL;
+}
+
+
+const string&
+Reader::path(uint32_t id, RealPathFn realpathFn, void* realpathArg)
+{
+  // normalize each distinct path once
+  if (!m_paths[id]) {
+    string x = str(id);
+    if (realpathFn) {
+      x = realpathFn(x, realpathArg);
+    }
+    m_paths[id] = new string(x);
+  }
+  return *m_paths[id];
+}
+
+
+void
+Reader::setVMAs(ACodeNode* node, const NodeRec& rec) const
+{
+  if (!isRange(rec.vmaBeg, rec.vmaCnt, m_hdr->numVMAs)) {
+    DIAG_Throw("Struct::BinFmt::Reader: invalid vma range in " << m_filenm);
+  }
+  for (uint32_t i = rec.vmaBeg; i < rec.vmaBeg + rec.vmaCnt; ++i) {
+    node->vmaSet().insert(m_vmas[i].beg, m_vmas[i].end);
+  }
+}
+
+
+// isValidParent: true if a node of type 'ty' may be a child of one of
+// type 'parentTy' (cf. Writer)
+bool
+Reader::isValidParent(uint8_t ty, uint8_t parentTy)
+{
+  switch (ty) {
+    case ANode::TyFile:
+      return (parentTy == ANode::TyLM);
+    case ANode::TyProc:
+      return (parentTy == ANode::TyFile);
+    case ANode::TyAlien:
+    case ANode::TyLoop:
+    case ANode::TyStmt:
+      return (parentTy == ANode::TyProc || parentTy == ANode::TyAlien
+	      || parentTy == ANode::TyLoop);
+    default:
+      return false;
+  }
+}
+
+
+void
+Reader::checkMapRec(const LMRec& lrec, const MapRec& mrec, uint8_t ty) const
+{
+  if (!(lrec.nodeBeg < mrec.node && mrec.node < lrec.nodeEnd)
+      || m_nodes[mrec.node].type != ty) {
+    DIAG_Throw("Struct::BinFmt::Reader: invalid vma map in " << m_filenm);
+  }
+}
+
+
+LM*
+Reader::materializeLM(Root* root, uint lmIdx,
+		      RealPathFn realpathFn, void* realpathArg)
+{
+  const LMRec& lrec = m_lms[lmIdx];
+
+  const string& lmNm = path(lrec.name, realpathFn, realpathArg);
+  LM* lm = root->findLM(lmNm);
+  bool isNewLM = (lm == NULL);
+  if (isNewLM) {
+    lm = new LM(lmNm, root);
+  }
+  lm->m_origId = m_nodes[lrec.nodeBeg].origId;
+
+  // the precomputed vma maps are only valid if the subtree is created
+  // exactly as recorded
+  bool isExact = isNewLM;
+
+  std::vector<ANode*> nodes(lrec.nodeEnd - lrec.nodeBeg, NULL);
+  nodes[0] = lm;
+
+  for (uint32_t i = lrec.nodeBeg + 1; i < lrec.nodeEnd; ++i) {
+    const NodeRec& rec = m_nodes[i];
+    if (!(lrec.nodeBeg <= rec.parent && rec.parent < i)
+	|| !isValidParent(rec.type, m_nodes[rec.parent].type)) {
+      DIAG_Throw("Struct::BinFmt::Reader: invalid parent in " << m_filenm);
+    }
+    if (rec.name >= m_hdr->numStrings || rec.aux >= m_hdr->numStrings) {
+      DIAG_Throw("Struct::BinFmt::Reader: invalid string in " << m_filenm);
+    }
+
+    ANode* parent = nodes[rec.parent - lrec.nodeBeg];
+    ANode* node = NULL;
+
+    switch (rec.type) {
+      case ANode::TyFile: {
+	node = File::demand(lm, path(rec.name, realpathFn, realpathArg));
+	break;
+      }
+      case ANode::TyProc: {
+	// cf. PGMDocHandler::startElement()
+	File* file = static_cast<File*>(parent);
+
+	string nm  = str(rec.name);
+	string lnm = str(rec.aux);
+
+	Proc* proc = file->findProc(nm);
+	if (proc && !proc->vmaSet().empty() && rec.vmaCnt > 0) {
+	  proc = NULL; // VMA information fully qualifies procedures
+	}
+
+	if (!proc) {
+	  proc = new Proc(nm, file, lnm, false, rec.begLn, rec.endLn);
+	  setVMAs(proc, rec);
+	}
+	else {
+	  DIAG_Msg(0, "Warning: Found procedure '" << nm << "' multiple times within file '" << file->name() << "'; information for this procedure will be aggregated.");
+	  isExact = false;
+	}
+	node = proc;
+	break;
+      }
+      case ANode::TyAlien: {
+	ACodeNode* p = static_cast<ACodeNode*>(parent);
+	string nm = str(rec.name);
+	node = new Alien(p, path(rec.aux, realpathFn, realpathArg), nm, nm,
+			 rec.begLn, rec.endLn);
+	break;
+      }
+      case ANode::TyLoop: {
+	ACodeNode* p = static_cast<ACodeNode*>(parent);
+	string fnm = path(rec.aux, realpathFn, realpathArg);
+	Loop* loop = new Loop(p, fnm, rec.begLn, rec.endLn);
+	setVMAs(loop, rec);
+	node = loop;
+	break;
+      }
+      case ANode::TyStmt: {
+	ACodeNode* p = static_cast<ACodeNode*>(parent);
+	Stmt::StmtType ty =
+	  (rec.flags & NFlg_Call) ? Stmt::STMT_CALL : Stmt::STMT_STMT;
+	Stmt* stmt = new Stmt(p, rec.begLn, rec.endLn, 0, 0, ty);
+	setVMAs(stmt, rec);
+	if (rec.flags & NFlg_HasTarget) {
+	  stmt->target(rec.target);
+	}
+	if (rec.flags & NFlg_HasDevice) {
+	  stmt->device(str(rec.aux));
+	}
+	node = stmt;
+	break;
+      }
+      default:
+	DIAG_Throw("Struct::BinFmt::Reader: invalid node type in " << m_filenm);
+    }
+
+    node->m_origId = rec.origId;
+    nodes[i - lrec.nodeBeg] = node;
+  }
+
+  if (isExact) {
+    LM::VMAToProcMap* procMap = new LM::VMAToProcMap;
+    for (uint64_t i = lrec.procMapBeg; i < lrec.procMapBeg + lrec.procMapCnt; ++i) {
+      const MapRec& mrec = m_maps[i];
+      checkMapRec(lrec, mrec, ANode::TyProc);
+      Proc* x = static_cast<Proc*>(nodes[mrec.node - lrec.nodeBeg]);
+      procMap->insert(procMap->end(),
+		      std::make_pair(VMAInterval(mrec.beg, mrec.end), x));
+    }
+
+    LM::VMAToStmtRangeMap* stmtMap = new LM::VMAToStmtRangeMap;
+    for (uint64_t i = lrec.stmtMapBeg; i < lrec.stmtMapBeg + lrec.stmtMapCnt; ++i) {
+      const MapRec& mrec = m_maps[i];
+      checkMapRec(lrec, mrec, ANode::TyStmt);
+      Stmt* x = static_cast<Stmt*>(nodes[mrec.node - lrec.nodeBeg]);
+      stmtMap->insert(stmtMap->end(),
+		      std::make_pair(VMAInterval(mrec.beg, mrec.end), x));
+    }
+
+    lm->vmaMaps(procMap, stmtMap);
+  }
+  else {
+    lm->vmaMaps(NULL, NULL); // rebuild on demand
+  }
+
+  DIAG_DevMsgIf(DBG, "Struct::BinFmt::Reader: " << lm->toStringMe());
+  return lm;
+}
+
+
+void
+Reader::materialize(Root* root, const std::set<string>* lmFilter,
+		    RealPathFn realpathFn, void* realpathArg)
+{
+  for (uint i = 0; i < numLMs(); ++i) {
+    if (lmFilter) {
+      string nm = lmName(i);
+      if (lmFilter->find(nm) == lmFilter->end()
+	  && lmFilter->find(FileUtil::basename(nm)) == lmFilter->end()) {
+	continue;
+      }
+    }
+    materializeLM(root, i, realpathFn, realpathArg);
+  }
+}
+
+
+void
+read(Tree& tree, const char* filenm, const std::set<string>* lmFilter,
+     Reader::RealPathFn realpathFn, void* realpathArg)
+{
+  Reader reader;
+  reader.open(filenm);
+  reader.materialize(tree.root(), lmFilter, realpathFn, realpathArg);
+}
+
+
+} // namespace BinFmt
+} // namespace Struct
+} // namespace Prof
@@ -0,0 +1,388 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A compact binary encoding of program structure (hpcstruct) files.
+//
+// Description:
+//   The XML structure file must be parsed (Xerces SAX) in its entirety
+//   before the first Struct::LM is usable.  The binary encoding is
+//   designed to be mmapped and consumed directly:
+//
+//     [header]
+//     [string table: offsets (uint64) + NUL-terminated string data]
+//     [node table: fixed-size NodeRec's in preorder]
+//     [vma table: [beg, end) pairs referenced by NodeRec's]
+//     [lm table: one LMRec per load module]
+//     [vma map table: sorted, non-overlapping MapRec's per LM]
+//
+//   The nodes of each load module form a contiguous range of the node
+//   table, so that load modules may be materialized independently
+//   (and lazily).  Each LM also carries its precomputed VMA -> Proc
+//   and VMA -> Stmt maps (cf. Struct::LM::findProc(), findStmt()), so
+//   that they need not be rebuilt by a tree traversal after reading.
+//
+//   All multi-byte values are written in host byte order; the endian
+//   tag in the header is checked on reading.
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Struct_BinFmt_hpp
+#define prof_Prof_Struct_BinFmt_hpp
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Struct-Tree.hpp"
+
+#include <lib/binutils/VMAInterval.hpp>
+
+#include <lib/support/SrcFile.hpp>
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+
+namespace Prof {
+namespace Struct {
+namespace BinFmt {
+
+//***************************************************************************
+// File format
+//***************************************************************************
+
+static const char Magic[]   = "HPCTOOLKIT-struct-bin"; // 21 bytes
+static const char Version[] = "01.00";                 // 5 bytes
+
+static const int MagicLen   = sizeof(Magic) - 1;
+static const int VersionLen = sizeof(Version) - 1;
+
+static const uint32_t Id_NULL = (uint32_t)-1;
+
+enum {
+  // NodeRec flags
+  NFlg_Call      = (1 << 0), // Stmt is a call site (<C>)
+  NFlg_HasTarget = (1 << 1), // call site has a target
+  NFlg_HasDevice = (1 << 2)  // call site has a device
+};
+
+
+struct FileHdr {
+  char     magic[MagicLen];
+  char     version[VersionLen];
+  char     endian;      // 'l' or 'b'
+  char     pad[5];
+
+  uint32_t numStrings;
+  uint32_t numNodes;
+  uint32_t numVMAs;
+  uint32_t numLMs;
+  uint64_t numMapRecs;
+
+  // file offsets of each section
+  uint64_t strOffsetsOff; // uint64_t[numStrings + 1]
+  uint64_t strDataOff;
+  uint64_t nodeOff;
+  uint64_t vmaOff;
+  uint64_t lmOff;
+  uint64_t mapOff;
+};
+
+
+// A structure node.  The meaning of 'name' and 'aux' depends on 'type':
+//   LM:    name = lm name
+//   File:  name = file name
+//   Proc:  name = proc name,  aux = link name
+//   Alien: name = proc name,  aux = file name
+//   Loop:                     aux = file name
+//   Stmt:                     aux = device (if NFlg_HasDevice)
+struct NodeRec {
+  uint8_t  type;     // ANode::ANodeTy
+  uint8_t  flags;    // NFlg_*
+  uint16_t pad;
+  uint32_t parent;   // index in node table (Id_NULL if parent is Root)
+  uint32_t origId;   // id in the original structure file
+  uint32_t name;     // string id
+  uint32_t aux;      // string id
+  uint32_t begLn;
+  uint32_t endLn;
+  uint32_t vmaBeg;   // [vmaBeg, vmaBeg + vmaCnt) in the vma table
+  uint32_t vmaCnt;
+  uint32_t pad2;
+  uint64_t target;
+};
+
+
+struct VMARec {
+  uint64_t beg;
+  uint64_t end;
+};
+
+
+struct LMRec {
+  uint32_t name;        // string id
+  uint32_t nodeBeg;     // [nodeBeg, nodeEnd) in the node table
+  uint32_t nodeEnd;
+  uint32_t pad;
+  uint64_t procMapBeg;  // [procMapBeg, procMapBeg + procMapCnt) in map table
+  uint64_t procMapCnt;
+  uint64_t stmtMapBeg;  // [stmtMapBeg, stmtMapBeg + stmtMapCnt) in map table
+  uint64_t stmtMapCnt;
+};
+
+
+// An entry of a VMA -> node map.  Entries are sorted by [beg, end).
+struct MapRec {
+  uint64_t beg;
+  uint64_t end;
+  uint32_t node;        // index in node table
+  uint32_t pad;
+};
+
+
+// isBinary: returns true if 'filenm' begins with the binary structure
+// magic string
+bool
+isBinary(const char* filenm);
+
+
+//***************************************************************************
+// Writer
+//***************************************************************************
+
+// Writer: Builds a binary structure file from a preorder stream of
+// scope events (mirroring the elements of the XML format), so that it
+// can be fed either by hpcstruct or by a Struct::Tree.  Every begin*()
+// must be matched by an end(); stmt() and call() are leaves.
+class Writer {
+public:
+  Writer();
+  ~Writer();
+
+  void
+  beginLM(uint id, const std::string& nm);
+
+  void
+  beginFile(uint id, const std::string& nm);
+
+  void
+  beginProc(uint id, const std::string& nm, const std::string& lnm,
+	    SrcFile::ln begLn, SrcFile::ln endLn, const VMAIntervalSet& vmaset);
+
+  void
+  beginAlien(uint id, const std::string& filenm, const std::string& nm,
+	     SrcFile::ln begLn, SrcFile::ln endLn);
+
+  void
+  beginLoop(uint id, const std::string& filenm,
+	    SrcFile::ln begLn, SrcFile::ln endLn, const VMAIntervalSet& vmaset);
+
+  void
+  stmt(uint id, SrcFile::ln begLn, SrcFile::ln endLn,
+       const VMAIntervalSet& vmaset);
+
+  void
+  call(uint id, SrcFile::ln line, const VMAIntervalSet& vmaset,
+       bool hasTarget, VMA target, const std::string& device);
+
+  void
+  end();
+
+  // write: Write the accumulated structure to 'os'.
+  void
+  write(std::ostream& os);
+
+  uint
+  numNodes() const
+  { return m_nodes.size(); }
+
+private:
+  uint32_t
+  str2id(const std::string& str);
+
+  uint32_t
+  pushNode(uint8_t type, uint id, uint32_t name, uint32_t aux,
+	   SrcFile::ln begLn, SrcFile::ln endLn);
+
+  void
+  pushVMAs(uint32_t nodeIdx, const VMAIntervalSet& vmaset);
+
+  void
+  finishLM();
+
+private:
+  typedef std::map<std::string, uint32_t> StrToIdMap;
+
+  StrToIdMap           m_strToId;
+  std::vector<const std::string*> m_strs;
+
+  std::vector<NodeRec> m_nodes;
+  std::vector<VMARec>  m_vmas;
+  std::vector<LMRec>   m_lms;
+  std::vector<MapRec>  m_maps;
+
+  std::vector<uint32_t> m_stack; // indices of open (non-leaf) nodes
+
+  // VMA maps of the current LM; the first node inserted for an
+  // interval wins (cf. Struct::LM::insertInMap())
+  std::map<VMAInterval, uint32_t> m_lmProcMap;
+  std::map<VMAInterval, uint32_t> m_lmStmtMap;
+};
+
+
+// write: Write 'tree' in binary form.  Groups are not supported.
+void
+write(std::ostream& os, const Tree& tree);
+
+
+//***************************************************************************
+// Reader
+//***************************************************************************
+
+// Reader: A read-only (mmapped) view of a binary structure file.  Load
+// modules are materialized into a Struct::Tree on demand.
+class Reader {
+public:
+  // RealPathFn: normalizes file names as they are materialized
+  typedef std::string (*RealPathFn)(const std::string& path, void* arg);
+
+  Reader();
+  ~Reader();
+
+  // open: map 'filenm'; throws on error
+  void
+  open(const char* filenm);
+
+  void
+  close();
+
+  uint
+  numLMs() const
+  { return (m_hdr) ? m_hdr->numLMs : 0; }
+
+  const char*
+  lmName(uint lmIdx) const
+  { return str(m_lms[lmIdx].name); }
+
+  // materializeLM: create the subtree for load module 'lmIdx' within
+  // 'root' and return it.  If 'root' already has an LM of the same
+  // name, the subtree is merged into it.
+  LM*
+  materializeLM(Root* root, uint lmIdx,
+		RealPathFn realpathFn = NULL, void* realpathArg = NULL);
+
+  // materialize: materialize all load modules; if 'lmFilter' is
+  // non-NULL, only those whose (base) names are contained within it.
+  void
+  materialize(Root* root, const std::set<std::string>* lmFilter = NULL,
+	      RealPathFn realpathFn = NULL, void* realpathArg = NULL);
+
+private:
+  const char*
+  str(uint32_t id) const
+  { return m_strData + m_strOffsets[id]; }
+
+  const std::string&
+  path(uint32_t id, RealPathFn realpathFn, void* realpathArg);
+
+  void
+  setVMAs(ACodeNode* node, const NodeRec& rec) const;
+
+  static bool
+  isValidParent(uint8_t ty, uint8_t parentTy);
+
+  void
+  checkMapRec(const LMRec& lrec, const MapRec& mrec, uint8_t ty) const;
+
+private:
+  std::string m_filenm;
+
+  void*  m_addr;
+  size_t m_len;
+
+  const FileHdr*  m_hdr;
+  const uint64_t* m_strOffsets;
+  const char*     m_strData;
+  const NodeRec*  m_nodes;
+  const VMARec*   m_vmas;
+  const LMRec*    m_lms;
+  const MapRec*   m_maps;
+
+  // normalized paths, by string id
+  std::vector<std::string*> m_paths;
+};
+
+
+// read: Read the binary structure file 'filenm' into 'tree'. See
+// Reader::materialize().
+void
+read(Tree& tree, const char* filenm,
+     const std::set<std::string>* lmFilter = NULL,
+     Reader::RealPathFn realpathFn = NULL, void* realpathArg = NULL);
+
+
+} // namespace BinFmt
+} // namespace Struct
+} // namespace Prof
+
+
+#endif /* prof_Prof_Struct_BinFmt_hpp */
@@ -334,6 +334,8 @@ LM::Ctor(const char* nm, ANode* parent)
   m_fileMap = new FileMap();
   m_procMap = NULL;
   m_stmtMap = NULL;
+  m_procIdx = NULL;
+  m_stmtIdx = NULL;
 
   Root* root = ancestorRoot();
   if (root) {
@@ -351,6 +353,8 @@ LM::operator=(const LM& x)
     m_fileMap  = NULL;
     m_procMap  = NULL;
     m_stmtMap  = NULL;
+    m_procIdx  = NULL;
+    m_stmtIdx  = NULL;
   }
   return *this;
 }
@@ -504,7 +508,7 @@ Proc::demandStmtSimple(SrcFile::ln line, VMA beg_vma, VMA end_vma)
 // needed.  This is for struct simple for stmts from a different file
 // (alien).
 Alien *
-Proc::demandGuardAlien(std::string & filenm, SrcFile::ln line)
+Proc::demandGuardAlien(const std::string & filenm, SrcFile::ln line)
 {
   Alien * alien = NULL;
 
@@ -538,8 +542,9 @@ Alien::Ctor(ACodeNode* parent, const char* filenm, const char* nm,
   DIAG_Assert((parent == NULL) || (t == TyGroup) || (t == TyAlien)
 	      || (t == TyProc) || (t == TyLoop), "");
 
-  m_filenm = (filenm) ? filenm : "";
-  s_realpathMgr.realpath(m_filenm);
+  std::string filenm_real = (filenm) ? filenm : "";
+  s_realpathMgr.realpath(filenm_real);
+  m_filenm = filenm_real;
 
   m_name   = (nm) ? nm : "";
   m_displaynm = (displaynm) ? displaynm : "";
@@ -976,8 +981,8 @@ Root::insertGroupMap(Group* grp)
 void
 Loop::setFile(std::string filenm)
 {
+  s_realpathMgr.realpath(filenm);
   m_filenm = filenm;
-  s_realpathMgr.realpath(m_filenm);
 }
 
 
@@ -1059,6 +1064,10 @@ LM::findByVMA(VMA vma) const
 Proc*
 LM::findProc(VMA vma) const
 {
+  if (m_procIdx) {
+    Proc* const* x = m_procIdx->find(vma);
+    return (x) ? *x : NULL;
+  }
   if (!m_procMap) {
     buildMap(m_procMap, ANode::TyProc);
   }
@@ -1071,6 +1080,10 @@ LM::findProc(VMA vma) const
 Stmt*
 LM::findStmt(VMA vma) const
 {
+  if (m_stmtIdx) {
+    Stmt* const* x = m_stmtIdx->find(vma);
+    return (x) ? *x : NULL;
+  }
   if (!m_stmtMap) {
     buildMap(m_stmtMap, ANode::TyStmt);
   }
@@ -1080,6 +1093,16 @@ LM::findStmt(VMA vma) const
 }
 
 
+void
+LM::computeVMAIndices() const
+{
+  delete m_procIdx;
+  m_procIdx = (m_procMap) ? new VMAToProcIndex(*m_procMap) : NULL;
+  delete m_stmtIdx;
+  m_stmtIdx = (m_stmtMap) ? new VMAToStmtRangeIndex(*m_stmtMap) : NULL;
+}
+
+
 template<typename T>
 void
 LM::buildMap(VMAIntervalMap<T>*& mp, ANode::ANodeTy ty) const
@@ -1137,19 +1160,30 @@ File::findProc(const char* name, const char* linkname) const
 {
   Proc* found = NULL;
 
-  ProcMap::const_iterator it = m_procMap->find(name);
-  if (it != m_procMap->end()) {
+  // A name that was never interned names no procedure.  (Do not
+  // intern it: lookups are often misses.)
+  InternStr nm;
+  if (!InternStr::find(name, nm)) {
+    return NULL;
+  }
+
+  std::pair<ProcMap::const_iterator, ProcMap::const_iterator> range =
+    m_procMap->equal_range(nm);
+  if (range.first != range.second) {
     if (linkname && linkname[0] != '\0') {
-      for ( ; (it != m_procMap->end() && strcmp(it->first.c_str(), name) == 0);
-	    ++it) {
+      InternStr lnm;
+      if (!InternStr::find(linkname, lnm)) {
+	return NULL;
+      }
+      for (ProcMap::const_iterator it = range.first; it != range.second; ++it) {
 	Proc* p = it->second;
-	if (strcmp(p->linkName().c_str(), linkname) == 0) {
+	if (&p->linkName() == &lnm.str()) { // both interned: compare identity
 	  return p; // found = p
 	}
       }
     }
     else {
-      found = it->second;
+      found = range.first->second;
     }
   }
   
@@ -1452,7 +1486,7 @@ Proc::codeName() const
 string
 Alien::codeName() const
 {
-  string nm = "<" + m_filenm + ">[" + m_name + "]:";
+  string nm = "<" + m_filenm.str() + ">[" + m_name.str() + "]:";
   nm += StrUtil::toStr(m_begLn);
   return nm;
 }
@@ -82,9 +82,11 @@
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/FileUtil.hpp>
+#include <lib/support/InternStr.hpp>
 #include <lib/support/Logic.hpp>
 #include <lib/support/NonUniformDegreeTree.hpp>
 #include <lib/support/RealPathMgr.hpp>
+#include <lib/support/SlabPool.hpp>
 #include <lib/support/SrcFile.hpp>
 using SrcFile::ln_NULL;
 #include <lib/support/Unique.hpp>
@@ -118,9 +120,11 @@ class LMMap : public std::map<std::string, LM*> { };
 
 // ProcMap: This is is a multimap because procedure names are
 // sometimes "generic", i.e. not qualified by types in the case of
-// templates, resulting in duplicate names
+// templates, resulting in duplicate names.  It is only searched, so
+// it is ordered by name identity.
 class Proc;
-class ProcMap : public std::multimap<std::string, Proc*> { };
+class ProcMap
+  : public std::multimap<InternStr, Proc*, InternStr::IdentityLess> { };
 
 class File;
 class FileMap : public std::map<std::string, File*> { };
@@ -297,6 +301,14 @@ public:
 		  << " " << std::hex << this << std::dec);
   }
 
+  static void*
+  operator new(size_t sz)
+  { return SlabPool::alloc(sz); }
+
+  static void
+  operator delete(void* p, size_t sz)
+  { SlabPool::free(p, sz); }
+
   // clone: return a shallow copy, unlinked from the tree
   virtual ANode*
   clone()
@@ -841,7 +853,7 @@ protected:
   // InlineNode sequence inside the location manager.
   // --------------------------------------------------------
 private:
-  std::string m_scope_filenm;
+  InternStr   m_scope_filenm;
   SrcFile::ln m_scope_lineno;
   bool m_lineno_frozen;
   
@@ -850,7 +862,7 @@ public:
     m_scope_filenm = file;
     m_scope_lineno = line;
   }
-  std::string & getScopeFileName() { return m_scope_filenm; }
+  const std::string & getScopeFileName() { return m_scope_filenm; }
   SrcFile::ln getScopeLineNum() { return m_scope_lineno; }
 };
 
@@ -1080,6 +1092,8 @@ public:
     delete m_fileMap;
     delete m_procMap;
     delete m_stmtMap;
+    delete m_procIdx;
+    delete m_stmtIdx;
   }
 
   virtual ANode*
@@ -1136,6 +1150,11 @@ public:
   //
   // N.B. these maps are maintained when new Struct::Proc or
   // Struct::Stmt are created
+  //
+  // computeVMAMaps() additionally freezes the maps into flat,
+  // sorted-array indices (VMAIntervalIndex) that serve lookups until
+  // the next insertion or erasure, after which lookups fall back to
+  // the maps until computeVMAMaps() is called again.
   ACodeNode*
   findByVMA(VMA vma) const;
 
@@ -1146,8 +1165,27 @@ public:
     m_procMap = NULL;
     delete m_stmtMap;
     m_stmtMap = NULL;
+    delete m_procIdx;
+    m_procIdx = NULL;
+    delete m_stmtIdx;
+    m_stmtIdx = NULL;
     findProc(0);
     findStmt(0);
+    computeVMAIndices();
+  }
+
+  // vmaMaps: adopt prebuilt VMA maps (e.g., from a binary structure
+  // file), replacing any existing ones.  The maps must be consistent
+  // with what computeVMAMaps() would build.
+  void
+  vmaMaps(VMAIntervalMap<Proc*>* procMap,
+	  VMAIntervalMap<Stmt*>* stmtMap) const
+  {
+    delete m_procMap;
+    m_procMap = procMap;
+    delete m_stmtMap;
+    m_stmtMap = stmtMap;
+    computeVMAIndices();
   }
 
 
@@ -1159,6 +1197,8 @@ public:
   {
     if (m_procMap) {
       insertInMap(m_procMap, proc);
+      delete m_procIdx;
+      m_procIdx = NULL;
       return true;
     }
     return false;
@@ -1173,6 +1213,8 @@ public:
   {
     if (m_stmtMap) {
       insertInMap(m_stmtMap, stmt);
+      delete m_stmtIdx;
+      m_stmtIdx = NULL;
       return true;
     }
     return false;
@@ -1183,6 +1225,8 @@ public:
   {
     if (m_stmtMap) {
       eraseFromMap(m_stmtMap, stmt);
+      delete m_stmtIdx;
+      m_stmtIdx = NULL;
       return true;
     }
     return false;
@@ -1215,6 +1259,9 @@ public:
   typedef VMAIntervalMap<Proc*> VMAToProcMap;
   typedef VMAIntervalMap<Stmt*> VMAToStmtRangeMap;
 
+  typedef VMAIntervalIndex<Proc*> VMAToProcIndex;
+  typedef VMAIntervalIndex<Stmt*> VMAToStmtRangeIndex;
+
 protected:
   void
   Ctor(const char* nm, ANode* parent);
@@ -1222,6 +1269,9 @@ protected:
   void
   insertFileMap(File* file);
 
+  void
+  computeVMAIndices() const;
+
 
   template<typename T>
   void
@@ -1274,6 +1324,8 @@ private:
   FileMap*                   m_fileMap; // mapped by RealPathMgr
   mutable VMAToProcMap*      m_procMap;
   mutable VMAToStmtRangeMap* m_stmtMap;
+  mutable VMAToProcIndex*      m_procIdx; // frozen copy of m_procMap
+  mutable VMAToStmtRangeIndex* m_stmtIdx; // frozen copy of m_stmtMap
 
 #if 0
   static RealPathMgr& s_realpathMgr;
@@ -1349,7 +1401,7 @@ public:
 
   std::string
   baseName() const
-  { return FileUtil::basename(m_name); }
+  { return FileUtil::basename(m_name.str()); }
 
 
   // --------------------------------------------------------
@@ -1392,7 +1444,7 @@ private:
   friend class Proc;
 
 private:
-  std::string m_name; // the file name including the path
+  InternStr   m_name; // the file name including the path
   ProcMap*    m_procMap;
 
 #if 0
@@ -1421,7 +1473,7 @@ public:
 
   // map of file name to alien node, for stmts with a single, guard
   // alien from struct simple
-  typedef std::map <std::string, Alien *> AlienFileMap;
+  typedef std::map <InternStr, Alien *, InternStr::IdentityLess> AlienFileMap;
 
   // --------------------------------------------------------
   // Create/Destroy
@@ -1468,7 +1520,7 @@ public:
 
   // find or create guard alien for struct simple
   Alien*
-  demandGuardAlien(std::string & filenm, SrcFile::ln line);
+  demandGuardAlien(const std::string & filenm, SrcFile::ln line);
 
   // --------------------------------------------------------
   //
@@ -1547,8 +1599,8 @@ private:
   friend class Stmt;
 
 private:
-  std::string m_name;
-  std::string m_linkname;
+  InternStr   m_name;
+  InternStr   m_linkname;
   bool m_hasSym;
 
   // for struct simple and guard aliens only.  all access should go
@@ -1670,9 +1722,9 @@ private:
   friend class Stmt;
 
 private:
-  std::string m_filenm;
-  std::string m_name;
-  std::string m_displaynm;
+  InternStr   m_filenm;
+  InternStr   m_name;
+  InternStr   m_displaynm;
 
   // for struct simple only
   StmtMap *   m_stmtMap;
@@ -1744,7 +1796,7 @@ public:
   { m_filenm = fnm; }
 
 private:
-  std::string m_filenm;
+  InternStr   m_filenm;
 };
 
 
@@ -1767,7 +1819,7 @@ public:
        VMA begVMA = 0, VMA endVMA = 0,
        StmtType stmt_type = STMT_STMT)
     : ACodeNode(TyStmt, parent, begLn, endLn, begVMA, endVMA),
-      m_stmt_type(stmt_type), m_sortId((int)begLn)
+      m_stmt_type(stmt_type), m_target(0), m_sortId((int)begLn)
   {
     ANodeTy t = (parent) ? parent->type() : TyANY;
     DIAG_Assert((parent == NULL) || (t == TyGroup) || (t == TyFile)
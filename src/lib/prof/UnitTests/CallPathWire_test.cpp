@@ -0,0 +1,274 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <typeinfo>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <stdint.h>
+
+using std::string;
+
+#include "../CallPath-Profile.hpp"
+#include "../CCT-Tree.hpp"
+#include "../CCT-TreeIterator.hpp"
+
+#include "TestMeasurement.hpp"
+
+
+using namespace Prof;
+
+// A measurement file with the metrics CYCLES and INSTS, the load
+// modules 'lmNames' (ids 1, 2, ...) and the CCT 'cct'
+static void
+writeMeasurement(const string& fnm, const char* const* lmNames, uint numLMs,
+		 const TestMeasurementNode* cct, uint numNodes)
+{
+	const TestMeasurementMetric metrics[] = {
+		{ "CYCLES", 0.0 },
+		{ "INSTS", 0.0 },
+	};
+	writeTestMeasurement(fnm, metrics, 2, lmNames, numLMs, cct, numNodes);
+}
+
+
+// The profile's metrics, load map and CCT, in preorder
+static string
+toString(const CallPath::Profile& prof)
+{
+	std::ostringstream os;
+	os << prof.metricMgr()->toString("M ");
+	for (uint i = LoadMap::LMId_NULL + 1; i <= prof.loadmap()->size(); ++i) {
+		const LoadMap::LM* lm = prof.loadmap()->lm(i);
+		os << "LM " << lm->id() << " " << lm->name() << " "
+		   << lm->isUsed() << "\n";
+	}
+	for (CCT::ANodeIterator it(prof.cct()->root()); it.Current(); ++it) {
+		CCT::ANode* n = it.current();
+		os << typeid(*n).name() << " " << n->childCount();
+		CCT::ADynNode* n_dyn = dynamic_cast<CCT::ADynNode*>(n);
+		if (n_dyn) {
+			os << " " << n_dyn->cpId() << " " << n_dyn->lmId_real()
+			   << " " << n_dyn->lmIP_real() << " " << n_dyn->assocInfo().bits;
+		}
+		for (uint i = 0; i < n->numMetrics(); ++i) {
+			os << " " << n->metric(i);
+		}
+		os << "\n";
+	}
+	return os.str();
+}
+
+
+// The subtree at 'n', independent of sibling order
+static string
+toStringCanonical(const CCT::ANode* n)
+{
+	std::ostringstream os;
+	os << typeid(*n).name();
+	const CCT::ADynNode* n_dyn = dynamic_cast<const CCT::ADynNode*>(n);
+	if (n_dyn) {
+		os << " " << n_dyn->cpId() << " " << n_dyn->lmId_real()
+		   << " " << n_dyn->lmIP_real() << " " << n_dyn->assocInfo().bits;
+	}
+	for (uint i = 0; i < n->numMetrics(); ++i) {
+		os << " " << n->metric(i);
+	}
+
+	std::vector<string> children;
+	for (CCT::ANodeChildIterator it(n); it.Current(); ++it) {
+		children.push_back(toStringCanonical(it.current()));
+	}
+	std::sort(children.begin(), children.end());
+
+	os << " {";
+	for (uint i = 0; i < children.size(); ++i) {
+		os << children[i] << ";";
+	}
+	os << "}";
+	return os.str();
+}
+
+
+// The wire encoding of profiles (cf. hpcprof-mpi): merging a profile
+// from its encoding is the same as merging the profile, and decoding
+// an encoded profile, with or without a base profile, reproduces it.
+void callPathWireTest()
+{
+	char tmpl[] = "/tmp/hpcprof-wire-XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	assert(dir);
+
+	// Two measurements that share some paths.  The load modules are
+	// numbered differently, so that merging must remap them.
+	const char* lmNames1[] = { "/wire/bin/wire", "/wire/lib/libm.so" };
+	const char* lmNames2[] = { "/wire/lib/libm.so", "/wire/lib/libc.so",
+				   "/wire/bin/wire" };
+	const TestMeasurementNode cct1[] = {
+		{  1, HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL, 0, { 0, 0 } },
+		{  2, 1, 1, 0x400100, { 0, 0 } },
+		{ -3, 2, 1, 0x400200, { 10, 0 } },
+		{  4, 2, 1, 0x400300, { 0, 0 } },
+		{ -5, 4, 2, 0x1000, { 20, 7 } },
+		{ -6, 4, 2, 0x2000, { 0, 3 } },
+	};
+	const TestMeasurementNode cct2[] = {
+		{  1, HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL, 0, { 0, 0 } },
+		{  2, 1, 3, 0x400100, { 0, 0 } },
+		{ -3, 2, 3, 0x400200, { 1, 1 } },
+		{  4, 2, 3, 0x400300, { 0, 0 } },
+		{ -5, 4, 1, 0x1000, { 2, 0 } },
+		{  7, 4, 2, 0x500000, { 0, 0 } },
+		{ -8, 7, 2, 0x500100, { 4, 4 } },
+	};
+
+	string fnm1 = string(dir) + "/wire-000000-000-0-0.hpcrun";
+	string fnm2 = string(dir) + "/wire-000001-000-0-0.hpcrun";
+	writeMeasurement(fnm1, lmNames1, 2, cct1, sizeof(cct1) / sizeof(cct1[0]));
+	writeMeasurement(fnm2, lmNames2, 3, cct2, sizeof(cct2) / sizeof(cct2[0]));
+
+	// with metric values (cf. hpcprof-mpi)
+	uint rFlags = (CallPath::Profile::RFlg_NoMetricSfx
+		       | CallPath::Profile::RFlg_MakeInclExcl);
+	int mergeTy = CallPath::Profile::Merge_MergeMetricByName;
+
+	// -------------------------------------------------------
+	// wire_merge() vs. merge()
+	// -------------------------------------------------------
+	// N.B.: merge() consumes its source, so y is read twice
+	CallPath::Profile* ref = CallPath::Profile::make(fnm1.c_str(), rFlags, NULL);
+	CallPath::Profile* y0 = CallPath::Profile::make(fnm2.c_str(), rFlags, NULL);
+	ref->merge(*y0, mergeTy);
+	delete y0;
+
+	CallPath::Profile* x = CallPath::Profile::make(fnm1.c_str(), rFlags, NULL);
+	CallPath::Profile* y = CallPath::Profile::make(fnm2.c_str(), rFlags, NULL);
+	uint8_t* buf = NULL;
+	size_t bufSz = 0;
+	CallPath::Profile::wire_pack(*y, &buf, &bufSz);
+
+	Metric::Mgr y_mMgr;
+	CallPath::Profile::WireNodeMap y_nodeMap;
+	x->wire_merge(buf, bufSz, mergeTy, &y_mMgr, &y_nodeMap);
+	free(buf);
+
+	assert(toString(*x) == toString(*ref));
+
+	double sum = 0.0;
+	for (CCT::ANodeIterator it(x->cct()->root()); it.Current(); ++it) {
+		CCT::ANode* n = it.current();
+		for (uint i = 0; i < n->numMetrics(); ++i) {
+			sum += n->metric(i);
+		}
+	}
+	// raw samples land in both the inclusive and exclusive metric
+	assert(sum == 2 * (10 + 20 + 7 + 3 + 1 + 1 + 2 + 4 + 4));
+	assert(y_mMgr.size() == y->metricMgr()->size());
+
+	uint y_numNodes = 0;
+	for (CCT::ANodeIterator it(y->cct()->root()); it.Current(); ++it) {
+		y_numNodes++;
+	}
+	assert(y_nodeMap.size() == y_numNodes);
+
+	// -------------------------------------------------------
+	// wire_pack()/wire_unpack()
+	// -------------------------------------------------------
+	CallPath::Profile::wire_pack(*x, &buf, &bufSz);
+	CallPath::Profile* x1 = CallPath::Profile::wire_unpack(buf, bufSz);
+	free(buf);
+
+	assert(toStringCanonical(x1->cct()->root())
+	       == toStringCanonical(x->cct()->root()));
+	assert(x1->metricMgr()->size() == x->metricMgr()->size());
+	assert(x1->loadmap()->size() == x->loadmap()->size());
+
+	// -------------------------------------------------------
+	// relative to a base profile: x, sent relative to the y it merged
+	// -------------------------------------------------------
+	CallPath::Profile::wire_pack(*x, &y_nodeMap, &buf, &bufSz);
+	std::vector<CCT::ANode*> yToX;
+	CallPath::Profile* x2 = CallPath::Profile::wire_unpack(buf, bufSz, y, &yToX);
+	free(buf);
+
+	assert(toStringCanonical(x2->cct()->root())
+	       == toStringCanonical(x->cct()->root()));
+	assert(yToX.size() == y_numNodes);
+
+	delete x2;
+	delete x1;
+	delete x;
+	delete y;
+	delete ref;
+
+	unlink(fnm1.c_str());
+	unlink(fnm2.c_str());
+	rmdir(dir);
+}
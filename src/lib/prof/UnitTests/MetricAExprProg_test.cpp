@@ -0,0 +1,223 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include <cstdlib>
+#include <cmath>
+
+#include <sys/time.h>
+
+#include "../Metric-AExpr.hpp"
+#include "../Metric-AExprProg.hpp"
+#include "../Metric-IData.hpp"
+
+
+using namespace Prof;
+
+static const uint NumRaw = 4;
+
+
+static double
+now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+static Metric::AExpr**
+opands(Metric::AExpr* x0, Metric::AExpr* x1, Metric::AExpr* x2 = NULL,
+       Metric::AExpr* x3 = NULL)
+{
+	Metric::AExpr** x = new Metric::AExpr*[4];
+	x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3;
+	return x;
+}
+
+
+static Metric::AExpr*
+var(uint mId)
+{
+	return new Metric::Var("m", mId);
+}
+
+
+// Derived metrics over the raw metrics [0, NumRaw) that exercise
+// every operation, including division by zero
+static void
+makeExprs(std::vector<Metric::AExpr*>& exprs)
+{
+	using namespace Metric;
+
+	exprs.push_back(new Divide(new Plus(opands(var(0), var(1)), 2), var(2)));
+	exprs.push_back(new Minus(new Max(opands(var(0), var(1), var(3)), 3),
+				  new Min(opands(var(1), var(2)), 2)));
+	exprs.push_back(new Times(opands(new Neg(var(3)), new Const(0.5),
+					 new Power(var(0), new Const(2.0))), 3));
+	exprs.push_back(new Mean(opands(var(0), var(1), var(2)), 3));
+	exprs.push_back(new StdDev(opands(var(0), var(1), var(2), var(3)), 4));
+	exprs.push_back(new CoefVar(opands(var(0), var(1), var(2)), 3));
+	exprs.push_back(new RStdDev(opands(var(1), var(2), var(3)), 3));
+}
+
+
+static bool
+isSame(double x, double y)
+{
+	return (x == y) || (std::isnan(x) && std::isnan(y));
+}
+
+
+// The compiled program computes exactly what the AExpr interpreter
+// does.  Also reports the time of each, as a benchmark.
+void metricAExprProgTest()
+{
+	const uint numNodes = 200000;
+
+	std::vector<Metric::AExpr*> exprs;
+	makeExprs(exprs);
+
+	// metric ids: raw metrics, then a result and two accumulators per
+	// expression
+	const uint numMetrics = NumRaw + 3 * exprs.size();
+	for (uint i = 0; i < exprs.size(); ++i) {
+		exprs[i]->accumId(0, NumRaw + exprs.size() + 2 * i);
+		exprs[i]->accumId(1, NumRaw + exprs.size() + 2 * i + 1);
+	}
+
+	srand(1);
+	std::vector<Metric::IData*> nodes1, nodes2;
+	for (uint i = 0; i < numNodes; ++i) {
+		Metric::IData* x = new Metric::IData(numMetrics);
+		for (uint mId = 0; mId < NumRaw; ++mId) {
+			// frequent zeros, as in a CCT
+			x->metric(mId) = (rand() % 4 == 0) ? 0.0 : (rand() % 1000) / 7.0;
+		}
+		nodes1.push_back(x);
+		nodes2.push_back(new Metric::IData(*x));
+	}
+
+	// Each evaluation is repeated (it is idempotent); the best time
+	// counts.
+	const uint numReps = 5;
+
+	// -------------------------------------------------------
+	// interpreter
+	// -------------------------------------------------------
+	double tInterp = HUGE_VAL;
+	for (uint rep = 0; rep < numReps; ++rep) {
+		double t0 = now();
+		for (uint i = 0; i < numNodes; ++i) {
+			for (uint k = 0; k < exprs.size(); ++k) {
+				exprs[k]->evalNF(*nodes1[i]);
+				nodes1[i]->demandMetric(NumRaw + k, numMetrics) =
+					exprs[k]->eval(*nodes1[i]);
+			}
+		}
+		tInterp = std::min(tInterp, now() - t0);
+	}
+
+	// -------------------------------------------------------
+	// compiled (cf. CCT::ANode::computeMetrics())
+	// -------------------------------------------------------
+	Metric::AExprProg prog;
+	for (uint k = 0; k < exprs.size(); ++k) {
+		exprs[k]->compileNF(prog);
+		exprs[k]->compile(prog);
+		prog.emit(Metric::AExprProg::OpStore, NumRaw + k, numMetrics);
+	}
+
+	const uint bsz = Metric::AExprProg::BatchSz;
+	std::vector<double> stack;
+	double tProg = HUGE_VAL;
+	for (uint rep = 0; rep < numReps; ++rep) {
+		double t0 = now();
+		for (uint beg = 0; beg < numNodes; beg += bsz) {
+			uint n = std::min(numNodes - beg, bsz);
+			prog.eval(&nodes2[beg], n, stack);
+		}
+		tProg = std::min(tProg, now() - t0);
+	}
+
+	for (uint i = 0; i < numNodes; ++i) {
+		for (uint mId = 0; mId < numMetrics; ++mId) {
+			assert(isSame(nodes1[i]->metric(mId), nodes2[i]->metric(mId)));
+		}
+	}
+
+	std::cout << "metric expressions: " << numNodes << " nodes x "
+		  << exprs.size() << " exprs: interpreted " << tInterp
+		  << "s, compiled " << tProg << "s" << std::endl;
+
+	for (uint i = 0; i < numNodes; ++i) {
+		delete nodes1[i];
+		delete nodes2[i];
+	}
+	for (uint k = 0; k < exprs.size(); ++k) {
+		delete exprs[k];
+	}
+}
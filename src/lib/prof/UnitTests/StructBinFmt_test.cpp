@@ -0,0 +1,318 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cassert>
+#include <string>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+using std::string;
+
+#include "../Struct-Tree.hpp"
+#include "../Struct-BinFmt.hpp"
+
+#include <lib/support/diagnostics.h>
+
+
+using namespace Prof;
+
+// A structure tree with every kind of node that the binary format
+// supports:
+//   LM a.out
+//     File a.c
+//       Proc main [0x1000, 0x1100)
+//         Stmt 11 [0x1000, 0x1010)
+//         Loop 12 [0x1010, 0x1040)
+//           Stmt 13 [0x1010, 0x1020), call 14 [0x1020, 0x1030) -> 0x2000
+//         Alien inl.h:f
+//           Stmt 3 [0x1040, 0x1050)
+//       Proc f [0x2000, 0x2010)
+//         Stmt 21 [0x2000, 0x2010)
+static Struct::Tree*
+makeTree()
+{
+	uint id = 1;
+	Struct::Root* root = new Struct::Root("");
+	Struct::LM* lm = new Struct::LM("a.out", root);
+	lm->m_origId = id++;
+	Struct::File* file = new Struct::File("a.c", lm);
+	file->m_origId = id++;
+
+	Struct::Proc* pMain = new Struct::Proc("main", file, "main", false, 10, 20);
+	pMain->m_origId = id++;
+	pMain->vmaSet().insert(0x1000, 0x1100);
+
+	Struct::Stmt* stmt = new Struct::Stmt(pMain, 11, 11, 0x1000, 0x1010);
+	stmt->m_origId = id++;
+
+	string fnm = "a.c";
+	Struct::Loop* loop = new Struct::Loop(pMain, fnm, 12, 15);
+	loop->m_origId = id++;
+	loop->vmaSet().insert(0x1010, 0x1040);
+	stmt = new Struct::Stmt(loop, 13, 13, 0x1010, 0x1020);
+	stmt->m_origId = id++;
+	stmt = new Struct::Stmt(loop, 14, 14, 0x1020, 0x1030,
+				Struct::Stmt::STMT_CALL);
+	stmt->m_origId = id++;
+	stmt->target(0x2000);
+
+	Struct::Alien* alien = new Struct::Alien(pMain, "inl.h", "f", "f", 2, 4);
+	alien->m_origId = id++;
+	stmt = new Struct::Stmt(alien, 3, 3, 0x1040, 0x1050);
+	stmt->m_origId = id++;
+
+	Struct::Proc* pF = new Struct::Proc("f", file, "f_", false, 21, 22);
+	pF->m_origId = id++;
+	pF->vmaSet().insert(0x2000, 0x2010);
+	stmt = new Struct::Stmt(pF, 21, 21, 0x2000, 0x2010);
+	stmt->m_origId = id++;
+
+	return new Struct::Tree("", root);
+}
+
+
+// Compare the subtrees 'x' and 'y' field by field
+static void
+checkEqual(const Struct::ANode* x, const Struct::ANode* y)
+{
+	assert(x->type() == y->type());
+	assert(x->m_origId == y->m_origId);
+	assert(x->name() == y->name());
+
+	const Struct::ACodeNode* cx = dynamic_cast<const Struct::ACodeNode*>(x);
+	const Struct::ACodeNode* cy = dynamic_cast<const Struct::ACodeNode*>(y);
+	if (cx && x->type() != Struct::ANode::TyFile) {
+		assert(cx->begLine() == cy->begLine());
+		assert(cx->endLine() == cy->endLine());
+		assert(cx->vmaSet().toString() == cy->vmaSet().toString());
+	}
+
+	switch (x->type()) {
+		case Struct::ANode::TyProc:
+			assert(static_cast<const Struct::Proc*>(x)->linkName()
+			       == static_cast<const Struct::Proc*>(y)->linkName());
+			break;
+		case Struct::ANode::TyAlien:
+			assert(static_cast<const Struct::Alien*>(x)->fileName()
+			       == static_cast<const Struct::Alien*>(y)->fileName());
+			break;
+		case Struct::ANode::TyLoop:
+			assert(static_cast<const Struct::Loop*>(x)->fileName()
+			       == static_cast<const Struct::Loop*>(y)->fileName());
+			break;
+		case Struct::ANode::TyStmt: {
+			Struct::Stmt* sx = const_cast<Struct::Stmt*>
+				(static_cast<const Struct::Stmt*>(x));
+			Struct::Stmt* sy = const_cast<Struct::Stmt*>
+				(static_cast<const Struct::Stmt*>(y));
+			assert(sx->stmtType() == sy->stmtType());
+			assert(sx->target() == sy->target());
+			break;
+		}
+		default:
+			break;
+	}
+
+	const Struct::ANode* cx_ = x->firstChild();
+	const Struct::ANode* cy_ = y->firstChild();
+	for ( ; cx_ && cy_; cx_ = cx_->nextSibling(), cy_ = cy_->nextSibling()) {
+		checkEqual(cx_, cy_);
+	}
+	assert(cx_ == NULL && cy_ == NULL);
+}
+
+
+static void
+writeFile(const string& fnm, const string& data)
+{
+	std::ofstream os(fnm.c_str(), std::ios::binary);
+	os.write(data.data(), data.size());
+	assert(os.good());
+}
+
+
+// Reading a corrupt file must throw rather than crash
+static bool
+isReadRejected(const string& fnm, const string& data)
+{
+	writeFile(fnm, data);
+	Struct::Tree tree("", new Struct::Root(""));
+	try {
+		Struct::BinFmt::read(tree, fnm.c_str());
+	}
+	catch (const Diagnostics::Exception& x) {
+		return true;
+	}
+	return false;
+}
+
+
+// A tree written in binary form and read back is the same tree, with
+// working VMA maps, and corrupt files are rejected.
+void structBinFmtTest()
+{
+	char tmpl[] = "/tmp/hpcstruct-bin-XXXXXX";
+	char* dir = mkdtemp(tmpl);
+	assert(dir);
+	string fnm = string(dir) + "/a.hpcstruct.bin";
+
+	Struct::Tree* tree = makeTree();
+
+	std::ostringstream os;
+	Struct::BinFmt::write(os, *tree);
+	string data = os.str();
+	writeFile(fnm, data);
+	assert(Struct::BinFmt::isBinary(fnm.c_str()));
+
+	// -------------------------------------------------------
+	// round trip
+	// -------------------------------------------------------
+	Struct::Tree tree2("", new Struct::Root(""));
+	Struct::BinFmt::read(tree2, fnm.c_str());
+	checkEqual(tree->root(), tree2.root());
+
+	Struct::LM* lm = tree2.root()->findLM("a.out");
+	assert(lm);
+	Struct::Proc* proc = lm->findProc(0x1008);
+	assert(proc && proc->name() == "main");
+	assert(lm->findProc(0x2004)->name() == "f");
+	assert(lm->findProc(0x3000) == NULL);
+
+	Struct::Stmt* stmt = lm->findStmt(0x1024);
+	assert(stmt && stmt->begLine() == 14);
+	assert(stmt->stmtType() == Struct::Stmt::STMT_CALL);
+	assert(lm->findStmt(0x1044)->begLine() == 3);
+
+	// -------------------------------------------------------
+	// corrupt files
+	// -------------------------------------------------------
+	const Struct::BinFmt::FileHdr* hdr =
+		(const Struct::BinFmt::FileHdr*)data.data();
+
+	// truncated
+	assert(isReadRejected(fnm, data.substr(0, data.size() / 2)));
+	assert(isReadRejected(fnm, data.substr(0, sizeof(*hdr) - 1)));
+
+	// a string that runs past the string data
+	{
+		string bad = data;
+		uint64_t* strOffsets = (uint64_t*)&bad[hdr->strOffsetsOff];
+		strOffsets[hdr->numStrings] = bad.size();
+		assert(isReadRejected(fnm, bad));
+	}
+
+	// a load module with nodes past the node table
+	{
+		string bad = data;
+		Struct::BinFmt::LMRec* lms = (Struct::BinFmt::LMRec*)&bad[hdr->lmOff];
+		lms[0].nodeEnd = hdr->numNodes + 1;
+		assert(isReadRejected(fnm, bad));
+	}
+
+	// a node whose parent follows it, or has the wrong type
+	{
+		string bad = data;
+		Struct::BinFmt::NodeRec* nodes =
+			(Struct::BinFmt::NodeRec*)&bad[hdr->nodeOff];
+		nodes[2].parent = 3;
+		assert(isReadRejected(fnm, bad));
+
+		bad = data;
+		nodes = (Struct::BinFmt::NodeRec*)&bad[hdr->nodeOff];
+		assert(nodes[2].type == Struct::ANode::TyProc);
+		nodes[2].parent = 0; // the LM
+		assert(isReadRejected(fnm, bad));
+	}
+
+	// a node with a bad string or vma range
+	{
+		string bad = data;
+		Struct::BinFmt::NodeRec* nodes =
+			(Struct::BinFmt::NodeRec*)&bad[hdr->nodeOff];
+		nodes[1].name = hdr->numStrings;
+		assert(isReadRejected(fnm, bad));
+
+		bad = data;
+		nodes = (Struct::BinFmt::NodeRec*)&bad[hdr->nodeOff];
+		nodes[2].vmaCnt = hdr->numVMAs + 1;
+		assert(isReadRejected(fnm, bad));
+	}
+
+	// a vma map entry that is not a Proc
+	{
+		string bad = data;
+		Struct::BinFmt::MapRec* maps =
+			(Struct::BinFmt::MapRec*)&bad[hdr->mapOff];
+		maps[0].node = 1; // the File
+		assert(isReadRejected(fnm, bad));
+	}
+
+	delete tree;
+	unlink(fnm.c_str());
+	rmdir(dir);
+}
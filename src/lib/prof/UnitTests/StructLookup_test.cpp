@@ -0,0 +1,208 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+
+
+#undef NDEBUG
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+
+using std::string;
+
+#include "../Struct-Tree.hpp"
+
+#include <lib/binutils/VMAInterval.hpp>
+
+
+using namespace Prof;
+
+// Check that 'idx' answers every probe exactly as 'map' does
+static void
+checkIndex(const VMAIntervalMap<int>& map, const VMAIntervalIndex<int>& idx,
+	   const std::vector<VMA>& probes)
+{
+	assert(idx.size() == map.size());
+	for (uint i = 0; i < probes.size(); ++i) {
+		VMA vma = probes[i];
+		VMAIntervalMap<int>::const_iterator it =
+			map.find(VMAInterval(vma, vma + 1));
+		const int* x = idx.find(vma);
+		if (it == map.end()) {
+			assert(x == NULL);
+		}
+		else {
+			assert(x && *x == it->second);
+		}
+	}
+}
+
+
+static void
+vmaIntervalIndexTest()
+{
+	// empty
+	VMAIntervalMap<int> map;
+	VMAIntervalIndex<int> idx(map);
+	assert(idx.empty() && idx.find(0) == NULL && idx.find(0x1000) == NULL);
+
+	// disjoint intervals, some adjacent, some separated by gaps
+	srand(1);
+	std::vector<VMA> probes;
+	VMA vma = 0x400000;
+	for (int i = 0; i < 5000; ++i) {
+		if (rand() % 4 == 0) {
+			vma += 1 + rand() % 64; // gap
+		}
+		VMA end = vma + 1 + rand() % 32;
+		map.insert(std::make_pair(VMAInterval(vma, end), i));
+		probes.push_back(vma - 1);
+		probes.push_back(vma);
+		probes.push_back(end - 1);
+		probes.push_back(end);
+		vma = end;
+	}
+	for (int i = 0; i < 20000; ++i) {
+		probes.push_back(0x400000 - 16 + rand() % (vma - 0x400000 + 32));
+	}
+	probes.push_back(0);
+	probes.push_back(VMA_MAX - 1);
+
+	idx.build(map);
+	checkIndex(map, idx, probes);
+
+	// a single interval
+	VMAIntervalMap<int> map1;
+	map1.insert(std::make_pair(VMAInterval(0x10, 0x20), 7));
+	idx.build(map1);
+	assert(idx.find(0x0f) == NULL);
+	assert(*idx.find(0x10) == 7 && *idx.find(0x1f) == 7);
+	assert(idx.find(0x20) == NULL);
+}
+
+
+// LM a.out
+//   File a.c
+//     Proc main [0x1000, 0x1100): Stmt 11 [0x1000, 0x1010),
+//                                 Stmt 12 [0x1010, 0x1020)
+//     Proc f    [0x2000, 0x2010): Stmt 21 [0x2000, 0x2010)
+static void
+lmLookupTest()
+{
+	Struct::Root* root = new Struct::Root("");
+	Struct::Tree tree("", root);
+	Struct::LM* lm = new Struct::LM("a.out", root);
+	Struct::File* file = new Struct::File("a.c", lm);
+
+	Struct::Proc* pMain = new Struct::Proc("main", file, "main", false, 10, 20);
+	pMain->vmaSet().insert(0x1000, 0x1100);
+	new Struct::Stmt(pMain, 11, 11, 0x1000, 0x1010);
+	new Struct::Stmt(pMain, 12, 12, 0x1010, 0x1020);
+
+	Struct::Proc* pF = new Struct::Proc("f", file, "f_", false, 21, 22);
+	pF->vmaSet().insert(0x2000, 0x2010);
+	new Struct::Stmt(pF, 21, 21, 0x2000, 0x2010);
+
+	// served by the indices
+	lm->computeVMAMaps();
+	assert(lm->findProc(0x0fff) == NULL);
+	assert(lm->findProc(0x1000) == pMain && lm->findProc(0x10ff) == pMain);
+	assert(lm->findProc(0x1100) == NULL);
+	assert(lm->findProc(0x2008) == pF);
+	assert(lm->findStmt(0x100f)->begLine() == 11);
+	assert(lm->findStmt(0x1010)->begLine() == 12);
+	assert(lm->findStmt(0x1020) == NULL);
+	assert(lm->findStmt(0x2000)->begLine() == 21);
+
+	// inserting a statement drops the stale statement index; the new
+	// statement must be visible before and after the next rebuild
+	new Struct::Stmt(pMain, 13, 13, 0x1020, 0x1030);
+	assert(lm->findStmt(0x1024)->begLine() == 13);
+	assert(lm->findStmt(0x1010)->begLine() == 12);
+	assert(lm->findProc(0x1024) == pMain);
+
+	lm->computeVMAMaps();
+	assert(lm->findStmt(0x1024)->begLine() == 13);
+	assert(lm->findStmt(0x1030) == NULL);
+
+	// procedure insertion likewise drops the procedure index
+	Struct::Proc* pG = new Struct::Proc("g", file, "g", false, 30, 31);
+	pG->vmaSet().insert(0x3000, 0x3040);
+	assert(lm->findProc(0x3000) == NULL);
+	lm->insertProcIf(pG);
+	assert(lm->findProc(0x3000) == pG && lm->findProc(0x303f) == pG);
+	assert(lm->findProc(0x2008) == pF);
+
+	lm->computeVMAMaps();
+	assert(lm->findProc(0x3000) == pG && lm->findProc(0x3040) == NULL);
+
+	// name lookups
+	assert(file->findProc("main") == pMain);
+	assert(file->findProc("f", "f_") == pF);
+	assert(file->findProc("f", "f") == NULL);
+	assert(file->findProc("no-such-proc") == NULL);
+}
+
+
+void structLookupTest()
+{
+	vmaIntervalIndexTest();
+	lmLookupTest();
+}
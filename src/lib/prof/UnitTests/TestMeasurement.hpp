@@ -0,0 +1,188 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Test support: write small measurement (hpcrun) files with a given
+//   CCT and metric values.
+//
+// Description:
+//   tool/hpcsynth writes large measurement files with random values;
+//   unit tests instead need a few nodes with known values, so they
+//   describe the CCT as a preorder table and write it with
+//   writeTestMeasurement().
+//
+//***************************************************************************
+
+#ifndef prof_UnitTests_TestMeasurement_hpp
+#define prof_UnitTests_TestMeasurement_hpp
+
+//************************* System Include Files ****************************
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+//****************************************************************************
+
+const uint TestMeasurementMaxMetrics = 4;
+
+// A raw, integer metric
+struct TestMeasurementMetric {
+	const char* name;
+	double periodMean; // cf. metric_aux_info_t
+};
+
+// A CCT node, in preorder; leaves have negated ids.  'val[i]' is the
+// value of metric i.
+struct TestMeasurementNode {
+	int32_t id, parent;
+	uint16_t lm;
+	uint64_t ip;
+	uint64_t val[TestMeasurementMaxMetrics];
+};
+
+
+// writeTestMeasurement: write the measurement file 'fnm' with the
+// metrics 'metrics', the load modules 'lmNames' (ids 1, 2, ...; the
+// first is the program) and the CCT 'cct'
+inline void
+writeTestMeasurement(const std::string& fnm,
+		     const TestMeasurementMetric* metrics, uint numMetrics,
+		     const char* const* lmNames, uint numLMs,
+		     const TestMeasurementNode* cct, uint numNodes)
+{
+	assert(numMetrics <= TestMeasurementMaxMetrics && numLMs > 0);
+
+	FILE* fs = hpcio_fopen_w(fnm.c_str(), 1/*overwrite*/);
+	assert(fs);
+
+	const char* prog = strrchr(lmNames[0], '/');
+	prog = (prog) ? prog + 1 : lmNames[0];
+
+	hpcrun_fmt_hdr_fwrite(fs,
+			      HPCRUN_FMT_NV_prog, prog,
+			      HPCRUN_FMT_NV_progPath, lmNames[0],
+			      HPCRUN_FMT_NV_envPath, "",
+			      HPCRUN_FMT_NV_jobId, "",
+			      HPCRUN_FMT_NV_mpiRank, "0",
+			      HPCRUN_FMT_NV_tid, "0",
+			      HPCRUN_FMT_NV_hostid, "0",
+			      HPCRUN_FMT_NV_pid, "1",
+			      HPCRUN_FMT_NV_traceMinTime, "0",
+			      HPCRUN_FMT_NV_traceMaxTime, "0",
+			      NULL);
+
+	epoch_flags_t epochFlags;
+	epochFlags.bits = 0;
+	hpcrun_fmt_epochHdr_fwrite(fs, epochFlags, 1 /*granularity*/,
+				   "TODO:epoch-name", "TODO:epoch-value", NULL);
+
+	hpcfmt_int4_fwrite(numMetrics, fs);
+	for (uint i = 0; i < numMetrics; ++i) {
+		metric_desc_t m = metricDesc_NULL;
+		m.name = const_cast<char*>(metrics[i].name);
+		m.description = m.name;
+		m.flags = hpcrun_metricFlags_NULL;
+		m.flags.fields.ty = MetricFlags_Ty_Raw;
+		m.flags.fields.valFmt = MetricFlags_ValFmt_Int;
+		m.flags.fields.show = true;
+		m.period = 1;
+
+		metric_aux_info_t aux;
+		memset(&aux, 0, sizeof(aux));
+		aux.threshold_mean = metrics[i].periodMean;
+		hpcrun_fmt_metricDesc_fwrite(&m, &aux, fs);
+	}
+
+	hpcfmt_int4_fwrite(numLMs, fs);
+	for (uint i = 0; i < numLMs; ++i) {
+		loadmap_entry_t lm;
+		lm.id = i + 1;
+		lm.name = const_cast<char*>(lmNames[i]);
+		lm.flags = 0;
+		hpcrun_fmt_loadmapEntry_fwrite(&lm, fs);
+	}
+
+	hpcfmt_int8_fwrite(numNodes, fs);
+	for (uint i = 0; i < numNodes; ++i) {
+		hpcrun_metricVal_t v[TestMeasurementMaxMetrics];
+		for (uint j = 0; j < numMetrics; ++j) {
+			v[j] = hpcrun_metricVal_ZERO;
+			v[j].i = cct[i].val[j];
+		}
+
+		hpcrun_fmt_cct_node_t x;
+		hpcrun_fmt_cct_node_init(&x);
+		x.id = (uint32_t)cct[i].id;
+		x.id_parent = (uint32_t)cct[i].parent;
+		x.lm_id = cct[i].lm;
+		x.lm_ip = cct[i].ip;
+		x.num_metrics = numMetrics;
+		x.metrics = v;
+		hpcrun_fmt_cct_node_fwrite(&x, epochFlags, fs);
+	}
+
+	hpcio_fclose(fs);
+}
+
+//****************************************************************************
+
+#endif // prof_UnitTests_TestMeasurement_hpp
@@ -78,6 +78,8 @@ using std::string;
 #include "PGMReader.hpp"
 #include "XercesUtil.hpp"
 
+#include <lib/prof/Struct-BinFmt.hpp>
+
 //*********************** Xerces Include Files *******************************
 
 #include <xercesc/util/XMLString.hpp>
@@ -133,11 +135,20 @@ xmlSanityCheck(const char *filenm, string & docType)
 }
 
 
+static string
+binRealPath(const string& path, void* arg)
+{
+  const DocHandlerArgs* docargs = static_cast<const DocHandlerArgs*>(arg);
+  return docargs->realpath(path);
+}
+
+
 void
 readStructure(Struct::Tree& structure, 
 	      const std::vector<string>& structureFiles,
 	      PGMDocHandler::Doc_t docty, 
-	      DocHandlerArgs& docargs)
+	      DocHandlerArgs& docargs,
+	      const std::set<string>* lmFilter)
 {
   if (structureFiles.empty()) { return; }
 
@@ -145,7 +156,18 @@ readStructure(Struct::Tree& structure,
 
   for (uint i = 0; i < structureFiles.size(); ++i) {
     const string& fnm = structureFiles[i];
-    read_PGM(structure, fnm.c_str(), docty, docargs);
+    if (BinFmt::isBinary(fnm.c_str())) {
+      if (docty != PGMDocHandler::Doc_STRUCT) {
+	DIAG_Throw("'" << fnm << "': binary format only supports "
+		   << PGMDocHandler::ToString(PGMDocHandler::Doc_STRUCT)
+		   << " files");
+      }
+      BinFmt::read(structure, fnm.c_str(), lmFilter, binRealPath,
+		   (void*)&docargs);
+    }
+    else {
+      read_PGM(structure, fnm.c_str(), docty, docargs);
+    }
   }
 
   FiniXerces();
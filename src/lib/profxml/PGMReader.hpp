@@ -63,6 +63,8 @@
 //************************ System Include Files ******************************
 
 #include <vector>
+#include <set>
+#include <string>
 
 //************************* User Include Files *******************************
 
@@ -77,11 +79,16 @@ namespace Prof {
 
 namespace Struct {
 
+// readStructure: read each structure file into 'structure'.  Files
+// in the binary structure format (see Struct-BinFmt.hpp) are read
+// directly; others are parsed as XML.  If 'lmFilter' is non-NULL,
+// binary files only materialize load modules named in 'lmFilter'.
 void
 readStructure(Tree& structure, 
 	      const std::vector<string>& structureFiles,
 	      PGMDocHandler::Doc_t docty, 
-	      DocHandlerArgs& docargs);
+	      DocHandlerArgs& docargs,
+	      const std::set<std::string>* lmFilter = NULL);
 
 void
 read_PGM(Tree& structure,
@@ -61,6 +61,10 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 #include <fnmatch.h>
 
 #include <string>
@@ -215,9 +219,56 @@ countChar(const char* path, char c)
 //
 //***************************************************************************
 
+// cpy_kernel: Copy the rest of 'srcFd' to 'dstFd' without moving the
+// data through user space, if the kernel and file systems allow it.
+// Returns false if the caller must finish with read/write; the file
+// offsets are always left consistent for that.
+static bool
+cpy_kernel(int srcFd, int dstFd)
+{
+#ifdef __linux__
+  struct stat st;
+  if (fstat(srcFd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+
+  off_t pos = lseek(srcFd, 0, SEEK_CUR);
+  if (pos < 0) {
+    return false;
+  }
+  size_t left = (st.st_size > pos) ? (st.st_size - pos) : 0;
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+  while (left > 0) {
+    ssize_t n = copy_file_range(srcFd, NULL, dstFd, NULL, left, 0);
+    if (n <= 0) {
+      break; // e.g., EXDEV or ENOSYS; try sendfile
+    }
+    left -= n;
+  }
+#endif
+
+  while (left > 0) {
+    ssize_t n = sendfile(dstFd, srcFd, NULL, left);
+    if (n <= 0) {
+      return false;
+    }
+    left -= n;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+
 static void
 cpy(int srcFd, int dstFd)
 {
+  if (cpy_kernel(srcFd, dstFd)) {
+    return;
+  }
+
   static const int bufSz = 4096;
   char buf[bufSz];
   ssize_t nRead;
@@ -322,12 +373,13 @@ mkdir(const char* dir)
   // Note: Could make this a binary search, but it would likely have
   // insignificant effects.
   // -------------------------------------------------------
-  size_t begIdx = 0;
+  // N.B.: 'curIdx' is one past the last existing component; the loop
+  // must not underflow when no prefix of a relative path exists.
   size_t endIdx = pathVec.size() - 1;
 
-  size_t curIdx = endIdx;
-  for ( ; curIdx >= begIdx; --curIdx) {
-    string x = StrUtil::join(pathVec, "/", 0, curIdx + 1);
+  size_t curIdx = endIdx + 1;
+  for ( ; curIdx > 0; --curIdx) {
+    string x = StrUtil::join(pathVec, "/", 0, curIdx);
     if (isAbsPath) {
       x = "/" + x;
     }
@@ -337,8 +389,6 @@ mkdir(const char* dir)
     }
   }
 
-  curIdx++;
-
   // -------------------------------------------------------
   // 3. Build directories from pathVec[curIdx ... endIdx]
   // -------------------------------------------------------
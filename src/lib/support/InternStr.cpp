@@ -0,0 +1,257 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+#include <deque>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+//*************************** User Include Files ****************************
+
+#include "InternStr.hpp"
+
+//*************************** Forward Declarations ***************************
+
+namespace {
+
+size_t
+hashStr(const char* x, size_t len)
+{
+  // FNV-1a style mixing, a word at a time: names can be kilobytes
+  const uint64_t prime = 1099511628211ULL;
+  uint64_t h = 14695981039346656037ULL ^ len;
+  size_t i = 0;
+  for ( ; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, x + i, sizeof(w));
+    h = (h ^ w) * prime;
+    h ^= (h >> 29);
+  }
+  for ( ; i < len; ++i) {
+    h = (h ^ (unsigned char)x[i]) * prime;
+  }
+  return (size_t)(h ^ (h >> 32));
+}
+
+} // namespace
+
+
+//****************************************************************************
+
+// Lookups search 'slots' without locking.  Inserters hold 'lock': they
+// publish an entry by storing it into an empty slot, and when the table
+// is half full, publish a copy twice its size.  Either way a reader
+// sees a complete entry or none.
+struct InternStrTable {
+  // Slots: an open-addressing (linear probing) table of entries; NULL
+  // marks an empty slot.  A table is never freed, since readers may
+  // still search it after it is replaced.
+  struct Slots {
+    size_t mask; // size - 1 (a power of 2)
+    const InternStr::Entry** ent;
+
+    explicit Slots(size_t sz)
+      : mask(sz - 1), ent(new const InternStr::Entry*[sz]())
+    { }
+  };
+
+  // entries never move once inserted
+  std::deque<InternStr::Entry> entries;
+  Slots* slots;
+  const InternStr::Entry* empty;
+  size_t bytes;
+  pthread_mutex_t lock;
+
+  InternStrTable()
+    : slots(new Slots(1024)), bytes(0)
+  {
+    pthread_mutex_init(&lock, NULL);
+
+    // "" receives Id_NULL
+    pthread_mutex_lock(&lock);
+    empty = insert("", 0, hashStr("", 0));
+    pthread_mutex_unlock(&lock);
+  }
+
+  // find: search without locking
+  const InternStr::Entry*
+  find(const char* x, size_t len, size_t hash) const
+  {
+    const Slots* t = __atomic_load_n(&slots, __ATOMIC_ACQUIRE);
+    for (size_t i = hash & t->mask; ; i = (i + 1) & t->mask) {
+      const InternStr::Entry* e = __atomic_load_n(&t->ent[i], __ATOMIC_ACQUIRE);
+      if (!e) {
+	return NULL;
+      }
+      if (e->hash == hash && e->str.size() == len
+	  && memcmp(e->str.data(), x, len) == 0) {
+	return e;
+      }
+    }
+  }
+
+  // insert: add 'x', which is not in the table.  Requires 'lock'.
+  const InternStr::Entry*
+  insert(const char* x, size_t len, size_t hash)
+  {
+    if (2 * (entries.size() + 1) > slots->mask + 1) {
+      Slots* t = new Slots(2 * (slots->mask + 1));
+      for (size_t k = 0; k < entries.size(); ++k) {
+	slotFor(t, entries[k].hash) = &entries[k];
+      }
+      __atomic_store_n(&slots, t, __ATOMIC_RELEASE);
+    }
+
+    entries.push_back(InternStr::Entry());
+    InternStr::Entry& e = entries.back();
+    e.str.assign(x, len);
+    e.id = (InternStr::Id)(entries.size() - 1);
+    e.hash = hash;
+    bytes += len;
+
+    __atomic_store_n(&slotFor(slots, hash), &e, __ATOMIC_RELEASE);
+    return &e;
+  }
+
+  // slotFor: the empty slot of 't' that an entry with 'hash' goes into
+  static const InternStr::Entry*&
+  slotFor(Slots* t, size_t hash)
+  {
+    size_t i = hash & t->mask;
+    while (t->ent[i]) {
+      i = (i + 1) & t->mask;
+    }
+    return t->ent[i];
+  }
+};
+
+
+// The table is never destroyed so that InternStrs held by static
+// objects stay valid during exit.
+static InternStrTable&
+table()
+{
+  static InternStrTable* s_table = new InternStrTable;
+  return *s_table;
+}
+
+
+const InternStr::Entry*
+InternStr::intern(const char* x, size_t len)
+{
+  InternStrTable& tbl = table();
+  size_t hash = hashStr(x, len);
+
+  // common case: 'x' was interned before
+  const Entry* ent = tbl.find(x, len, hash);
+  if (ent) {
+    return ent;
+  }
+
+  pthread_mutex_lock(&tbl.lock);
+  ent = tbl.find(x, len, hash); // another thread may have added it
+  if (!ent) {
+    ent = tbl.insert(x, len, hash);
+  }
+  pthread_mutex_unlock(&tbl.lock);
+  return ent;
+}
+
+
+bool
+InternStr::find(const char* x, size_t len, InternStr& y)
+{
+  const Entry* ent = table().find(x, len, hashStr(x, len));
+  if (ent) {
+    y.m_ent = ent;
+  }
+  return (ent != NULL);
+}
+
+
+const InternStr::Entry*
+InternStr::emptyEntry()
+{
+  return table().empty;
+}
+
+
+size_t
+InternStr::numStrings()
+{
+  InternStrTable& tbl = table();
+  pthread_mutex_lock(&tbl.lock);
+  size_t x = tbl.entries.size();
+  pthread_mutex_unlock(&tbl.lock);
+  return x;
+}
+
+
+size_t
+InternStr::numBytes()
+{
+  InternStrTable& tbl = table();
+  pthread_mutex_lock(&tbl.lock);
+  size_t x = tbl.bytes;
+  pthread_mutex_unlock(&tbl.lock);
+  return x;
+}
@@ -0,0 +1,267 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Process-wide interning of frequently repeated strings such as
+//   procedure, file and load module names.
+//
+// Description:
+//   An InternStr refers to the single stored copy of its text in a
+//   global table.  Copying or assigning an InternStr copies a pointer,
+//   and equality between two InternStrs is a pointer comparison.  Each
+//   distinct text also has a small, stable id.  The text is exposed as
+//   a 'const std::string&' that remains valid for the life of the
+//   process, so accessors that used to return a reference to a member
+//   string can return InternStr::str() instead.
+//
+//   Interned strings are never freed.  This is meant for names that
+//   repeat across many tree nodes (e.g., an inlined C++ template
+//   function appearing as hundreds of Struct::Alien), not for
+//   transient strings.
+//
+//   Only adding a new string to the table takes a lock: finding or
+//   interning an existing string, and reading an InternStr, do not.
+//
+//***************************************************************************
+
+#ifndef support_InternStr_hpp
+#define support_InternStr_hpp
+
+//************************* System Include Files ****************************
+
+#include <iostream>
+#include <string>
+
+#include <cstring>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+//*************************** Forward Declarations ***************************
+
+//****************************************************************************
+
+class InternStr
+{
+public:
+  typedef uint Id;
+
+  // the id of the empty string
+  static const Id Id_NULL = 0;
+
+public:
+  InternStr()
+    : m_ent(emptyEntry())
+  { }
+
+  InternStr(const std::string& x)
+    : m_ent(intern(x.data(), x.size()))
+  { }
+
+  InternStr(const char* x)
+    : m_ent((x) ? intern(x, strlen(x)) : emptyEntry())
+  { }
+
+  InternStr&
+  operator=(const std::string& x)
+  {
+    m_ent = intern(x.data(), x.size());
+    return *this;
+  }
+
+  InternStr&
+  operator=(const char* x)
+  {
+    m_ent = (x) ? intern(x, strlen(x)) : emptyEntry();
+    return *this;
+  }
+
+  // default copy constructor and operator= copy the pointer
+
+  // --------------------------------------------------------
+  // access
+  // --------------------------------------------------------
+
+  const std::string&
+  str() const
+  { return m_ent->str; }
+
+  operator const std::string&() const
+  { return m_ent->str; }
+
+  const char*
+  c_str() const
+  { return m_ent->str.c_str(); }
+
+  size_t
+  length() const
+  { return m_ent->str.length(); }
+
+  bool
+  empty() const
+  { return m_ent->str.empty(); }
+
+  // id: a dense id in [0, numStrings()), Id_NULL for ""
+  Id
+  id() const
+  { return m_ent->id; }
+
+  bool
+  operator==(const InternStr& y) const
+  { return (m_ent == y.m_ent); }
+
+  bool
+  operator!=(const InternStr& y) const
+  { return (m_ent != y.m_ent); }
+
+  // IdentityLess: orders by identity, not text: a cheap comparison for
+  // maps that are searched but whose order does not matter
+  struct IdentityLess {
+    bool
+    operator()(const InternStr& x, const InternStr& y) const
+    { return (x.m_ent < y.m_ent); }
+  };
+
+
+  // --------------------------------------------------------
+  // lookup
+  // --------------------------------------------------------
+
+  // find: if 'x' has been interned, sets 'y' to it and returns true;
+  // otherwise returns false.  Unlike the constructors, does not add
+  // 'x' to the table: use this to search with transient strings.
+  static bool
+  find(const char* x, InternStr& y)
+  { return (x) ? find(x, strlen(x), y) : (y = InternStr(), true); }
+
+  static bool
+  find(const std::string& x, InternStr& y)
+  { return find(x.data(), x.size(), y); }
+
+
+  // --------------------------------------------------------
+  // table statistics
+  // --------------------------------------------------------
+
+  // numStrings: number of distinct interned strings (including "")
+  static size_t
+  numStrings();
+
+  // numBytes: total length of the distinct interned strings
+  static size_t
+  numBytes();
+
+private:
+  struct Entry {
+    std::string str;
+    Id id;
+    size_t hash;
+  };
+
+  static const Entry*
+  intern(const char* x, size_t len);
+
+  static bool
+  find(const char* x, size_t len, InternStr& y);
+
+  static const Entry*
+  emptyEntry();
+
+  friend struct InternStrTable;
+
+private:
+  const Entry* m_ent;
+};
+
+
+//****************************************************************************
+
+// Comparisons with plain strings compare text.  (The std::string
+// operators are templates and would not consider the conversion.)
+
+inline bool
+operator==(const InternStr& x, const std::string& y)
+{ return (x.str() == y); }
+
+inline bool
+operator==(const std::string& x, const InternStr& y)
+{ return (x == y.str()); }
+
+inline bool
+operator==(const InternStr& x, const char* y)
+{ return (x.str() == y); }
+
+inline bool
+operator!=(const InternStr& x, const std::string& y)
+{ return !(x == y); }
+
+inline bool
+operator!=(const std::string& x, const InternStr& y)
+{ return !(x == y); }
+
+inline bool
+operator!=(const InternStr& x, const char* y)
+{ return !(x == y); }
+
+
+// operator<: orders by text (not by id) so that sorted output is
+// independent of interning order
+inline bool
+operator<(const InternStr& x, const InternStr& y)
+{ return (x != y) && (x.str() < y.str()); }
+
+
+inline std::ostream&
+operator<<(std::ostream& os, const InternStr& x)
+{ return os << x.str(); }
+
+
+//****************************************************************************
+
+#endif // support_InternStr_hpp
@@ -93,6 +93,7 @@ RealPathMgr::RealPathMgr()
 {
   m_pathFindMgr = NULL;
   m_pathReplaceMgr = NULL;
+  pthread_mutex_init(&m_lock, NULL);
 }
 
 
@@ -102,6 +103,7 @@ RealPathMgr::RealPathMgr(PathFindMgr * findMgr, PathReplacementMgr * replaceMgr)
 {
   m_pathFindMgr = findMgr;
   m_pathReplaceMgr = replaceMgr;
+  pthread_mutex_init(&m_lock, NULL);
 }
 
 
@@ -114,6 +116,7 @@ RealPathMgr::~RealPathMgr()
   if (m_pathReplaceMgr != NULL) {
     delete m_pathReplaceMgr;
   }
+  pthread_mutex_destroy(&m_lock);
 }
 
 
@@ -125,6 +128,18 @@ RealPathMgr& RealPathMgr::singleton()
 
 bool
 RealPathMgr::realpath(string& pathNm) const
+{
+  // N.B.: the lock also covers the (unsynchronized) PathFindMgr and
+  // PathReplacementMgr lookups made on behalf of 'pathNm'
+  pthread_mutex_lock(&m_lock);
+  bool ret = realpathNoLock(pathNm);
+  pthread_mutex_unlock(&m_lock);
+  return ret;
+}
+
+
+bool
+RealPathMgr::realpathNoLock(string& pathNm) const
 {
   if (pathNm.empty()) {
     return false;
@@ -68,6 +68,8 @@
 
 #include <cctype>
 
+#include <pthread.h>
+
 //*************************** User Include Files ****************************
 
 #include <include/uint.h>
@@ -102,7 +104,7 @@ public:
   // realpath: Given 'fnm', convert it to its 'realpath' (if possible)
   // and return true.  Return true if 'fnm' is as fully resolved as it
   // can be (which does not necessarily mean it exists); otherwise
-  // return false.
+  // return false.  May be called by several threads at once.
   bool
   realpath(std::string& pathNm) const;
   
@@ -139,6 +141,10 @@ public:
   ddump(uint flags = 0) const;
 
 
+private:
+  bool
+  realpathNoLock(std::string& pathNm) const;
+
 private:
   typedef std::map<std::string, std::string> MyMap;
 
@@ -147,6 +153,7 @@ private:
 
   std::string m_searchPaths;
   mutable MyMap m_cache;
+  mutable pthread_mutex_t m_lock; // protects m_cache
 };
 
 
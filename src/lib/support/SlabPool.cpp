@@ -0,0 +1,465 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <new>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+//*************************** User Include Files ****************************
+
+#include "SlabPool.hpp"
+
+//*************************** Forward Declarations ***************************
+
+namespace SlabPool {
+
+struct FreeObj {
+  FreeObj* next;
+};
+
+static const size_t CacheLineSz = 64;
+
+// A slab header precedes the slab's objects.  A slab is 'owned' while
+// it is some thread's current slab for its class; otherwise it is
+// retired and, if it has free objects, on its class's partial list.
+//
+// The owner allocates from and frees to 'freeLst' and 'cur' without
+// locking.  Other threads push the objects they free onto 'remoteFree'
+// with a compare-and-swap; the owner takes the whole list once its
+// local space is used up.  Retiring a slab (under 'lock') drains
+// 'remoteFree' and replaces it with the sentinel 'Retired', after
+// which frees go to 'freeLst' under 'lock'.
+struct Slab {
+  // owner-private while owned; protected by 'lock' while retired
+  void* owner;          // owning thread's token (NULL when retired)
+  FreeObj* freeLst;
+  char* cur;            // unused space: [cur, end)
+  char* end;
+  size_t numLive;       // includes objects on 'remoteFree'
+
+  pthread_mutex_t lock;
+  bool isPartial;
+
+  // partial list links (protected by the class lock)
+  Slab* prev;
+  Slab* next;
+
+  // written by other threads, so kept off the owner's cache line
+  FreeObj* remoteFree __attribute__((aligned(CacheLineSz)));
+};
+
+static FreeObj* const Retired = reinterpret_cast<FreeObj*>(1);
+
+static const size_t NumClasses = (MaxObjSz / Align) + 1;
+
+static const size_t HdrSz = ((sizeof(Slab) + Align - 1) / Align) * Align;
+
+
+// per-class retired slabs with free objects.  Lock order: a class
+// lock before a slab lock.
+struct Class {
+  pthread_mutex_t lock;
+  Slab* partialLst;
+};
+
+static Class s_class[NumClasses];
+static pthread_once_t s_initOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t s_threadKey;
+
+// per-thread current slab (indexed by size class).  The address of
+// s_threadTok identifies the thread as a slab owner.
+static __thread Slab* s_curSlab[NumClasses];
+static __thread bool s_isThreadInit = false;
+static __thread char s_threadTok;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t s_bytesReserved = 0;
+
+
+static void
+retireThread(void* unused);
+
+
+static void
+init()
+{
+  for (size_t i = 0; i < NumClasses; ++i) {
+    pthread_mutex_init(&s_class[i].lock, NULL);
+    s_class[i].partialLst = NULL;
+  }
+  pthread_key_create(&s_threadKey, retireThread);
+}
+
+
+static inline size_t
+sizeClass(size_t sz)
+{
+  size_t cls = (sz + (Align - 1)) / Align;
+  return (cls == 0) ? 1 : cls;
+}
+
+
+static inline Slab*
+slabOf(void* p)
+{
+  return reinterpret_cast<Slab*>((uintptr_t)p & ~(uintptr_t)(SlabSz - 1));
+}
+
+
+static void
+partialPush(Class& c, Slab* s)
+{
+  s->isPartial = true;
+  s->prev = NULL;
+  s->next = c.partialLst;
+  if (c.partialLst) {
+    c.partialLst->prev = s;
+  }
+  c.partialLst = s;
+}
+
+
+static void
+partialRemove(Class& c, Slab* s)
+{
+  if (s->prev) {
+    s->prev->next = s->next;
+  }
+  else {
+    c.partialLst = s->next;
+  }
+  if (s->next) {
+    s->next->prev = s->prev;
+  }
+  s->isPartial = false;
+  s->prev = s->next = NULL;
+}
+
+
+static Slab*
+newSlab()
+{
+  // map twice the size and trim to an aligned slab
+  char* map = static_cast<char*>(mmap(NULL, 2 * SlabSz,
+				      PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (map == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+
+  char* mem = reinterpret_cast<char*>(((uintptr_t)map + SlabSz - 1)
+				      & ~(uintptr_t)(SlabSz - 1));
+  if (mem > map) {
+    munmap(map, mem - map);
+  }
+  munmap(mem + SlabSz, (map + 2 * SlabSz) - (mem + SlabSz));
+
+  Slab* s = reinterpret_cast<Slab*>(mem);
+  __atomic_store_n(&s->owner, &s_threadTok, __ATOMIC_RELAXED);
+  s->freeLst = NULL;
+  s->cur = mem + HdrSz;
+  s->end = mem + SlabSz;
+  s->numLive = 0;
+  pthread_mutex_init(&s->lock, NULL);
+  s->isPartial = false;
+  s->prev = s->next = NULL;
+  __atomic_store_n(&s->remoteFree, (FreeObj*)NULL, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&s_lock);
+  s_bytesReserved += SlabSz;
+  pthread_mutex_unlock(&s_lock);
+
+  return s;
+}
+
+
+static void
+deleteSlab(Slab* s)
+{
+  pthread_mutex_destroy(&s->lock);
+  munmap(s, SlabSz);
+
+  pthread_mutex_lock(&s_lock);
+  s_bytesReserved -= SlabSz;
+  pthread_mutex_unlock(&s_lock);
+}
+
+
+// acquireSlab: make a slab of class 'cls' the calling thread's
+// current slab, preferring a retired slab with free objects
+static Slab*
+acquireSlab(size_t cls)
+{
+  if (!s_isThreadInit) {
+    pthread_once(&s_initOnce, init);
+    pthread_setspecific(s_threadKey, &s_isThreadInit); // non-NULL
+    s_isThreadInit = true;
+  }
+
+  Class& c = s_class[cls];
+  pthread_mutex_lock(&c.lock);
+  Slab* s = c.partialLst;
+  if (s) {
+    partialRemove(c, s);
+    pthread_mutex_lock(&s->lock);
+    __atomic_store_n(&s->owner, &s_threadTok, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->remoteFree, (FreeObj*)NULL, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->lock);
+  }
+  pthread_mutex_unlock(&c.lock);
+
+  if (!s) {
+    s = newSlab();
+  }
+  s_curSlab[cls] = s;
+  return s;
+}
+
+
+// drainRemote: move the objects in 'lst' (taken from 'remoteFree')
+// to the free list of 's'
+static void
+drainRemote(Slab* s, FreeObj* lst)
+{
+  FreeObj* last = lst;
+  size_t n = 1;
+  for ( ; last->next; last = last->next) {
+    n++;
+  }
+  last->next = s->freeLst;
+  s->freeLst = lst;
+  s->numLive -= n;
+}
+
+
+// retireSlab: the calling thread gives up its current slab 's'
+static void
+retireSlab(size_t cls, Slab* s)
+{
+  Class& c = s_class[cls];
+  pthread_mutex_lock(&c.lock);
+  pthread_mutex_lock(&s->lock);
+
+  FreeObj* lst = __atomic_exchange_n(&s->remoteFree, Retired,
+				     __ATOMIC_ACQUIRE);
+  if (lst) {
+    drainRemote(s, lst);
+  }
+  __atomic_store_n(&s->owner, (void*)NULL, __ATOMIC_RELAXED);
+
+  bool isEmpty = (s->numLive == 0);
+  if (!isEmpty && (s->freeLst || s->cur + cls * Align <= s->end)) {
+    partialPush(c, s);
+  }
+
+  pthread_mutex_unlock(&s->lock);
+  pthread_mutex_unlock(&c.lock);
+
+  if (isEmpty) {
+    deleteSlab(s);
+  }
+}
+
+
+static void
+retireThread(void* unused)
+{
+  for (size_t cls = 1; cls < NumClasses; ++cls) {
+    if (s_curSlab[cls]) {
+      retireSlab(cls, s_curSlab[cls]);
+      s_curSlab[cls] = NULL;
+    }
+  }
+}
+
+} // namespace SlabPool
+
+
+//****************************************************************************
+
+namespace SlabPool {
+
+void*
+alloc(size_t sz)
+{
+  if (sz > MaxObjSz) {
+    return ::operator new(sz);
+  }
+
+  size_t cls = sizeClass(sz);
+  size_t objSz = cls * Align;
+
+  Slab* s = s_curSlab[cls];
+  if (!s) {
+    s = acquireSlab(cls);
+  }
+
+  // 's' is owned by the calling thread: no locking
+  while (true) {
+    FreeObj* x = s->freeLst;
+    if (x) {
+      s->freeLst = x->next;
+      s->numLive++;
+      return x;
+    }
+    if (s->cur + objSz <= s->end) {
+      void* obj = s->cur;
+      s->cur += objSz;
+      s->numLive++;
+      return obj;
+    }
+    if (__atomic_load_n(&s->remoteFree, __ATOMIC_RELAXED)) {
+      FreeObj* lst = __atomic_exchange_n(&s->remoteFree, (FreeObj*)NULL,
+					 __ATOMIC_ACQUIRE);
+      if (lst) {
+	drainRemote(s, lst);
+      }
+      continue;
+    }
+
+    // 's' is full
+    retireSlab(cls, s);
+    s = acquireSlab(cls);
+  }
+}
+
+
+void
+free(void* p, size_t sz)
+{
+  if (!p) {
+    return;
+  }
+
+  if (sz > MaxObjSz) {
+    ::operator delete(p);
+    return;
+  }
+
+  FreeObj* x = static_cast<FreeObj*>(p);
+  Slab* s = slabOf(p);
+
+  // common case: the slab is the calling thread's current slab.  (Only
+  // a thread itself makes or unmakes itself an owner.)
+  if (__atomic_load_n(&s->owner, __ATOMIC_RELAXED) == &s_threadTok) {
+    x->next = s->freeLst;
+    s->freeLst = x;
+    s->numLive--;
+    return;
+  }
+
+  // the slab is another thread's current slab.  N.B.: 'x' is live until
+  // it is on a free list, so 's' cannot be deleted in the meantime.
+  FreeObj* hd = __atomic_load_n(&s->remoteFree, __ATOMIC_RELAXED);
+  while (hd != Retired) {
+    x->next = hd;
+    if (__atomic_compare_exchange_n(&s->remoteFree, &hd, x, true,
+				    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+
+  // the slab is retired and may move to or from the partial list
+  Class& c = s_class[sizeClass(sz)];
+  pthread_mutex_lock(&c.lock);
+  pthread_mutex_lock(&s->lock);
+
+  if (__atomic_load_n(&s->remoteFree, __ATOMIC_RELAXED) != Retired) {
+    // a thread acquired 's' in the meantime
+    pthread_mutex_unlock(&s->lock);
+    pthread_mutex_unlock(&c.lock);
+    free(p, sz);
+    return;
+  }
+
+  x->next = s->freeLst;
+  s->freeLst = x;
+  s->numLive--;
+
+  bool isEmpty = (s->numLive == 0);
+  if (isEmpty && s->isPartial) {
+    partialRemove(c, s);
+  }
+  else if (!isEmpty && !s->isPartial) {
+    partialPush(c, s);
+  }
+
+  pthread_mutex_unlock(&s->lock);
+  pthread_mutex_unlock(&c.lock);
+
+  if (isEmpty) {
+    deleteSlab(s);
+  }
+}
+
+
+size_t
+bytesReserved()
+{
+  pthread_mutex_lock(&s_lock);
+  size_t x = s_bytesReserved;
+  pthread_mutex_unlock(&s_lock);
+  return x;
+}
+
+} // namespace SlabPool
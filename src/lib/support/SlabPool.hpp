@@ -0,0 +1,126 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Pooled allocation for small, numerous, individually freed objects
+//   such as CCT and structure tree nodes.
+//
+// Description:
+//   SlabPool serves objects of up to SlabPool::MaxObjSz bytes from
+//   size classes (multiples of SlabPool::Align bytes).  Each slab is
+//   SlabPool::SlabSz bytes, aligned to its size, and holds objects of
+//   one size class.  A thread allocates from its own current slab for
+//   each class and frees to it without locking, so allocations by
+//   different threads do not contend.
+//
+//   A freed object returns to the slab that holds it, whichever thread
+//   frees it: an object freed by another thread goes on the slab's
+//   atomic remote-free list, which the owner reclaims once the slab is
+//   otherwise full.  Locks are taken only to retire and release slabs
+//   and to free into retired slabs.  When a thread fills a slab (or
+//   exits) the slab is retired; a retired slab with free objects is
+//   handed to the next thread that needs a slab of its class, and a
+//   retired slab whose objects are all freed is returned to the
+//   system.  Thus deleting a tree releases the slabs that held only
+//   its nodes.  (Nodes move between trees when profiles are merged, so
+//   slabs are not owned by a tree and cannot be dropped wholesale.)
+//
+//   A class opts in by defining
+//     static void* operator new(size_t sz)
+//     { return SlabPool::alloc(sz); }
+//     static void operator delete(void* p, size_t sz)
+//     { SlabPool::free(p, sz); }
+//   The class must have a virtual destructor if objects are deleted
+//   through a base class pointer, so that the size is the dynamic one.
+//
+//***************************************************************************
+
+#ifndef support_SlabPool_hpp
+#define support_SlabPool_hpp
+
+//************************* System Include Files ****************************
+
+#include <cstddef>
+
+//*************************** User Include Files ****************************
+
+//*************************** Forward Declarations ***************************
+
+//****************************************************************************
+
+namespace SlabPool {
+
+// alignment and granularity of pooled objects
+const size_t Align = 16;
+
+// objects larger than MaxObjSz bytes are allocated with ::operator new
+const size_t MaxObjSz = 512;
+
+// bytes of each slab (a power of 2)
+const size_t SlabSz = (1 << 18);
+
+
+void*
+alloc(size_t sz);
+
+void
+free(void* p, size_t sz);
+
+
+// bytesReserved: total size of all slabs not yet returned to the system
+size_t
+bytesReserved();
+
+} // namespace SlabPool
+
+//****************************************************************************
+
+#endif // support_SlabPool_hpp
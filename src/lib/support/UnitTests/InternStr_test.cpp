@@ -0,0 +1,233 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "../InternStr.hpp"
+
+
+const uint InternStrMTThreads = 4;
+const uint InternStrMTStrings = 20000;
+
+struct InternStrMTWork
+{
+	uint tid;
+	const std::vector<std::string>* names;
+	std::vector<InternStr>* strs; // per name
+};
+
+
+// Each thread interns all names, starting at a different offset, and
+// looks each one up right after, so lookups run while other threads
+// add names and grow the table.
+static void*
+internStrMT(void* arg)
+{
+	InternStrMTWork* w = static_cast<InternStrMTWork*>(arg);
+	const std::vector<std::string>& names = *w->names;
+	uint n = names.size();
+	for (uint k = 0; k < n; ++k) {
+		uint i = (k + w->tid * (n / InternStrMTThreads)) % n;
+		(*w->strs)[i] = InternStr(names[i]);
+		InternStr x;
+		assert(InternStr::find(names[i], x) && x == (*w->strs)[i]);
+		assert(!InternStr::find(names[i] + "?", x));
+	}
+	return NULL;
+}
+
+
+struct InternStrBenchWork
+{
+	const std::vector<std::string>* names;
+	uint reps;
+	size_t found;
+};
+
+
+static void*
+internStrBench(void* arg)
+{
+	InternStrBenchWork* w = static_cast<InternStrBenchWork*>(arg);
+	InternStr x;
+	w->found = 0;
+	for (uint r = 0; r < w->reps; ++r) {
+		for (uint i = 0; i < w->names->size(); ++i) {
+			w->found += InternStr::find((*w->names)[i], x);
+		}
+	}
+	return NULL;
+}
+
+
+static double
+internStrTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+void internStrTest()
+{
+	// equal text is the same object; the empty string is Id_NULL
+	InternStr a("internStrTest::a");
+	InternStr a2(std::string("internStrTest::a"));
+	InternStr b("internStrTest::b");
+	assert(a == a2 && &a.str() == &a2.str() && a.id() == a2.id());
+	assert(a != b && a.id() != b.id());
+	assert(InternStr().id() == InternStr::Id_NULL);
+	assert(InternStr("").id() == InternStr::Id_NULL);
+	assert(InternStr((const char*)NULL) == InternStr());
+	assert(a == "internStrTest::a" && a == std::string("internStrTest::a"));
+	assert(a < b && !(b < a) && !(a < a2));
+
+	// find: finds interned strings but does not intern others
+	size_t numStrings = InternStr::numStrings();
+	size_t numBytes = InternStr::numBytes();
+
+	InternStr x;
+	assert(InternStr::find("internStrTest::a", x) && x == a);
+	assert(InternStr::find(std::string("internStrTest::b"), x) && x == b);
+	assert(!InternStr::find("internStrTest::c", x) && x == b);
+	assert(!InternStr::find(std::string("internStrTest::c"), x));
+	assert(InternStr::find("", x) && x == InternStr());
+	assert(InternStr::numStrings() == numStrings);
+	assert(InternStr::numBytes() == numBytes);
+
+	InternStr c("internStrTest::c");
+	assert(InternStr::numStrings() == numStrings + 1);
+	assert(InternStr::numBytes() == numBytes + c.length());
+	assert(InternStr::find("internStrTest::c", x) && x == c);
+
+	// IdentityLess: a map keyed by identity finds equal text
+	std::map<InternStr, int, InternStr::IdentityLess> map;
+	map[a] = 1;
+	map[b] = 2;
+	map[InternStr("internStrTest::a")] += 10;
+	assert(map.size() == 2);
+	assert(map[a] == 11 && map[b] == 2);
+	assert(map.find(c) == map.end());
+
+	// concurrent interning and lookup
+	std::vector<std::string> names(InternStrMTStrings);
+	for (uint i = 0; i < names.size(); ++i) {
+		std::ostringstream os;
+		os << "internStrTest::mt::" << i;
+		names[i] = os.str();
+	}
+	numStrings = InternStr::numStrings();
+
+	std::vector<std::vector<InternStr> > strs(InternStrMTThreads,
+		std::vector<InternStr>(names.size()));
+	std::vector<InternStrMTWork> work(InternStrMTThreads);
+	std::vector<pthread_t> threads(InternStrMTThreads);
+	for (uint t = 0; t < InternStrMTThreads; ++t) {
+		InternStrMTWork wt = { t, &names, &strs[t] };
+		work[t] = wt;
+		pthread_create(&threads[t], NULL, internStrMT, &work[t]);
+	}
+	for (uint t = 0; t < InternStrMTThreads; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	// each name was interned exactly once
+	assert(InternStr::numStrings() == numStrings + names.size());
+	for (uint i = 0; i < names.size(); ++i) {
+		for (uint t = 1; t < InternStrMTThreads; ++t) {
+			assert(strs[t][i] == strs[0][i]);
+		}
+		assert(strs[0][i] == names[i]);
+	}
+
+	// lookup time: hits and misses, all threads at once
+	std::vector<std::string> misses(names.size());
+	for (uint i = 0; i < names.size(); ++i) {
+		misses[i] = names[i] + "?";
+	}
+	for (int k = 0; k < 2; ++k) {
+		std::vector<InternStrBenchWork> bench(InternStrMTThreads);
+		double t0 = internStrTime();
+		for (uint t = 0; t < InternStrMTThreads; ++t) {
+			InternStrBenchWork wt = { (k == 0) ? &names : &misses, 20, 0 };
+			bench[t] = wt;
+			pthread_create(&threads[t], NULL, internStrBench, &bench[t]);
+		}
+		for (uint t = 0; t < InternStrMTThreads; ++t) {
+			pthread_join(threads[t], NULL);
+			assert(bench[t].found == ((k == 0) ? 20 * names.size() : 0));
+		}
+		double t1 = internStrTime();
+		std::cout << "intern str: " << InternStrMTThreads << " threads x "
+			  << 20 * names.size() << " finds (" << ((k == 0) ? "hits" : "misses")
+			  << "): " << t1 - t0 << "s" << std::endl;
+	}
+}
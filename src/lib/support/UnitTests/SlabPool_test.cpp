@@ -0,0 +1,271 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+
+#undef NDEBUG
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "../SlabPool.hpp"
+
+
+struct SlabPoolWork
+{
+	std::vector<void*>* objs;
+	size_t sz;
+};
+
+
+static void*
+slabPoolFree(void* arg)
+{
+	SlabPoolWork* w = static_cast<SlabPoolWork*>(arg);
+	for (size_t i = 0; i < w->objs->size(); ++i) {
+		SlabPool::free((*w->objs)[i], w->sz);
+	}
+	return NULL;
+}
+
+
+static void*
+slabPoolAlloc(void* arg)
+{
+	SlabPoolWork* w = static_cast<SlabPoolWork*>(arg);
+	for (size_t i = 0; i < w->objs->size(); ++i) {
+		(*w->objs)[i] = SlabPool::alloc(w->sz);
+	}
+	return NULL;
+}
+
+
+// Several threads allocate concurrently while their neighbors free
+// the objects each allocated in the previous round (cross-thread
+// frees into a slab its owner is allocating from), and each also
+// frees some of its own objects.
+struct SlabPoolMTWork
+{
+	uint tid;
+	uint numThreads;
+	pthread_barrier_t* barrier;
+	std::vector<std::vector<void*> >* batch; // per thread
+};
+
+const uint SlabPoolMTRounds = 20;
+const size_t SlabPoolMTBatch = 20000;
+const size_t SlabPoolMTSz = 48;
+
+
+static void*
+slabPoolMT(void* arg)
+{
+	SlabPoolMTWork* w = static_cast<SlabPoolMTWork*>(arg);
+	std::vector<void*>& mine = (*w->batch)[w->tid];
+	uint nbr = (w->tid + 1) % w->numThreads;
+	std::vector<void*> local(SlabPoolMTBatch / 4);
+
+	for (uint r = 0; r < SlabPoolMTRounds; ++r) {
+		for (size_t i = 0; i < mine.size(); ++i) {
+			mine[i] = SlabPool::alloc(SlabPoolMTSz);
+			static_cast<size_t*>(mine[i])[1] = (w->tid << 24) | i;
+		}
+		pthread_barrier_wait(w->barrier);
+
+		// free the neighbor's batch while allocating and freeing locally
+		std::vector<void*>& theirs = (*w->batch)[nbr];
+		for (size_t i = 0; i < theirs.size(); ++i) {
+			assert(static_cast<size_t*>(theirs[i])[1] == ((nbr << 24) | i));
+			SlabPool::free(theirs[i], SlabPoolMTSz);
+			if (i % 4 == 0) {
+				void*& x = local[i / 4];
+				x = SlabPool::alloc(SlabPoolMTSz);
+				static_cast<size_t*>(x)[0] = i;
+			}
+		}
+		for (size_t i = 0; i < local.size(); ++i) {
+			assert(static_cast<size_t*>(local[i])[0] == 4 * i);
+			SlabPool::free(local[i], SlabPoolMTSz);
+		}
+		pthread_barrier_wait(w->barrier);
+	}
+	return NULL;
+}
+
+
+static double
+slabPoolTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+// Time 'reps' rounds of allocating and then freeing 'n' objects with
+// SlabPool and with ::operator new (best of several runs).  With small
+// 'n' the pool reuses its current slab; with large 'n' it maps fresh
+// slabs and returns them to the system on every round.
+static void
+slabPoolBenchmark(size_t n, uint reps)
+{
+	const size_t sz = 64;
+	std::vector<void*> objs(n);
+	double tmPool = 1e9, tmNew = 1e9;
+	for (int k = 0; k < 5; ++k) {
+		double t0 = slabPoolTime();
+		for (uint r = 0; r < reps; ++r) {
+			for (size_t i = 0; i < n; ++i) {
+				objs[i] = SlabPool::alloc(sz);
+			}
+			for (size_t i = 0; i < n; ++i) {
+				SlabPool::free(objs[i], sz);
+			}
+		}
+		double t1 = slabPoolTime();
+		for (uint r = 0; r < reps; ++r) {
+			for (size_t i = 0; i < n; ++i) {
+				objs[i] = ::operator new(sz);
+			}
+			for (size_t i = 0; i < n; ++i) {
+				::operator delete(objs[i]);
+			}
+		}
+		double t2 = slabPoolTime();
+		tmPool = std::min(tmPool, t1 - t0);
+		tmNew = std::min(tmNew, t2 - t1);
+	}
+	std::cout << "slab pool: " << reps << " x " << n << " allocs+frees: pool "
+		  << tmPool << "s, operator new " << tmNew << "s" << std::endl;
+}
+
+
+void slabPoolTest()
+{
+	const size_t n = 4 * SlabPool::SlabSz / 64;
+	size_t reserved0 = SlabPool::bytesReserved();
+
+	// objects are aligned, distinct and writable
+	std::vector<void*> objs(n);
+	for (size_t i = 0; i < n; ++i) {
+		objs[i] = SlabPool::alloc(40);
+		assert(((size_t)objs[i] % SlabPool::Align) == 0);
+		if (i > 0) {
+			assert(objs[i] != objs[i - 1]);
+		}
+		static_cast<size_t*>(objs[i])[4] = i;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		assert(static_cast<size_t*>(objs[i])[4] == i);
+	}
+	size_t reserved1 = SlabPool::bytesReserved();
+	assert(reserved1 > reserved0);
+
+	// a freed object is reused
+	void* x = objs[n - 1];
+	SlabPool::free(x, 40);
+	objs[n - 1] = SlabPool::alloc(40);
+	assert(objs[n - 1] == x);
+
+	// objects freed by another thread return to their slabs, and slabs
+	// whose objects are all freed return to the system
+	SlabPoolWork w = { &objs, 40 };
+	pthread_t thread;
+	pthread_create(&thread, NULL, slabPoolFree, &w);
+	pthread_join(thread, NULL);
+	std::cout << "slab pool: reserved " << reserved0 << " -> " << reserved1
+		  << " -> " << SlabPool::bytesReserved() << std::endl;
+	assert(SlabPool::bytesReserved() <= reserved0 + SlabPool::SlabSz);
+
+	// slabs of an exited thread are released once their objects are freed
+	pthread_create(&thread, NULL, slabPoolAlloc, &w);
+	pthread_join(thread, NULL);
+	slabPoolFree(&w);
+	assert(SlabPool::bytesReserved() <= reserved0 + SlabPool::SlabSz);
+
+	// concurrent allocation with cross-thread frees
+	const uint numThreads = 4;
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, numThreads);
+	std::vector<std::vector<void*> > batch(numThreads,
+					       std::vector<void*>(SlabPoolMTBatch));
+	std::vector<SlabPoolMTWork> work(numThreads);
+	std::vector<pthread_t> threads(numThreads);
+	for (uint t = 0; t < numThreads; ++t) {
+		SlabPoolMTWork wt = { t, numThreads, &barrier, &batch };
+		work[t] = wt;
+		pthread_create(&threads[t], NULL, slabPoolMT, &work[t]);
+	}
+	for (uint t = 0; t < numThreads; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	pthread_barrier_destroy(&barrier);
+	assert(SlabPool::bytesReserved() <= reserved0 + SlabPool::SlabSz);
+
+	slabPoolBenchmark(1000, 1000);
+	slabPoolBenchmark(1000000, 1);
+
+	// large objects bypass the pool
+	void* big = SlabPool::alloc(SlabPool::MaxObjSz + 1);
+	SlabPool::free(big, SlabPool::MaxObjSz + 1);
+}
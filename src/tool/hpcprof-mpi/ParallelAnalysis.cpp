@@ -69,8 +69,14 @@
 using std::string;
 
 #include <algorithm>
+#include <vector>
+
+#include <cfloat>  // DBL_MIN
+#include <cstdio>
+#include <cstring> // memcpy()
 
 #include <stdint.h>
+#include <unistd.h> // fsync()
 
 //*************************** User Include Files ****************************
 
@@ -81,7 +87,12 @@ using std::string;
 #include <lib/analysis/CallPath.hpp>
 #include <lib/analysis/Util.hpp>
 
+#include <lib/banal/StructSimpleCache.hpp>
+
+#include <lib/prof-lean/hpcfmt.h>
+
 #include <lib/support/diagnostics.h>
+#include <lib/support/FileUtil.hpp>
 #include <lib/support/StrUtil.hpp>
 
 
@@ -105,10 +116,33 @@ packStringSet(const StringSet& profile,
 static StringSet*
 unpackStringSet(uint8_t* buffer, size_t bufferSz);
 
+static void
+recvMergeProfile(Prof::CallPath::Profile* profile,
+		 Prof::CallPath::Profile::WireNodeMap* nodeMap,
+		 int src, int myRank, MPI_Comm comm,
+		 Prof::Metric::Mgr* y_metricMgr = NULL);
+
 //***************************************************************************
 // private functions
 //***************************************************************************
 
+// bytes sent and received by the interface functions (cf. bytesSent())
+static uint64_t s_bytesSent = 0;
+static uint64_t s_bytesRecv = 0;
+
+// noteBcast: count a broadcast of 'size' bytes from rank 0
+static void
+noteBcast(size_t size, int myRank)
+{
+  if (myRank == 0) {
+    s_bytesSent += size;
+  }
+  else {
+    s_bytesRecv += size;
+  }
+}
+
+
 static void 
 broadcast_sizet
 (
@@ -123,6 +157,57 @@ broadcast_sizet
 
 
 
+// recvMergeProfile: receive src's profile and merge it into 'profile'.
+//   If 'y_metricMgr' is given, it receives src's metrics, whose perf
+//   event statistics are then left for the caller to merge.
+static void
+recvMergeProfile(Prof::CallPath::Profile* profile,
+		 Prof::CallPath::Profile::WireNodeMap* nodeMap,
+		 int src, int myRank, MPI_Comm comm,
+		 Prof::Metric::Mgr* y_metricMgr)
+{
+  // probe src
+  MPI_Status mpistat;
+  MPI_Probe(src, src, comm, &mpistat);
+  int profileBufSz;
+  MPI_Get_count(&mpistat, MPI_BYTE, &profileBufSz);
+
+  // receive profile from src
+  uint8_t *profileBuf = new uint8_t[profileBufSz];
+  MPI_Recv(profileBuf, profileBufSz, MPI_BYTE, src, src, comm, &mpistat);
+  s_bytesRecv += profileBufSz;
+
+  // merge the received profile directly from its wire encoding
+  // (without materializing it)
+  Prof::Metric::Mgr new_metricMgr;
+  Prof::Metric::Mgr* mMgr = (y_metricMgr) ? y_metricMgr : &new_metricMgr;
+  int mergeTy = Prof::CallPath::Profile::Merge_MergeMetricByName;
+  profile->wire_merge(profileBuf, (size_t)profileBufSz, mergeTy,
+		      mMgr, nodeMap);
+  delete[] profileBuf;
+
+  if (DBG_CCT_MERGE) {
+    string pfx0 = "[" + StrUtil::toStr(myRank) + "]";
+    string pfx1 = "[" + StrUtil::toStr(src) + "]";
+    DIAG_DevMsgIf(1, profile->metricMgr()->toString(pfx0.c_str()));
+    DIAG_DevMsgIf(1, mMgr->toString(pfx1.c_str()));
+  }
+
+  if (y_metricMgr) {
+    return;
+  }
+
+  // merging the perf event statistics
+  profile->metricMgr()->mergePerfEventStatistics(&new_metricMgr);
+
+  if (DBG_CCT_MERGE) {
+    string pfx = ("[" + StrUtil::toStr(src)
+		  + " => " + StrUtil::toStr(myRank) + "]");
+    DIAG_DevMsgIf(1, profile->metricMgr()->toString(pfx.c_str()));
+  }
+}
+
+
 //***************************************************************************
 // interface functions
 //***************************************************************************
@@ -149,6 +234,7 @@ broadcast
   }
 
   MPI_Bcast(buf, size, MPI_BYTE, 0, comm);
+  noteBcast(size, myRank);
 
   if (myRank != 0) {
     profile = unpackProfile(buf, size);
@@ -179,6 +265,7 @@ broadcast
   }
 
   MPI_Bcast(buf, size, MPI_BYTE, 0, comm);
+  noteBcast(size, myRank);
 
   if (myRank != 0) {
     StringSet *rhs = unpackStringSet(buf, size);
@@ -190,6 +277,186 @@ broadcast
 }
 
 
+void
+broadcast
+(
+  Prof::CallPath::Profile*& profGbl,
+  const Prof::CallPath::Profile* profLcl,
+  ChildNodeMaps& childNodeMaps,
+  int myRank, int numRanks,
+  MPI_Comm comm
+)
+{
+  // receive the canonical profile from the parent, relative to 'profLcl'
+  if (myRank > 0) {
+    int parent = (myRank - 1) / 2;
+
+    MPI_Status mpistat;
+    MPI_Probe(parent, parent, comm, &mpistat);
+    int bufSz;
+    MPI_Get_count(&mpistat, MPI_BYTE, &bufSz);
+
+    uint8_t* buf = new uint8_t[bufSz];
+    MPI_Recv(buf, bufSz, MPI_BYTE, parent, parent, comm, &mpistat);
+    s_bytesRecv += bufSz;
+
+    std::vector<Prof::CCT::ANode*> lclToGbl;
+    profGbl = Prof::CallPath::Profile::wire_unpack(buf, (size_t)bufSz,
+						   profLcl, &lclToGbl);
+    delete[] buf;
+
+    // The children's node maps refer to nodes of 'profLcl'; translate
+    // them to those of 'profGbl'
+    std::map<const Prof::CCT::ANode*, Prof::CCT::ANode*> nodeMap;
+    uint i = 0;
+    for (Prof::CCT::ANodeIterator it(profLcl->cct()->root());
+	 it.Current(); ++it, ++i) {
+      nodeMap.insert(std::make_pair(it.current(), lclToGbl[i]));
+    }
+    nodeMap[profLcl->cct()->root()] = profGbl->cct()->root();
+
+    for (ChildNodeMaps::iterator it = childNodeMaps.begin();
+	 it != childNodeMaps.end(); ++it) {
+      Prof::CallPath::Profile::WireNodeMap& childNodeMap = it->second;
+      for (uint j = 0; j < childNodeMap.size(); ++j) {
+	std::map<const Prof::CCT::ANode*, Prof::CCT::ANode*>::iterator fnd =
+	  nodeMap.find(childNodeMap[j].node);
+	childNodeMap[j].node = (fnd != nodeMap.end()) ? fnd->second : NULL;
+      }
+    }
+  }
+
+  // send it to each child, relative to the profile the child sent
+  for (int child = 2 * myRank + 1;
+       child <= 2 * myRank + 2 && child < numRanks; ++child) {
+    uint8_t* buf = NULL;
+    size_t bufSz = 0;
+    Prof::CallPath::Profile::wire_pack(*profGbl, &childNodeMaps[child],
+				       &buf, &bufSz);
+    MPI_Send(buf, (int)bufSz, MPI_BYTE, child, myRank, comm);
+    s_bytesSent += bufSz;
+    free(buf);
+  }
+}
+
+
+void
+broadcast
+(
+  uint8_t* nodeSet,
+  uint nodeSetSz,
+  int myRank,
+  MPI_Comm comm
+)
+{
+  // Encode the set as the lengths (varints) of its alternating runs of
+  // 0s and 1s, beginning with 0s.  Since each run is at least one
+  // node, this is never larger than the set itself.
+  std::vector<uint8_t> buf;
+
+  if (myRank == 0) {
+    uint8_t val = 0;
+    uint runLen = 0;
+    for (uint i = 0; i <= nodeSetSz; ++i) {
+      if (i == nodeSetSz || (nodeSet[i] != 0) != val) {
+	for (uint x = runLen; true; x >>= 7) {
+	  buf.push_back((uint8_t)((x & 0x7f) | ((x >= 0x80) ? 0x80 : 0)));
+	  if (x < 0x80) {
+	    break;
+	  }
+	}
+	val ^= 1;
+	runLen = 0;
+      }
+      runLen++;
+    }
+  }
+
+  size_t size = buf.size();
+  broadcast_sizet(size, comm);
+  buf.resize(size);
+
+  MPI_Bcast(&buf[0], size, MPI_BYTE, 0, comm);
+  noteBcast(size, myRank);
+
+  if (myRank != 0) {
+    uint8_t val = 0;
+    uint i = 0;
+    for (size_t j = 0; j < buf.size(); /* */) {
+      uint runLen = 0;
+      for (uint shift = 0; j < buf.size(); shift += 7) {
+	uint8_t b = buf[j++];
+	runLen |= (uint)(b & 0x7f) << shift;
+	if (!(b & 0x80)) {
+	  break;
+	}
+      }
+      DIAG_Assert(i + runLen <= nodeSetSz, DIAG_UnexpectedInput);
+      memset(nodeSet + i, val, runLen);
+      i += runLen;
+      val ^= 1;
+    }
+    DIAG_Assert(i == nodeSetSz, DIAG_UnexpectedInput);
+  }
+}
+
+
+void
+allgather(Analysis::CallPath::LMSimpleCaches& lmCaches, int myRank,
+	  int numRanks, MPI_Comm comm)
+{
+  // pack: each entry is its load map id followed by the cache
+  uint8_t* myBuf = NULL;
+  size_t myBufSz = 0;
+  FILE* fs = open_memstream((char**)&myBuf, &myBufSz);
+  for (Analysis::CallPath::LMSimpleCaches::const_iterator it =
+	 lmCaches.begin(); it != lmCaches.end(); ++it) {
+    hpcfmt_int4_fwrite(it->first, fs);
+    it->second->fmt_fwrite(fs);
+  }
+  fclose(fs);
+
+  int mySz = (int)myBufSz;
+  std::vector<int> sizes(numRanks), displs(numRanks);
+  MPI_Allgather(&mySz, 1, MPI_INT, &sizes[0], 1, MPI_INT, comm);
+
+  int totalSz = 0;
+  for (int rank = 0; rank < numRanks; ++rank) {
+    displs[rank] = totalSz;
+    totalSz += sizes[rank];
+  }
+
+  std::vector<uint8_t> buf(totalSz + 1);
+  MPI_Allgatherv(myBuf, mySz, MPI_BYTE, &buf[0], &sizes[0], &displs[0],
+		 MPI_BYTE, comm);
+  free(myBuf);
+  s_bytesSent += mySz;
+  s_bytesRecv += totalSz - mySz;
+
+  // unpack the other ranks' entries
+  for (int rank = 0; rank < numRanks; ++rank) {
+    if (rank == myRank || sizes[rank] == 0) {
+      continue;
+    }
+
+    FILE* fs = fmemopen(&buf[displs[rank]], sizes[rank], "r");
+    uint32_t lmId;
+    while (hpcfmt_int4_fread(&lmId, fs) == HPCFMT_OK) {
+      BAnal::Struct::SimpleCache* cache = new BAnal::Struct::SimpleCache;
+      bool isValid = cache->fmt_fread(fs);
+      DIAG_Assert(isValid, DIAG_UnexpectedInput);
+
+      Analysis::CallPath::LMSimpleCaches::iterator it = lmCaches.find(lmId);
+      if (it != lmCaches.end()) {
+	delete it->second;
+      }
+      lmCaches[lmId] = cache;
+    }
+    fclose(fs);
+  }
+}
+
+
 void
 packSend(Prof::CallPath::Profile* profile,
 	 int dest, int myRank, MPI_Comm comm)
@@ -198,6 +465,7 @@ packSend(Prof::CallPath::Profile* profile,
   size_t profileBufSz = 0;
   packProfile(*profile, &profileBuf, &profileBufSz);
   MPI_Send(profileBuf, (int)profileBufSz, MPI_BYTE, dest, myRank, comm);
+  s_bytesSent += profileBufSz;
   free(profileBuf);
 }
 
@@ -205,67 +473,62 @@ void
 recvMerge(Prof::CallPath::Profile* profile,
 	  int src, int myRank, MPI_Comm comm)
 {
-  // probe src
-  MPI_Status mpistat;
-  MPI_Probe(src, src, comm, &mpistat);
-  int profileBufSz;
-  MPI_Get_count(&mpistat, MPI_BYTE, &profileBufSz);
-
-  // receive profile from src
-  uint8_t *profileBuf = new uint8_t[profileBufSz];
-  MPI_Recv(profileBuf, profileBufSz, MPI_BYTE, src, src, comm, &mpistat);
-  Prof::CallPath::Profile* new_profile =
-    unpackProfile(profileBuf, (size_t)profileBufSz);
-  delete[] profileBuf;
-
-  if (DBG_CCT_MERGE) {
-    string pfx0 = "[" + StrUtil::toStr(myRank) + "]";
-    string pfx1 = "[" + StrUtil::toStr(src) + "]";
-    DIAG_DevMsgIf(1, profile->metricMgr()->toString(pfx0.c_str()));
-    DIAG_DevMsgIf(1, new_profile->metricMgr()->toString(pfx1.c_str()));
-  }
-    
-  int mergeTy = Prof::CallPath::Profile::Merge_MergeMetricByName;
-  profile->merge(*new_profile, mergeTy);
-
-  // merging the perf event statistics
-  profile->metricMgr()->mergePerfEventStatistics(new_profile->metricMgr());
+  recvMergeProfile(profile, NULL, src, myRank, comm);
+}
 
-  if (DBG_CCT_MERGE) {
-    string pfx = ("[" + StrUtil::toStr(src)
-		  + " => " + StrUtil::toStr(myRank) + "]");
-    DIAG_DevMsgIf(1, profile->metricMgr()->toString(pfx.c_str()));
-  }
+void
+packSend(std::pair<Prof::CallPath::Profile*,
+	                ParallelAnalysis::ChildNodeMaps*> data,
+	 int dest, int myRank, MPI_Comm comm)
+{
+  packSend(data.first, dest, myRank, comm);
+}
 
-  delete new_profile;
+void
+recvMerge(std::pair<Prof::CallPath::Profile*,
+	  ParallelAnalysis::ChildNodeMaps*> data,
+	  int src, int myRank, MPI_Comm comm)
+{
+  // note where each of src's nodes is merged (cf. broadcast())
+  recvMergeProfile(data.first, &(*data.second)[src], src, myRank, comm);
 }
 
 void
 packSend(std::pair<Prof::CallPath::Profile*,
-	                ParallelAnalysis::PackedMetrics*> data,
+	                ParallelAnalysis::SparseMetrics*> data,
 	 int dest, int myRank, MPI_Comm comm)
 {
   Prof::CallPath::Profile* profile = data.first;
-  ParallelAnalysis::PackedMetrics* packedMetrics = data.second;
-  packMetrics(*profile, *packedMetrics);
-  MPI_Send(packedMetrics->data(), packedMetrics->dataSize(),
-	   MPI_DOUBLE, dest, myRank, comm);
+  ParallelAnalysis::SparseMetrics* sparseMetrics = data.second;
+  packMetrics(*profile, *sparseMetrics);
+
+  std::vector<uint8_t> buf;
+  sparseMetrics->pack(buf);
+  MPI_Send(&buf[0], (int)buf.size(), MPI_BYTE, dest, myRank, comm);
+  s_bytesSent += buf.size();
 }
 
 void
 recvMerge(std::pair<Prof::CallPath::Profile*,
-	  ParallelAnalysis::PackedMetrics*> data,
+	  ParallelAnalysis::SparseMetrics*> data,
 	  int src, int myRank, MPI_Comm comm)
 {
   Prof::CallPath::Profile* profile = data.first;
-  ParallelAnalysis::PackedMetrics* packedMetrics = data.second;
+  ParallelAnalysis::SparseMetrics* sparseMetrics = data.second;
 
   // receive new metric data from src
   MPI_Status mpistat;
-  MPI_Recv(packedMetrics->data(), packedMetrics->dataSize(),
-	   MPI_DOUBLE, src, src, comm, &mpistat);
-  DIAG_Assert(packedMetrics->verify(), DIAG_UnexpectedInput);
-  unpackMetrics(*profile, *packedMetrics);
+  MPI_Probe(src, src, comm, &mpistat);
+  int bufSz;
+  MPI_Get_count(&mpistat, MPI_BYTE, &bufSz);
+
+  std::vector<uint8_t> buf(bufSz);
+  MPI_Recv(&buf[0], bufSz, MPI_BYTE, src, src, comm, &mpistat);
+  s_bytesRecv += bufSz;
+
+  bool isValid = sparseMetrics->unpack(&buf[0], buf.size());
+  DIAG_Assert(isValid, DIAG_UnexpectedInput);
+  unpackMetrics(*profile, *sparseMetrics);
 }
 
 void
@@ -277,6 +540,7 @@ packSend(StringSet *stringSet,
   packStringSet(*stringSet, &stringSetBuf, &stringSetBufSz);
   MPI_Send(stringSetBuf, (int)stringSetBufSz, MPI_BYTE, 
 	   dest, myRank, comm);
+  s_bytesSent += stringSetBufSz;
   free(stringSetBuf);
 }
 
@@ -294,6 +558,7 @@ recvMerge(StringSet *stringSet,
   uint8_t *stringSetBuf = new uint8_t[stringSetBufSz];
   MPI_Recv(stringSetBuf, stringSetBufSz, MPI_BYTE, 
 	   src, src, comm, &mpistat);
+  s_bytesRecv += stringSetBufSz;
   StringSet *new_stringSet =
     unpackStringSet(stringSetBuf, (size_t) stringSetBufSz);
   delete[] stringSetBuf;
@@ -304,33 +569,335 @@ recvMerge(StringSet *stringSet,
 
 //***************************************************************************
 
+PipelinedReduce::PipelinedReduce(ChildNodeMaps* childNodeMaps,
+				 int myRank, int numRanks, MPI_Comm comm)
+  : m_childNodeMaps(childNodeMaps), m_myRank(myRank), m_comm(comm)
+{
+  for (int child = 2 * myRank + 1;
+       child <= 2 * myRank + 2 && child < numRanks; ++child) {
+    m_pending.push_back(child);
+  }
+}
+
+
+PipelinedReduce::~PipelinedReduce()
+{
+  for (uint i = 0; i < m_perfStats.size(); ++i) {
+    delete m_perfStats[i];
+  }
+}
+
+
+uint
+PipelinedReduce::poll(Prof::CallPath::Profile* profile)
+{
+  uint numMerged = 0;
+  for (uint i = 0; i < m_pending.size(); ) {
+    int src = m_pending[i];
+    int isArrived = 0;
+    MPI_Iprobe(src, src, m_comm, &isArrived, MPI_STATUS_IGNORE);
+    if (!isArrived) {
+      ++i;
+      continue;
+    }
+
+    // hold back src's perf event statistics until finish()
+    Prof::Metric::Mgr* y_metricMgr = new Prof::Metric::Mgr;
+    recvMergeProfile(profile, &(*m_childNodeMaps)[src], src, m_myRank,
+		     m_comm, y_metricMgr);
+    m_perfStats.push_back(y_metricMgr);
+
+    m_pending.erase(m_pending.begin() + i);
+    numMerged++;
+  }
+  return numMerged;
+}
+
+
 void
-packProfile(const Prof::CallPath::Profile& profile,
-	    uint8_t** buffer, size_t* bufferSz)
+PipelinedReduce::finish(Prof::CallPath::Profile* profile)
 {
-  // open_memstream: mallocs buffer and sets bufferSz
-  FILE* fs = open_memstream((char**)buffer, bufferSz);
+  for (uint i = 0; i < m_pending.size(); ++i) {
+    int src = m_pending[i];
+    Prof::Metric::Mgr* y_metricMgr = new Prof::Metric::Mgr;
+    recvMergeProfile(profile, &(*m_childNodeMaps)[src], src, m_myRank,
+		     m_comm, y_metricMgr);
+    m_perfStats.push_back(y_metricMgr);
+  }
+  m_pending.clear();
 
-  uint wFlags = Prof::CallPath::Profile::WFlg_VirtualMetrics;
-  Prof::CallPath::Profile::fmt_fwrite(profile, fs, wFlags);
+  for (uint i = 0; i < m_perfStats.size(); ++i) {
+    profile->metricMgr()->mergePerfEventStatistics(m_perfStats[i]);
+    delete m_perfStats[i];
+  }
+  m_perfStats.clear();
+}
 
-  fclose(fs);
+
+//***************************************************************************
+
+// Layout (native byte order; ranks are homogeneous):
+//   magic, uint64 inputId, uint32 numRanks, uint32 numSections
+//   each section: uint64 size, bytes[size]
+static const char Checkpoint_magic[] = "HPCCKPT1";
+static const size_t Checkpoint_magicLen = sizeof(Checkpoint_magic) - 1;
+
+static const char* Checkpoint_stageNm[] = { "read", "reduce", "summary" };
+
+
+Checkpoint::Checkpoint(const std::string& dir, int myRank, int numRanks,
+		       MPI_Comm comm)
+  : m_dir(dir), m_myRank(myRank), m_numRanks(numRanks), m_comm(comm)
+{
+  for (uint i = 0; i < Stage_NUM; ++i) {
+    m_inputIds[i] = 0;
+    m_holders[i].assign(numRanks, 0);
+  }
+
+  if (isEnabled() && myRank == 0) {
+    FileUtil::mkdir(m_dir);
+  }
+}
+
+
+Checkpoint::~Checkpoint()
+{
+}
+
+
+void
+Checkpoint::find(Stage stage, uint64_t inputId)
+{
+  m_inputIds[stage] = inputId;
+  if (!isEnabled()) {
+    return;
+  }
+
+  char isHeld = 0;
+  FILE* fs = fopen(fileName(stage).c_str(), "r");
+  if (fs) {
+    char magic[Checkpoint_magicLen];
+    uint64_t id = 0;
+    uint32_t numRanks = 0;
+    isHeld = (fread(magic, 1, Checkpoint_magicLen, fs) == Checkpoint_magicLen
+	      && fread(&id, sizeof(id), 1, fs) == 1
+	      && fread(&numRanks, sizeof(numRanks), 1, fs) == 1
+	      && memcmp(magic, Checkpoint_magic, Checkpoint_magicLen) == 0
+	      && id == inputId && numRanks == (uint32_t)m_numRanks);
+    fclose(fs);
+  }
+
+  MPI_Allgather(&isHeld, 1, MPI_CHAR, &m_holders[stage][0], 1, MPI_CHAR,
+		m_comm);
+}
+
+
+bool
+Checkpoint::isCovered(Stage stage) const
+{
+  for (int r = m_myRank; r > 0; ) {
+    r = (r - 1) / 2;
+    if (m_holders[stage][r]) {
+      return true;
+    }
+  }
+  return false;
 }
 
 
 Prof::CallPath::Profile*
-unpackProfile(uint8_t* buffer, size_t bufferSz)
+Checkpoint::readProfile(Stage stage) const
 {
-  FILE* fs = fmemopen(buffer, bufferSz, "r");
+  std::vector<std::vector<uint8_t> > sections;
+  read(stage, sections);
+  if (sections.size() != 2 || sections[0].empty() || sections[1].empty()) {
+    DIAG_Throw("invalid checkpoint '" << fileName(stage) << "'");
+  }
+
+  Prof::CallPath::Profile* profile =
+    unpackProfile(&sections[0][0], sections[0].size());
+
+  StringSet* directorySet =
+    unpackStringSet(&sections[1][0], sections[1].size());
+  profile->copyDirectory(*directorySet);
+  delete directorySet;
+
+  return profile;
+}
+
+
+void
+Checkpoint::writeProfile(Stage stage, Prof::CallPath::Profile& profile) const
+{
+  if (!isEnabled()) {
+    return;
+  }
+
+  uint8_t* profileBuf = NULL;
+  size_t profileBufSz = 0;
+  packProfile(profile, &profileBuf, &profileBufSz);
+
+  uint8_t* stringSetBuf = NULL;
+  size_t stringSetBufSz = 0;
+  packStringSet(profile.directorySet(), &stringSetBuf, &stringSetBufSz);
+
+  std::vector<const uint8_t*> sections;
+  std::vector<size_t> sectionSzs;
+  sections.push_back(profileBuf);
+  sectionSzs.push_back(profileBufSz);
+  sections.push_back(stringSetBuf);
+  sectionSzs.push_back(stringSetBufSz);
+
+  write(stage, sections, sectionSzs);
+
+  free(profileBuf);
+  free(stringSetBuf);
+}
+
+
+void
+Checkpoint::readMetrics(SparseMetrics& sparseMetrics) const
+{
+  std::vector<std::vector<uint8_t> > sections;
+  read(Stage_Summary, sections);
+
+  bool isValid = (sections.size() == 1 && !sections[0].empty()
+		  && sparseMetrics.unpack(&sections[0][0],
+					  sections[0].size()));
+  if (!isValid) {
+    DIAG_Throw("invalid checkpoint '" << fileName(Stage_Summary) << "'");
+  }
+}
+
+
+void
+Checkpoint::writeMetrics(const SparseMetrics& sparseMetrics) const
+{
+  if (!isEnabled()) {
+    return;
+  }
+
+  std::vector<uint8_t> buf;
+  sparseMetrics.pack(buf);
+
+  std::vector<const uint8_t*> sections(1, &buf[0]);
+  std::vector<size_t> sectionSzs(1, buf.size());
+  write(Stage_Summary, sections, sectionSzs);
+}
+
+
+std::string
+Checkpoint::fileName(Stage stage) const
+{
+  return (m_dir + "/" + Checkpoint_stageNm[stage] + "-"
+	  + StrUtil::toStr(m_myRank) + ".ckpt");
+}
+
 
-  Prof::CallPath::Profile* prof = NULL;
-  uint rFlags = Prof::CallPath::Profile::RFlg_VirtualMetrics;
-  Prof::CallPath::Profile::fmt_fread(prof, fs, rFlags,
-				     "(ParallelAnalysis::unpackProfile)",
-				     NULL, NULL);
+void
+Checkpoint::read(Stage stage,
+		 std::vector<std::vector<uint8_t> >& sections) const
+{
+  string fnm = fileName(stage);
+  FILE* fs = fopen(fnm.c_str(), "r");
+  if (!fs) {
+    DIAG_Throw("error opening checkpoint '" << fnm << "'");
+  }
 
+  char magic[Checkpoint_magicLen];
+  uint64_t id;
+  uint32_t numRanks, numSections;
+  bool isOk = (fread(magic, 1, Checkpoint_magicLen, fs) == Checkpoint_magicLen
+	       && fread(&id, sizeof(id), 1, fs) == 1
+	       && fread(&numRanks, sizeof(numRanks), 1, fs) == 1
+	       && fread(&numSections, sizeof(numSections), 1, fs) == 1);
+
+  sections.clear();
+  for (uint32_t i = 0; isOk && i < numSections; ++i) {
+    uint64_t sz = 0;
+    isOk = (fread(&sz, sizeof(sz), 1, fs) == 1);
+    if (isOk) {
+      sections.push_back(std::vector<uint8_t>(sz));
+      isOk = (sz == 0 || fread(&sections.back()[0], 1, sz, fs) == sz);
+    }
+  }
   fclose(fs);
-  return prof;
+
+  if (!isOk) {
+    DIAG_Throw("error reading checkpoint '" << fnm << "'");
+  }
+}
+
+
+void
+Checkpoint::write(Stage stage, const std::vector<const uint8_t*>& sections,
+		  const std::vector<size_t>& sectionSzs) const
+{
+  string fnm = fileName(stage);
+  string fnm_tmp = fnm + ".tmp";
+  FILE* fs = fopen(fnm_tmp.c_str(), "w");
+  if (!fs) {
+    DIAG_Throw("error opening checkpoint '" << fnm_tmp << "'");
+  }
+
+  uint64_t id = m_inputIds[stage];
+  uint32_t numRanks = m_numRanks;
+  uint32_t numSections = sections.size();
+  bool isOk = (fwrite(Checkpoint_magic, 1, Checkpoint_magicLen, fs)
+	       == Checkpoint_magicLen
+	       && fwrite(&id, sizeof(id), 1, fs) == 1
+	       && fwrite(&numRanks, sizeof(numRanks), 1, fs) == 1
+	       && fwrite(&numSections, sizeof(numSections), 1, fs) == 1);
+
+  for (uint i = 0; isOk && i < sections.size(); ++i) {
+    uint64_t sz = sectionSzs[i];
+    isOk = (fwrite(&sz, sizeof(sz), 1, fs) == 1
+	    && (sz == 0 || fwrite(sections[i], 1, sz, fs) == sz));
+  }
+
+  // N.B.: the checkpoint must be on disk before it replaces the last
+  isOk = (isOk && fflush(fs) == 0 && fsync(fileno(fs)) == 0);
+  isOk = (fclose(fs) == 0 && isOk);
+  if (!isOk) {
+    FileUtil::remove(fnm_tmp.c_str());
+    DIAG_Throw("error writing checkpoint '" << fnm_tmp << "'");
+  }
+
+  FileUtil::move(fnm, fnm_tmp);
+}
+
+
+//***************************************************************************
+
+uint64_t
+bytesSent()
+{
+  return s_bytesSent;
+}
+
+
+uint64_t
+bytesReceived()
+{
+  return s_bytesRecv;
+}
+
+
+//***************************************************************************
+
+void
+packProfile(const Prof::CallPath::Profile& profile,
+	    uint8_t** buffer, size_t* bufferSz)
+{
+  // mallocs buffer and sets bufferSz
+  Prof::CallPath::Profile::wire_pack(profile, buffer, bufferSz);
+}
+
+
+Prof::CallPath::Profile*
+unpackProfile(uint8_t* buffer, size_t bufferSz)
+{
+  return Prof::CallPath::Profile::wire_unpack(buffer, bufferSz);
 }
 
 
@@ -420,6 +987,176 @@ unpackMetrics(Prof::CallPath::Profile& profile,
 
 
 
+void
+packMetrics(const Prof::CallPath::Profile& profile,
+	    ParallelAnalysis::SparseMetrics& sparseMetrics)
+{
+  Prof::CCT::Tree& cct = *profile.cct();
+
+  // pack the non-zero derived metrics [mDrvdBeg, mDrvdEnd) from
+  // 'profile' into 'sparseMetrics'
+  uint mDrvdBeg = sparseMetrics.mDrvdBegId();
+  uint mDrvdEnd = sparseMetrics.mDrvdEndId();
+
+  DIAG_Assert(sparseMetrics.numNodes() == cct.maxDenseId() + 1, "");
+  DIAG_Assert(sparseMetrics.numMetrics() == mDrvdEnd - mDrvdBeg, "");
+
+  // rows must be in node order; dense ids are preorder, but use the
+  // ids rather than rely on it
+  std::vector<Prof::CCT::ANode*> nodes(sparseMetrics.numNodes(), NULL);
+  for (Prof::CCT::ANodeIterator it(cct.root()); it.Current(); ++it) {
+    Prof::CCT::ANode* n = it.current();
+    nodes[n->id()] = n;
+  }
+
+  sparseMetrics.clear();
+
+  for (uint nodeId = 1; nodeId < nodes.size(); ++nodeId) {
+    Prof::CCT::ANode* n = nodes[nodeId];
+    if (!n || !n->hasMetrics(mDrvdBeg, mDrvdEnd)) {
+      continue;
+    }
+
+    uint mEnd = std::min(mDrvdEnd, n->numMetrics());
+
+    bool hasRow = false;
+    for (uint mId1 = 0, mId2 = mDrvdBeg; mId2 < mEnd; ++mId1, ++mId2) {
+      double mval = n->metric(mId2);
+
+      // N.B.: DBL_MIN is MinIncr's and MaxIncr's 'no value', which,
+      // like 0, their combine() ignores
+      if (mval == 0.0 || mval == DBL_MIN) {
+	continue;
+      }
+      if (!hasRow) {
+	sparseMetrics.addRow(nodeId);
+	hasRow = true;
+      }
+      sparseMetrics.addEntry(mId1, mval);
+    }
+  }
+}
+
+
+void
+unpackMetrics(Prof::CallPath::Profile& profile,
+	      const ParallelAnalysis::SparseMetrics& sparseMetrics)
+{
+  Prof::CCT::Tree& cct = *profile.cct();
+  const Prof::Metric::Mgr& mMgr = *profile.metricMgr();
+
+  uint mBegId = sparseMetrics.mBegId(), mEndId = sparseMetrics.mEndId();
+
+  DIAG_Assert(sparseMetrics.numNodes() == cct.maxDenseId() + 1, "");
+  DIAG_Assert(sparseMetrics.numMetrics() == mEndId - mBegId, "");
+
+  uint mDrvdBeg = sparseMetrics.mDrvdBegId();
+  uint mDrvdEnd = sparseMetrics.mDrvdEndId();
+
+  std::vector<const Prof::Metric::AExprIncr*> exprs;
+  for (uint mId = mDrvdBeg; mId < mDrvdEnd; ++mId) {
+    const Prof::Metric::DerivedIncrDesc* m =
+      dynamic_cast<const Prof::Metric::DerivedIncrDesc*>(mMgr.metric(mId));
+    if (m && m->expr()) {
+      exprs.push_back(m->expr());
+    }
+  }
+
+  // For each node with values: 1. unpack them into temporary derived
+  // metrics [mBegId, mEndId); 2. update derived metrics [mDrvdBeg,
+  // mDrvdEnd) based on them; 3. restore the temporaries to 0, which
+  // combine() ignores.  Nodes without values would be unchanged.
+  for (uint row = 0; row < sparseMetrics.numRows(); ++row) {
+    Prof::CCT::ANode* n = cct.findNode(sparseMetrics.nodeId(row));
+    DIAG_Assert(n, DIAG_UnexpectedInput);
+
+    uint beg = sparseMetrics.rowBeg(row), end = sparseMetrics.rowEnd(row);
+    for (uint i = beg; i < end; ++i) {
+      n->demandMetric(mBegId + sparseMetrics.col(i)) = sparseMetrics.val(i);
+    }
+
+    for (uint i = 0; i < exprs.size(); ++i) {
+      exprs[i]->combine(*n);
+    }
+
+    for (uint i = beg; i < end; ++i) {
+      n->metric(mBegId + sparseMetrics.col(i)) = 0.0;
+    }
+  }
+}
+
+
+//***************************************************************************
+// SparseMetrics
+//***************************************************************************
+
+// Layout (native byte order; ranks are homogeneous):
+//   uint32 numNodes, mBegId, mEndId, numRows, numEntries, (pad)
+//   double vals[numEntries]
+//   uint32 nodeIds[numRows], rowEnds[numRows], cols[numEntries]
+static const uint SparseMetrics_numHdr = 6;
+
+void
+SparseMetrics::pack(std::vector<uint8_t>& buf) const
+{
+  uint32_t hdr[SparseMetrics_numHdr] = {
+    m_numNodes, m_mBegId, m_mEndId, (uint32_t)m_nodeIds.size(),
+    (uint32_t)m_vals.size(), 0
+  };
+
+  size_t hdrSz = sizeof(hdr);
+  size_t valsSz = m_vals.size() * sizeof(double);
+  size_t rowsSz = m_nodeIds.size() * sizeof(uint32_t);
+  size_t colsSz = m_cols.size() * sizeof(uint32_t);
+
+  buf.resize(hdrSz + valsSz + 2 * rowsSz + colsSz);
+  uint8_t* p = &buf[0];
+
+  memcpy(p, hdr, hdrSz);                     p += hdrSz;
+  if (valsSz) { memcpy(p, &m_vals[0], valsSz);    p += valsSz; }
+  if (rowsSz) { memcpy(p, &m_nodeIds[0], rowsSz); p += rowsSz; }
+  if (rowsSz) { memcpy(p, &m_rowEnds[0], rowsSz); p += rowsSz; }
+  if (colsSz) { memcpy(p, &m_cols[0], colsSz); }
+}
+
+
+bool
+SparseMetrics::unpack(const uint8_t* buf, size_t bufSz)
+{
+  uint32_t hdr[SparseMetrics_numHdr];
+  if (bufSz < sizeof(hdr)) {
+    return false;
+  }
+  memcpy(hdr, buf, sizeof(hdr));
+
+  if (hdr[0] != m_numNodes || hdr[1] != m_mBegId || hdr[2] != m_mEndId) {
+    return false;
+  }
+
+  uint numRows = hdr[3], numEntries = hdr[4];
+
+  size_t valsSz = (size_t)numEntries * sizeof(double);
+  size_t rowsSz = (size_t)numRows * sizeof(uint32_t);
+  size_t colsSz = (size_t)numEntries * sizeof(uint32_t);
+  if (bufSz != sizeof(hdr) + valsSz + 2 * rowsSz + colsSz) {
+    return false;
+  }
+
+  m_vals.resize(numEntries);
+  m_nodeIds.resize(numRows);
+  m_rowEnds.resize(numRows);
+  m_cols.resize(numEntries);
+
+  const uint8_t* p = buf + sizeof(hdr);
+  if (valsSz) { memcpy(&m_vals[0], p, valsSz);    p += valsSz; }
+  if (rowsSz) { memcpy(&m_nodeIds[0], p, rowsSz); p += rowsSz; }
+  if (rowsSz) { memcpy(&m_rowEnds[0], p, rowsSz); p += rowsSz; }
+  if (colsSz) { memcpy(&m_cols[0], p, colsSz); }
+
+  return true;
+}
+
+
 //***************************************************************************
 
 } // namespace ParallelAnalysis
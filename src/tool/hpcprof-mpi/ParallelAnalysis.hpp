@@ -69,6 +69,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 
 #include <cstring> // for memset()
 
@@ -78,6 +79,8 @@
 
 #include <include/uint.h>
 
+#include <lib/analysis/CallPath.hpp>
+
 #include <lib/prof/CallPath-Profile.hpp>
 
 #include <lib/support/Unique.hpp>
@@ -190,6 +193,138 @@ private:
 
 };
 
+//***************************************************************************
+// SparseMetrics: a packable sparse matrix
+//***************************************************************************
+
+// SparseMetrics: Holds the non-zero values of metrics [mDrvdBegId,
+// mDrvdEndId) of a CCT in compressed-row form: the i-th row has node
+// id nodeId(i) and entries [rowBeg(i), rowEnd(i)), each of which is a
+// column (metric offset) and a value.  Rows are in increasing node
+// order.
+//
+// Unlike PackedMetrics, the memory and message size are proportional
+// to the number of values, not to the CCT size times the number of
+// metrics.  Zero is the identity of Metric::AExprIncr::combine(), so
+// values that are not stored need not be combined (cf. unpackMetrics).
+class SparseMetrics
+  : public Unique // prevent copying
+{
+public:
+  // [mBegId, mEndId)
+  SparseMetrics(uint numNodes, uint mBegId, uint mEndId,
+		uint mDrvdBegId, uint mDrvdEndId)
+    : m_numNodes(numNodes), m_numMetrics(mEndId - mBegId),
+      m_mBegId(mBegId), m_mEndId(mEndId),
+      m_mDrvdBegId(mDrvdBegId), m_mDrvdEndId(mDrvdEndId)
+  { }
+
+  ~SparseMetrics()
+  { }
+
+
+  void
+  clear()
+  {
+    m_nodeIds.clear();
+    m_rowEnds.clear();
+    m_cols.clear();
+    m_vals.clear();
+  }
+
+  // addRow: begin the row for 'nodeId', which must exceed that of the
+  //   previous row
+  void
+  addRow(uint nodeId)
+  {
+    m_nodeIds.push_back(nodeId);
+    m_rowEnds.push_back(m_vals.size());
+  }
+
+  // addEntry: add an entry to the current row
+  void
+  addEntry(uint col, double val)
+  {
+    m_cols.push_back(col);
+    m_vals.push_back(val);
+    m_rowEnds.back() = m_vals.size();
+  }
+
+
+  uint
+  numRows() const
+  { return m_nodeIds.size(); }
+
+  uint
+  nodeId(uint row) const
+  { return m_nodeIds[row]; }
+
+  uint
+  rowBeg(uint row) const
+  { return (row == 0) ? 0 : m_rowEnds[row - 1]; }
+
+  uint
+  rowEnd(uint row) const
+  { return m_rowEnds[row]; }
+
+  uint
+  col(uint i) const
+  { return m_cols[i]; }
+
+  double
+  val(uint i) const
+  { return m_vals[i]; }
+
+  
+  uint
+  numNodes() const
+  { return m_numNodes; }
+
+  uint
+  numMetrics() const
+  { return m_numMetrics; }
+
+
+  uint
+  mBegId() const
+  { return m_mBegId; }
+
+  uint
+  mEndId() const
+  { return m_mEndId; }
+
+
+  uint
+  mDrvdBegId() const
+  { return m_mDrvdBegId; }
+
+  uint
+  mDrvdEndId() const
+  { return m_mDrvdEndId; }
+
+
+  // pack: serialize into 'buf' (cf. unpack())
+  void
+  pack(std::vector<uint8_t>& buf) const;
+
+  // unpack: replace the rows with those serialized in 'buf'; returns
+  //   false if 'buf' was not packed from a corresponding matrix
+  bool
+  unpack(const uint8_t* buf, size_t bufSz);
+
+private:
+  uint m_numNodes;   // rows (of the corresponding dense matrix)
+  uint m_numMetrics; // columns
+  uint m_mBegId, m_mEndId; // [ )
+
+  uint m_mDrvdBegId, m_mDrvdEndId; // [ )
+
+  std::vector<uint32_t> m_nodeIds;
+  std::vector<uint32_t> m_rowEnds;
+  std::vector<uint32_t> m_cols;
+  std::vector<double>   m_vals;
+};
+
 } // namespace ParallelAnalysis
 
 
@@ -199,6 +334,13 @@ private:
 
 namespace ParallelAnalysis {
 
+// ------------------------------------------------------------------------
+// ChildNodeMaps: For each child in the reduction tree, the map of the
+// nodes of the profile it sent to those into which reduce() merged
+// them.  Lets broadcast() send a child only what it does not hold.
+// ------------------------------------------------------------------------
+typedef std::map<int, Prof::CallPath::Profile::WireNodeMap> ChildNodeMaps;
+
 // ------------------------------------------------------------------------
 // recvMerge: merge profile on rank_y into profile on rank_x
 // ------------------------------------------------------------------------
@@ -212,11 +354,20 @@ recvMerge(Prof::CallPath::Profile* profile,
 
 void
 packSend(std::pair<Prof::CallPath::Profile*,
-	                ParallelAnalysis::PackedMetrics*> data,
+	                ParallelAnalysis::ChildNodeMaps*> data,
 	 int dest, int myRank, MPI_Comm comm = MPI_COMM_WORLD);
 void
 recvMerge(std::pair<Prof::CallPath::Profile*,
-	  ParallelAnalysis::PackedMetrics*> data,
+	  ParallelAnalysis::ChildNodeMaps*> data,
+	  int src, int myRank, MPI_Comm comm = MPI_COMM_WORLD);
+
+void
+packSend(std::pair<Prof::CallPath::Profile*,
+	                ParallelAnalysis::SparseMetrics*> data,
+	 int dest, int myRank, MPI_Comm comm = MPI_COMM_WORLD);
+void
+recvMerge(std::pair<Prof::CallPath::Profile*,
+	  ParallelAnalysis::SparseMetrics*> data,
 	  int src, int myRank, MPI_Comm comm = MPI_COMM_WORLD);
 
 void
@@ -232,12 +383,14 @@ recvMerge(StringSet *stringSet,
 // 0-based ranks.
 // 
 // T: Prof::CallPath::Profile*
-// T: std::pair<Prof::CallPath::Profile*, ParallelAnalysis::PackedMetrics*>
+// T: std::pair<Prof::CallPath::Profile*, ParallelAnalysis::ChildNodeMaps*>
+// T: std::pair<Prof::CallPath::Profile*, ParallelAnalysis::SparseMetrics*>
 // ------------------------------------------------------------------------
 
 template<typename T>
 void
-reduce(T object, int myRank, int numRanks, MPI_Comm comm = MPI_COMM_WORLD)
+reduceChildren(T object, int myRank, int numRanks,
+	       MPI_Comm comm = MPI_COMM_WORLD)
 {
   int lchild = 2 * myRank + 1;
   if (lchild < numRanks) {
@@ -247,12 +400,155 @@ reduce(T object, int myRank, int numRanks, MPI_Comm comm = MPI_COMM_WORLD)
       recvMerge(object, rchild, myRank);
     }
   }
+}
+
+template<typename T>
+void
+sendParent(T object, int myRank, MPI_Comm comm = MPI_COMM_WORLD)
+{
   if (myRank > 0) {
     int parent = (myRank - 1) / 2;
     packSend(object, parent, myRank);
   }
 }
 
+// reduceChildren() and sendParent() are the two halves of reduce(),
+// for a rank that saves or restores its subtree's contribution in
+// between (cf. Checkpoint)
+template<typename T>
+void
+reduce(T object, int myRank, int numRanks, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  reduceChildren(object, myRank, numRanks, comm);
+  sendParent(object, myRank, comm);
+}
+
+
+// ------------------------------------------------------------------------
+// PipelinedReduce: reduce() with ChildNodeMaps for a rank that is still
+// reading its own files.  poll() merges the profile of each child that
+// has arrived without waiting for the others; finish() merges the rest
+// and sends the result to the parent.  Children are merged in the
+// order in which they arrive rather than left before right, so
+// metrics are sorted only for a single measurement group.
+// ------------------------------------------------------------------------
+class PipelinedReduce
+  : public Unique // prevent copying
+{
+public:
+  PipelinedReduce(ChildNodeMaps* childNodeMaps, int myRank, int numRanks,
+		  MPI_Comm comm = MPI_COMM_WORLD);
+  ~PipelinedReduce();
+
+  // poll: merge into 'profile' the profile of each child that has
+  // arrived; never blocks.  Returns the number of children merged.
+  uint
+  poll(Prof::CallPath::Profile* profile);
+
+  // finish: merge the remaining children's profiles into 'profile',
+  // then add the children's perf event statistics (after those of
+  // 'profile' have been finalized).  The caller then sends 'profile'
+  // to the parent (cf. sendParent()).
+  void
+  finish(Prof::CallPath::Profile* profile);
+
+private:
+  ChildNodeMaps* m_childNodeMaps;
+  std::vector<int> m_pending;                  // children not yet merged
+  std::vector<Prof::Metric::Mgr*> m_perfStats; // of the merged children
+  int m_myRank;
+  MPI_Comm m_comm;
+};
+
+
+// ------------------------------------------------------------------------
+// Checkpoint: Saves what a rank has read and reduced in a directory
+// shared by all ranks, one file per rank and stage, so that a run
+// restarted with the same input (cf. find()) resumes from it.
+//
+// A Stage_Read checkpoint holds the profile of a rank's own files; a
+// Stage_Reduce checkpoint, the profile it sends up the reduction
+// tree; a Stage_Summary checkpoint, the summary metrics it sends up
+// (cf. reduce()).  The latter two include the contributions of the
+// rank's subtree, so a rank whose ancestor holds one is 'covered':
+// it neither reads nor sends for that stage.  Profiles are saved in
+// their wire encoding (cf. Prof::CallPath::Profile::wire_pack()).
+//
+// Each checkpoint is written to a temporary file that is then renamed,
+// so a rank killed while writing leaves no partial checkpoint.
+// ------------------------------------------------------------------------
+class Checkpoint
+  : public Unique // prevent copying
+{
+public:
+  enum Stage {
+    Stage_Read,
+    Stage_Reduce,
+    Stage_Summary,
+    Stage_NUM
+  };
+
+  // Checkpoint: checkpoints in 'dir', which rank 0 creates; disabled
+  // if 'dir' is empty
+  Checkpoint(const std::string& dir, int myRank, int numRanks,
+	     MPI_Comm comm = MPI_COMM_WORLD);
+  ~Checkpoint();
+
+  bool
+  isEnabled() const
+  { return !m_dir.empty(); }
+
+  // find: Note which ranks hold a checkpoint of 'stage' for input
+  // 'inputId', a fingerprint of what the stage depends on.  Collective;
+  // later writes of 'stage' are tagged with 'inputId'.
+  void
+  find(Stage stage, uint64_t inputId);
+
+  // has: whether this rank holds a checkpoint of 'stage' (cf. find())
+  bool
+  has(Stage stage) const
+  { return m_holders[stage][m_myRank] != 0; }
+
+  // isCovered: whether a proper ancestor in the reduction tree holds a
+  // checkpoint of 'stage' (cf. find())
+  bool
+  isCovered(Stage stage) const;
+
+  // readProfile/writeProfile: the profile (with its directory set) of
+  // 'stage' (Stage_Read or Stage_Reduce)
+  Prof::CallPath::Profile*
+  readProfile(Stage stage) const;
+
+  void
+  writeProfile(Stage stage, Prof::CallPath::Profile& profile) const;
+
+  // readMetrics/writeMetrics: the summary metrics of Stage_Summary
+  void
+  readMetrics(SparseMetrics& sparseMetrics) const;
+
+  void
+  writeMetrics(const SparseMetrics& sparseMetrics) const;
+
+private:
+  std::string
+  fileName(Stage stage) const;
+
+  // read/write: the sections of the checkpoint of 'stage'
+  void
+  read(Stage stage, std::vector<std::vector<uint8_t> >& sections) const;
+
+  void
+  write(Stage stage, const std::vector<const uint8_t*>& sections,
+	const std::vector<size_t>& sectionSzs) const;
+
+  std::string m_dir;
+  int m_myRank, m_numRanks;
+  MPI_Comm m_comm;
+
+  uint64_t m_inputIds[Stage_NUM];
+  std::vector<char> m_holders[Stage_NUM]; // per rank
+};
+
 
 // ------------------------------------------------------------------------
 // broadcast: Broadcast the profile at the tree's root (rank 0) to every
@@ -265,6 +561,48 @@ void
 broadcast(StringSet &stringSet, int myRank,
 	  MPI_Comm comm = MPI_COMM_WORLD);
 
+// ------------------------------------------------------------------------
+// broadcast: Given 'profLcl', the profile each rank sent up the
+// reduction tree (cf. reduce() with ChildNodeMaps), send the canonical
+// profile at rank 0 back down the tree, each rank receiving it encoded
+// relative to its 'profLcl'.  Sets 'profGbl' to a new profile on ranks
+// other than 0; on rank 0, 'profGbl' is the canonical profile (and
+// 'profLcl' is unused).  Assumes 0-based ranks.
+// ------------------------------------------------------------------------
+void
+broadcast(Prof::CallPath::Profile*& profGbl,
+	  const Prof::CallPath::Profile* profLcl,
+	  ChildNodeMaps& childNodeMaps, int myRank, int numRanks,
+	  MPI_Comm comm = MPI_COMM_WORLD);
+
+// ------------------------------------------------------------------------
+// broadcast: Broadcast the node set 'nodeSet' (a 0/1 flag per node id)
+// at rank 0 to every other rank, run-length encoded.
+// ------------------------------------------------------------------------
+void
+broadcast(uint8_t* nodeSet, uint nodeSetSz, int myRank,
+	  MPI_Comm comm = MPI_COMM_WORLD);
+
+// ------------------------------------------------------------------------
+// allgather: Add to 'lmCaches' on every rank the load modules that
+// other ranks have read (cf. Analysis::CallPath::readStructureSimple()).
+// Each load module should be read by only one rank.
+// ------------------------------------------------------------------------
+void
+allgather(Analysis::CallPath::LMSimpleCaches& lmCaches, int myRank,
+	  int numRanks, MPI_Comm comm = MPI_COMM_WORLD);
+
+// ------------------------------------------------------------------------
+// bytesSent/bytesReceived: the bytes of profiles, metrics and other
+// data that this rank has sent and received with the functions above.
+// A broadcast counts as sent by rank 0 and received by the others.
+// ------------------------------------------------------------------------
+uint64_t
+bytesSent();
+
+uint64_t
+bytesReceived();
+
 // ------------------------------------------------------------------------
 // pack/unpack a profile to/from a buffer
 // ------------------------------------------------------------------------
@@ -292,6 +630,18 @@ void
 unpackMetrics(Prof::CallPath::Profile& profile,
 	      const ParallelAnalysis::PackedMetrics& packedMetrics);
 
+// packMetrics: pack the non-zero metric values from 'profile' into
+// 'sparseMetrics'
+void
+packMetrics(const Prof::CallPath::Profile& profile,
+	    ParallelAnalysis::SparseMetrics& sparseMetrics);
+
+// unpackMetrics: apply the metric update in 'sparseMetrics' to
+// 'profile', visiting only the nodes that have values
+void
+unpackMetrics(Prof::CallPath::Profile& profile,
+	      const ParallelAnalysis::SparseMetrics& sparseMetrics);
+
 } // namespace ParallelAnalysis
 
 
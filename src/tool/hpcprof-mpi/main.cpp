@@ -68,11 +68,16 @@
 #include <typeinfo>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 
 #include <string>
 using std::string;
 
 #include <vector>
+#include <queue>
+#include <functional> // std::greater
+#include <algorithm> // std::min(), std::stable_sort()
 using std::vector;
 
 #include <cstdlib> // getenv()
@@ -83,14 +88,18 @@ using std::vector;
 
 //*************************** User Include Files ****************************
 
+#include <include/hpctoolkit-config.h>
 #include <include/uint.h>
 
 #include "Args.hpp"
 #include "ParallelAnalysis.hpp"
 
 #include <lib/analysis/CallPath.hpp>
+#include <lib/analysis/PhaseTimer.hpp>
 #include <lib/analysis/Util.hpp>
 
+#include <lib/banal/StructSimpleCache.hpp>
+
 #include <lib/binutils/VMAInterval.hpp>
 #include <lib/prof/FileError.hpp>
 
@@ -102,6 +111,9 @@ using std::vector;
 #include <lib/support/RealPathMgr.hpp>
 #include <lib/support/StrUtil.hpp>
 
+#ifdef ENABLE_OPENMP
+#include <omp.h>
+#endif
 
 //*************************** Forward Declarations ***************************
 
@@ -111,7 +123,50 @@ realmain(int argc, char* const* argv);
 static Analysis::Util::NormalizeProfileArgs_t
 myNormalizeProfileArgs(const Analysis::Util::StringVec& profileFiles,
 		       vector<uint>& groupIdToGroupSizeMap,
-		       int myRank, int numRanks);
+		       bool& doQueue, int myRank, int numRanks);
+
+static void
+assignFilesBySize(vector<vector<uint> >& rankToFiles,
+		  const Analysis::Util::StringVec& files, bool isContiguous);
+
+static uint
+numWorkerThreads(const Analysis::Args& args, int mpiThreadLvl, int myRank);
+
+static vector<Prof::LoadMap::LMId_t>
+assignLoadModules(const Prof::CallPath::Profile& prof,
+		  int myRank, int numRanks);
+
+static Prof::CallPath::Profile*
+readProfiles(Analysis::Util::NormalizeProfileArgs_t& nArgs,
+	     int mergeTy, uint rFlags, uint numWorkers,
+	     ParallelAnalysis::PipelinedReduce* pipelinedReduce);
+
+static Prof::CallPath::Profile*
+readProfileQueue(Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		 int mergeTy, uint rFlags, int myRank, int numRanks,
+		 uint numWorkers);
+
+static void
+readProfileInto(Prof::CallPath::Profile*& prof, const string& fnm,
+		uint groupId, int mergeTy, uint rFlags);
+
+static Prof::CallPath::Profile*
+mergeWorkerProfiles(vector<Prof::CallPath::Profile*>& profs,
+		    int mergeTy, uint rFlags, uint numWorkers);
+
+static void
+reportLoadBalance(const Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		  int myRank, int numRanks);
+
+static void
+writePhaseTimes(const string& fnm, int myRank, int numRanks);
+
+static uint64_t
+fingerprintInput(const Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		 int myRank, int numRanks);
+
+static uint64_t
+fingerprintCCT(const Prof::CallPath::Profile& profGbl, uint64_t inputId);
 
 
 static void
@@ -119,14 +174,15 @@ makeSummaryMetrics(Prof::CallPath::Profile& profGbl,
 		   const Analysis::Args& args,
 		   const Analysis::Util::NormalizeProfileArgs_t& nArgs,
 		   const vector<uint>& groupIdToGroupSizeMap,
-		   int myRank, int numRanks);
+		   int myRank, int numRanks, uint numWorkers,
+		   ParallelAnalysis::Checkpoint& checkpoint, uint64_t inputId);
 
 static void
 makeThreadMetrics(Prof::CallPath::Profile& profGbl,
 		  const Analysis::Args& args,
 		  const Analysis::Util::NormalizeProfileArgs_t& nArgs,
 		  const vector<uint>& groupIdToGroupSizeMap,
-		  int myRank, int numRanks);
+		  int myRank, int numRanks, uint numWorkers);
 
 static uint
 makeDerivedMetricDescs(Prof::CallPath::Profile& profGbl,
@@ -137,25 +193,61 @@ makeDerivedMetricDescs(Prof::CallPath::Profile& profGbl,
 		       const vector<uint>& groupIdToGroupSizeMap,
 		       int myRank);
 
+static void
+prepareStructure(const Prof::Struct::Tree& structure);
+
+static Prof::CallPath::Profile*
+readProfile_Lcl(Prof::CallPath::Profile& profGbl, const string& profileFile,
+		uint groupId, uint groupMax);
+
 static void
 makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
-		       const string& profileFile,
-		       const Analysis::Args& args, uint groupId, uint groupMax,
+		       Prof::CallPath::Profile& prof,
+		       uint groupId,
 		       vector<VMAIntervalSet*>& groupIdToGroupMetricsMap,
 		       int myRank);
 
+// SharedMetricDB: the file to which all ranks write the thread-level
+// metric databases (cf. --metric-db shared).  Each rank's index
+// entries are collected and written by rank 0 when the file is closed.
+struct SharedMetricDB {
+  MPI_File fh;
+  MPI_Datatype real8Ty;
+  string fnm;
+  uint64_t dataEnd;  // end of the dbs written by all ranks so far
+  uint64_t numDBs;   // number of dbs written by this rank
+  vector<unsigned char> index; // this rank's encoded index entries
+};
+
 static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
+		      Prof::CallPath::Profile& prof,
 		      const string& profileFile,
-		      const Analysis::Args& args, uint groupId, uint groupMax,
-		      int myRank);
+		      const Analysis::Args& args, uint groupId,
+		      SharedMetricDB* sharedDB, int myRank);
 
 static string
 makeDBFileName(const string& dbDir, uint groupId, const string& profileFile);
 
 static void
 writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm);
+	       const string& metricDBFnm, const Analysis::Args& args,
+	       SharedMetricDB* sharedDB);
+
+static SharedMetricDB*
+openSharedMetricDB(const string& fnm);
+
+static void
+writeSharedMetricDB(SharedMetricDB& sharedDB, const unsigned char* buf,
+		    uint64_t len, const string& metricDBFnm);
+
+static void
+closeSharedMetricDB(SharedMetricDB* sharedDB, uint numNodes, int myRank,
+		    int numRanks);
+
+static int
+writeMetricsDBSparse(const ParallelAnalysis::PackedMetrics& packedMetrics,
+		     uint numNodes, uint numMetrics, bool doNodeIdx, FILE* fs);
 
 
 static void
@@ -246,12 +338,22 @@ realmain(int argc, char* const* argv)
   // -------------------------------------------------------
   // 0. MPI initialize
   // -------------------------------------------------------
-  MPI_Init(&argc, (char***)&argv);
+
+  // N.B.: Worker threads make MPI calls, but only one at a time.
+  int mpiThreadLvl = MPI_THREAD_SINGLE;
+  MPI_Init_thread(&argc, (char***)&argv, MPI_THREAD_SERIALIZED,
+		  &mpiThreadLvl);
 
   int myRank, numRanks;
   MPI_Comm_rank(MPI_COMM_WORLD, &myRank); 
   MPI_Comm_size(MPI_COMM_WORLD, &numRanks);
 
+  uint numWorkers = numWorkerThreads(args, mpiThreadLvl, myRank);
+  Prof::CCT::Tree::numThreads(numWorkers);
+
+  Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+  timer.start("total");
+
   // -------------------------------------------------------
   // 0. Debugging hook
   // -------------------------------------------------------
@@ -291,9 +393,11 @@ realmain(int argc, char* const* argv)
 
   vector<uint> groupIdToGroupSizeMap; // only initialized for rank 0
 
+  bool doQueue = (args.prof_distribute == Analysis::Args::Distribute_Queue);
+
   Analysis::Util::NormalizeProfileArgs_t nArgs =
     myNormalizeProfileArgs(args.profileFiles, groupIdToGroupSizeMap,
-			   myRank, numRanks);
+			   doQueue, myRank, numRanks);
 
   if (nArgs.paths->size() == 0 && myRank == 0) {
     std::cerr << "ERROR: command line directories"
@@ -305,10 +409,69 @@ realmain(int argc, char* const* argv)
   uint rFlags = (Prof::CallPath::Profile::RFlg_VirtualMetrics
 		 | Prof::CallPath::Profile::RFlg_NoMetricSfx
 		 | Prof::CallPath::Profile::RFlg_MakeInclExcl);
-  Analysis::Util::UIntVec* groupMap =
-    (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
 
-  profLcl = Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags);
+  // N.B.: children's profiles merged as they arrive would not keep the
+  // metrics of several measurement groups sorted (cf. PipelinedReduce)
+  bool doPipeline = (args.prof_pipeline && !doQueue && nArgs.groupMax <= 1);
+  if (args.prof_pipeline && !doPipeline && myRank == 0) {
+    DIAG_WMsgIf(1, "--pipeline requires a single measurement group and '--distribute size'; not pipelining");
+  }
+
+  ParallelAnalysis::ChildNodeMaps childNodeMaps;
+  ParallelAnalysis::PipelinedReduce pipelinedReduce(&childNodeMaps,
+						    myRank, numRanks);
+
+  // A restarted run resumes from the checkpoints of the same input.
+  // N.B.: With '--distribute queue', which files a process reads varies
+  // from run to run.  Rank 0 keeps no profile checkpoints: its profile
+  // seeds the canonical one, including metric descriptors that the
+  // wire encoding does not keep.
+  string checkpointDir = args.prof_checkpointDir;
+  if (!checkpointDir.empty() && doQueue) {
+    if (myRank == 0) {
+      DIAG_WMsgIf(1, "--checkpoint requires '--distribute size'; not checkpointing");
+    }
+    checkpointDir = "";
+  }
+
+  ParallelAnalysis::Checkpoint checkpoint(checkpointDir, myRank, numRanks);
+  uint64_t inputId = 0;
+  if (checkpoint.isEnabled()) {
+    inputId = fingerprintInput(nArgs, myRank, numRanks);
+  }
+  checkpoint.find(ParallelAnalysis::Checkpoint::Stage_Read, inputId);
+  checkpoint.find(ParallelAnalysis::Checkpoint::Stage_Reduce, inputId);
+
+  // N.B.: an ancestor's checkpoint includes this rank's profile
+  bool isReduceCovered =
+    checkpoint.isCovered(ParallelAnalysis::Checkpoint::Stage_Reduce);
+  bool isReduceRestored = (!isReduceCovered &&
+    checkpoint.has(ParallelAnalysis::Checkpoint::Stage_Reduce));
+
+  if (isReduceCovered) {
+    profLcl = Prof::CallPath::Profile::make(rFlags);
+  }
+  else if (isReduceRestored) {
+    profLcl =
+      checkpoint.readProfile(ParallelAnalysis::Checkpoint::Stage_Reduce);
+  }
+  else if (checkpoint.has(ParallelAnalysis::Checkpoint::Stage_Read)) {
+    profLcl = checkpoint.readProfile(ParallelAnalysis::Checkpoint::Stage_Read);
+  }
+  else if (doQueue) {
+    profLcl = readProfileQueue(nArgs, mergeTy, rFlags, myRank, numRanks,
+			       numWorkers);
+  }
+  else {
+    profLcl = readProfiles(nArgs, mergeTy, rFlags, numWorkers,
+			   (doPipeline) ? &pipelinedReduce : NULL);
+
+    // N.B.: a pipelined profile already holds some of the children's
+    if (!doPipeline && myRank > 0) {
+      checkpoint.writeProfile(ParallelAnalysis::Checkpoint::Stage_Read,
+			      *profLcl);
+    }
+  }
 
   // -------------------------------------------------------
   // 1b. Create canonical CCT (metrics merged by <group>.<name>.*)
@@ -316,24 +479,57 @@ realmain(int argc, char* const* argv)
   Prof::CallPath::Profile* profGbl = NULL;
 
   // Post-INVARIANT: rank 0's 'profLcl' is the canonical CCT.  Metrics
-  // are merged (and sorted by always merging left-child before right)
-  ParallelAnalysis::reduce(profLcl, myRank, numRanks);
+  // are merged (and sorted by always merging left-child before right,
+  // unless pipelining, which requires a single measurement group)
+  //
+  // A restored rank's children are covered and send nothing; the
+  // canonical profile is then broadcast to them in full.
+  timer.start("reduce");
+  if (!isReduceCovered) {
+    if (!isReduceRestored) {
+      if (doPipeline) {
+	pipelinedReduce.finish(profLcl);
+      }
+      else {
+	ParallelAnalysis::reduceChildren(std::make_pair(profLcl,
+							&childNodeMaps),
+					 myRank, numRanks);
+      }
+      ParallelAnalysis::reduceChildren(&profLcl->directorySet(),
+				       myRank, numRanks);
 
-  ParallelAnalysis::reduce(&profLcl->directorySet(), myRank, numRanks);
+      if (myRank > 0) {
+	checkpoint.writeProfile(ParallelAnalysis::Checkpoint::Stage_Reduce,
+				*profLcl);
+      }
+    }
+
+    ParallelAnalysis::sendParent(std::make_pair(profLcl, &childNodeMaps),
+				 myRank);
+    ParallelAnalysis::sendParent(&profLcl->directorySet(), myRank);
+  }
+  timer.stop("reduce");
+
+  reportLoadBalance(nArgs, myRank, numRanks);
 
   if (myRank == 0) {
     profGbl = profLcl;
     profLcl = NULL;
   }
 
-  // Post-INVARIANT: 'profGbl' is the canonical CCT
-  ParallelAnalysis::broadcast(profGbl, myRank);
+  // Post-INVARIANT: 'profGbl' is the canonical CCT.  N.B.: Each rank
+  // receives only what the profile it reduced lacks.
+  timer.start("broadcast");
+  ParallelAnalysis::broadcast(profGbl, profLcl, childNodeMaps,
+			      myRank, numRanks);
+  childNodeMaps.clear();
 
   if (myRank == 0) {
     profGbl->metricMgr()->mergePerfEventStatistics_finalize(numRanks - 1);
   }
 
   ParallelAnalysis::broadcast(profGbl->directorySet(), myRank);
+  timer.stop("broadcast");
 
   delete profLcl;
 
@@ -344,35 +540,58 @@ realmain(int argc, char* const* argv)
   // ids; corresponding nodes have idential ids.
   // -------------------------------------------------------
 
+  timer.start("overlay");
   Prof::Struct::Tree* structure = new Prof::Struct::Tree("");
   if (!args.structureFiles.empty()) {
-    Analysis::CallPath::readStructure(structure, args);
+    Analysis::CallPath::readStructure(structure, args, profGbl->loadmap());
   }
   profGbl->structure(structure);
 
 
+  // Each rank reads only its share of the load modules without
+  // structure files and receives what the others read.
+  Analysis::CallPath::LMSimpleCaches lmCaches;
+  if (numRanks > 1) {
+    vector<Prof::LoadMap::LMId_t> myLMs =
+      assignLoadModules(*profGbl, myRank, numRanks);
+    Analysis::CallPath::readStructureSimple(*profGbl, myLMs,
+					    args.lmCacheDir, lmCaches);
+    ParallelAnalysis::allgather(lmCaches, myRank, numRanks);
+  }
+
   // N.B.: Ensures that each rank adds static structure in the same
   // order so that new corresponding nodes have identical node ids.
   bool printProgress =  (myRank == 0);
   Analysis::CallPath::overlayStaticStructureMain(*profGbl, args.agent,
 						 args.doNormalizeTy,
-                                                 printProgress);
+                                                 printProgress,
+						 args.lmCacheDir, &lmCaches);
+
+  for (Analysis::CallPath::LMSimpleCaches::iterator it = lmCaches.begin();
+       it != lmCaches.end(); ++it) {
+    delete it->second;
+  }
+  lmCaches.clear();
 
   // N.B.: Dense ids are assigned w.r.t. Prof::CCT::...::cmpByStructureInfo()
   profGbl->cct()->makeDensePreorderIds();
+  timer.stop("overlay");
 
   // -------------------------------------------------------
   // 2a. Create summary metrics for canonical CCT
   //
   // Post-INVARIANT: rank 0's 'profGbl' contains summary metrics
   // -------------------------------------------------------
+  timer.start("summary");
   makeSummaryMetrics(*profGbl, args, nArgs, groupIdToGroupSizeMap,
-		     myRank, numRanks);
+		     myRank, numRanks, numWorkers, checkpoint, inputId);
+  timer.stop("summary");
 
   // -------------------------------------------------------
   // 2b. Prune and normalize canonical CCT
   // -------------------------------------------------------
 
+  timer.start("prune");
   uint prunedNodesSz = profGbl->cct()->maxDenseId() + 1;
   uint8_t* prunedNodes = new uint8_t[prunedNodesSz];
   memset(prunedNodes, 0, prunedNodesSz * sizeof(uint8_t));
@@ -386,7 +605,7 @@ realmain(int argc, char* const* argv)
     }
   }
   
-  MPI_Bcast(prunedNodes, prunedNodesSz, MPI_BYTE, 0, MPI_COMM_WORLD);
+  ParallelAnalysis::broadcast(prunedNodes, prunedNodesSz, myRank);
 
   if (myRank != 0) {
     profGbl->cct()->pruneCCTByNodeId(prunedNodes);
@@ -402,18 +621,22 @@ realmain(int argc, char* const* argv)
 
   // N.B.: Dense ids are assigned w.r.t. Prof::CCT::...::cmpByStructureInfo()
   profGbl->cct()->makeDensePreorderIds();
+  timer.stop("prune");
 
   // -------------------------------------------------------
   // 2c. Create thread-level metric DB // Normalize trace files
   // -------------------------------------------------------
+  timer.start("thread");
   makeThreadMetrics(*profGbl, args, nArgs, groupIdToGroupSizeMap,
-		    myRank, numRanks);
+		    myRank, numRanks, numWorkers);
+  timer.stop("thread");
   
   // ------------------------------------------------------------
   // 3. Generate Experiment database
   //    INVARIANT: database dir already exists
   // ------------------------------------------------------------
 
+  timer.start("write");
   Analysis::CallPath::pruneStructTree(*profGbl);
 
   if (myRank == 0) {
@@ -430,6 +653,7 @@ realmain(int argc, char* const* argv)
   else {
     Analysis::Util::copyTraceFiles(args.db_dir, profGbl->traceFileNameSet());
   }
+  timer.stop("write");
 
   // -------------------------------------------------------
   // Cleanup/MPI finalize
@@ -438,6 +662,11 @@ realmain(int argc, char* const* argv)
 
   delete profGbl;
 
+  timer.stop("total");
+  if (!args.out_phaseTimes.empty()) {
+    writePhaseTimes(args.out_phaseTimes, myRank, numRanks);
+  }
+
   MPI_Finalize();
 
   return 0;
@@ -447,18 +676,24 @@ realmain(int argc, char* const* argv)
 //****************************************************************************
 
 // myNormalizeProfileArgs: creates canonical list of profiles files and
-//   distributes chunks of size ceil(numFiles / numRanks) to each process.
-//   The last process may have a smaller chunk than the others.
+//   distributes it across all processes so that each reads about the
+//   same number of bytes (cf. assignFilesBySize()).  Each process
+//   receives its files in canonical order.
+//
+//   If 'doQueue' is true on entry and there is a single measurement
+//   group, rank 0 receives the whole list and other processes none:
+//   they fetch files from rank 0 as they go (cf. readProfileQueue()).
+//   On exit, 'doQueue' tells whether this is the case.
 static Analysis::Util::NormalizeProfileArgs_t
 myNormalizeProfileArgs(const Analysis::Util::StringVec& profileFiles,
 		       vector<uint>& groupIdToGroupSizeMap,
-		       int myRank, int numRanks)
+		       bool& doQueue, int myRank, int numRanks)
 {
   Analysis::Util::NormalizeProfileArgs_t out;
 
   char* sendFilesBuf = NULL;
-  uint sendFilesBufSz = 0;
-  uint sendFilesChunkSz = 0;
+  int* sendFilesCnts = NULL;  // bytes to each rank
+  int* sendFilesDispls = NULL;
   const uint groupIdLen = 1; // see asssertion below
   uint pathLenMax = 0;
   uint groupIdMax = 0;
@@ -477,27 +712,47 @@ myNormalizeProfileArgs(const Analysis::Util::StringVec& profileFiles,
 
     DIAG_Assert(nArgs.groupMax <= UCHAR_MAX, "myNormalizeProfileArgs: 'groupMax' cannot be packed into a uchar!");
 
-    uint chunkSz = (uint)
-      ceil( (double)canonicalFiles->size() / (double)numRanks);
-    
-    sendFilesChunkSz = chunkSz * (groupIdLen + pathLenMax + 1);
-    sendFilesBufSz = sendFilesChunkSz * numRanks;
-    sendFilesBuf = new char[sendFilesBufSz];
-    memset(sendFilesBuf, '\0', sendFilesBufSz);
-
     groupIdToGroupSizeMap.resize(groupIdMax + 1);
-    
-    for (uint i = 0, j = 0; i < canonicalFiles->size(); 
-	 i++, j += (groupIdLen + pathLenMax + 1)) {
-      const std::string& nm = (*canonicalFiles)[i];
-      uint groupId = (*nArgs.groupMap)[i];
+    for (uint i = 0; i < canonicalFiles->size(); ++i) {
+      groupIdToGroupSizeMap[(*nArgs.groupMap)[i]]++;
+    }
+
+    if (doQueue && groupIdMax > 1) {
+      DIAG_WMsgIf(1, "--distribute queue requires a single measurement group; distributing by size");
+    }
+    doQueue = (doQueue && groupIdMax <= 1 && numRanks > 1);
 
-      groupIdToGroupSizeMap[groupId]++;
+    vector<vector<uint> > rankToFiles(numRanks);
+    if (doQueue) {
+      rankToFiles[0].resize(canonicalFiles->size());
+      for (uint i = 0; i < canonicalFiles->size(); ++i) {
+	rankToFiles[0][i] = i;
+      }
+    }
+    else {
+      assignFilesBySize(rankToFiles, *canonicalFiles, (groupIdMax > 1));
+    }
 
-      // pack into sendFilesBuf
-      sendFilesBuf[j] = (char)groupId;
-      strncpy(&(sendFilesBuf[j + groupIdLen]), nm.c_str(), pathLenMax);
-      sendFilesBuf[j + groupIdLen + pathLenMax] = '\0';
+    const uint recSz = groupIdLen + pathLenMax + 1;
+    sendFilesBuf = new char[canonicalFiles->size() * recSz];
+    memset(sendFilesBuf, '\0', canonicalFiles->size() * recSz);
+    sendFilesCnts = new int[numRanks];
+    sendFilesDispls = new int[numRanks];
+
+    for (int rank = 0, j = 0; rank < numRanks; ++rank) {
+      sendFilesDispls[rank] = j;
+      sendFilesCnts[rank] = rankToFiles[rank].size() * recSz;
+
+      for (uint k = 0; k < rankToFiles[rank].size(); ++k, j += recSz) {
+	uint i = rankToFiles[rank][k];
+	const std::string& nm = (*canonicalFiles)[i];
+	uint groupId = (*nArgs.groupMap)[i];
+
+	// pack into sendFilesBuf
+	sendFilesBuf[j] = (char)groupId;
+	strncpy(&(sendFilesBuf[j + groupIdLen]), nm.c_str(), pathLenMax);
+	sendFilesBuf[j + groupIdLen + pathLenMax] = '\0';
+      }
     }
 
     nArgs.destroy();
@@ -509,35 +764,40 @@ myNormalizeProfileArgs(const Analysis::Util::StringVec& profileFiles,
   
   const uint metadataBufSz = 3;
   uint metadataBuf[metadataBufSz];
-  metadataBuf[0] = sendFilesChunkSz;
-  metadataBuf[1] = pathLenMax;
-  metadataBuf[2] = groupIdMax;
+  metadataBuf[0] = pathLenMax;
+  metadataBuf[1] = groupIdMax;
+  metadataBuf[2] = doQueue;
 
   MPI_Bcast((void*)metadataBuf, metadataBufSz, MPI_UNSIGNED,
 	    0, MPI_COMM_WORLD);
 
   if (myRank != 0) {
-    sendFilesChunkSz = metadataBuf[0];
-    pathLenMax       = metadataBuf[1];
-    groupIdMax       = metadataBuf[2];
+    pathLenMax = metadataBuf[0];
+    groupIdMax = metadataBuf[1];
+    doQueue    = metadataBuf[2];
   }
 
   // -------------------------------------------------------
-  // evenly distribute profile files across all processes
+  // distribute profile files across all processes
   // -------------------------------------------------------
 
-  uint recvFilesChunkSz = sendFilesChunkSz;
-  const char* recvFilesBuf = new char[recvFilesChunkSz];
-  
-  MPI_Scatter((void*)sendFilesBuf, sendFilesChunkSz, MPI_CHAR,
-	      (void*)recvFilesBuf, recvFilesChunkSz, MPI_CHAR,
-	      0, MPI_COMM_WORLD);
+  int recvFilesSz = 0;
+  MPI_Scatter((void*)sendFilesCnts, 1, MPI_INT,
+	      (void*)&recvFilesSz, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  char* recvFilesBuf = new char[recvFilesSz + 1];
+
+  MPI_Scatterv((void*)sendFilesBuf, sendFilesCnts, sendFilesDispls, MPI_CHAR,
+	       (void*)recvFilesBuf, recvFilesSz, MPI_CHAR,
+	       0, MPI_COMM_WORLD);
   
   delete[] sendFilesBuf;
+  delete[] sendFilesCnts;
+  delete[] sendFilesDispls;
 
 
-  for (uint i = 0; i < recvFilesChunkSz; i += (groupIdLen + pathLenMax + 1)) {
-    uint groupId = recvFilesBuf[i];
+  for (int i = 0; i < recvFilesSz; i += (groupIdLen + pathLenMax + 1)) {
+    uint groupId = (unsigned char)recvFilesBuf[i];
     const char* nm_cstr = &recvFilesBuf[i + groupIdLen];
     string nm = nm_cstr;
     if (!nm.empty()) {
@@ -562,6 +822,691 @@ myNormalizeProfileArgs(const Analysis::Util::StringVec& profileFiles,
 }
 
 
+static uint64_t
+fileSize(const string& fnm)
+{
+  struct stat st;
+  if (stat(fnm.c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_size;
+}
+
+
+// assignFilesBySize: fill 'rankToFiles' with the indices of the
+//   'files' that each rank reads, in ascending order, such that the
+//   total size per rank is about even.
+//
+//   If 'isContiguous', each rank receives a contiguous run of
+//   'files'.  This keeps measurement groups in sorted order across
+//   ranks, which the reduction requires (cf. Metric::Mgr::findGroup()).
+//   Otherwise, files are assigned largest first to the rank with the
+//   fewest bytes, which balances better when a few files dominate.
+static void
+assignFilesBySize(vector<vector<uint> >& rankToFiles,
+		  const Analysis::Util::StringVec& files, bool isContiguous)
+{
+  const uint numRanks = rankToFiles.size();
+
+  // N.B.: count each file as at least one byte so that empty files
+  // are spread out as well
+  vector<uint64_t> sizes(files.size());
+  uint64_t total = 0;
+  for (uint i = 0; i < files.size(); ++i) {
+    sizes[i] = fileSize(files[i]) + 1;
+    total += sizes[i];
+  }
+
+  if (isContiguous) {
+    // rank r's run ends at the file whose midpoint last falls within
+    // the first (r + 1)/numRanks of the total size
+    uint i = 0;
+    uint64_t sum = 0;
+    for (uint rank = 0; rank < numRanks; ++rank) {
+      double target = (double)total * (rank + 1) / numRanks;
+      while (i < files.size()
+	     && (rank == numRanks - 1 || sum + sizes[i] / 2.0 <= target)) {
+	sum += sizes[i];
+	rankToFiles[rank].push_back(i++);
+      }
+    }
+  }
+  else {
+    vector<uint> order(files.size());
+    for (uint i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+		     [&sizes](uint a, uint b) { return sizes[a] > sizes[b]; });
+
+    // min-heap of (bytes, rank)
+    typedef std::pair<uint64_t, uint> RankLoad;
+    std::priority_queue<RankLoad, vector<RankLoad>,
+			std::greater<RankLoad> > loads;
+    for (uint rank = 0; rank < numRanks; ++rank) {
+      loads.push(RankLoad(0, rank));
+    }
+
+    for (uint k = 0; k < order.size(); ++k) {
+      RankLoad ld = loads.top();
+      loads.pop();
+      rankToFiles[ld.second].push_back(order[k]);
+      ld.first += sizes[order[k]];
+      loads.push(ld);
+    }
+
+    for (uint rank = 0; rank < numRanks; ++rank) {
+      std::sort(rankToFiles[rank].begin(), rankToFiles[rank].end());
+    }
+  }
+}
+
+
+// numWorkerThreads: the number of worker threads with which each
+//   process reads profiles and makes metrics (cf. --threads).  Worker
+//   threads take turns making MPI calls.
+static uint
+numWorkerThreads(const Analysis::Args& args, int mpiThreadLvl, int myRank)
+{
+  uint numWorkers = args.prof_numThreads;
+
+#ifndef ENABLE_OPENMP
+  if (numWorkers > 1) {
+    DIAG_WMsgIf(myRank == 0, "--threads: built without OpenMP; using one thread per process");
+    numWorkers = 1;
+  }
+#endif
+
+  if (numWorkers > 1 && mpiThreadLvl < MPI_THREAD_SERIALIZED) {
+    DIAG_WMsgIf(myRank == 0, "--threads: MPI does not support MPI_THREAD_SERIALIZED; using one thread per process");
+    numWorkers = 1;
+  }
+
+  return numWorkers;
+}
+
+
+// assignLoadModules: rank 0 assigns the load modules of 'prof' that
+//   have no structure file to ranks, largest binary first to the rank
+//   with the fewest bytes (cf. assignFilesBySize()), and tells each
+//   rank which ones it reads.  Ranks agree on the assignment even if
+//   they see different file sizes.
+static vector<Prof::LoadMap::LMId_t>
+assignLoadModules(const Prof::CallPath::Profile& prof,
+		  int myRank, int numRanks)
+{
+  const Prof::LoadMap* loadmap = prof.loadmap();
+  vector<int> lmToRank(loadmap->size() + 1, -1);
+
+  if (myRank == 0) {
+    const Prof::Struct::Root* rootStrct = prof.structure()->root();
+
+    vector<Prof::LoadMap::LMId_t> lmIds;
+    Analysis::Util::StringVec lmNames;
+    for (Prof::LoadMap::LMId_t i = Prof::LoadMap::LMId_NULL + 1;
+	 i <= loadmap->size(); ++i) {
+      const Prof::LoadMap::LM* lm = loadmap->lm(i);
+      const Prof::Struct::LM* lmStrct = rootStrct->findLM(lm->name());
+      if (lm->isUsed() && !(lmStrct && lmStrct->childCount() > 0)) {
+	lmIds.push_back(i);
+	lmNames.push_back(lm->name());
+      }
+    }
+
+    vector<vector<uint> > rankToLMs(numRanks);
+    assignFilesBySize(rankToLMs, lmNames, false/*isContiguous*/);
+    for (int rank = 0; rank < numRanks; ++rank) {
+      for (uint k = 0; k < rankToLMs[rank].size(); ++k) {
+	lmToRank[lmIds[rankToLMs[rank][k]]] = rank;
+      }
+    }
+  }
+
+  MPI_Bcast(&lmToRank[0], lmToRank.size(), MPI_INT, 0, MPI_COMM_WORLD);
+
+  vector<Prof::LoadMap::LMId_t> myLMs;
+  for (uint i = 0; i < lmToRank.size(); ++i) {
+    if (lmToRank[i] == myRank) {
+      myLMs.push_back(i);
+    }
+  }
+  return myLMs;
+}
+
+
+// abortWorker: an exception may not leave a worker thread's parallel
+//   region; report it and abort all processes instead.
+static void
+abortWorker(const string& msg)
+{
+  DIAG_EMsg(msg);
+  prof_abort(1);
+}
+
+
+// readProfiles: read and merge the files in 'nArgs'.  With several
+//   worker threads, each reads a contiguous run of the files (of about
+//   equal size) into its own profile; merging the runs left to right
+//   gives the same metric order as reading the files one by one.
+//
+//   If 'pipelinedReduce' is given, the first worker merges the profiles
+//   of this process's children in the reduction tree into its own
+//   after each file, as they arrive; their perf event statistics are
+//   left for PipelinedReduce::finish().
+static Prof::CallPath::Profile*
+readProfiles(Analysis::Util::NormalizeProfileArgs_t& nArgs,
+	     int mergeTy, uint rFlags, uint numWorkers,
+	     ParallelAnalysis::PipelinedReduce* pipelinedReduce)
+{
+  const Analysis::Util::StringVec& files = *nArgs.paths;
+  const Analysis::Util::UIntVec* groupMap =
+    (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
+
+  numWorkers = std::min(numWorkers, (uint)files.size());
+  if (numWorkers <= 1 && !pipelinedReduce) {
+    return Analysis::CallPath::read(files, groupMap, mergeTy, rFlags);
+  }
+  if (numWorkers == 0) {
+    return Prof::CallPath::Profile::make(rFlags);
+  }
+
+  vector<vector<uint> > workerToFiles(numWorkers);
+  assignFilesBySize(workerToFiles, files, true/*isContiguous*/);
+
+  Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+
+  vector<Prof::CallPath::Profile*> profs(numWorkers, NULL);
+
+  timer.start("read");
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(numWorkers)
+#endif
+  for (uint w = 0; w < numWorkers; ++w) {
+    const vector<uint>& myFiles = workerToFiles[w];
+    for (uint k = 0; k < myFiles.size(); ++k) {
+      uint i = myFiles[k];
+      uint groupId = (groupMap) ? (*groupMap)[i] : 0;
+      readProfileInto(profs[w], files[i], groupId, mergeTy, rFlags);
+
+      // N.B.: the others' profiles are merged into profs[0]'s nodes
+      if (w == 0 && pipelinedReduce) {
+	try {
+	  pipelinedReduce->poll(profs[0]);
+	}
+	catch (const Diagnostics::Exception& x) {
+	  abortWorker(x.message());
+	}
+	catch (const std::exception& x) {
+	  abortWorker(string("[std::exception] ") + x.what());
+	}
+	catch (...) {
+	  abortWorker("Unknown exception encountered!");
+	}
+      }
+    }
+  }
+  timer.stop("read");
+
+  timer.start("merge");
+  Prof::CallPath::Profile* prof =
+    mergeWorkerProfiles(profs, mergeTy, rFlags, numWorkers);
+  timer.stop("merge");
+
+  for (uint i = 0; i < files.size(); ++i) {
+    prof->addDirectory(files[i]);
+  }
+  prof->metricMgr()->mergePerfEventStatistics_finalize(files.size());
+
+  return prof;
+}
+
+
+// readProfileQueue: rank 0 hands out the files in 'nArgs' one at a
+//   time, largest first, to the other processes as they request them;
+//   each of those reads and merges its files into its local profile.
+//   Within a process, each worker thread requests and reads files on
+//   its own.  On exit, 'nArgs' lists the files that this process has
+//   read (none for rank 0).
+static Prof::CallPath::Profile*
+readProfileQueue(Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		 int mergeTy, uint rFlags, int myRank, int numRanks,
+		 uint numWorkers)
+{
+  const int queueTag = 1;
+  const uint groupIdLen = 1;
+  const uint recSz = groupIdLen + nArgs.pathLenMax + 1;
+
+  Prof::CallPath::Profile* prof = NULL;
+
+  if (myRank == 0) {
+    const Analysis::Util::StringVec& files = *nArgs.paths;
+    char* recBuf = new char[recSz];
+
+    vector<uint64_t> sizes(files.size());
+    vector<uint> order(files.size());
+    for (uint i = 0; i < files.size(); ++i) {
+      sizes[i] = fileSize(files[i]);
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+		     [&sizes](uint a, uint b) { return sizes[a] > sizes[b]; });
+
+    // an empty path tells a process that the queue is exhausted
+    uint next = 0;
+    for (int numDone = 0; numDone < numRanks - 1; ) {
+      MPI_Status status;
+      MPI_Recv(NULL, 0, MPI_BYTE, MPI_ANY_SOURCE, queueTag, MPI_COMM_WORLD,
+	       &status);
+
+      memset(recBuf, '\0', recSz);
+      if (next < order.size()) {
+	uint i = order[next++];
+	recBuf[0] = (char)(*nArgs.groupMap)[i];
+	strncpy(&recBuf[groupIdLen], files[i].c_str(), nArgs.pathLenMax);
+      }
+      else {
+	numDone++;
+      }
+
+      MPI_Send(recBuf, recSz, MPI_CHAR, status.MPI_SOURCE, queueTag,
+	       MPI_COMM_WORLD);
+    }
+
+    delete[] recBuf;
+
+    nArgs.paths->clear();
+    nArgs.groupMap->clear();
+  }
+  else if (numWorkers <= 1) {
+    char* recBuf = new char[recSz];
+
+    // N.B.: a single measurement group; cf. myNormalizeProfileArgs()
+    while (true) {
+      MPI_Send(NULL, 0, MPI_BYTE, 0, queueTag, MPI_COMM_WORLD);
+      MPI_Recv(recBuf, recSz, MPI_CHAR, 0, queueTag, MPI_COMM_WORLD,
+	       MPI_STATUS_IGNORE);
+
+      string nm = &recBuf[groupIdLen];
+      if (nm.empty()) {
+	break;
+      }
+
+      Analysis::Util::StringVec file(1, nm);
+      if (!prof) {
+	prof = Analysis::CallPath::read(file, NULL, mergeTy, rFlags);
+      }
+      else {
+	Analysis::CallPath::merge(*prof, file, NULL, nArgs.paths->size(),
+				  mergeTy, rFlags);
+      }
+
+      nArgs.paths->push_back(nm);
+      nArgs.groupMap->push_back((unsigned char)recBuf[0]);
+    }
+
+    delete[] recBuf;
+  }
+  else {
+    Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+
+    vector<Prof::CallPath::Profile*> profs(numWorkers, NULL);
+    vector<Analysis::Util::StringVec> workerToFiles(numWorkers);
+    unsigned char groupId = 0;
+
+    // Only one thread talks to rank 0 at a time.  Rank 0 sends one
+    // empty path per process, so the thread that receives it tells the
+    // others to stop asking.
+    bool isQueueDone = false;
+
+    timer.start("read");
+#ifdef ENABLE_OPENMP
+#pragma omp parallel num_threads(numWorkers)
+#endif
+    {
+      uint w = 0;
+#ifdef ENABLE_OPENMP
+      w = omp_get_thread_num();
+#endif
+      char* recBuf = NULL;
+
+      try {
+	recBuf = new char[recSz];
+
+	// N.B.: a single measurement group; cf. myNormalizeProfileArgs()
+	while (true) {
+	  string nm;
+#ifdef ENABLE_OPENMP
+#pragma omp critical (readProfileQueue)
+#endif
+	  {
+	    if (!isQueueDone) {
+	      MPI_Send(NULL, 0, MPI_BYTE, 0, queueTag, MPI_COMM_WORLD);
+	      MPI_Recv(recBuf, recSz, MPI_CHAR, 0, queueTag, MPI_COMM_WORLD,
+		       MPI_STATUS_IGNORE);
+	      nm = &recBuf[groupIdLen];
+	      isQueueDone = nm.empty();
+	      groupId = (unsigned char)recBuf[0];
+	    }
+	  }
+
+	  if (nm.empty()) {
+	    break;
+	  }
+
+	  readProfileInto(profs[w], nm, 0, mergeTy, rFlags);
+	  workerToFiles[w].push_back(nm);
+	}
+      }
+      catch (const Diagnostics::Exception& x) {
+	abortWorker(x.message());
+      }
+      catch (const std::exception& x) {
+	abortWorker(string("[std::exception] ") + x.what());
+      }
+      catch (...) {
+	abortWorker("Unknown exception encountered!");
+      }
+
+      delete[] recBuf;
+    }
+    timer.stop("read");
+
+    timer.start("merge");
+    prof = mergeWorkerProfiles(profs, mergeTy, rFlags, numWorkers);
+    timer.stop("merge");
+
+    for (uint w = 0; w < numWorkers; ++w) {
+      const Analysis::Util::StringVec& files = workerToFiles[w];
+      for (uint k = 0; k < files.size(); ++k) {
+	prof->addDirectory(files[k]);
+	nArgs.paths->push_back(files[k]);
+	nArgs.groupMap->push_back(groupId);
+      }
+    }
+    prof->metricMgr()->mergePerfEventStatistics_finalize(nArgs.paths->size());
+  }
+
+  if (!prof) {
+    prof = Prof::CallPath::Profile::make(rFlags);
+  }
+  return prof;
+}
+
+
+// readProfileInto: read 'fnm' and merge it into 'prof', which is
+//   created on first use.  Leaves the perf event statistics summed
+//   (cf. Metric::Mgr::mergePerfEventStatistics_finalize()).  Worker
+//   threads call this concurrently for distinct 'prof'.
+static void
+readProfileInto(Prof::CallPath::Profile*& prof, const string& fnm,
+		uint groupId, int mergeTy, uint rFlags)
+{
+  try {
+    Prof::CallPath::Profile* p =
+      Analysis::CallPath::read(fnm, groupId, rFlags);
+    if (!prof) {
+      prof = p;
+      return;
+    }
+
+    prof->merge(*p, mergeTy);
+    prof->metricMgr()->mergePerfEventStatistics(p->metricMgr());
+    delete p;
+  }
+  catch (const Diagnostics::Exception& x) {
+    abortWorker(x.message());
+  }
+  catch (const std::exception& x) {
+    abortWorker(string("[std::exception] ") + x.what());
+  }
+  catch (...) {
+    abortWorker("Unknown exception encountered!");
+  }
+}
+
+
+// mergeWorkerProfiles: merge the workers' profiles 'profs' (some of
+//   which may be NULL) pairwise, always merging right into left, and
+//   return the result.  Deletes the others.
+static Prof::CallPath::Profile*
+mergeWorkerProfiles(vector<Prof::CallPath::Profile*>& profs,
+		    int mergeTy, uint rFlags, uint numWorkers)
+{
+  const uint n = profs.size();
+  for (uint stride = 1; stride < n; stride *= 2) {
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numWorkers)
+#endif
+    for (uint i = 0; i < n - stride; i += 2 * stride) {
+      Prof::CallPath::Profile*& x = profs[i];
+      Prof::CallPath::Profile*& y = profs[i + stride];
+      if (!y) {
+	continue;
+      }
+      if (!x) {
+	std::swap(x, y);
+	continue;
+      }
+      try {
+	x->merge(*y, mergeTy);
+	x->metricMgr()->mergePerfEventStatistics(y->metricMgr());
+	delete y;
+	y = NULL;
+      }
+      catch (const Diagnostics::Exception& ex) {
+	abortWorker(ex.message());
+      }
+      catch (const std::exception& ex) {
+	abortWorker(string("[std::exception] ") + ex.what());
+      }
+      catch (...) {
+	abortWorker("Unknown exception encountered!");
+      }
+    }
+  }
+
+  Prof::CallPath::Profile* prof = (n > 0) ? profs[0] : NULL;
+  if (!prof) {
+    prof = Prof::CallPath::Profile::make(rFlags);
+  }
+  return prof;
+}
+
+
+// reportLoadBalance: rank 0 prints how the time to read and merge
+//   the local profiles and to reduce them varies across processes.
+static void
+reportLoadBalance(const Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		  int myRank, int numRanks)
+{
+  const Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+
+  uint64_t bytes = 0;
+  for (uint i = 0; i < nArgs.paths->size(); ++i) {
+    bytes += fileSize((*nArgs.paths)[i]);
+  }
+
+  const int statsSz = 5;
+  double stats[statsSz] = {
+    (double)nArgs.paths->size(), (double)bytes / (1024 * 1024),
+    timer.seconds("read"), timer.seconds("merge"), timer.seconds("reduce")
+  };
+
+  double* allStats = (myRank == 0) ? new double[numRanks * statsSz] : NULL;
+  MPI_Gather(stats, statsSz, MPI_DOUBLE, allStats, statsSz, MPI_DOUBLE,
+	     0, MPI_COMM_WORLD);
+
+  if (myRank != 0) {
+    return;
+  }
+
+  // read+merge time over ranks
+  vector<double> times(numRanks);
+  int minRank = 0, maxRank = 0;
+  double sum = 0.0;
+  for (int rank = 0; rank < numRanks; ++rank) {
+    const double* s = &allStats[rank * statsSz];
+    times[rank] = s[2] + s[3];
+    sum += times[rank];
+    if (times[rank] < times[minRank]) {
+      minRank = rank;
+    }
+    if (times[rank] > times[maxRank]) {
+      maxRank = rank;
+    }
+
+    DIAG_Msg(2, "[" << rank << "] files: " << s[0] << ", MB: " << s[1]
+	     << ", read: " << s[2] << "s, merge: " << s[3]
+	     << "s, reduce: " << s[4] << "s");
+  }
+
+  const double* mx = &allStats[maxRank * statsSz];
+  DIAG_MsgIf(true, "READ+MERGE: mean " << sum / numRanks << "s, min "
+	     << times[minRank] << "s (rank " << minRank << "), max "
+	     << times[maxRank] << "s (rank " << maxRank << ": " << mx[0]
+	     << " files, " << mx[1] << " MB)");
+
+  delete[] allStats;
+}
+
+
+// writePhaseTimes: rank 0 gathers, for each rank, the wall-clock time
+//   of each phase, the bytes that it sent and received (cf.
+//   ParallelAnalysis::bytesSent()) and its peak resident set size, and
+//   writes them to 'fnm' as comma-separated lines, one per rank, after
+//   a header (cf. Analysis::PhaseTimer::write()).
+static void
+writePhaseTimes(const string& fnm, int myRank, int numRanks)
+{
+  static const char* phases[] = {
+    "read", "merge", "reduce", "broadcast", "overlay", "summary", "prune",
+    "thread", "write", "total"
+  };
+  const int numPhases = sizeof(phases) / sizeof(phases[0]);
+
+  const Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    usage.ru_maxrss = 0;
+  }
+
+  const int statsSz = numPhases + 3;
+  double stats[statsSz];
+  for (int i = 0; i < numPhases; ++i) {
+    stats[i] = timer.seconds(phases[i]);
+  }
+  stats[numPhases]     = (double)ParallelAnalysis::bytesSent();
+  stats[numPhases + 1] = (double)ParallelAnalysis::bytesReceived();
+  stats[numPhases + 2] = (double)usage.ru_maxrss; // KB on Linux
+
+  double* allStats = (myRank == 0) ? new double[numRanks * statsSz] : NULL;
+  MPI_Gather(stats, statsSz, MPI_DOUBLE, allStats, statsSz, MPI_DOUBLE,
+	     0, MPI_COMM_WORLD);
+
+  if (myRank != 0) {
+    return;
+  }
+
+  std::ostream* os = IOUtil::OpenOStream(fnm.c_str());
+  os->precision(6);
+  os->setf(std::ios_base::fixed, std::ios_base::floatfield);
+
+  *os << "rank";
+  for (int i = 0; i < numPhases; ++i) {
+    *os << "," << phases[i];
+  }
+  *os << ",bytes-sent,bytes-received,max-rss-kb\n";
+
+  for (int rank = 0; rank < numRanks; ++rank) {
+    const double* s = &allStats[rank * statsSz];
+    *os << rank;
+    for (int i = 0; i < numPhases; ++i) {
+      *os << "," << s[i];
+    }
+    *os << "," << (uint64_t)s[numPhases] << "," << (uint64_t)s[numPhases + 1]
+	<< "," << (uint64_t)s[numPhases + 2] << "\n";
+  }
+
+  IOUtil::CloseStream(os);
+  delete[] allStats;
+}
+
+
+// hashBytes: continue the FNV-1a hash 'h' with 'data'
+static uint64_t
+hashBytes(uint64_t h, const void* data, size_t dataSz)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  for (size_t i = 0; i < dataSz; ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+static const uint64_t hashBasis = 14695981039346656037ULL;
+
+
+// fingerprintInput: a fingerprint of the files that every rank reads
+//   (their names, groups, sizes and modification times) and of the
+//   number of ranks, identical on each rank (cf.
+//   ParallelAnalysis::Checkpoint::find()).  Collective.
+static uint64_t
+fingerprintInput(const Analysis::Util::NormalizeProfileArgs_t& nArgs,
+		 int myRank, int numRanks)
+{
+  uint64_t h = hashBasis;
+  for (uint i = 0; i < nArgs.paths->size(); ++i) {
+    const string& fnm = (*nArgs.paths)[i];
+    uint64_t groupId = (*nArgs.groupMap)[i];
+    uint64_t size = 0, mtime = 0;
+    struct stat st;
+    if (stat(fnm.c_str(), &st) == 0) {
+      size = st.st_size;
+      mtime = st.st_mtime;
+    }
+    h = hashBytes(h, fnm.c_str(), fnm.size() + 1);
+    h = hashBytes(h, &groupId, sizeof(groupId));
+    h = hashBytes(h, &size, sizeof(size));
+    h = hashBytes(h, &mtime, sizeof(mtime));
+  }
+
+  unsigned long long myId = h;
+  vector<unsigned long long> ids(numRanks);
+  MPI_Allgather(&myId, 1, MPI_UNSIGNED_LONG_LONG, &ids[0], 1,
+		MPI_UNSIGNED_LONG_LONG, MPI_COMM_WORLD);
+
+  uint64_t id = hashBytes(hashBasis, &ids[0], numRanks * sizeof(ids[0]));
+  return hashBytes(id, &numRanks, sizeof(numRanks));
+}
+
+
+// fingerprintCCT: a fingerprint of the canonical CCT's shape, node
+//   ids and types and its metrics' names, continuing 'inputId'.
+//   Summary metrics are only valid for an identical CCT.
+static uint64_t
+fingerprintCCT(const Prof::CallPath::Profile& profGbl, uint64_t inputId)
+{
+  uint64_t h = inputId;
+
+  const Prof::Metric::Mgr& mMgr = *profGbl.metricMgr();
+  for (uint i = 0; i < mMgr.size(); ++i) {
+    const string& nm = mMgr.metric(i)->name();
+    h = hashBytes(h, nm.c_str(), nm.size() + 1);
+  }
+
+  for (Prof::CCT::ANodeIterator it(profGbl.cct()->root());
+       it.Current(); ++it) {
+    const Prof::CCT::ANode* n = it.current();
+    uint32_t rec[3] = {
+      n->id(), (n->parent()) ? n->parent()->id() : 0, (uint32_t)n->type()
+    };
+    h = hashBytes(h, rec, sizeof(rec));
+  }
+  return h;
+}
+
+
 //***************************************************************************
 
 // makeSummaryMetrics: Assumes 'profGbl' is the canonical CCT (with
@@ -571,7 +1516,8 @@ makeSummaryMetrics(Prof::CallPath::Profile& profGbl,
 		   const Analysis::Args& args,
 		   const Analysis::Util::NormalizeProfileArgs_t& nArgs,
 		   const vector<uint>& groupIdToGroupSizeMap,
-		   int myRank, int numRanks)
+		   int myRank, int numRanks, uint numWorkers,
+		   ParallelAnalysis::Checkpoint& checkpoint, uint64_t inputId)
 {
   uint mDrvdBeg = 0, mDrvdEnd = 0;   // [ )
   uint mXDrvdBeg = 0, mXDrvdEnd = 0; // [ )
@@ -586,17 +1532,65 @@ makeSummaryMetrics(Prof::CallPath::Profile& profGbl,
   Prof::Metric::Mgr& mMgrGbl = *profGbl.metricMgr();
   Prof::CCT::ANode* cctRoot = profGbl.cct()->root();
 
+  // A rank with a checkpoint restores its subtree's summary metrics in
+  // the reduction below; one covered by an ancestor's does nothing.
+  uint64_t summaryId = 0;
+  if (checkpoint.isEnabled()) {
+    summaryId = fingerprintCCT(profGbl, inputId);
+  }
+  checkpoint.find(ParallelAnalysis::Checkpoint::Stage_Summary, summaryId);
+
+  bool isSummaryCovered =
+    checkpoint.isCovered(ParallelAnalysis::Checkpoint::Stage_Summary);
+  bool isSummaryRestored = (!isSummaryCovered &&
+    checkpoint.has(ParallelAnalysis::Checkpoint::Stage_Summary));
+
   // -------------------------------------------------------
   // compute local contribution summary metrics (accumulate function)
   // -------------------------------------------------------
   cctRoot->computeMetricsIncr(mMgrGbl, mDrvdBeg, mDrvdEnd,
 			      Prof::Metric::AExprIncr::FnInit);
 
-  for (uint i = 0; i < nArgs.paths->size(); ++i) {
-    const string& fnm = (*nArgs.paths)[i];
-    uint groupId = (*nArgs.groupMap)[i];
-    makeSummaryMetrics_Lcl(profGbl, fnm, args, groupId, nArgs.groupMax,
-			   groupIdToGroupMetricsMap, myRank);
+  // Worker threads read profiles ahead, concurrently; each is then
+  // merged into the canonical CCT in order (cf. makeThreadMetrics()).
+  uint numFiles = nArgs.paths->size();
+  if (isSummaryCovered || isSummaryRestored) {
+    numFiles = 0;
+  }
+  if (numWorkers > 1) {
+    prepareStructure(*profGbl.structure());
+  }
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for ordered schedule(dynamic, 1) \
+  num_threads(numWorkers) if (numWorkers > 1)
+#endif
+  for (uint i = 0; i < numFiles; ++i) {
+    try {
+      const string& fnm = (*nArgs.paths)[i];
+      uint groupId = (*nArgs.groupMap)[i];
+      Prof::CallPath::Profile* prof =
+	readProfile_Lcl(profGbl, fnm, groupId, nArgs.groupMax);
+
+#ifdef ENABLE_OPENMP
+#pragma omp ordered
+#endif
+      {
+	makeSummaryMetrics_Lcl(profGbl, *prof, groupId,
+			       groupIdToGroupMetricsMap, myRank);
+      }
+
+      delete prof;
+    }
+    catch (const Diagnostics::Exception& x) {
+      abortWorker(x.message());
+    }
+    catch (const std::exception& x) {
+      abortWorker(string("[std::exception] ") + x.what());
+    }
+    catch (...) {
+      abortWorker("Unknown exception encountered!");
+    }
   }
 
   // -------------------------------------------------------
@@ -628,13 +1622,32 @@ makeSummaryMetrics(Prof::CallPath::Profile& profGbl,
   // 3. Reduction
   uint maxCCTId = profGbl.cct()->maxDenseId();
 
-  ParallelAnalysis::PackedMetrics* packedMetrics =
-    new ParallelAnalysis::PackedMetrics(maxCCTId + 1, mXDrvdBeg, mXDrvdEnd,
+  ParallelAnalysis::SparseMetrics* sparseMetrics =
+    new ParallelAnalysis::SparseMetrics(maxCCTId + 1, mXDrvdBeg, mXDrvdEnd,
 					mDrvdBeg, mDrvdEnd);
 
-  // Post-INVARIANT: rank 0's 'profGbl' contains summary metrics
-  ParallelAnalysis::reduce(std::make_pair(&profGbl, packedMetrics),
-			   myRank, numRanks);
+  // Post-INVARIANT: rank 0's 'profGbl' contains summary metrics.
+  // N.B.: The accumulators hold the identity of 'combine' (cf. FnInit)
+  // where no files were read, so restoring combines the checkpoint
+  // into them like a child's metrics.
+  if (!isSummaryCovered) {
+    if (isSummaryRestored) {
+      checkpoint.readMetrics(*sparseMetrics);
+      ParallelAnalysis::unpackMetrics(profGbl, *sparseMetrics);
+    }
+    else {
+      ParallelAnalysis::reduceChildren(std::make_pair(&profGbl,
+						      sparseMetrics),
+				       myRank, numRanks);
+      if (checkpoint.isEnabled()) {
+	ParallelAnalysis::packMetrics(profGbl, *sparseMetrics);
+	checkpoint.writeMetrics(*sparseMetrics);
+      }
+    }
+
+    ParallelAnalysis::sendParent(std::make_pair(&profGbl, sparseMetrics),
+				 myRank);
+  }
 
   // -------------------------------------------------------
   // finalize metrics
@@ -652,7 +1665,7 @@ makeSummaryMetrics(Prof::CallPath::Profile& profGbl,
     delete groupIdToGroupMetricsMap[grpId];
   }
 
-  delete packedMetrics;
+  delete sparseMetrics;
 }
 
 
@@ -661,13 +1674,73 @@ makeThreadMetrics(Prof::CallPath::Profile& profGbl,
 		  const Analysis::Args& args,
 		  const Analysis::Util::NormalizeProfileArgs_t& nArgs,
 		  const vector<uint>& groupIdToGroupSizeMap,
-		  int myRank, int numRanks)
+		  int myRank, int numRanks, uint numWorkers)
 {
-  for (uint i = 0; i < nArgs.paths->size(); ++i) {
-    string& fnm = (*nArgs.paths)[i];
-    uint groupId = (*nArgs.groupMap)[i];
-    makeThreadMetrics_Lcl(profGbl, fnm, args, groupId, nArgs.groupMax, myRank);
+  SharedMetricDB* sharedDB = NULL;
+
+  // With a shared metric db, each rank's i-th db is written in the
+  // i-th collective write; ranks with fewer files join the remaining
+  // writes with no data.
+  uint numFiles = nArgs.paths->size();
+  uint numRounds = numFiles;
+  if (args.db_makeMetricDB && args.db_metricDBShared) {
+    sharedDB = openSharedMetricDB(args.db_dir + "/" + Analysis_OUT_DB_METRICS);
+    MPI_Allreduce(&numFiles, &numRounds, 1, MPI_UNSIGNED, MPI_MAX,
+		  MPI_COMM_WORLD);
+  }
+
+  // Worker threads read profiles ahead, concurrently, using the
+  // canonical CCT's structure read-only.  Each profile is then merged
+  // into the canonical CCT, and its metrics written, in order; this
+  // also keeps the shared db's collective writes in step across ranks.
+  if (numWorkers > 1) {
+    prepareStructure(*profGbl.structure());
+  }
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for ordered schedule(dynamic, 1) \
+  num_threads(numWorkers) if (numWorkers > 1)
+#endif
+  for (uint i = 0; i < numRounds; ++i) {
+    try {
+      Prof::CallPath::Profile* prof = NULL;
+      if (i < numFiles) {
+	prof = readProfile_Lcl(profGbl, (*nArgs.paths)[i],
+			       (*nArgs.groupMap)[i], nArgs.groupMax);
+      }
+
+#ifdef ENABLE_OPENMP
+#pragma omp ordered
+#endif
+      {
+	if (prof) {
+	  makeThreadMetrics_Lcl(profGbl, *prof, (*nArgs.paths)[i], args,
+				(*nArgs.groupMap)[i], sharedDB, myRank);
+	}
+	else {
+	  writeSharedMetricDB(*sharedDB, NULL, 0, "");
+	}
+      }
+
+      delete prof;
+    }
+    catch (const Diagnostics::Exception& x) {
+      abortWorker(x.message());
+    }
+    catch (const std::exception& x) {
+      abortWorker(string("[std::exception] ") + x.what());
+    }
+    catch (...) {
+      abortWorker("Unknown exception encountered!");
+    }
+  }
+
+  if (sharedDB) {
+    closeSharedMetricDB(sharedDB, profGbl.cct()->maxDenseId(), myRank,
+			numRanks);
   }
+
+  profGbl.fixTraceFiles();
 }
 
 
@@ -763,31 +1836,30 @@ makeDerivedMetricDescs(Prof::CallPath::Profile& profGbl,
 }
 
 
-// makeSummaryMetrics_Lcl: Make summary metrics.
-//
-// Assumes:
-// - 'profGbl' is the canonical CCT (with structure and with
-//   canonical ids)
-// - each thread-level CCT is always a subset of 'profGbl' (the
-//   canonical CCT); in other words, 'profGbl' should not be pruned
-//   in any way!
-// - 'args' contains the correct final experiment database.
-//
-// FIXME: abstract between makeSummaryMetrics_Lcl() & makeThreadMetrics_Lcl()
+// prepareStructure: build the VMA maps of each load module in
+//   'structure' so that worker threads can look up structure
+//   concurrently (cf. readProfile_Lcl()).
 static void
-makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
-		       const string& profileFile,
-		       const Analysis::Args& args, uint groupId, uint groupMax,
-		       vector<VMAIntervalSet*>& groupIdToGroupMetricsMap,
-		       int myRank)
+prepareStructure(const Prof::Struct::Tree& structure)
 {
-  Prof::Metric::Mgr* mMgrGbl = profGbl.metricMgr();
-  Prof::CCT::Tree* cctGbl = profGbl.cct();
-  Prof::CCT::ANode* cctRootGbl = cctGbl->root();
+  Prof::Struct::ANodeIterator
+    it(structure.root(),
+       &Prof::Struct::ANodeTyFilter[Prof::Struct::ANode::TyLM]);
+  for (Prof::Struct::ANode* n = NULL; (n = it.current()); ++it) {
+    const Prof::Struct::LM* lm = dynamic_cast<Prof::Struct::LM*>(n);
+    lm->findProc(0);
+    lm->findStmt(0);
+  }
+}
 
-  // -------------------------------------------------------
-  // read profile file
-  // -------------------------------------------------------
+
+// readProfile_Lcl: Read a thread-level profile to be merged with the
+// canonical CCT 'profGbl'.  Uses 'profGbl' read-only, so worker threads
+// may call it concurrently (after prepareStructure()).
+static Prof::CallPath::Profile*
+readProfile_Lcl(Prof::CallPath::Profile& profGbl, const string& profileFile,
+		uint groupId, uint groupMax)
+{
   uint rFlags = (Prof::CallPath::Profile::RFlg_NoMetricSfx
 		 | Prof::CallPath::Profile::RFlg_MakeInclExcl);
   uint rGroupId = (groupMax > 1) ? groupId : 0;
@@ -795,12 +1867,6 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
   Prof::CallPath::Profile* prof =
     Analysis::CallPath::read(profileFile, rGroupId, rFlags);
 
-  // -------------------------------------------------------
-  // merge into canonical CCT
-  // -------------------------------------------------------
-  int mergeTy  = Prof::CallPath::Profile::Merge_MergeMetricByName;
-  int mergeFlg = (Prof::CCT::MrgFlg_AssertCCTMergeOnly);
-
   // Add *some* structure information to the leaves of 'prof' so that
   // it will be merged successfully with the structured canonical CCT
   // 'profGbl'.
@@ -815,8 +1881,40 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
   Analysis::CallPath::noteStaticStructureOnLeaves(*prof);
   prof->structure(NULL);
 
-  uint mBeg = profGbl.merge(*prof, mergeTy, mergeFlg); // [closed begin
-  uint mEnd = mBeg + prof->metricMgr()->size();        //  open end)
+  return prof;
+}
+
+
+// makeSummaryMetrics_Lcl: Make summary metrics from 'prof' (cf.
+// readProfile_Lcl()).
+//
+// Assumes:
+// - 'profGbl' is the canonical CCT (with structure and with
+//   canonical ids)
+// - each thread-level CCT is always a subset of 'profGbl' (the
+//   canonical CCT); in other words, 'profGbl' should not be pruned
+//   in any way!
+//
+// FIXME: abstract between makeSummaryMetrics_Lcl() & makeThreadMetrics_Lcl()
+static void
+makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
+		       Prof::CallPath::Profile& prof,
+		       uint groupId,
+		       vector<VMAIntervalSet*>& groupIdToGroupMetricsMap,
+		       int myRank)
+{
+  Prof::Metric::Mgr* mMgrGbl = profGbl.metricMgr();
+  Prof::CCT::Tree* cctGbl = profGbl.cct();
+  Prof::CCT::ANode* cctRootGbl = cctGbl->root();
+
+  // -------------------------------------------------------
+  // merge into canonical CCT
+  // -------------------------------------------------------
+  int mergeTy  = Prof::CallPath::Profile::Merge_MergeMetricByName;
+  int mergeFlg = (Prof::CCT::MrgFlg_AssertCCTMergeOnly);
+
+  uint mBeg = profGbl.merge(prof, mergeTy, mergeFlg); // [closed begin
+  uint mEnd = mBeg + prof.metricMgr()->size();        //  open end)
 
   // -------------------------------------------------------
   // compute local incl/excl sampled metrics and update local derived metrics
@@ -864,12 +1962,11 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
   // assignment) instead of CCT::merge() (which initializes based on
   // addition against 0).
   cctRootGbl->zeroMetricsDeep(mBeg, mEnd); // cf. FnInitSrc
-  
-  delete prof;
 }
 
 
-// makeThreadMetrics_Lcl: Make thread-level metric database.
+// makeThreadMetrics_Lcl: Make thread-level metric database from 'prof'
+// (cf. readProfile_Lcl()).
 //
 // Makes same assumptions as makeSummaryMetrics_Lcl but with one key
 // exception: Each thread-level CCT does not have to be a subset of
@@ -877,49 +1974,27 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
 // pruned.
 static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
+		      Prof::CallPath::Profile& prof,
 		      const string& profileFile,
-		      const Analysis::Args& args, uint groupId, uint groupMax,
-		      int myRank)
+		      const Analysis::Args& args, uint groupId,
+		      SharedMetricDB* sharedDB, int myRank)
 {
   Prof::Metric::Mgr* mMgrGbl = profGbl.metricMgr();
   Prof::CCT::Tree* cctGbl = profGbl.cct();
   Prof::CCT::ANode* cctRootGbl = cctGbl->root();
 
-  // -------------------------------------------------------
-  // read profile file
-  // -------------------------------------------------------
-  uint rFlags = (Prof::CallPath::Profile::RFlg_NoMetricSfx
-		 | Prof::CallPath::Profile::RFlg_MakeInclExcl);
-  uint rGroupId = (groupMax > 1) ? groupId : 0;
-
-  Prof::CallPath::Profile* prof =
-    Analysis::CallPath::read(profileFile, rGroupId, rFlags);
-
   // -------------------------------------------------------
   // merge into canonical CCT
   // -------------------------------------------------------
   int mergeTy  = Prof::CallPath::Profile::Merge_MergeMetricByName;
   int mergeFlg = (Prof::CCT::MrgFlg_NormalizeTraceFileY
+		  | Prof::CCT::MrgFlg_DeferTraceFileY
 		  | Prof::CCT::MrgFlg_CCTMergeOnly);
 
-  // Add *some* structure information to the leaves of 'prof' so that
-  // it will be merged successfully with the structured canonical CCT
-  // 'profGbl'.
-  //
-  // Background: When CCT::Stmts are merged in
-  // Analysis::CallPath::coalesceStmts(CallPath::Profile), IP/LIP
-  // information is not retained.  This means that when merging 'prof'
-  // into 'profGbl' (using CallPath::Profile::merge()), many leaves in
-  // 'prof' will not find their corresponding node in 'profGbl' unless
-  // corrective measures are taken.
-  prof->structure(profGbl.structure());
-  Analysis::CallPath::noteStaticStructureOnLeaves(*prof);
-  prof->structure(NULL);
-
-  uint mBeg = profGbl.merge(*prof, mergeTy, mergeFlg); // [closed begin
+  uint mBeg = profGbl.merge(prof, mergeTy, mergeFlg); // [closed begin
 
   if (args.db_makeMetricDB) {
-    uint mEnd = mBeg + prof->metricMgr()->size(); // open end)
+    uint mEnd = mBeg + prof.metricMgr()->size(); // open end)
 
     // -------------------------------------------------------
     // compute local incl/excl sampled metrics
@@ -946,7 +2021,7 @@ makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
     // -------------------------------------------------------
 
     string dbFnm = makeDBFileName(args.db_dir, groupId, profileFile);
-    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm);
+    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm, args, sharedDB);
 
     // -------------------------------------------------------
     // reinitialize metric values for next time
@@ -955,8 +2030,6 @@ makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
     // TODO: see corresponding comments in makeSummaryMetrics_Lcl()
     cctRootGbl->zeroMetricsDeep(mBeg, mEnd); // cf. FnInitSrc
   }
-
-  delete prof;
 }
 
 
@@ -975,9 +2048,13 @@ makeDBFileName(const string& dbDir, uint groupId, const string& profileFile)
 
 
 // [mBegId, mEndId)
+//
+// If 'sharedDB' is non-NULL, append the (dense) database to it instead
+// of writing the file 'metricDBFnm'.
 static void
 writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm)
+	       const string& metricDBFnm, const Analysis::Args& args,
+	       SharedMetricDB* sharedDB)
 {
   const Prof::CCT::Tree& cct = *(profGbl.cct());
 
@@ -995,6 +2072,26 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
   // write data
   // -------------------------------------------------------
 
+  if (sharedDB) {
+    hpcmetricDB_fmt_hdr_t hdr;
+    hdr.numNodes = packedMetrics.numNodes() - 1;
+    hdr.numMetrics = mEndId - mBegId; // [mBegId mEndId)
+
+    // rows for nodes [1, numNodes], as below
+    uint64_t numVals = (uint64_t)hdr.numNodes * hdr.numMetrics;
+    vector<unsigned char> buf(HPCMETRICDB_FMT_DenseHeaderLen + numVals * 8);
+
+    size_t len = hpcmetricDB_fmt_hdr_encode(&hdr, false, &buf[0]);
+    if (numVals > 0) {
+      len += hpcmetricDB_fmt_real8_encode(&packedMetrics.idx(1, 0), numVals,
+					  &buf[len]);
+    }
+
+    writeSharedMetricDB(*sharedDB, &buf[0], len,
+			FileUtil::basename(metricDBFnm));
+    return;
+  }
+
   FILE* fs = hpcio_fopen_w(metricDBFnm.c_str(), 1);
   if (!fs) {
     std::string errorString;
@@ -1009,12 +2106,22 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
 
   uint numNodes = packedMetrics.numNodes() - 1;
 
+  int ret;
+
+  if (args.db_metricDBSparse) {
+    ret = writeMetricsDBSparse(packedMetrics, numNodes, mEndId - mBegId,
+			       args.db_metricDBNodeIdx, fs);
+    if (ret == HPCFMT_ERR) goto badwrite;
+
+    hpcio_fclose(fs);
+    return;
+  }
+
   // 1. header
   hpcmetricDB_fmt_hdr_t hdr;
   hdr.numNodes = numNodes;
   hdr.numMetrics = mEndId - mBegId; // [mBegId mEndId)
 
-  int ret;
   ret = hpcmetricDB_fmt_hdr_fwrite(&hdr, fs);
   if (ret == HPCFMT_ERR) goto badwrite;
 
@@ -1047,6 +2154,253 @@ badwrite:
 }
 
 
+// Write the non-zero values of 'packedMetrics' in the sparse metric-db
+// format (cf. hpcrun-fmt.h).  The first pass counts the entries for
+// the header and node index; the second encodes the entries into a
+// buffer that is written in large blocks.
+static int
+writeMetricsDBSparse(const ParallelAnalysis::PackedMetrics& packedMetrics,
+		     uint numNodes, uint numMetrics, bool doNodeIdx, FILE* fs)
+{
+  // 1. count non-zero entries (and form the node index of byte
+  //    offsets, which follow the header and the index itself)
+  std::vector<uint64_t> nodeIdx(numNodes + 2, 0);
+  uint64_t entriesOff = HPCMETRICDB_FMT_SparseHeaderLen;
+  if (doNodeIdx) {
+    entriesOff += nodeIdx.size() * sizeof(uint64_t);
+  }
+
+  uint64_t numEntries = 0;
+  for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
+    nodeIdx[nodeId] = entriesOff + numEntries * HPCMETRICDB_FMT_EntryLen;
+    for (uint mId = 0; mId < numMetrics; ++mId) {
+      if (packedMetrics.idx(nodeId, mId) != 0.0) {
+	numEntries++;
+      }
+    }
+  }
+  nodeIdx[numNodes + 1] = entriesOff + numEntries * HPCMETRICDB_FMT_EntryLen;
+
+  // 2. header
+  hpcmetricDB_fmt_hdr_t hdr;
+  hdr.numNodes = numNodes;
+  hdr.numMetrics = numMetrics;
+  hdr.numEntries = numEntries;
+  hdr.flags = (doNodeIdx) ? HPCMETRICDB_FMT_FLG_NodeIdx : 0;
+
+  HPCFMT_ThrowIfError(hpcmetricDB_fmt_sparse_hdr_fwrite(&hdr, fs));
+
+  const uint bufEntries = 1 << 16;
+  std::vector<unsigned char> buf(bufEntries * HPCMETRICDB_FMT_EntryLen);
+
+  // 3. node index
+  if (doNodeIdx) {
+    for (uint i = 0; i < nodeIdx.size(); i += bufEntries) {
+      size_t n = std::min<size_t>(bufEntries, nodeIdx.size() - i);
+      size_t len = hpcmetricDB_fmt_index_encode(&nodeIdx[i], n, &buf[0]);
+      if (fwrite(&buf[0], 1, len, fs) != len) {
+	return HPCFMT_ERR;
+      }
+    }
+  }
+
+  // 4. entries, sorted by node and then metric
+  std::vector<hpcmetricDB_fmt_entry_t> entries;
+  entries.reserve(bufEntries);
+
+  for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
+    for (uint mId = 0; mId < numMetrics; ++mId) {
+      double mval = packedMetrics.idx(nodeId, mId);
+      if (mval == 0.0) {
+	continue;
+      }
+
+      hpcmetricDB_fmt_entry_t x;
+      x.nodeId = nodeId;
+      x.metricId = mId;
+      x.value = mval;
+      entries.push_back(x);
+
+      if (entries.size() == bufEntries) {
+	size_t len = hpcmetricDB_fmt_entries_encode(&entries[0], entries.size(),
+						     &buf[0]);
+	if (fwrite(&buf[0], 1, len, fs) != len) {
+	  return HPCFMT_ERR;
+	}
+	entries.clear();
+      }
+    }
+  }
+
+  if (!entries.empty()) {
+    size_t len = hpcmetricDB_fmt_entries_encode(&entries[0], entries.size(),
+						 &buf[0]);
+    if (fwrite(&buf[0], 1, len, fs) != len) {
+      return HPCFMT_ERR;
+    }
+  }
+
+  return HPCFMT_OK;
+}
+
+
+//***************************************************************************
+
+static void
+abortSharedMetricDB(const string& fnm, int ret)
+{
+  char errStr[MPI_MAX_ERROR_STRING];
+  int errStrLen = 0;
+  MPI_Error_string(ret, errStr, &errStrLen);
+
+  DIAG_EMsg("failed writing metric database '" << fnm << "': "
+	    << errStr << "; aborting.");
+  prof_abort(-1);
+}
+
+
+// openSharedMetricDB: collectively create (or truncate) 'fnm'
+static SharedMetricDB*
+openSharedMetricDB(const string& fnm)
+{
+  SharedMetricDB* db = new SharedMetricDB;
+  db->fnm = fnm;
+  db->dataEnd = HPCMETRICDB_FMT_SharedHeaderLen;
+  db->numDBs = 0;
+
+  int ret = MPI_File_open(MPI_COMM_WORLD, (char*)fnm.c_str(),
+			  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+			  &db->fh);
+  if (ret != MPI_SUCCESS) {
+    abortSharedMetricDB(fnm, ret);
+  }
+
+  ret = MPI_File_set_size(db->fh, 0);
+  if (ret != MPI_SUCCESS) {
+    abortSharedMetricDB(fnm, ret);
+  }
+
+  // dbs are a multiple of 8 bytes; writing 8-byte units raises the
+  // size limit of one collective write
+  MPI_Type_contiguous(8, MPI_BYTE, &db->real8Ty);
+  MPI_Type_commit(&db->real8Ty);
+
+  return db;
+}
+
+
+// writeSharedMetricDB: collectively append one db per rank (an empty
+// 'buf' if a rank has none).  The dbs are placed in rank order.
+static void
+writeSharedMetricDB(SharedMetricDB& db, const unsigned char* buf,
+		    uint64_t len, const string& metricDBFnm)
+{
+  DIAG_Assert(len % 8 == 0 && len / 8 <= INT_MAX,
+	      "writeSharedMetricDB: unexpected db size " << len);
+
+  unsigned long long myLen = len;
+  unsigned long long myOffset = 0;
+  unsigned long long roundLen = 0;
+
+  MPI_Exscan(&myLen, &myOffset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+	     MPI_COMM_WORLD);
+  MPI_Allreduce(&myLen, &roundLen, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+		MPI_COMM_WORLD);
+
+  int myRank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+  if (myRank == 0) {
+    myOffset = 0; // undefined after MPI_Exscan()
+  }
+
+  uint64_t offset = db.dataEnd + myOffset;
+
+  int ret = MPI_File_write_at_all(db.fh, offset, (void*)buf, (int)(len / 8),
+				  db.real8Ty, MPI_STATUS_IGNORE);
+  if (ret != MPI_SUCCESS) {
+    abortSharedMetricDB(db.fnm, ret);
+  }
+
+  if (len > 0) {
+    size_t pos = db.index.size();
+    db.index.resize(pos + 8 + 8 + 4 + metricDBFnm.size());
+    hpcmetricDB_fmt_dbidx_encode(offset, len, metricDBFnm.c_str(),
+				 &db.index[pos]);
+    db.numDBs++;
+  }
+
+  db.dataEnd += roundLen;
+}
+
+
+// closeSharedMetricDB: rank 0 gathers the index entries of all ranks
+// and writes them after the dbs, followed by the header; then the
+// file is collectively closed and 'sharedDB' deleted.
+static void
+closeSharedMetricDB(SharedMetricDB* db, uint numNodes, int myRank,
+		    int numRanks)
+{
+  int idxLen = db->index.size();
+  unsigned long long numDBs = db->numDBs;
+  unsigned long long numDBsAll = 0;
+
+  MPI_Reduce(&numDBs, &numDBsAll, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+	     MPI_COMM_WORLD);
+
+  int* idxLens = NULL;
+  int* idxDispls = NULL;
+  vector<unsigned char> indexAll(1);
+  if (myRank == 0) {
+    idxLens = new int[numRanks];
+    idxDispls = new int[numRanks];
+  }
+
+  MPI_Gather(&idxLen, 1, MPI_INT, idxLens, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  if (myRank == 0) {
+    int total = 0;
+    for (int rank = 0; rank < numRanks; ++rank) {
+      idxDispls[rank] = total;
+      total += idxLens[rank];
+    }
+    indexAll.resize(total + 1);
+  }
+
+  db->index.push_back(0); // ensure a valid address
+  MPI_Gatherv(&db->index[0], idxLen, MPI_BYTE, &indexAll[0], idxLens,
+	      idxDispls, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+  if (myRank == 0) {
+    hpcmetricDB_fmt_hdr_t hdr;
+    hdr.numNodes = numNodes;
+    hdr.numMetrics = 0;
+    hdr.numDBs = numDBsAll;
+    hdr.indexOffset = db->dataEnd;
+
+    unsigned char hdrBuf[HPCMETRICDB_FMT_SharedHeaderLen];
+    size_t hdrLen = hpcmetricDB_fmt_hdr_encode(&hdr, true, hdrBuf);
+
+    int ret = MPI_File_write_at(db->fh, db->dataEnd, &indexAll[0],
+				indexAll.size() - 1, MPI_BYTE,
+				MPI_STATUS_IGNORE);
+    if (ret == MPI_SUCCESS) {
+      ret = MPI_File_write_at(db->fh, 0, hdrBuf, hdrLen, MPI_BYTE,
+			      MPI_STATUS_IGNORE);
+    }
+    if (ret != MPI_SUCCESS) {
+      abortSharedMetricDB(db->fnm, ret);
+    }
+
+    delete[] idxLens;
+    delete[] idxDispls;
+  }
+
+  MPI_Type_free(&db->real8Ty);
+  MPI_File_close(&db->fh);
+  delete db;
+}
+
+
 //***************************************************************************
 
 static void
@@ -67,6 +67,7 @@
 using std::string;
 
 #include <vector>
+#include <set>
 
 //*************************** User Include Files ****************************
 
@@ -82,10 +83,12 @@ using std::string;
 #include <lib/analysis/CallPath-TorchView.hpp>
 #include <lib/analysis/advisor/GPUInstruction.hpp>
 #include <lib/analysis/CallPath.hpp>
+#include <lib/analysis/PhaseTimer.hpp>
 #include <lib/analysis/Util.hpp>
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/RealPathMgr.hpp>
+#include <lib/support/realpath.h>
 
 
 //*************************** Forward Declarations ***************************
@@ -146,8 +149,18 @@ realmain(int argc, char* const* argv)
   Args args;
   args.parse(argc, argv);
 
+  Analysis::PhaseTimer& timer = Analysis::PhaseTimer::singleton();
+  timer.start("total");
+
   RealPathMgr::singleton().searchPaths(args.searchPathStr());
 
+#ifdef ENABLE_OPENMP
+  Prof::CCT::Tree::numThreads(args.prof_numThreads);
+#else
+  DIAG_WMsgIf(args.prof_numThreads > 1,
+	      "--threads: built without OpenMP; using one thread");
+#endif
+
   Analysis::Util::NormalizeProfileArgs_t nArgs =
     Analysis::Util::normalizeProfileArgs(args.profileFiles);
 
@@ -161,14 +174,56 @@ realmain(int argc, char* const* argv)
     exit(-1);
   }
 
-  if (nArgs.paths->size() == 1 && !args.hpcprof_isMetricArg) {
+  Analysis::Util::StringVec* profileFiles = nArgs.paths;
+  Analysis::Util::UIntVec* groupMap =
+    (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
+
+  // With --update, start from the database's saved canonical CCT and
+  // read only the measurement files that it does not yet contain.
+  Prof::CallPath::Profile* prof = NULL;
+  Analysis::Util::StringVec stateFiles;
+  Analysis::Util::StringVec newFiles;
+  Analysis::Util::UIntVec newGroupMap;
+
+  if (args.db_update) {
+    args.makeDatabaseDir();
+    timer.start("read");
+    prof = Analysis::CallPath::readState(args.db_dir, stateFiles);
+    timer.stop("read");
+
+    std::set<string> stateFileSet(stateFiles.begin(), stateFiles.end());
+    for (uint i = 0; i < nArgs.paths->size(); ++i) {
+      const string& fnm = (*nArgs.paths)[i];
+      if (stateFileSet.find(RealPath(fnm.c_str())) == stateFileSet.end()) {
+	newFiles.push_back(fnm);
+	newGroupMap.push_back((*nArgs.groupMap)[i]);
+      }
+    }
+
+    if (newFiles.empty()) {
+      DIAG_Msg(1, "No new measurement files; database is up to date: "
+	       << args.db_dir);
+      nArgs.destroy();
+      delete prof;
+      return 0;
+    }
+
+    profileFiles = &newFiles;
+    if (groupMap) {
+      groupMap = &newGroupMap;
+    }
+  }
+
+  uint numProfiles = stateFiles.size() + profileFiles->size();
+
+  if (numProfiles == 1 && !args.hpcprof_isMetricArg) {
     args.prof_metrics = Analysis::Args::MetricFlg_Thread;
   }
 
   if (Analysis::Args::MetricFlg_isThread(args.prof_metrics)
-      && nArgs.paths->size() > 16
+      && numProfiles > 16
       && !args.hpcprof_forceMetrics) {
-    DIAG_Throw("You have requested thread-level metrics for " << nArgs.paths->size() << " profile files.  Because this may result in an unusable database, to continue you must use the --force-metric option.");
+    DIAG_Throw("You have requested thread-level metrics for " << numProfiles << " profile files.  Because this may result in an unusable database, to continue you must use the --force-metric option.");
   }
 
   // ------------------------------------------------------------
@@ -176,8 +231,6 @@ realmain(int argc, char* const* argv)
   // ------------------------------------------------------------
 
   int mergeTy = Prof::CallPath::Profile::Merge_MergeMetricByName;
-  Analysis::Util::UIntVec* groupMap =
-    (nArgs.groupMax > 1) ? nArgs.groupMap : NULL;
 
   uint rFlags = 0;
   if (Analysis::Args::MetricFlg_isSum(args.prof_metrics)) {
@@ -185,8 +238,15 @@ realmain(int argc, char* const* argv)
   }
   uint mrgFlags = (Prof::CCT::MrgFlg_NormalizeTraceFileY);
 
-  Prof::CallPath::Profile* prof =
-    Analysis::CallPath::read(*nArgs.paths, groupMap, mergeTy, rFlags, mrgFlags);
+  if (prof) {
+    Analysis::CallPath::merge(*prof, *profileFiles, groupMap,
+			      stateFiles.size(), mergeTy, rFlags, mrgFlags,
+			      args.prof_pruneThreshold);
+  }
+  else {
+    prof = Analysis::CallPath::read(*profileFiles, groupMap, mergeTy,
+				    rFlags, mrgFlags, args.prof_pruneThreshold);
+  }
 
   prof->disable_redundancy(args.remove_redundancy);
 
@@ -195,15 +255,29 @@ realmain(int argc, char* const* argv)
   // 0. Make empty Experiment database (ensure file system works)
   // -------------------------------------------------------
 
-  args.makeDatabaseDir();
+  if (!args.db_update) {
+    args.makeDatabaseDir();
+  }
+
+  // Save the canonical CCT before static structure is overlaid so a
+  // later --update can merge into it.
+  if (args.db_updatable) {
+    timer.start("write");
+    stateFiles.insert(stateFiles.end(),
+		      profileFiles->begin(), profileFiles->end());
+    Analysis::CallPath::writeState(*prof, stateFiles, args.db_dir);
+    timer.stop("write");
+  }
 
   // ------------------------------------------------------------
   // 1b. Add static structure to canonical CCT
   // ------------------------------------------------------------
 
+  timer.start("overlay");
+
   Prof::Struct::Tree* structure = new Prof::Struct::Tree("");
   if (!args.structureFiles.empty()) {
-    Analysis::CallPath::readStructure(structure, args);
+    Analysis::CallPath::readStructure(structure, args, prof->loadmap());
   }
   prof->structure(structure);
 
@@ -215,7 +289,8 @@ realmain(int argc, char* const* argv)
   // Analysis::CallPath::analyzeTorchViewMain(*prof, args.torchViewFiles);
 
   Analysis::CallPath::overlayStaticStructureMain(*prof, args.agent,
-						 args.doNormalizeTy, printProgress);
+						 args.doNormalizeTy, printProgress,
+						 args.lmCacheDir);
 
   Analysis::CallPath::analyzeTorchViewMain(*prof, args.torchViewFiles);           
 
@@ -227,6 +302,8 @@ realmain(int argc, char* const* argv)
 
   Analysis::CallPath::analyzeTorchMonitorMain(*prof, args.torchMonitorFiles);
 
+  timer.stop("overlay");
+
   // return 0;  // early stop JUST FOR """TORCH_VIEW"""
 
   // Do not transform CFG in this sanitizer
@@ -236,14 +313,17 @@ realmain(int argc, char* const* argv)
   // 2a. Create summary metrics for canonical CCT
   // -------------------------------------------------------
 
+  timer.start("metrics");
   if (Analysis::Args::MetricFlg_isSum(args.prof_metrics)) {
     makeMetrics(*prof, args, nArgs);
   }
+  timer.stop("metrics");
 
   // -------------------------------------------------------
   // 2b. Prune and normalize canonical CCT
   // -------------------------------------------------------
 
+  timer.start("prune");
   if (Analysis::Args::MetricFlg_isSum(args.prof_metrics)) {
     Analysis::CallPath::pruneBySummaryMetrics(*prof, NULL);
   }
@@ -256,6 +336,7 @@ realmain(int argc, char* const* argv)
   }
 
   prof->cct()->makeDensePreorderIds();
+  timer.stop("prune");
 
   // -------------------------------------------------------
   // 2c. Create thread-level metric DB
@@ -267,7 +348,9 @@ realmain(int argc, char* const* argv)
   //    INVARIANT: database dir already exists
   // ------------------------------------------------------------
 
+  timer.start("prune");
   Analysis::CallPath::pruneStructTree(*prof);
+  timer.stop("prune");
 
   if (args.title.empty()) {
     args.title = prof->name();
@@ -277,15 +360,24 @@ realmain(int argc, char* const* argv)
     prof->metricMgr()->zeroDBInfo();
   }
 
+  timer.start("write");
   Analysis::CallPath::makeDatabase(*prof, args);
+  timer.stop("write");
 
 
   // -------------------------------------------------------
   // Cleanup
   // -------------------------------------------------------
+  timer.start("cleanup");
   nArgs.destroy();
 
   delete prof;
+  timer.stop("cleanup");
+
+  timer.stop("total");
+  if (!args.out_phaseTimes.empty()) {
+    timer.write(args.out_phaseTimes);
+  }
 
   return 0;
 }
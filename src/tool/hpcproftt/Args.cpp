@@ -95,16 +95,23 @@ using std::string;
 static const char* version_info = HPCTOOLKIT_VERSION_STRING;
 
 static const char* usage_summary =
-"profile-file [profile-file]*\n";
+"profile-file [profile-file]*\n"
+"  or: hpcproftt --struct-bin <file> structure-file [structure-file]*\n";
 
 static const char* usage_details =
 		 "hpcproftt generates textual dumps of call path profiles\n"
 		 "recorded by hpcrun.  The profile list may contain one or\n"
 		 "more call path profiles.\n"
 		 "\n"
+		 "With --struct-bin, hpcproftt instead converts one or more\n"
+		 "XML structure files from hpcstruct into a single binary\n"
+		 "structure file, which hpcprof reads much faster.\n"
+		 "\n"
 		 "Options:\n"
 		 "  -V, --version        Print version information.\n"
-		 "  -h, --help           Print this help.\n";
+		 "  -h, --help           Print this help.\n"
+		 "  --struct-bin <file>  Convert structure files to binary\n"
+		 "                       format and write to <file>.\n";
 
 #define CLP CmdLineParser
 #define CLP_SEPARATOR "!!!"
@@ -116,6 +123,8 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
      NULL },
   { 'h', "help",            CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "struct-bin",      CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
+     NULL },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
 };
 
@@ -145,6 +154,8 @@ Args::Ctor()
   obj_showSourceCode = false;
   obj_procThreshold = 1;
 
+  struct_bin = "";
+
   Diagnostics_SetDiagnosticFilterLevel(1);
 
 
@@ -229,6 +240,10 @@ Args::parse(int argc, const char* const argv[])
       exit(1);
     }
 
+    if (parser.isOpt("struct-bin")) {
+      struct_bin = parser.getOptArg("struct-bin");
+    }
+
     // FIXME: sanity check that options correspond to mode
     
     // Check for required arguments
@@ -237,9 +252,11 @@ Args::parse(int argc, const char* const argv[])
       ARG_ERROR("Incorrect number of arguments!");
     }
 
-    profileFiles.resize(numArgs);
+    std::vector<std::string>& files =
+      (struct_bin.empty()) ? profileFiles : structureFiles;
+    files.resize(numArgs);
     for (uint i = 0; i < numArgs; ++i) {
-      profileFiles[i] = parser.getArg(i);
+      files[i] = parser.getArg(i);
     }
   }
   catch (const CmdLineParser::ParseError& x) {
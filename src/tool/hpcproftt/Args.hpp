@@ -142,6 +142,10 @@ public:
   bool obj_metricsAsPercents;
   bool obj_showSourceCode;
 
+  // Structure conversion: write the structure files given as arguments
+  // in binary form to this file (empty: no conversion)
+  std::string struct_bin;
+
 private:
   void Ctor();
   void setHPCHome(); 
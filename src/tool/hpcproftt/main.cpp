@@ -65,7 +65,13 @@ using std::string;
 #include <lib/analysis/Flat-ObjCorrelation.hpp>
 #include <lib/analysis/Raw.hpp>
 
+#include <lib/prof/Struct-Tree.hpp>
+#include <lib/prof/Struct-BinFmt.hpp>
+
+#include <lib/profxml/PGMReader.hpp>
+
 #include <lib/support/diagnostics.h>
+#include <lib/support/IOUtil.hpp>
 #include <lib/support/NaN.h>
 
 //************************ Forward Declarations ******************************
@@ -76,6 +82,9 @@ realmain(int argc, char* const* argv);
 static int
 main_rawData(const std::vector<string>& profileFiles);
 
+static int
+main_structBin(const Args& args);
+
 
 //****************************************************************************
 
@@ -122,6 +131,9 @@ static int
 realmain(int argc, char* const* argv) 
 {
   Args args(argc, argv);  // exits if error on command line
+  if (!args.struct_bin.empty()) {
+    return main_structBin(args);
+  }
   return main_rawData(args.profileFiles); 
 }
 
@@ -148,4 +160,21 @@ main_rawData(const std::vector<string>& profileFiles)
   return 0;
 }
 
+
+// Convert XML structure files to the binary structure format
+static int
+main_structBin(const Args& args)
+{
+  Prof::Struct::Tree structure("");
+
+  DocHandlerArgs docargs;
+  Prof::Struct::readStructure(structure, args.structureFiles,
+			      PGMDocHandler::Doc_STRUCT, docargs);
+
+  std::ostream* os = IOUtil::OpenOStream(args.struct_bin.c_str());
+  Prof::Struct::BinFmt::write(*os, structure);
+  IOUtil::CloseStream(os);
+  return 0;
+}
+
 //****************************************************************************
@@ -164,6 +164,10 @@ Options: Output files\n\
   -o <file>, --output <file>\n\
                        Write hpcstruct file to <file>.\n\
                        Use '--output=-' to write output to stdout.\n\
+  --format <fmt>       Write the structure file in format <fmt>: 'xml',\n\
+                       'binary', or 'both'.  The binary format is much\n\
+                       faster for hpcprof to read.  With 'both', the binary\n\
+                       file is written to '<file>.bin'. {xml}\n\
 \n\
 Options for Developers:\n\
   --jobs-struct <num>  Use <num> threads for the MakeStructure() phase only.\n\
@@ -198,6 +202,8 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
   // Output options
   { 'o', "output",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "format",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // General
   { 'v', "verbose",     CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL,
@@ -245,6 +251,8 @@ Args::Ctor()
   gpu_size = DEFAULT_GPU_SIZE;
   searchPathStr = ".";
   show_gaps = false;
+  write_xml = true;
+  write_binary = false;
   compute_gpu_cfg = false;
 }
 
@@ -396,6 +404,24 @@ Args::parse(int argc, const char* const argv[])
     if (parser.isOpt("output")) {
       out_filenm = parser.getOptArg("output");
     }
+    if (parser.isOpt("format")) {
+      const string & arg = parser.getOptArg("format");
+      if (arg == "xml") {
+	write_xml = true;
+	write_binary = false;
+      }
+      else if (arg == "binary") {
+	write_xml = false;
+	write_binary = true;
+      }
+      else if (arg == "both") {
+	write_xml = true;
+	write_binary = true;
+      }
+      else {
+	ARG_ERROR("format argument must be 'xml', 'binary' or 'both'.");
+      }
+    }
 
     // Check for required arguments
     if (parser.getNumArgs() != 1) {
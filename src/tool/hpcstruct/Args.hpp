@@ -124,6 +124,8 @@ public:
   bool prettyPrintOutput;         // default: true
   bool useBinutils;		  // default: false
   bool show_gaps;                 // default: false
+  bool write_xml;                 // default: true
+  bool write_binary;              // default: false
 
   // Parsed Data: arguments
   std::string in_filenm;
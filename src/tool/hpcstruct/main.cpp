@@ -284,11 +284,43 @@ realmain(int argc, char* argv[])
   // ------------------------------------------------------------
 
   const char* osnm = (args.out_filenm == "-") ? NULL : args.out_filenm.c_str();
-  std::ostream* outFile = IOUtil::OpenOStream(osnm);
-  char* outBuf = new char[HPCIO_RWBufferSz];
 
-  std::streambuf* os_buf = outFile->rdbuf();
-  os_buf->pubsetbuf(outBuf, HPCIO_RWBufferSz);
+  // with --format=both, the binary file is '<file>.bin'
+  std::string binName = "";
+  const char* binnm = NULL;
+  if (args.write_binary) {
+    if (args.write_xml) {
+      if (osnm == NULL) {
+	DIAG_EMsg("Cannot make binary structure file when hpcstruct file is stdout.");
+	exit(1);
+      }
+      binName = args.out_filenm + std::string(".bin");
+      binnm = binName.c_str();
+    }
+    else {
+      binnm = osnm;
+    }
+  }
+
+  std::ostream* outFile = NULL;
+  char* outBuf = NULL;
+  if (args.write_xml) {
+    outFile = IOUtil::OpenOStream(osnm);
+    outBuf = new char[HPCIO_RWBufferSz];
+
+    std::streambuf* os_buf = outFile->rdbuf();
+    os_buf->pubsetbuf(outBuf, HPCIO_RWBufferSz);
+  }
+
+  std::ostream* binFile = NULL;
+  char* binBuf = NULL;
+  if (args.write_binary) {
+    binFile = IOUtil::OpenOStream(binnm);
+    binBuf = new char[HPCIO_RWBufferSz];
+
+    std::streambuf* bin_buf = binFile->rdbuf();
+    bin_buf->pubsetbuf(binBuf, HPCIO_RWBufferSz);
+  }
 
   std::string gapsName = "";
   std::ostream* gapsFile = NULL;
@@ -310,12 +342,20 @@ realmain(int argc, char* argv[])
   }
 
   try {
-    BAnal::Struct::makeStructure(args.in_filenm, outFile, gapsFile, gapsName,
-			         args.searchPathStr, opts);
+    BAnal::Struct::makeStructure(args.in_filenm, outFile, binFile, gapsFile,
+				 gapsName, args.searchPathStr, opts);
   } catch (int n) {
-    IOUtil::CloseStream(outFile);
-    if (osnm) {
-      unlink(osnm);
+    if (outFile) {
+      IOUtil::CloseStream(outFile);
+      if (osnm) {
+	unlink(osnm);
+      }
+    }
+    if (binFile) {
+      IOUtil::CloseStream(binFile);
+      if (binnm) {
+	unlink(binnm);
+      }
     }
     if (gapsFile) {
       IOUtil::CloseStream(gapsFile);
@@ -324,8 +364,14 @@ realmain(int argc, char* argv[])
     exit(n);
   }
 
-  IOUtil::CloseStream(outFile);
-  delete[] outBuf;
+  if (outFile != NULL) {
+    IOUtil::CloseStream(outFile);
+    delete[] outBuf;
+  }
+  if (binFile != NULL) {
+    IOUtil::CloseStream(binFile);
+    delete[] binBuf;
+  }
 
   if (gapsFile != NULL) {
     IOUtil::CloseStream(gapsFile);
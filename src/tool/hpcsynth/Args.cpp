@@ -0,0 +1,346 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <cstdlib>
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/hpctoolkit-config.h>
+
+#include "Args.hpp"
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/StrUtil.hpp>
+#include <lib/support/Trace.hpp>
+
+//*************************** Forward Declarations **************************
+
+// Cf. DIAG_Die.
+#define ARG_ERROR(streamArgs)                                        \
+  { std::ostringstream WeIrDnAmE;                                    \
+    WeIrDnAmE << streamArgs /*<< std::ends*/;                        \
+    printError(std::cerr, WeIrDnAmE.str());                          \
+    exit(1); }
+
+//***************************************************************************
+
+static const char* version_info = HPCTOOLKIT_VERSION_STRING;
+
+static const char* usage_summary =
+"[options]\n";
+
+static const char* usage_details = "\
+Synthetic profile generator.  Writes a measurement directory of call path\n\
+profiles (.hpcrun) and, optionally, traces (.hpctrace) with the same file\n\
+formats and naming as hpcrun, for benchmarking hpcprof and hpcprof-mpi\n\
+(cf. hpcprof --phase-times and hpcprof-bench).\n\
+\n\
+Every thread's CCT has the same shape, a complete tree with <d> levels of\n\
+<f> children below the root, so that profiles merge as those of an SPMD\n\
+program do.  Raw metric values are attributed to leaves only.  Output is\n\
+a deterministic function of the options.\n\
+\n\
+Options:\n\
+  -o <dir>, --output <dir>\n\
+                       Write the measurement directory <dir>.\n\
+                       {hpctoolkit-synth-measurements}\n\
+  -p <n>, --ranks <n>  Generate <n> processes (MPI ranks). {1}\n\
+  -t <n>, --threads <n>\n\
+                       Generate <n> threads per process. {1}\n\
+  -d <n>, --depth <n>  CCT depth: frames below the root. {6}\n\
+  -f <n>, --fanout <n> Children per interior CCT node. {4}\n\
+  -m <n>, --metrics <n>\n\
+                       Number of raw metrics; integer and real valued\n\
+                       metrics alternate. {2}\n\
+  -s <x>, --sparsity <x>\n\
+                       Fraction in [0, 1] of leaf metric values that are\n\
+                       zero. {0.5}\n\
+  -l <n>, --load-modules <n>\n\
+                       Spread CCT frames over <n> load modules. {4}\n\
+  -T <n>, --trace <n>  Write <n> trace records per thread; 0 for no\n\
+                       traces. {0}\n\
+  --seed <n>           Seed the random number generator with <n>. {1}\n\
+  -V, --version        Print version information.\n\
+  -h, --help           Print this help.\n\
+  --debug [<n>]        Debug: use debug level <n>. {1}\n";
+
+
+
+#define CLP CmdLineParser
+
+// Note: Changing the option name requires changing the name in Parse()
+CmdLineParser::OptArgDesc Args::optArgs[] = {
+
+  // Options
+  { 'o', "output",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'p', "ranks",        CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 't', "threads",      CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'd', "depth",        CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'f', "fanout",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'm', "metrics",      CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 's', "sparsity",     CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'l', "load-modules", CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'T', "trace",        CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+  {  0 , "seed",         CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL, NULL },
+
+  { 'V', "version",      CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL, NULL },
+  { 'h', "help",         CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL, NULL },
+  {  0 , "debug",        CLP::ARG_OPT,  CLP::DUPOPT_CLOB, NULL, CLP::isOptArg_long }, // hidden
+  CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
+};
+
+#undef CLP
+
+
+//***************************************************************************
+// Args
+//***************************************************************************
+
+Args::Args()
+{
+  Ctor();
+}
+
+Args::Args(int argc, const char* const argv[])
+{
+  Ctor();
+  parse(argc, argv);
+}
+
+void
+Args::Ctor()
+{
+  outDir     = "hpctoolkit-synth-measurements";
+  numRanks   = 1;
+  numThreads = 1;
+  depth      = 6;
+  fanout     = 4;
+  numMetrics = 2;
+  sparsity   = 0.5;
+  numLMs     = 4;
+  traceLen   = 0;
+  seed       = 1;
+  debugLevel = 0;
+}
+
+
+Args::~Args()
+{
+}
+
+
+void
+Args::printVersion(std::ostream& os) const
+{
+  os << getCmd() << ": " << version_info << endl;
+}
+
+
+void
+Args::printUsage(std::ostream& os) const
+{
+  os << "Usage: " << getCmd() << " " << usage_summary << endl
+     << usage_details << endl;
+}
+
+
+void
+Args::printError(std::ostream& os, const char* msg) const
+{
+  os << getCmd() << ": " << msg << endl
+     << "Try '" << getCmd() << " --help' for more information." << endl;
+}
+
+void
+Args::printError(std::ostream& os, const std::string& msg) const
+{
+  printError(os, msg.c_str());
+}
+
+
+void
+Args::parse(int argc, const char* const argv[])
+{
+  try {
+
+    // -------------------------------------------------------
+    // Parse the command line
+    // -------------------------------------------------------
+    parser.parse(optArgs, argc, argv);
+    
+    // -------------------------------------------------------
+    // Sift through results, checking for semantic errors
+    // -------------------------------------------------------
+    
+    // Special options that should be checked first
+    trace = debugLevel = 0;
+    
+    if (parser.isOpt("debug")) {
+      trace = debugLevel = 1;
+      if (parser.isOptArg("debug")) {
+	const string& arg = parser.getOptArg("debug");
+	trace = debugLevel = (int)CmdLineParser::toLong(arg);
+      }
+    }
+    if (parser.isOpt("help")) {
+      printUsage(std::cerr);
+      exit(1);
+    }
+    if (parser.isOpt("version")) {
+      printVersion(std::cerr);
+      exit(1);
+    }
+    
+    // Check for other options
+    if (parser.isOpt("output")) {
+      outDir = parser.getOptArg("output");
+    }
+    if (parser.isOpt("ranks")) {
+      numRanks = parseArg_uint("ranks", 1);
+    }
+    if (parser.isOpt("threads")) {
+      numThreads = parseArg_uint("threads", 1);
+    }
+    if (parser.isOpt("depth")) {
+      depth = parseArg_uint("depth", 1);
+    }
+    if (parser.isOpt("fanout")) {
+      fanout = parseArg_uint("fanout", 1);
+    }
+    if (parser.isOpt("metrics")) {
+      numMetrics = parseArg_uint("metrics", 1);
+    }
+    if (parser.isOpt("sparsity")) {
+      const string& arg = parser.getOptArg("sparsity");
+      sparsity = StrUtil::toDbl(arg);
+      if ( !(0.0 <= sparsity && sparsity <= 1.0) ) {
+	ARG_ERROR("--sparsity must be in [0, 1]: " << arg);
+      }
+    }
+    if (parser.isOpt("load-modules")) {
+      numLMs = parseArg_uint("load-modules", 1);
+      if (numLMs >= UINT16_MAX) {
+	ARG_ERROR("--load-modules must be less than " << UINT16_MAX);
+      }
+    }
+    if (parser.isOpt("trace")) {
+      traceLen = parseArg_uint("trace", 0);
+    }
+    if (parser.isOpt("seed")) {
+      seed = parseArg_uint("seed", 0);
+    }
+
+    // Check for required arguments
+    if (parser.getNumArgs() != 0) {
+      ARG_ERROR("Incorrect number of arguments!");
+    }
+  }
+  catch (const CmdLineParser::ParseError& x) {
+    ARG_ERROR(x.what());
+  }
+  catch (const CmdLineParser::Exception& x) {
+    DIAG_EMsg(x.message());
+    exit(1);
+  }
+}
+
+
+uint
+Args::parseArg_uint(const char* opt, uint minVal)
+{
+  const string& arg = parser.getOptArg(opt);
+  long x = CmdLineParser::toLong(arg);
+  if (x < (long)minVal || x > (long)UINT32_MAX) {
+    ARG_ERROR("--" << opt << " must be at least " << minVal << ": " << arg);
+  }
+  return (uint)x;
+}
+
+
+void
+Args::dump(std::ostream& os) const
+{
+  os << "Args.cmd= " << getCmd() << endl;
+  os << "Args.debugLevel= " << debugLevel << endl;
+  os << "Args.outDir= " << outDir << endl;
+  os << "Args.numRanks= " << numRanks << endl;
+  os << "Args.numThreads= " << numThreads << endl;
+  os << "Args.depth= " << depth << endl;
+  os << "Args.fanout= " << fanout << endl;
+  os << "Args.numMetrics= " << numMetrics << endl;
+  os << "Args.sparsity= " << sparsity << endl;
+  os << "Args.numLMs= " << numLMs << endl;
+  os << "Args.traceLen= " << traceLen << endl;
+  os << "Args.seed= " << seed << endl;
+  os << "::trace " << ::trace << endl;
+}
+
+void
+Args::ddump() const
+{
+  dump(std::cerr);
+}
@@ -0,0 +1,464 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+#include <string>
+using std::string;
+
+#include <vector>
+#include <new>
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include "Args.hpp"
+
+#include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+#include <lib/support/diagnostics.h>
+#include <lib/support/FileUtil.hpp>
+#include <lib/support/StrUtil.hpp>
+
+#include <lib/support-lean/OSUtil.h>
+
+
+//*************************** Forward Declarations ***************************
+
+static int
+realmain(int argc, char* const* argv);
+
+
+//****************************************************************************
+
+int
+main(int argc, char* const* argv)
+{
+  int ret;
+
+  try {
+    ret = realmain(argc, argv);
+  }
+  catch (const Diagnostics::Exception& x) {
+    DIAG_EMsg(x.message());
+    exit(1);
+  }
+  catch (const std::bad_alloc& x) {
+    DIAG_EMsg("[std::bad_alloc] " << x.what());
+    exit(1);
+  }
+  catch (const std::exception& x) {
+    DIAG_EMsg("[std::exception] " << x.what());
+    exit(1);
+  }
+  catch (...) {
+    DIAG_EMsg("Unknown exception encountered!");
+    exit(2);
+  }
+
+  return ret;
+}
+
+
+//****************************************************************************
+// Synthetic CCT
+//****************************************************************************
+
+// A frame of the CCT shared by all threads.  Nodes are stored in
+// preorder; a node's hpcrun id is derived from its preorder index
+// (cf. nodeId()), so that every thread writes the same ids.
+struct SynthNode {
+  uint32_t parent;  // preorder index of parent (root: itself)
+  uint16_t lm_id;
+  uint64_t lm_ip;
+  bool     isLeaf;
+};
+
+static const uint64_t SynthHostId = 0x5e17e000;
+static const uint    SynthPidBase = 10000;
+
+// 2001-09-09 in nanoseconds since the epoch; trace times must be non-zero
+static const uint64_t SynthTraceTimeBeg = 1000000000ULL * 1000000000ULL;
+
+
+static inline uint64_t
+mix64(uint64_t x)
+{
+  // splitmix64 finalizer
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+
+// nodeId: Even ids for interior nodes; odd (retained, cf.
+// HPCRUN_FMT_RetainIdFlag) ids for leaves, which traces reference.
+// Id 0 is reserved.
+static inline uint32_t
+nodeId(const std::vector<SynthNode>& cct, uint32_t idx)
+{
+  uint32_t id = 2 * (idx + 1);
+  return (cct[idx].isLeaf) ? (id | HPCRUN_FMT_RetainIdFlag) : id;
+}
+
+
+static void
+makeCCT(std::vector<SynthNode>& cct, uint32_t parent, uint depth,
+	const Args& args)
+{
+  const SynthNode& p = cct[parent];
+  for (uint i = 0; i < args.fanout; ++i) {
+    // The frame is a function of the path from the root, so that equal
+    // paths of different threads merge, and distinct ones do not.
+    uint64_t h = mix64(p.lm_ip * args.fanout + i + 1);
+
+    SynthNode x;
+    x.parent = parent;
+    x.lm_id  = (uint16_t)(1 + (h % args.numLMs));
+    x.lm_ip  = 0x400000 + ((h >> 16) & 0xffffffffffULL) * 4;
+    x.isLeaf = (depth == args.depth);
+
+    uint32_t idx = cct.size();
+    cct.push_back(x);
+    if (!x.isLeaf) {
+      makeCCT(cct, idx, depth + 1, args);
+    }
+  }
+}
+
+
+static void
+makeCCT(std::vector<SynthNode>& cct, const Args& args)
+{
+  // size: 1 + f + f^2 + ... + f^d; ids must fit in a positive int32_t
+  uint64_t size = 1, width = 1;
+  for (uint d = 1; d <= args.depth; ++d) {
+    width *= args.fanout;
+    size += width;
+    if (size > (INT32_MAX / 2 - 1)) {
+      DIAG_Throw("CCT too large: " << args.fanout << "^" << args.depth);
+    }
+  }
+
+  cct.clear();
+  cct.reserve(size);
+
+  // primary synthetic root: <lm-id: NULL, lm-ip: NULL>
+  SynthNode root;
+  root.parent = 0;
+  root.lm_id  = HPCRUN_FMT_LMId_NULL;
+  root.lm_ip  = HPCRUN_FMT_LMIp_NULL;
+  root.isLeaf = false;
+  cct.push_back(root);
+
+  makeCCT(cct, 0, 1, args);
+}
+
+
+//****************************************************************************
+// Writers
+//****************************************************************************
+
+static string
+makeFileName(const Args& args, const char* exe, uint rank, uint tid,
+	     const char* sfx)
+{
+  // cf. hpcrun's file naming (files.c)
+  char fnm[PATH_MAX];
+  snprintf(fnm, sizeof(fnm), "%s/%s-%06u-%03u-" HOSTID_FORMAT "-%u-%d.%s",
+	   args.outDir.c_str(), exe, rank, tid, (unsigned long)SynthHostId,
+	   SynthPidBase + rank, 0, sfx);
+  return string(fnm);
+}
+
+
+static FILE*
+openFile(const string& fnm, char* buf)
+{
+  FILE* fs = hpcio_fopen_w(fnm.c_str(), 1);
+  if (!fs) {
+    DIAG_Throw("error opening file '" << fnm << "'");
+  }
+  setvbuf(fs, buf, _IOFBF, HPCIO_RWBufferSz);
+  return fs;
+}
+
+
+static void
+closeFile(FILE* fs, const string& fnm)
+{
+  if (ferror(fs) || hpcio_fclose(fs) != 0) {
+    DIAG_Throw("error writing file '" << fnm << "'");
+  }
+}
+
+
+// writeTrace: writes 'args.traceLen' records that sample random
+// leaves at increasing times; returns the first and last times.
+static void
+writeTrace(const string& fnm, char* buf,
+	   const std::vector<uint32_t>& leafIds, std::mt19937_64& rng,
+	   const Args& args, uint64_t& timeBeg, uint64_t& timeEnd)
+{
+  FILE* fs = openFile(fnm, buf);
+
+  hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
+  hpctrace_fmt_hdr_fwrite(flags, fs);
+
+  std::uniform_int_distribution<uint64_t> step(1000, 100000); // 1-100 us
+  std::uniform_int_distribution<size_t> leaf(0, leafIds.size() - 1);
+
+  uint64_t time = SynthTraceTimeBeg + step(rng);
+  timeBeg = time;
+  for (uint i = 0; i < args.traceLen; ++i) {
+    hpctrace_fmt_datum_t x;
+    x.comp = 0;
+    HPCTRACE_FMT_SET_TIME(x.comp, time);
+    x.cpId = leafIds[leaf(rng)];
+    x.metricId = 0;
+    hpctrace_fmt_datum_fwrite(&x, flags, fs);
+
+    timeEnd = time;
+    time += step(rng);
+  }
+
+  closeFile(fs, fnm);
+}
+
+
+static void
+writeProfile(const string& fnm, char* buf,
+	     const std::vector<SynthNode>& cct, std::mt19937_64& rng,
+	     const Args& args, uint rank, uint tid,
+	     uint64_t traceTimeBeg, uint64_t traceTimeEnd)
+{
+  FILE* fs = openFile(fnm, buf);
+
+  // ------------------------------------------------------------
+  // header
+  // ------------------------------------------------------------
+  string rankStr = StrUtil::toStr(rank);
+  string tidStr  = StrUtil::toStr(tid);
+  string pidStr  = StrUtil::toStr(SynthPidBase + rank);
+  string hostStr = StrUtil::toStr(SynthHostId, 16);
+  string timeBegStr = StrUtil::toStr(traceTimeBeg);
+  string timeEndStr = StrUtil::toStr(traceTimeEnd);
+
+  hpcrun_fmt_hdr_fwrite(fs,
+			HPCRUN_FMT_NV_prog, "synth",
+			HPCRUN_FMT_NV_progPath, "/synth/bin/synth",
+			HPCRUN_FMT_NV_envPath, "",
+			HPCRUN_FMT_NV_jobId, "",
+			HPCRUN_FMT_NV_mpiRank, rankStr.c_str(),
+			HPCRUN_FMT_NV_tid, tidStr.c_str(),
+			HPCRUN_FMT_NV_hostid, hostStr.c_str(),
+			HPCRUN_FMT_NV_pid, pidStr.c_str(),
+			HPCRUN_FMT_NV_traceMinTime, timeBegStr.c_str(),
+			HPCRUN_FMT_NV_traceMaxTime, timeEndStr.c_str(),
+			NULL);
+
+  // ------------------------------------------------------------
+  // epoch: header
+  // ------------------------------------------------------------
+  epoch_flags_t epochFlags;
+  epochFlags.bits = 0;
+
+  hpcrun_fmt_epochHdr_fwrite(fs, epochFlags, 1 /*granularity*/,
+			     "TODO:epoch-name", "TODO:epoch-value", NULL);
+
+  // ------------------------------------------------------------
+  // epoch: metric table
+  // ------------------------------------------------------------
+  std::vector<metric_desc_t> mdescs(args.numMetrics, metricDesc_NULL);
+  std::vector<string> mnames(args.numMetrics);
+
+  hpcfmt_int4_fwrite(args.numMetrics, fs);
+  for (uint i = 0; i < args.numMetrics; ++i) {
+    metric_desc_t& m = mdescs[i];
+    mnames[i] = "SYNTH." + StrUtil::toStr(i);
+    m.name = const_cast<char*>(mnames[i].c_str());
+    m.description = m.name;
+    m.flags = hpcrun_metricFlags_NULL;
+    m.flags.fields.ty = MetricFlags_Ty_Raw;
+    m.flags.fields.valFmt =
+      (i % 2 == 0) ? MetricFlags_ValFmt_Int : MetricFlags_ValFmt_Real;
+    m.flags.fields.show = true;
+    m.flags.fields.showPercent = true;
+    m.period = 1;
+
+    metric_aux_info_t aux;
+    memset(&aux, 0, sizeof(aux));
+    hpcrun_fmt_metricDesc_fwrite(&m, &aux, fs);
+  }
+
+  // ------------------------------------------------------------
+  // epoch: loadmap (LM 1 is the executable)
+  // ------------------------------------------------------------
+  hpcfmt_int4_fwrite(args.numLMs, fs);
+  for (uint i = 1; i <= args.numLMs; ++i) {
+    string nm = (i == 1) ? string("/synth/bin/synth")
+      : ("/synth/lib/libsynth-" + StrUtil::toStr(i - 1) + ".so");
+
+    loadmap_entry_t lm;
+    lm.id = (uint16_t)i;
+    lm.name = const_cast<char*>(nm.c_str());
+    lm.flags = 0;
+    hpcrun_fmt_loadmapEntry_fwrite(&lm, fs);
+  }
+
+  // ------------------------------------------------------------
+  // epoch: cct (preorder; leaves have negated ids)
+  // ------------------------------------------------------------
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::uniform_int_distribution<uint64_t> ival(1, 1000);
+
+  std::vector<hpcrun_metricVal_t> metrics(args.numMetrics);
+
+  hpcfmt_int8_fwrite(cct.size(), fs);
+  for (uint32_t idx = 0; idx < cct.size(); ++idx) {
+    const SynthNode& n = cct[idx];
+
+    hpcrun_fmt_cct_node_t x;
+    hpcrun_fmt_cct_node_init(&x);
+
+    uint32_t id = nodeId(cct, idx);
+    x.id = (n.isLeaf) ? (uint32_t)(- (int32_t)id) : id;
+    x.id_parent = (idx == 0) ? HPCRUN_FMT_CCTNodeId_NULL : nodeId(cct, n.parent);
+    x.lm_id = n.lm_id;
+    x.lm_ip = n.lm_ip;
+
+    for (uint i = 0; i < args.numMetrics; ++i) {
+      metrics[i] = hpcrun_metricVal_ZERO;
+      if (n.isLeaf && coin(rng) >= args.sparsity) {
+	if (mdescs[i].flags.fields.valFmt == MetricFlags_ValFmt_Int) {
+	  metrics[i].i = ival(rng);
+	}
+	else {
+	  metrics[i].r = coin(rng) * 1000.0;
+	}
+      }
+    }
+    x.num_metrics = args.numMetrics;
+    x.metrics = metrics.data();
+
+    hpcrun_fmt_cct_node_fwrite(&x, epochFlags, fs);
+  }
+
+  closeFile(fs, fnm);
+}
+
+
+//****************************************************************************
+
+static int
+realmain(int argc, char* const argv[])
+{
+  Args args(argc, argv);
+
+  std::vector<SynthNode> cct;
+  makeCCT(cct, args);
+
+  std::vector<uint32_t> leafIds;
+  for (uint32_t idx = 0; idx < cct.size(); ++idx) {
+    if (cct[idx].isLeaf) {
+      leafIds.push_back(nodeId(cct, idx));
+    }
+  }
+
+  DIAG_Msg(1, "Writing " << args.numRanks * args.numThreads
+	   << " profiles of " << cct.size() << " CCT nodes to '"
+	   << args.outDir << "'");
+
+  FileUtil::mkdir(args.outDir);
+
+  char* buf = new char[HPCIO_RWBufferSz];
+
+  for (uint rank = 0; rank < args.numRanks; ++rank) {
+    for (uint tid = 0; tid < args.numThreads; ++tid) {
+      // one stream per thread so output does not depend on file order
+      std::seed_seq seq{ args.seed, rank, tid };
+      std::mt19937_64 rng(seq);
+
+      uint64_t timeBeg = 0, timeEnd = 0;
+      if (args.traceLen > 0) {
+	string fnm = makeFileName(args, "synth", rank, tid,
+				  HPCRUN_TraceFnmSfx);
+	writeTrace(fnm, buf, leafIds, rng, args, timeBeg, timeEnd);
+      }
+
+      string fnm = makeFileName(args, "synth", rank, tid,
+				HPCRUN_ProfileFnmSfx);
+      writeProfile(fnm, buf, cct, rng, args, rank, tid, timeBeg, timeEnd);
+    }
+  }
+
+  delete[] buf;
+  return 0;
+}